@@ -0,0 +1,58 @@
+#pragma once
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/**
+ * Small helpers shared by the micro-benchmarks in bench/.
+ * They are plain executables (no framework) so they build everywhere the
+ * cache does; results are printed as a table on stdout.
+ */
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+/// Keeps a computed value alive so the optimizer can't drop the work.
+template <typename T>
+inline void keep(const T& value) {
+    static volatile size_t sink;
+    sink = sink + static_cast<size_t>(sizeof(value));
+    (void)value;
+}
+
+/// Runs f(i) for i in [0, ops) and returns the mean nanoseconds per call.
+template <typename F>
+double ns_per_op(size_t ops, F&& f) {
+    auto start = clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    return elapsed.count() / static_cast<double>(ops);
+}
+
+/// Seconds elapsed while running f().
+template <typename F>
+double seconds(F&& f) {
+    auto start = clock::now();
+    f();
+    std::chrono::duration<double> elapsed = clock::now() - start;
+    return elapsed.count();
+}
+
+/// Zero-padded key of the given length ending in the decimal value of i.
+inline std::string make_key(size_t i, size_t length) {
+    std::string digits = std::to_string(i);
+    if (digits.size() >= length) {
+        return digits;
+    }
+    return std::string(length - digits.size(), 'k') + digits;
+}
+
+} // namespace bench
+
+#endif // BENCH_UTIL_H
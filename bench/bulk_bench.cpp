@@ -0,0 +1,109 @@
+// Throughput of the bulk import and export paths behind POST /cache/_import
+// and GET /cache/_export, in records per second, without the HTTP layer.
+//
+// Import: an NDJSON body of `entries` records (1 in 10 with a TTL) is fed to
+// NdjsonImporter in 64 KiB pieces, as the content receiver hands it over,
+// and stored with Cache::multi_put; batch size 1 shows what storing record
+// by record costs. Export: the filled cache is walked with export_slice()
+// and written out as NDJSON, next to export_shard(), which copies a whole
+// shard under one lock hold. "longest" is the slowest single call, which
+// bounds how long a writer can be kept waiting for the shard.
+//
+// Usage: BulkBench [entries] [value bytes] [shards]  (defaults: 1000000 64 4)
+
+#include "ndjson.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+constexpr size_t kPieceBytes = 64 * 1024;
+
+void report(const char* name, size_t records, double seconds, double longest_s) {
+    std::printf("%-24s %10zu records %8.2f s %12.0f records/s", name, records, seconds,
+                static_cast<double>(records) / seconds);
+    if (longest_s > 0) {
+        std::printf("   longest %8.3f ms", longest_s * 1e3);
+    }
+    std::printf("\n");
+}
+
+double import_body(Cache& cache, const std::string& body, size_t batch, size_t& records) {
+    NdjsonImporter importer([&cache](const std::vector<CacheItem>& items) { cache.multi_put(items); }, batch);
+    const double s = bench::seconds([&] {
+        for (size_t pos = 0; pos < body.size(); pos += kPieceBytes) {
+            importer.feed(std::string_view(body).substr(pos, kPieceBytes));
+        }
+        importer.finish();
+    });
+    records = importer.records();
+    return s;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t value_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const size_t shards = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4;
+    const size_t capacity = entries + entries / 4;   // Nothing gets evicted
+
+    std::string body;
+    const std::string value(value_bytes, 'v');
+    for (size_t i = 0; i < entries; ++i) {
+        append_ndjson_record(body, bench::make_key(i, 16), value, i % 10 == 0 ? 3600 * 1000 : 0);
+    }
+    std::printf("body: %.1f MB\n", static_cast<double>(body.size()) / 1e6);
+
+    size_t records = 0;
+    {
+        Cache cache(capacity, 60000, shards);
+        report("import batch=1", entries, import_body(cache, body, 1, records), 0);
+    }
+    Cache cache(capacity, 60000, shards);
+    report("import batch=1024", records,
+           import_body(cache, body, NdjsonImporter::kDefaultBatch, records), 0);
+
+    // Export the way the endpoint does: one slice of 1024 slots per call, NDJSON in 64 KiB chunks
+    std::string chunk;
+    size_t exported = 0;
+    double longest = 0;
+    ExportCursor cursor;
+    const double slices_s = bench::seconds([&] {
+        while (!cursor.done) {
+            std::vector<CacheRecord> slice;
+            longest = std::max(longest, bench::seconds([&] { slice = cache.export_slice(cursor, 1024); }));
+            for (const CacheRecord& record : slice) {
+                append_ndjson_record(chunk, record.key, record.value.view(), record.ttl_ms);
+            }
+            exported += slice.size();
+            if (chunk.size() >= kPieceBytes) {
+                bench::keep(chunk.size());
+                chunk.clear();
+            }
+        }
+    });
+    report("export slices of 1024", exported, slices_s, longest);
+
+    exported = 0;
+    longest = 0;
+    const double shards_s = bench::seconds([&] {
+        for (size_t shard = 0; shard < cache.shard_count(); ++shard) {
+            std::vector<CacheRecord> all;
+            longest = std::max(longest, bench::seconds([&] { all = cache.export_shard(shard); }));
+            for (const CacheRecord& record : all) {
+                append_ndjson_record(chunk, record.key, record.value.view(), record.ttl_ms);
+                if (chunk.size() >= kPieceBytes) {
+                    bench::keep(chunk.size());
+                    chunk.clear();
+                }
+            }
+            exported += all.size();
+        }
+    });
+    report("export whole shards", exported, shards_s, longest);
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Latency of single-key calls under a mixed load (90% get, 10% put) from
+// several client threads, for the shared sharded cache (any thread touches
+// any shard under its lock) against the per-core engine (each key's shard is
+// owned by one pinned worker, requests travel through its queue).
+//
+// The per-core engine pays a queue hop and a wakeup on every call; what it
+// buys is shard data that stays in one core's caches and no lock contention,
+// which shows in the tail once clients outnumber cores.
+//
+// Usage: CoreEngineBench [ops-per-thread] [client-threads] [cores] [keys]
+
+#include "cache.h"
+#include "core_engine.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Latencies {
+    double mops;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+};
+
+template <typename Target>
+Latencies run(Target& target, const std::vector<std::string>& keys, size_t threads, size_t ops) {
+    std::vector<std::vector<double>> samples(threads);
+    std::vector<std::thread> clients;
+    double elapsed = bench::seconds([&] {
+        for (size_t t = 0; t < threads; ++t) {
+            clients.emplace_back([&, t] {
+                auto& mine = samples[t];
+                mine.reserve(ops);
+                size_t k = t * 7919;
+                for (size_t i = 0; i < ops; ++i) {
+                    k = (k + 40503) % keys.size();
+                    auto start = bench::clock::now();
+                    if (i % 10 == 0) {
+                        target.put(keys[k], "value");
+                    } else {
+                        bench::keep(target.get_ref(keys[k]));
+                    }
+                    std::chrono::duration<double, std::micro> took = bench::clock::now() - start;
+                    mine.push_back(took.count());
+                }
+            });
+        }
+        for (auto& c : clients) c.join();
+    });
+
+    std::vector<double> all;
+    all.reserve(threads * ops);
+    for (const auto& s : samples) all.insert(all.end(), s.begin(), s.end());
+    std::sort(all.begin(), all.end());
+    auto at = [&all](double q) { return all[std::min(all.size() - 1, static_cast<size_t>(q * all.size()))]; };
+    return {static_cast<double>(threads * ops) / elapsed / 1e6, at(0.50), at(0.99), at(0.999)};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : hw * 2;
+    size_t cores = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : hw;
+    size_t key_count = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 100000;
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < key_count; ++i) {
+        keys.push_back(bench::make_key(i, 16));
+    }
+
+    CacheOptions options;
+    options.capacity = key_count * 2;
+    options.shard_count = cores;   // Same number of independent shards either way
+
+    std::printf("%zu client threads, %zu cores, %zu keys, 90%% get / 10%% put\n", threads, cores, key_count);
+    std::printf("%-10s %10s %10s %10s %10s\n", "engine", "Mops/s", "p50 us", "p99 us", "p999 us");
+
+    auto print = [](const char* name, const Latencies& l) {
+        std::printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", name, l.mops, l.p50_us, l.p99_us, l.p999_us);
+    };
+    {
+        Cache cache(options);
+        for (const auto& key : keys) cache.put(key, "value");
+        print("shared", run(cache, keys, threads, ops));
+    }
+    {
+        CoreEngine engine(options, cores);
+        for (const auto& key : keys) engine.put(key, "value");
+        print("per-core", run(engine, keys, threads, ops));
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+// Compares the shard index (SwissIndex over intrusive nodes) against the
+// std::unordered_map<std::string, Entry> layout the cache started from:
+// hit and miss lookup latency in random order, and heap bytes per entry.
+// Each probe key depends on the previous result, so lookups cannot overlap
+// and the time per op is the latency of one lookup, not the throughput.
+//
+// Usage: IndexBench [ops] [sizes...]     (default sizes: 1000000 10000000)
+
+#include "swiss_index.h"
+#include "bench_util.h"
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Net live heap bytes, tracked through a size header on every allocation
+static std::atomic<size_t> g_live_bytes{0};
+
+namespace {
+constexpr size_t kHeader = alignof(std::max_align_t);
+}
+
+void* operator new(std::size_t size) {
+    void* raw = std::malloc(size + kHeader);
+    if (raw == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(raw) = size;
+    g_live_bytes.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<char*>(raw) + kHeader;
+}
+
+// GCC pairs the free() below with the operator new above once both are inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    void* raw = static_cast<char*>(p) - kHeader;
+    g_live_bytes.fetch_sub(*static_cast<size_t*>(raw), std::memory_order_relaxed);
+    std::free(raw);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+namespace {
+
+constexpr size_t kKeyLength = 16;
+
+// Payload the cache keeps per key besides the key itself (value, expiry, LRU links)
+struct Payload {
+    void* value = nullptr;
+    size_t value_size = 0;
+    int64_t expiry = 0;
+    void* lru_prev = nullptr;
+    void* lru_next = nullptr;
+};
+
+struct Node {
+    std::string key;
+    size_t hash;
+    Payload payload;
+
+    Node(std::string k, size_t h) : key(std::move(k)), hash(h) {}
+};
+
+struct Row {
+    double hit_ns;
+    double miss_ns;
+    double bytes_per_entry;
+};
+
+void print(const char* name, size_t keys, const Row& r) {
+    std::printf("%-10zu %-16s %10.1f %10.1f %14.1f\n", keys, name, r.hit_ns, r.miss_ns, r.bytes_per_entry);
+}
+
+// Random probe order so lookups are not served from a warm, sequential walk
+std::vector<uint32_t> probe_order(size_t keys, size_t ops) {
+    std::mt19937 rng(42);
+    std::vector<uint32_t> order(ops);
+    for (auto& i : order) {
+        i = static_cast<uint32_t>(rng() % keys);
+    }
+    return order;
+}
+
+Row run_unordered_map(const std::vector<std::string>& hits, const std::vector<std::string>& misses,
+                      const std::vector<uint32_t>& order) {
+    size_t before = g_live_bytes.load();
+    std::unordered_map<std::string, Payload> map;
+    for (const auto& key : hits) {
+        map.emplace(key, Payload{});
+    }
+    double bytes = static_cast<double>(g_live_bytes.load() - before) / static_cast<double>(hits.size());
+
+    size_t dep = 0;   // Always 0, but only known after the previous lookup
+    double hit_ns = bench::ns_per_op(order.size(), [&](size_t i) {
+        dep = map.find(hits[(order[i] + dep) % hits.size()]) == map.end();
+    });
+    double miss_ns = bench::ns_per_op(order.size(), [&](size_t i) {
+        dep = map.find(misses[(order[i] + dep) % misses.size()]) != map.end();
+    });
+    bench::keep(dep);
+    return {hit_ns, miss_ns, bytes};
+}
+
+Row run_swiss_index(const std::vector<std::string>& hits, const std::vector<std::string>& misses,
+                    const std::vector<uint32_t>& order) {
+    size_t before = g_live_bytes.load();
+    SwissIndex<Node, &Node::hash> index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    nodes.reserve(hits.size());
+    double bytes;
+    {
+        size_t owner_vector = g_live_bytes.load() - before;   // Bench bookkeeping, not index memory
+        for (const auto& key : hits) {
+            nodes.push_back(std::make_unique<Node>(key, std::hash<std::string_view>{}(key)));
+            index.insert(nodes.back().get());
+        }
+        bytes = static_cast<double>(g_live_bytes.load() - before - owner_vector) / static_cast<double>(hits.size());
+    }
+
+    auto lookup = [&index](const std::string& key) {
+        const size_t hash = std::hash<std::string_view>{}(key);
+        return index.find(hash, [&key, hash](const Node* n) { return n->hash == hash && n->key == key; });
+    };
+    size_t dep = 0;
+    double hit_ns = bench::ns_per_op(order.size(), [&](size_t i) {
+        dep = lookup(hits[(order[i] + dep) % hits.size()]) == nullptr;
+    });
+    double miss_ns = bench::ns_per_op(order.size(), [&](size_t i) {
+        dep = lookup(misses[(order[i] + dep) % misses.size()]) != nullptr;
+    });
+    bench::keep(dep);
+    return {hit_ns, miss_ns, bytes};
+}
+
+void run(size_t keys, size_t ops) {
+    std::vector<std::string> hits, misses;
+    hits.reserve(keys);
+    misses.reserve(keys);
+    for (size_t i = 0; i < keys; ++i) {
+        hits.push_back(bench::make_key(i, kKeyLength));
+        misses.push_back(bench::make_key(i + keys, kKeyLength));
+    }
+    auto order = probe_order(keys, ops);
+
+    print("unordered_map", keys, run_unordered_map(hits, misses, order));
+    print("SwissIndex", keys, run_swiss_index(hits, misses, order));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i) {
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = {1000000, 10000000};
+    }
+
+    std::printf("%-10s %-16s %10s %10s %14s\n", "keys", "index", "hit ns", "miss ns", "bytes/entry");
+    for (size_t keys : sizes) {
+        run(keys, ops);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Compares Cache lookups through std::string_view against the previous
+// calling convention, where every request first materialized a std::string
+// key (e.g. from a regex sub-match) before calling the cache.
+//
+// Usage: KeyLookupBench [keys] [ops]
+
+#include "cache.h"
+#include "bench_util.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Result {
+    double ns;
+    double allocs;
+};
+
+template <typename F>
+Result measure(size_t ops, F&& f) {
+    size_t before = g_allocations.load();
+    double ns = bench::ns_per_op(ops, f);
+    return {ns, static_cast<double>(g_allocations.load() - before) / static_cast<double>(ops)};
+}
+
+void run(size_t key_length, size_t keys, size_t ops) {
+    Cache cache(keys * 2);
+    // Request-buffer style storage: keys are only available as bytes
+    std::vector<std::string> hit_keys, miss_keys;
+    for (size_t i = 0; i < keys; ++i) {
+        hit_keys.push_back(bench::make_key(i, key_length));
+        miss_keys.push_back(bench::make_key(i + keys, key_length));
+        cache.put(hit_keys.back(), "v");
+    }
+
+    // Warm caches and the allocator before timing
+    for (const auto& key : hit_keys) {
+        bench::keep(cache.get(key));
+    }
+
+    auto view_hit = measure(ops, [&](size_t i) {
+        bench::keep(cache.get(std::string_view(hit_keys[i % keys])));
+    });
+    auto copy_hit = measure(ops, [&](size_t i) {
+        std::string key(hit_keys[i % keys].data(), hit_keys[i % keys].size());
+        bench::keep(cache.get(key));
+    });
+    auto view_miss = measure(ops, [&](size_t i) {
+        bench::keep(cache.get(std::string_view(miss_keys[i % keys])));
+    });
+    auto copy_miss = measure(ops, [&](size_t i) {
+        std::string key(miss_keys[i % keys].data(), miss_keys[i % keys].size());
+        bench::keep(cache.get(key));
+    });
+
+    auto row = [key_length](const char* name, const Result& r) {
+        std::printf("%-6zu %-22s %10.1f %12.2f\n", key_length, name, r.ns, r.allocs);
+    };
+    row("hit  string_view", view_hit);
+    row("hit  std::string copy", copy_hit);
+    row("miss string_view", view_miss);
+    row("miss std::string copy", copy_miss);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    std::printf("%-6s %-22s %10s %12s\n", "keylen", "lookup", "ns/op", "allocs/op");
+    for (size_t key_length : {8, 64, 256}) {
+        run(key_length, keys, ops);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Compares the CPU cost of PUT and GET through the REST API with JSON bodies
+// against application/octet-stream bodies, at 1 KB, 64 KB and 1 MB values.
+//
+// Server and client run in this process over loopback on one keep-alive
+// connection, and the figures are process CPU time per request. Each mode
+// pays for what a client of it has to do: JSON requests are encoded and
+// JSON responses parsed back to the value, raw ones are sent and used as
+// they are. The payload is text with an escaped character every 64 bytes,
+// so it is valid in both modes.
+//
+// Usage: RawValueBench [requests per size]
+
+#include "api.h"
+#include "bench_util.h"
+#include "logger.h"
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kPort = 5099;
+
+std::string make_payload(size_t size) {
+    std::string value(size, 'x');
+    for (size_t i = 0; i < size; ++i) {
+        value[i] = i % 64 == 63 ? '"' : static_cast<char>('a' + i % 26);
+    }
+    return value;
+}
+
+// Process CPU microseconds per call of f, over `requests` calls
+template <typename F>
+double cpu_us_per_request(size_t requests, F&& f) {
+    const std::clock_t start = std::clock();
+    for (size_t i = 0; i < requests; ++i) {
+        f();
+    }
+    return 1e6 * static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC / static_cast<double>(requests);
+}
+
+void run(httplib::Client& cli, size_t size, size_t requests) {
+    const std::string value = make_payload(size);
+
+    const double json_put = cpu_us_per_request(requests, [&] {
+        auto res = cli.Put("/cache/bench", json{{"value", value}, {"ttl", 0}}.dump(), "application/json");
+        bench::keep(res->status);
+    });
+    const double json_get = cpu_us_per_request(requests, [&] {
+        auto res = cli.Get("/cache/bench");
+        bench::keep(json::parse(res->body)["value"].get_ref<const std::string&>().size());
+    });
+    const double raw_put = cpu_us_per_request(requests, [&] {
+        auto res = cli.Put("/cache/bench", value, "application/octet-stream");
+        bench::keep(res->status);
+    });
+    const double raw_get = cpu_us_per_request(requests, [&] {
+        auto res = cli.Get("/cache/bench", {{"Accept", "application/octet-stream"}});
+        bench::keep(res->body.size());
+    });
+
+    std::printf("%-8zu %-7s %12.1f %12.1f\n", size, "json", json_put, json_get);
+    std::printf("%-8zu %-7s %12.1f %12.1f\n", size, "raw", raw_put, raw_get);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+
+    Logger::global().set_access_sampling(0);   // Keep the access log out of the figures
+    CacheAPI api(std::make_shared<Cache>(16));
+    std::thread server([&api] { api.start("127.0.0.1", kPort); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    httplib::Client cli("127.0.0.1", kPort);
+    cli.set_keep_alive(true);
+
+    std::printf("%-8s %-7s %12s %12s\n", "bytes", "mode", "PUT cpu us", "GET cpu us");
+    for (size_t size : {size_t{1024}, size_t{64 * 1024}, size_t{1024 * 1024}}) {
+        run(cli, size, size >= 1024 * 1024 ? requests / 10 + 1 : requests);
+    }
+
+    api.stop();
+    server.join();
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Read throughput of a 99%-read workload as threads are added, for the
+// shard-locked cache (LRU with an exclusive lock, CLOCK with a shared one)
+// against CLOCK with lock-free reads (epoch-pinned, no shard lock). Keys are
+// spread over few shards on purpose, so readers of a shard actually meet;
+// "lru/1-shard" puts every key behind a single lock, for comparison with
+// the striped "lru".
+//
+// Usage: ReadScalingBench [ops-per-thread] [max-threads] [keys]
+
+#include "cache.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kShards = 4;
+
+CacheOptions options_for(EvictionPolicy eviction, bool lock_free, size_t keys, size_t shards = kShards) {
+    CacheOptions options;
+    options.capacity = keys * 2;
+    options.shard_count = shards;
+    options.eviction = eviction;
+    options.lock_free_reads = lock_free;
+    return options;
+}
+
+// Million ops/s over all threads; one op in 100 is a put
+double run(Cache& cache, const std::vector<std::string>& keys, size_t threads, size_t ops) {
+    std::vector<std::thread> workers;
+    double elapsed = bench::seconds([&] {
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                size_t k = t * 7919;
+                for (size_t i = 0; i < ops; ++i) {
+                    k = (k + 40503) % keys.size();
+                    if (i % 100 == 0) {
+                        cache.put(keys[k], "value");
+                    } else {
+                        bench::keep(cache.get(keys[k]));
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    });
+    return static_cast<double>(threads * ops) / elapsed / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                                  : std::max(1u, std::thread::hardware_concurrency());
+    size_t key_count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000;
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < key_count; ++i) {
+        keys.push_back(bench::make_key(i, 16));
+    }
+
+    struct Variant {
+        const char* name;
+        CacheOptions options;
+    };
+    const Variant variants[] = {
+        {"lru/1-shard", options_for(EvictionPolicy::LRU, false, key_count, 1)},
+        {"lru", options_for(EvictionPolicy::LRU, false, key_count)},
+        {"clock", options_for(EvictionPolicy::CLOCK, false, key_count)},
+        {"clock+lock-free", options_for(EvictionPolicy::CLOCK, true, key_count)},
+    };
+
+    std::printf("%-8s %-16s %12s %10s\n", "threads", "cache", "Mops/s", "speedup");
+    constexpr size_t kVariants = sizeof(variants) / sizeof(variants[0]);
+    double base[kVariants] = {};
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        for (size_t v = 0; v < kVariants; ++v) {
+            Cache cache(variants[v].options);
+            for (const auto& key : keys) {
+                cache.put(key, "value");
+            }
+            double mops = run(cache, keys, threads, ops);
+            if (threads == 1) {
+                base[v] = mops;
+            }
+            std::printf("%-8zu %-16s %12.2f %9.2fx\n", threads, variants[v].name, mops, mops / base[v]);
+        }
+    }
+    return 0;
+}
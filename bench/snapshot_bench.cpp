@@ -0,0 +1,52 @@
+// Time to write and to load a cache snapshot: the warm-restart cost.
+// The cache is filled with `entries` keys (1 in 10 with a TTL), saved, and
+// then loaded into an empty cache the way DistributedCachePP does at startup.
+//
+// Usage: SnapshotBench [entries] [value bytes] [shards] [path]
+//        (defaults: 10000000 32 16 snapshot_bench.snap)
+
+#include "snapshot.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    const size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const size_t value_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32;
+    const size_t shards = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16;
+    const std::string path = argc > 4 ? argv[4] : "snapshot_bench.snap";
+
+    // Headroom so uneven shard fill does not evict anything
+    const size_t capacity = entries + entries / 4;
+    size_t file_bytes = 0;
+    size_t saved = 0;
+    double save_s = 0;
+    {
+        Cache source(capacity, 60000, shards);
+        const std::string value(value_bytes, 'v');
+        double fill_s = bench::seconds([&] {
+            for (size_t i = 0; i < entries; ++i) {
+                source.put(bench::make_key(i, 16), value, i % 10 == 0 ? 3600 * 1000 : 0);
+            }
+        });
+        std::printf("fill     %10zu entries  %8.2f s\n", source.size(), fill_s);
+
+        save_s = bench::seconds([&] { saved = save_snapshot(source, path); });
+        if (std::FILE* f = std::fopen(path.c_str(), "rb")) {
+            std::fseek(f, 0, SEEK_END);
+            file_bytes = static_cast<size_t>(std::ftell(f));
+            std::fclose(f);
+        }
+    }
+    std::printf("save     %10zu bytes    %8.2f s  %8.1f MB/s\n", file_bytes, save_s, file_bytes / save_s / 1e6);
+
+    Cache target(capacity, 60000, shards);
+    SnapshotLoadResult loaded;
+    double load_s = bench::seconds([&] { loaded = load_snapshot(target, path); });
+    std::printf("load     %10zu entries  %8.2f s  %8.2f M entries/s\n", loaded.loaded, load_s,
+                loaded.loaded / load_s / 1e6);
+
+    std::remove(path.c_str());
+    return loaded.loaded == saved ? 0 : 1;
+}
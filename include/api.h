@@ -3,21 +3,71 @@
 #define API_H
 
 #include "cache.h"
+#include "core_engine.h"
 #include "replication.h"
+#include "metrics.h"
+#include "oplog.h"
+#include "rate_limiter.h"
+#include "worker_pool.h"
 #include "httplib.h"
 #include <memory>
 #include <string>
 
 /**
- * REST API wrapper around Cache
+ * How the HTTP server takes on work (see CacheAPI::set_server_options)
+ */
+struct ServerOptions {
+    size_t threads = 0;               ///< Connection workers (0 = max(8, cores - 1), like httplib)
+    size_t max_queued = 0;            ///< Connections waiting for a worker at most; more are closed (0 = unbounded)
+    uint64_t queue_budget_ms = 0;     ///< Answer 503 to a request whose connection waited longer (0 = never)
+    size_t keep_alive_max = 5;        ///< Requests served on one connection at most
+    time_t keep_alive_timeout_s = 5;  ///< Idle seconds before a keep-alive connection is closed
+    double rate_limit = 0;            ///< Requests per second per client address (0 = unlimited)
+    double rate_limit_burst = 0;      ///< Requests a client may make at once (0 = rate_limit)
+};
+
+/**
+ * REST API wrapper around Cache, or around the per-core engine
  */
 class CacheAPI {
 public:
     /**
      * Constructor
      * @param cache Shared pointer to Cache instance
+     * @param repl Followers to replicate writes to, if this node leads
+     * @param oplog If set, writes go through it (and so are logged) instead of straight to the cache
+     */
+    explicit CacheAPI(std::shared_ptr<Cache> cache, ReplicationManager* repl = nullptr, OpLog* oplog = nullptr);
+
+    /**
+     * Constructor for the shared-nothing mode: every request is routed to the core owning its key
+     * @param engine Shared pointer to the per-core engine
+     * @param repl Followers to replicate writes to, if this node leads
+     */
+    explicit CacheAPI(std::shared_ptr<CoreEngine> engine, ReplicationManager* repl = nullptr);
+
+    /**
+     * Read-through mode: a GET that misses fetches GET <origin_url>/<key>
+     * (key percent-encoded) from the origin, stores the value with the
+     * given TTL and serves it (see Cache::get_or_load). The origin answers
+     * 200 with the raw value as body, or 404 if the key does not exist.
+     * Call before start().
+     * @param origin_url Origin base URL, e.g. "http://db-proxy:8080/values"
+     * @param ttl_ms     Time-to-live of loaded values in ms (0 = no expiry)
+     * @throws std::logic_error in per-core mode
+     */
+    void set_origin(const std::string& origin_url, uint64_t ttl_ms);
+
+    /**
+     * Configure the worker pool, keep-alive limits, load shedding and rate
+     * limits. Accepted connections queue for a worker; once max_queued are
+     * waiting, new ones are closed right away. A request whose connection
+     * waited longer than queue_budget_ms is answered 503 with Retry-After
+     * without being handled, and a client over its rate gets 429.
+     * /metrics, /healthz and /debug/hot_keys are exempt from both.
+     * Call before start().
      */
-    explicit CacheAPI(std::shared_ptr<Cache> cache, ReplicationManager* repl = nullptr);
+    void set_server_options(const ServerOptions& options);
 
     /**
      * Start the HTTP server
@@ -32,12 +82,55 @@ public:
     void stop();
 private:
     /**
-     * Log an incoming request with method, path, and status code
+     * Log an incoming request with method, path, and status code (an access line, see Logger::access)
      */
-    void logRequest(const std::string& method, const std::string& path, int status);
-    std::shared_ptr<Cache> cache_;
+    void logRequest(const char* method, const std::string& path, int status);
+
+    /**
+     * Wrap a route handler so it is timed into cache_request_duration_seconds,
+     * counted as in flight while it runs, and logged. With admit, the request
+     * goes through admit() first.
+     */
+    httplib::Server::Handler instrument(const char* method, const char* route, httplib::Server::Handler handler,
+                                        bool admit = true);
+
+    /// instrument() for a handler that streams the request body.
+    httplib::Server::HandlerWithContentReader instrument(const char* method, const char* route,
+                                                         httplib::Server::HandlerWithContentReader handler);
+
+    /// Latency series of one route in cache_request_duration_seconds.
+    Histogram& request_latency(const char* method, const char* route);
+
+    /// What an instrumented handler does around one request; `handle` runs the route's handler.
+    template <typename Handle>
+    void handle_instrumented(const char* method, Histogram& latency, bool admit, const httplib::Request& req,
+                             httplib::Response& res, Handle&& handle);
+
+    /**
+     * Store a batch of writes (through the oplog if set) and replicate it,
+     * as NDJSON when `raw` (keys and values not known to be valid UTF-8).
+     */
+    void put_batch(const std::vector<CacheItem>& items, bool raw = false);
+
+    /**
+     * Load shedding and rate limiting: answer 503 or 429 and return false if
+     * the request should not be handled.
+     * @param waited Time the request's connection queued for a worker
+     */
+    bool admit(const httplib::Request& req, httplib::Response& res, WorkerPool::Clock::duration waited);
+
+    std::shared_ptr<Cache> cache_;      ///< Null in per-core mode
+    std::shared_ptr<CoreEngine> engine_;  ///< Set in per-core mode only
+    Cache::Loader origin_;          ///< Fetches misses from the origin (empty = no read-through)
+    uint64_t origin_ttl_ms_ = 0;    ///< TTL of values loaded from the origin
     httplib::Server server_;
     ReplicationManager* replication_;
+    OpLog* oplog_;
+    MetricsRegistry metrics_;       ///< Everything GET /metrics renders
+    Gauge& in_flight_;              ///< Requests being handled, owned by metrics_
+    Counter& shed_;                 ///< Requests answered 503 for waiting too long, owned by metrics_
+    ServerOptions options_;
+    std::unique_ptr<RateLimiter> rate_limiter_;  ///< Null without a rate limit
 };
 
 #endif // API_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Helpers shared by the on-disk formats (snapshots, operation log).
+ */
+
+/// Store `value` little-endian in sizeof(T) bytes.
+template <typename T>
+inline void put_le(char* out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8 * i));
+    }
+}
+
+/// Read a little-endian T from sizeof(T) bytes.
+template <typename T>
+inline T get_le(const char* in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return static_cast<T>(value);
+}
+
+/// Milliseconds since the Unix epoch; on-disk times survive restarts, steady_clock does not.
+int64_t wall_clock_ms();
+
+/**
+ * Read-only view of a whole file: mmap'ed where available, read into
+ * memory otherwise.
+ */
+class MappedFile {
+public:
+    /// @throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
+
+#endif // BINARY_IO_H
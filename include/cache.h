@@ -3,8 +3,7 @@
 #define CACHE_H
 
 #include <string>
-#include <unordered_map>
-#include <list>
+#include <string_view>
 #include <chrono>
 #include <optional>
 #include <mutex>
@@ -12,40 +11,216 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <memory>
+#include <type_traits>
+#include <functional>
+#include <cstring>
+#include <new>
+#include "timer_wheel.h"
+#include "swiss_index.h"
+#include "rcu_index.h"
+#include "eviction_policy.h"
+#include "slab_allocator.h"
+#include "value_ref.h"
+#include "frequency_sketch.h"
+#include "hot_keys.h"
+#include "single_flight.h"
+#include "metrics.h"
+
+/**
+ * Replacement policy used when a shard is over capacity.
+ */
+enum class EvictionPolicy {
+    LRU,    ///< Exact LRU: every hit relinks the entry, so get() takes the shard lock exclusively
+    CLOCK   ///< Approximate LRU: hits only set an atomic reference bit, so get() takes a shared lock
+};
+
+/**
+ * Filter deciding whether a new key may displace an existing one.
+ */
+enum class AdmissionPolicy {
+    NONE,     ///< Every new key is admitted and the policy's victim is evicted
+    TINY_LFU  ///< W-TinyLFU: a new key replaces the LRU victim only if it was seen more often
+};
+
+/**
+ * Construction options for BasicCache. Fields not set keep the defaults used by
+ * the positional constructor.
+ */
+struct CacheOptions {
+    size_t capacity = 0;                           ///< Maximum number of items in the cache
+    size_t capacity_bytes = 0;                     ///< Memory budget in bytes; when non-zero it bounds
+                                                   ///< the cache instead of `capacity`
+    uint64_t eviction_interval_ms = 100;           ///< Interval (ms) for background async eviction
+    size_t shard_count = 1;                        ///< Number of independent lock stripes
+    EvictionPolicy eviction = EvictionPolicy::LRU; ///< Replacement policy (LruPolicy caches only)
+    AdmissionPolicy admission = AdmissionPolicy::NONE; ///< Admission filter (TINY_LFU requires LRU)
+    size_t compress_threshold = 0;                 ///< Values of at least this many bytes are stored
+                                                   ///< LZ4-compressed when that pays off (0 = never)
+    bool lock_free_reads = false;                  ///< Experimental: lookups take no shard lock at all
+                                                   ///< (epoch-based reclamation); requires CLOCK
+    size_t hot_keys = 0;                           ///< Detect up to this many hot keys and serve them from
+                                                   ///< per-thread near caches (0 = off)
+    bool background_expiry = true;                 ///< Refresh the coarse clock and sweep expired keys on a
+                                                   ///< thread of the cache's own; when false the owner
+                                                   ///< calls maintain() instead
+};
+
+/**
+ * Value compression counters (Cache::compression_stats), cumulative since start.
+ */
+struct CompressionStats {
+    uint64_t compressed = 0;       ///< Values stored compressed
+    uint64_t incompressible = 0;   ///< Values over the threshold stored raw because they barely shrank
+    uint64_t raw_bytes = 0;        ///< Original size of the values stored compressed
+    uint64_t stored_bytes = 0;     ///< Their compressed size
+    uint64_t compress_ns = 0;      ///< Time spent compressing, incompressible values included
+    uint64_t decompressions = 0;   ///< Compressed values read back
+    uint64_t decompress_ns = 0;    ///< Time spent decompressing them
+};
+
+/**
+ * One key-value pair of a batched write (Cache::multi_put). The views must
+ * stay valid for the duration of the call.
+ */
+struct CacheItem {
+    std::string_view key;    ///< Key bytes
+    std::string_view value;  ///< Value bytes
+    uint64_t ttl_ms = 0;     ///< Time-to-live in ms (0 = no expiry)
+};
+
+/**
+ * One live entry as exported for persistence (Cache::export_shard). The
+ * value is shared with the cache, not copied.
+ */
+struct CacheRecord {
+    std::string key;         ///< Key bytes
+    ValueRef value;          ///< Value block
+    uint64_t ttl_ms = 0;     ///< Remaining time-to-live in ms (0 = no expiry)
+};
+
+/**
+ * Position of a Cache::export_slice() walk. Start from a default-constructed
+ * cursor and call again until `done`.
+ */
+struct ExportCursor {
+    size_t shard = 0;        ///< Shard being walked
+    size_t scan = 0;         ///< Index scan cursor in it (see SwissIndex::scan)
+    bool done = false;       ///< Every shard has been walked
+};
+
+/**
+ * Shard "lock" of a cache that only its owning thread ever touches, such
+ * as a CoreEngine core's private cache: every lock call compiles away.
+ */
+struct NoLock {
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+    void lock_shared() {}
+    bool try_lock_shared() { return true; }
+    void unlock_shared() {}
+};
 
 /**
  * Thread-safe Cache with:
- * - LRU eviction (Least Recently Used)
+ * - Eviction policy chosen at compile time (see eviction_policy.h): the
+ *   built-in LRU lists, LFU, FIFO, ARC or S3-FIFO; `Cache` is the LRU
+ *   instantiation
+ * - LRU eviction (Least Recently Used), or CLOCK for read-mostly workloads
+ * - Optional W-TinyLFU admission in front of LRU: a 1% window LRU, a
+ *   count-min frequency sketch with aging and a segmented (probation /
+ *   protected) main region, so one-off scans cannot flush the working set
+ * - Intrusive entries: key bytes, expiry, hash and LRU links live in one
+ *   allocation (the key trails the node), the value in an arena block;
+ *   hits relink pointers and never allocate
+ * - Swiss-table style index: open addressing with 7-bit hash fragments in
+ *   control bytes, probed 16 at a time with SSE2
+ * - Zero-copy reads: values are immutable reference-counted slab blocks, so
+ *   get_ref() holds the shard lock only to bump a reference count
  * - TTL expiration (per key, in ms)
- * - Async background eviction (thread removes expired keys periodically)
+ * - Async background eviction: TTL entries are indexed in a hierarchical
+ *   timing wheel, so each sweep only touches entries that are due, in
+ *   bounded batches per lock hold
+ * - Coarse cached clock refreshed by the background thread, so get/put do
+ *   not read steady_clock on every operation. A cache that is only ever
+ *   used by one thread can drop that thread (background_expiry = false)
+ *   and have its owner call maintain() between operations
  * - O(1) average complexity for get/put
- * - Basic metrics: cache hits & misses
+ * - Batched multi_get / multi_put / multi_erase taking each shard lock once
+ * - Metrics: hits, misses, evictions, expirations and admission rejections,
+ *   in per-thread cache-line padded counter slots summed on read
+ * - Optional memory-bounded mode: capacity in bytes, accounted per entry as
+ *   key + value chunk + node overhead; values live in per-shard slab arenas
+ * - Optional lock striping: keys are partitioned by hash into independent
+ *   shards, each with its own map, LRU list, lock and capacity slice
+ * - Optional LZ4 compression of large values: compressed before the shard
+ *   lock is taken and decompressed after it is released; values that do not
+ *   shrink enough are stored raw
+ * - Experimental lock-free reads (CLOCK only): lookups probe an RCU-style
+ *   index under an epoch pin instead of the shard lock, so a read writes no
+ *   shared cache line; writers still serialize on the shard lock, replace
+ *   entries instead of updating them in place and retire what they unlink
+ * - Optional hot-key near caches: sampled reads feed a top-K sketch, and
+ *   get / get_ref of the keys it finds hot are served from a private copy
+ *   in the calling thread, invalidated by version stamp on every change
+ * - Read-through loading (get_or_load): concurrent misses of a key share
+ *   one loader call, and entries are reloaded shortly before they expire
+ *   (XFetch), with a probability that grows as the expiry nears
+ *
+ * CLOCK, TinyLFU admission and lock-free reads are options of the LRU
+ * policy; the other policies bring their own replacement and reject them.
+ *
+ * @tparam Policy      Eviction policy, e.g. LruPolicy or S3FifoPolicy
+ * @tparam SharedMutex Shard lock; NoLock for a cache that one thread owns
  */
-class Cache {
+template <typename Policy, typename SharedMutex = std::shared_mutex>
+class BasicCache {
+    /// SFINAE guard for the std::string-only convenience overloads below.
+    template <typename K>
+    using StringOnly = std::enable_if_t<!std::is_convertible_v<const K&, std::string_view> &&
+                                        std::is_convertible_v<const K&, std::string>>;
+
 public:
     using clock = std::chrono::steady_clock;
 
+    /// Fetches a missing key from the backing store: its value, or nullopt if the key does not exist there.
+    using Loader = std::function<std::optional<std::string>(std::string_view key)>;
+
     /**
      * Constructor
      * @param capacity             Maximum number of items in the cache
      * @param eviction_interval_ms Interval (ms) for background async eviction
+     * @param shard_count          Number of independent lock stripes (1 = exact global LRU).
+     *                             Clamped so that every shard owns at least one slot.
+     */
+    explicit BasicCache(size_t capacity, uint64_t eviction_interval_ms = 100, size_t shard_count = 1);
+
+    /**
+     * Constructor taking the full set of options.
+     * @throws std::invalid_argument if TINY_LFU admission is combined with CLOCK eviction,
+     *         or lock-free reads with anything but CLOCK, or any of them with a policy
+     *         other than LruPolicy
      */
-    explicit Cache(size_t capacity, uint64_t eviction_interval_ms = 100);
+    explicit BasicCache(const CacheOptions& options);
 
     /**
      * Destructor - stops background eviction thread.
      */
-    virtual ~Cache();
+    virtual ~BasicCache();
 
     // ---------------- Public API ----------------
+    // Keys are taken as std::string_view: lookups hash and compare the
+    // caller's bytes in place, and the only key copy is the one stored on insert.
 
     /**
      * Insert or update a key-value pair with optional TTL.
      * @param key       Key string
      * @param value     Value string
      * @param ttl_ms    Time-to-live in ms (0 = no expiry)
+     * @param flags     Opaque client flags kept with the value (see ValueRef::flags())
      */
-    void put(const std::string& key, const std::string& value, uint64_t ttl_ms = 0);
+    void put(std::string_view key, std::string_view value, uint64_t ttl_ms = 0, uint32_t flags = 0);
 
     /**
      * Get value if present and not expired.
@@ -53,14 +228,133 @@ public:
      * @param key Key to fetch
      * @return std::optional containing value if hit, empty if miss
      */
-    std::optional<std::string> get(const std::string& key);
+    std::optional<std::string> get(std::string_view key);
+
+    /**
+     * Get a shared handle to the value if present and not expired, without
+     * copying it. The shard lock is held only to bump the value's reference
+     * count; the bytes stay valid and unchanged for as long as the handle
+     * lives, even if the key is overwritten or evicted meanwhile.
+     * A compressed value is decompressed into a handle of its own, after
+     * the lock is released. Increments hit/miss counters like get().
+     * @param key Key to fetch
+     * @return handle to the value if hit, empty if miss
+     */
+    std::optional<ValueRef> get_ref(std::string_view key);
+
+    /**
+     * get_ref(), loading the value on a miss and storing it with the given
+     * TTL. Concurrent misses of one key share a single loader call: the
+     * first caller runs it, the others wait for its result (or exception).
+     *
+     * Hits on a loaded entry with a TTL may reload it ahead of its expiry
+     * (XFetch): a hit refreshes when now - cost * ln(rand) reaches the
+     * expiry, cost being how long the last load took, so a slow-to-load
+     * key starts refreshing earlier and, among concurrent readers, about
+     * one gets to do it while the others keep reading the cached value.
+     * A failed early refresh keeps the cached value.
+     *
+     * A key the loader reports as absent is erased. A put or erase of the
+     * key made while the loader runs wins: the loaded result is then handed
+     * to the callers but not stored, and does not erase anything. Reads
+     * through here are not served from near caches.
+     *
+     * @param key    Key to fetch
+     * @param loader Called with no lock held; must not call get_or_load for the same key
+     * @param ttl_ms Time-to-live of a loaded value in ms (0 = no expiry, and no early refresh)
+     * @return handle to the cached or loaded value, empty if the loader found nothing
+     * @throws whatever the loader throws, to every caller waiting on that load
+     */
+    std::optional<ValueRef> get_or_load(std::string_view key, const Loader& loader, uint64_t ttl_ms = 0);
 
     /**
      * Remove a key from cache.
      * @param key Key to erase
      * @return true if key was removed, false if not found
      */
-    bool erase(const std::string& key);
+    bool erase(std::string_view key);
+
+    /**
+     * Add to a value holding an unsigned decimal number, in place under the
+     * shard lock, keeping its TTL. Increments wrap around at 2^64 (memcached
+     * incr semantics).
+     * @param key    Key to update
+     * @param delta  Amount to add
+     * @param ttl_ms If set, receives the key's remaining time-to-live in ms (0 = no expiry), so
+     *               that the update can be replicated as a put
+     * @param flags  If set, receives the client flags kept with the value, for the same reason
+     * @return the new value, empty if the key is absent
+     * @throws std::invalid_argument if the value is not a decimal number of at most 20 digits
+     */
+    std::optional<uint64_t> incr(std::string_view key, uint64_t delta, uint64_t* ttl_ms = nullptr,
+                                 uint32_t* flags = nullptr);
+
+    /**
+     * Like incr(), subtracting. The result stops at 0 (memcached decr semantics).
+     */
+    std::optional<uint64_t> decr(std::string_view key, uint64_t delta, uint64_t* ttl_ms = nullptr,
+                                 uint32_t* flags = nullptr);
+
+    // Batched operations: keys are grouped by shard and every shard lock is
+    // taken once per call. Duplicate keys are applied in input order.
+
+    /**
+     * get() for several keys.
+     * @param keys Keys to fetch
+     * @return one entry per key, in input order, empty for a miss
+     */
+    std::vector<std::optional<std::string>> multi_get(const std::vector<std::string_view>& keys);
+
+    /**
+     * get_ref() for several keys.
+     * @param keys Keys to fetch
+     * @return one handle per key, in input order, empty for a miss
+     */
+    std::vector<std::optional<ValueRef>> multi_get_ref(const std::vector<std::string_view>& keys);
+
+    /**
+     * put() for several pairs.
+     * @param items Pairs to insert or update
+     */
+    void multi_put(const std::vector<CacheItem>& items);
+
+    /**
+     * erase() for several keys.
+     * @param keys Keys to erase
+     * @return number of keys removed
+     */
+    size_t multi_erase(const std::vector<std::string_view>& keys);
+
+    /**
+     * Overloads for argument types that convert to std::string but not to
+     * std::string_view (std::ssub_match, nlohmann::json, ...). They
+     * materialize the string first.
+     */
+    template <typename K, typename V, typename = std::enable_if_t<
+        !(std::is_convertible_v<const K&, std::string_view> && std::is_convertible_v<const V&, std::string_view>)>>
+    void put(const K& key, const V& value, uint64_t ttl_ms = 0) {
+        const std::string k = key;
+        const std::string v = value;
+        put(std::string_view(k), std::string_view(v), ttl_ms);
+    }
+
+    template <typename K, typename = StringOnly<K>>
+    std::optional<std::string> get(const K& key) {
+        const std::string k = key;
+        return get(std::string_view(k));
+    }
+
+    template <typename K, typename = StringOnly<K>>
+    std::optional<ValueRef> get_ref(const K& key) {
+        const std::string k = key;
+        return get_ref(std::string_view(k));
+    }
+
+    template <typename K, typename = StringOnly<K>>
+    bool erase(const K& key) {
+        const std::string k = key;
+        return erase(std::string_view(k));
+    }
 
     /**
      * @return Current number of entries in the cache
@@ -71,15 +365,45 @@ public:
      * Raw check: returns true if key exists in map (ignores TTL).
      * Mainly useful for testing async eviction.
      */
-    bool contains(const std::string& key) const;
+    bool contains(std::string_view key) const;
 
     /**
      * Snapshot of all keys currently in cache (ignores TTL).
+     * Keys are grouped per shard, each group in MRU → LRU order (under
+     * TinyLFU: window, then protected, then probation).
      */
     std::vector<std::string> keys() const;
 
+    /**
+     * Copy the live entries of one shard, least recently used first, so
+     * that inserting them in order restores the recency order. The shard
+     * lock is held (shared) only while keys are copied and value handles
+     * taken; other shards are not locked at all.
+     * @param shard Shard index in [0, shard_count())
+     */
+    std::vector<CacheRecord> export_shard(size_t shard) const;
+
+    /**
+     * Copy the live entries that hash to the next `slots` or so slots of a
+     * shard's index, walking the shards one after the other. A call holds
+     * one shard lock (shared) for one slice, so exporting a large cache
+     * never blocks writers for long. Entries come in index order, not
+     * recency order.
+     *
+     * An entry present for the whole walk is returned exactly once, even if
+     * its shard's index grows between two slices; entries of a shard that
+     * is cleared mid-walk may come again.
+     * @return the slice's records, possibly none; sets cursor.done once the walk is over
+     */
+    std::vector<CacheRecord> export_slice(ExportCursor& cursor, size_t slots) const;
+
+    /**
+     * @return index of the shard that owns the key, in [0, shard_count())
+     */
+    size_t shard_of(std::string_view key) const;
+
     /** 
-    * Clear all the contents in map_ and lru_list_
+    * Clear all the contents of every shard
     */
     void clear();
 
@@ -88,11 +412,61 @@ public:
     */ 
     size_t capacity() const;
 
+    /**
+    * @return memory budget in bytes (0 when bounded by entry count)
+    */
+    size_t capacity_bytes() const;
+
+    /**
+    * @return accounted footprint of all entries in bytes (values still held
+    *         by outstanding ValueRefs after eviction are not counted)
+    */
+    size_t memory_used() const;
+
+    /**
+    * @return value slab usage per size class, summed over shards
+    */
+    std::vector<SlabAllocator::ClassStats> slab_stats() const;
+
     /**
     * @return the time in which async eviction thread is running
     */ 
     uint64_t eviction_interval() const;
 
+    /**
+    * Refresh the coarse clock and, once per eviction interval, remove the
+    * expired entries. The background thread calls it every millisecond;
+    * with background_expiry = false the owner must call it before the
+    * operations it runs and at least once per eviction interval while idle.
+    * Not to be called from two threads at once.
+    */
+    void maintain();
+
+    /**
+    * @return number of lock stripes the key space is partitioned into
+    */
+    size_t shard_count() const;
+
+    /**
+    * @return replacement policy selected at construction (LruPolicy caches only)
+    */
+    EvictionPolicy eviction_policy() const;
+
+    /**
+    * @return name of the compile-time eviction policy
+    */
+    static constexpr const char* policy_name() { return Policy::kName; }
+
+    /**
+     * @return admission filter selected at construction
+     */
+    AdmissionPolicy admission_policy() const;
+
+    /**
+     * @return true if lookups run without the shard lock
+     */
+    bool lock_free_reads() const;
+
     /**
      * @return Number of successful cache hits
      */
@@ -103,40 +477,414 @@ public:
      */
     size_t misses() const;
 
+    /**
+     * @return Number of new keys the admission filter turned away
+     */
+    size_t admission_rejections() const;
+
+    /**
+     * @return Number of entries removed to make room (admission rejections included)
+     */
+    size_t evictions() const;
+
+    /**
+     * @return Number of entries removed because their TTL passed, lazily or by the background sweep
+     */
+    size_t expirations() const;
+
+    /**
+     * @return minimum value size that is compressed (0 = compression off)
+     */
+    size_t compress_threshold() const;
+
+    /**
+     * @return value compression counters
+     */
+    CompressionStats compression_stats() const;
+
+    /**
+     * @return current hot keys, hottest first (empty when hot-key tracking is off)
+     */
+    std::vector<HotKeyTracker::HotKey> hot_keys() const;
+
+    /**
+     * @return maximum number of hot keys tracked (0 = off)
+     */
+    size_t hot_key_capacity() const;
+
+    /**
+     * @return reads served from per-thread near caches
+     */
+    uint64_t near_cache_hits() const;
+
+    /**
+     * @return get / get_ref calls that looked in a near cache, hits included
+     */
+    uint64_t near_cache_lookups() const;
+
+    /**
+     * @return loader calls made by get_or_load, early refreshes included
+     */
+    uint64_t loads() const;
+
+    /**
+     * @return get_or_load misses that waited for another caller's load instead of loading
+     */
+    uint64_t coalesced_loads() const;
+
+    /**
+     * @return loads started ahead of an entry's expiry
+     */
+    uint64_t early_refreshes() const;
+
 private:
+    /// Unit tests hold a shard's lock through it to check who waits for whom.
+    friend struct CacheTestAccess;
+
     // ---------------- Internal types ----------------
 
-    struct Entry {
-        std::string value;                        ///< Stored value
-        clock::time_point expiry;                 ///< Expiration time
-        std::list<std::string>::iterator lru_it;  ///< Iterator pointing into LRU list
+    /// Recency list an entry belongs to.
+    enum class Region : uint8_t {
+        Main,       ///< The LRU list; the probation segment under TinyLFU
+        Window,     ///< TinyLFU admission window
+        Protected   ///< TinyLFU main region, entries hit again while on probation
+    };
+
+    /// The built-in recency lists (LRU, CLOCK, TinyLFU) rather than a policy queue.
+    static constexpr bool kBuiltinLru = std::is_same<Policy, LruPolicy>::value;
+
+    /**
+     * Intrusive cache node. The key is stored exactly once, and the node is
+     * simultaneously a member of its shard's index and of one LRU list (or
+     * of its policy's queues, through the same links). The policy's hook is
+     * a base, so an empty one costs nothing.
+     */
+    struct Entry : public Policy::template Hook<Entry> {
+        size_t key_size = 0;             ///< Length of the key bytes that follow the node
+        ValueRef value;                  ///< Immutable value block in the shard's arena
+        clock::time_point expiry;        ///< Expiration time
+        size_t hash = 0;                 ///< Cached key hash, reused when the index grows
+        Entry* lru_prev = nullptr;       ///< Neighbour towards the MRU end
+        Entry* lru_next = nullptr;       ///< Neighbour towards the LRU end
+        std::atomic<bool> referenced{false}; ///< CLOCK reference bit, set by readers under a shared lock
+        Region region = Region::Main;    ///< List the node is linked into
+        std::atomic<uint16_t> load_ms{0};  ///< get_or_load: how long the loader took for this value,
+                                         ///< in ms (at least 1), 0 if put() stored it
+        std::atomic<uint32_t> access_tick{0}; ///< Lock-free mode: coarse ms of the last hit since the
+                                         ///< clock hand last passed, 0 if none (replaces `referenced`)
+        TimerHook<Entry> timer;          ///< Expiry wheel links (entries with a TTL only)
+
+        /// Allocate a node with room for the key right behind it, and copy the key there.
+        static Entry* make(std::string_view key, clock::time_point exp, size_t h) {
+            void* block = ::operator new(sizeof(Entry) + key.size());
+            Entry* entry = new (block) Entry(key.size(), exp, h);
+            if (!key.empty()) {
+                std::memcpy(reinterpret_cast<char*>(entry + 1), key.data(), key.size());
+            }
+            return entry;
+        }
+
+        /// Destroy a node allocated by make().
+        static void release(Entry* entry) {
+            entry->~Entry();
+            ::operator delete(entry);
+        }
+
+        std::string_view key() const { return {reinterpret_cast<const char*>(this + 1), key_size}; }
+        std::string_view value_view() const { return value.view(); }
+
+    private:
+        Entry(size_t size, clock::time_point exp, size_t h) : key_size(size), expiry(exp), hash(h) {}
+    };
+
+    /**
+     * Intrusive doubly linked recency list over Entry::lru_prev / lru_next.
+     */
+    struct LruList {
+        Entry* head = nullptr;   ///< Most recently used entry
+        Entry* tail = nullptr;   ///< Least recently used entry
+        size_t weight = 0;       ///< Capacity units held: entries, or bytes when bounded by memory
+
+        void push_front(Entry* entry);
+        void unlink(Entry* entry);
+    };
+
+    /**
+     * A get_or_load() whose loader is running, registered with its shard so
+     * that writes made meanwhile can tell it its result is stale.
+     */
+    struct PendingLoad {
+        size_t hash = 0;                 ///< Hash of the key being loaded
+        bool overtaken = false;          ///< The key was put or erased since the loader started
+    };
+
+    /**
+     * One lock stripe. Aligned to a cache line so that neighbouring shards'
+     * locks and counters do not false-share.
+     */
+    struct alignas(64) Shard {
+        mutable SharedMutex mutex;                   ///< Protects everything below
+        size_t capacity = 0;                         ///< Max entries in this shard
+        size_t capacity_bytes = 0;                   ///< Memory budget of this shard (0 = none)
+        size_t bytes_used = 0;                       ///< Sum of entry footprints
+        ValueArena* values;                          ///< Arena for value blocks, outlives the shard
+                                                     ///< while ValueRefs are out
+        SwissIndex<Entry, &Entry::hash> index;       ///< Key index over the cached hashes
+        std::unique_ptr<RcuIndex<Entry, &Entry::hash>> lock_free_index; ///< Replaces `index` when readers
+                                                     ///< take no lock (null otherwise)
+        size_t count = 0;                            ///< Number of live entries
+        LruList main;                                ///< LRU list (probation segment under TinyLFU)
+        LruList window;                              ///< TinyLFU admission window
+        LruList protected_segment;                   ///< TinyLFU protected segment
+        size_t window_capacity = 0;                  ///< TinyLFU window size, in capacity units
+        size_t protected_capacity = 0;               ///< TinyLFU protected size, in capacity units
+        std::unique_ptr<FrequencySketch> sketch;     ///< TinyLFU frequencies (null without admission)
+        TimerWheel<Entry, &Entry::timer> expiry_wheel; ///< Entries with a TTL, by expiry tick
+        typename Policy::template Queue<Entry> policy; ///< Replacement state of a policy other than LRU
+        HotKeyTracker* hot_keys = nullptr;           ///< Told about every changed or removed entry
+                                                     ///< (null without hot-key tracking)
+        std::vector<PendingLoad*> pending_loads;     ///< Loads in progress on this shard
+
+        explicit Shard(size_t page_size);
+        ~Shard();
+        Shard(const Shard&) = delete;
+        Shard& operator=(const Shard&) = delete;
+
+        /// Find the node for key, nullptr if absent.
+        Entry* find(std::string_view key, size_t hash) const;
+
+        /// Allocate a node, copy the value into the arena and link it at the MRU end of a list.
+        Entry* create(std::string_view key, std::string_view value, bool compressed, clock::time_point expiry,
+                      size_t hash, Region region = Region::Main, uint32_t flags = 0);
+
+        /// Replace a linked node's value with a fresh block, keeping bytes_used in sync.
+        void assign_value(Entry* entry, std::string_view value, bool compressed, uint32_t flags = 0);
+
+        /// Accounted size of a node: key, value chunk and node overhead.
+        size_t footprint(const Entry* entry) const;
+
+        /// Footprint a node with this key and value size would have.
+        size_t footprint(size_t key_size, size_t value_size) const;
+
+        /// Capacity units a node counts for: 1, or its footprint when bounded by memory.
+        size_t weight(const Entry* entry) const;
+
+        /// Unlink a node from the index, its LRU list (or policy) and the expiry wheel and free it
+        /// (retire it to the EpochDomain in lock-free mode).
+        void destroy(Entry* entry);
+
+        /// Move a node to the MRU end of its LRU list (pointer relinking only).
+        void touch_to_front(Entry* entry);
+
+        /// Move a node to the MRU end of another region's list.
+        void move_to(Entry* entry, Region region);
+
+        /// Free every node and reset the index.
+        void clear();
+
+        /// Tell the loads of this hash in progress that a put or erase overtook them.
+        void overtake_loads(size_t hash);
+
+    private:
+        void link(Entry* entry);
+        void free(Entry* entry);
+        LruList& list_of(const Entry* entry);
+        void store_value(Entry* entry, std::string_view value, bool compressed, uint32_t flags);
     };
 
     // ---------------- Internal helpers ----------------
 
-    /// Move accessed/updated key to front of LRU list.
-    void touch_to_front(typename std::unordered_map<std::string, Entry>::iterator it);
+    /// Hash used both to pick the shard and to index inside it.
+    static size_t hash_key(std::string_view key);
+
+    /// Position in shards_ of the shard that owns a key with the given hash.
+    size_t shard_index(size_t hash) const;
 
-    /// Remove least recently used key if capacity exceeded.
-    void evict_if_needed();
+    /// Shard that owns a key with the given hash.
+    Shard& shard_for(size_t hash) const;
+
+    /**
+     * Call fn(shard, positions) once per shard that owns one of the hashes,
+     * with the positions (ascending) of the hashes it owns.
+     */
+    template <typename F>
+    void for_each_shard(const std::vector<size_t>& hashes, F&& fn) const;
+
+    /// Expiry time of an entry written at `now` with this TTL.
+    static clock::time_point expiry_for(uint64_t ttl_ms, clock::time_point now);
+
+    /// TTL in ms left at `now` before `expiry` (at least 1), 0 if it never expires.
+    static uint64_t remaining_ttl_ms(clock::time_point expiry, clock::time_point now);
+
+    /// put() body; `value` is as stored (see pack()). PRECONDITION: the shard lock is held exclusively.
+    void put_locked(Shard& shard, std::string_view key, std::string_view value, bool compressed, size_t hash,
+                    clock::time_point expiry_time, clock::time_point now, uint32_t flags = 0);
+
+    /**
+     * Form a value is stored in: compressed into `buffer` if it reaches the
+     * threshold and shrinks enough, else the value itself. Runs before any
+     * shard lock is taken.
+     */
+    std::string_view pack(std::string_view value, std::string& buffer, bool& compressed) const;
 
-    /// Background eviction loop: periodically removes expired keys.
-    void eviction_loop(uint64_t interval_ms);
+    /// Replace a handle to a compressed value with a decompressed copy. Runs with no shard lock held.
+    void unpack(std::optional<ValueRef>& value) const;
+
+    /// Append an entry to an export unless it has expired. PRECONDITION: the shard lock is held.
+    static void add_record(std::vector<CacheRecord>& records, const Entry* entry, clock::time_point now);
+
+    /// Replace the compressed values of exported records with plain copies. Runs with no shard lock held.
+    void unpack_records(std::vector<CacheRecord>& records) const;
+
+    /// Copy a value out as a string, decompressing it if needed.
+    std::string copy_value(const ValueRef& value) const;
+
+    /// What get_or_load() needs to know about a hit to decide on an early refresh.
+    struct HitInfo {
+        clock::time_point expiry;
+        uint16_t load_ms = 0;
+    };
+
+    /**
+     * get_ref() body when reads relink entries. PRECONDITION: the shard lock is held exclusively.
+     * @param info Filled on a hit, if given
+     */
+    std::optional<ValueRef> get_locked(Shard& shard, std::string_view key, size_t hash, clock::time_point now,
+                                       HitInfo* info = nullptr);
+
+    /**
+     * Remove the policy's victims until the shard has room for one more
+     * entry of `incoming_bytes`. `keep` (if any) is never chosen as a victim.
+     */
+    void evict_if_needed(Shard& shard, size_t incoming_bytes, const Entry* keep = nullptr) const;
+
+    /// Pick the entry the policy would evict next, nullptr if only `keep` is left.
+    Entry* select_victim(Shard& shard, const Entry* keep) const;
+
+    /**
+     * TinyLFU maintenance after an insert or update: window overflow moves
+     * to probation as admission candidates, and while the shard is over
+     * budget each candidate competes with the main region's victim. The
+     * one with the lower estimated frequency is evicted (ties reject the
+     * candidate).
+     */
+    void admit_candidates(Shard& shard) const;
+
+    /// Record a hit on an entry according to the eviction policy.
+    void on_access(Shard& shard, Entry* entry) const;
+
+    /// @return true if hits only need a shared shard lock (CLOCK, or the policy says so)
+    bool shared_reads() const;
+
+    /// get_ref() when shared_reads(): readers share the shard lock, or only pin the epoch in lock-free mode.
+    std::optional<ValueRef> get_shared(Shard& shard, std::string_view key, size_t hash, HitInfo* info = nullptr);
+
+    /// Remove the key's entry if its TTL has passed; takes the shard lock exclusively.
+    void remove_if_expired(Shard& shard, std::string_view key, size_t hash);
+
+    /**
+     * Serve a read from the calling thread's near cache. Sampled reads are
+     * never served from it, so hot entries still reach the policy and the sketch.
+     * @param fill Set when the key is hot but was not there: the caller fills it after its own read
+     */
+    std::optional<ValueRef> near_lookup(std::string_view key, size_t hash, bool& fill);
+
+    /// Copy the key's current value into the calling thread's near cache.
+    void fill_near_cache(Shard& shard, std::string_view key, size_t hash);
+
+    /// @return true if a hit should reload the entry now rather than wait for it to expire (XFetch)
+    bool refresh_early(const HitInfo& info) const;
+
+    /// Live value of the key without counting a hit or miss, decompressed.
+    std::optional<ValueRef> peek(Shard& shard, std::string_view key, size_t hash) const;
+
+    /// incr() / decr() body.
+    std::optional<uint64_t> add(std::string_view key, uint64_t delta, bool decrement, uint64_t* ttl_ms,
+                                uint32_t* flags);
+
+    /// Call the loader and store its result (erase the key if it found nothing), unless the key was
+    /// put or erased while the loader ran. No lock is held on entry.
+    std::optional<ValueRef> load(Shard& shard, std::string_view key, size_t hash, const Loader& loader,
+                                 uint64_t ttl_ms);
+
+    /**
+     * Lock-free lookup: find the entry with the epoch pinned and, on a live
+     * hit, call use(entry) before unpinning. Counts hits and misses.
+     * @return true on a hit
+     */
+    template <typename F>
+    bool visit_pinned(Shard& shard, std::string_view key, size_t hash, F&& use);
+
+    /// Coarse access time for Entry::access_tick, never 0.
+    uint32_t access_stamp() const;
+
+    /// Background eviction loop: calls maintain() every kClockResolutionMs.
+    void eviction_loop();
+
+    /// Expire the due entries of one shard, releasing the lock between bounded batches.
+    void expire_shard(Shard& shard, clock::time_point now);
+
+    /// Cached coarse time, refreshed by maintain().
+    clock::time_point now() const;
+
+    /// Expiry wheel tick at or after which the given expiry time has passed.
+    uint64_t expiry_tick(clock::time_point expiry) const;
+
+    /// Put a TTL entry on its shard's expiry wheel (no-op for entries without TTL).
+    void schedule_expiry(Shard& shard, Entry* entry) const;
+
+    /// @return true if the entry has a TTL that has passed at `now`
+    static bool is_expired(const Entry* entry, clock::time_point now);
 
     // ---------------- Data members ----------------
-    mutable std::shared_mutex mutex_;               ///< Protects map_, lru_list_, capacity_
-    size_t capacity_;                               ///< Max allowed entries
-    std::unordered_map<std::string, Entry> map_;    ///< key -> Entry
-    std::list<std::string> lru_list_;               ///< Keys in MRU → LRU order
+    size_t capacity_;                               ///< Max allowed entries (sum over shards)
+    size_t capacity_bytes_;                         ///< Memory budget (sum over shards, 0 = none)
+    EvictionPolicy eviction_policy_;                ///< Replacement policy of the LRU lists
+    AdmissionPolicy admission_policy_;              ///< Admission filter
+    bool lock_free_reads_;                          ///< Readers pin an epoch instead of locking
+    std::unique_ptr<HotKeyTracker> hot_keys_;       ///< Hot-key sketch and near caches (null = off);
+                                                    ///< outlives the shards, which report to it
+    std::vector<std::unique_ptr<Shard>> shards_;    ///< Lock stripes, fixed after construction
+    SingleFlight<std::optional<ValueRef>> loads_;   ///< get_or_load calls in progress, by key
+
+    // Metrics: striped per thread, so hot paths never share a counter line
+    mutable Counter hits_;                          ///< Count of cache hits
+    mutable Counter misses_;                        ///< Count of cache misses
+    mutable Counter rejections_;                    ///< New keys refused by admission
+    mutable Counter evictions_;                     ///< Entries removed to make room
+    mutable Counter expirations_;                   ///< Entries removed after their TTL
+    mutable Counter loads_started_;                 ///< Loader calls (get_or_load)
+    mutable Counter coalesced_loads_;               ///< Misses that waited for another caller's load
+    mutable Counter early_refreshes_;               ///< Loads started before the entry expired
+
+    // Value compression
+    size_t compress_threshold_;                     ///< Minimum value size to compress (0 = off)
+    mutable Counter compressed_values_;             ///< Values stored compressed
+    mutable Counter incompressible_values_;         ///< Values over the threshold stored raw
+    mutable Counter compress_raw_bytes_;            ///< Input bytes of values stored compressed
+    mutable Counter compress_stored_bytes_;         ///< Their output bytes
+    mutable Counter compress_ns_;                   ///< Time spent in the compressor
+    mutable Counter decompressions_;                ///< Compressed values read back
+    mutable Counter decompress_ns_;                 ///< Time spent in the decompressor
     
     // Async eviction members
-    std::thread eviction_thread_;
+    const clock::time_point epoch_;                 ///< Origin of expiry wheel ticks
+    std::atomic<clock::rep> coarse_now_;            ///< Cached clock::now(), see now()
+    std::thread eviction_thread_;                   ///< Not started with background_expiry = false
     std::atomic<bool> stop_eviction_{false};
     uint64_t eviction_interval_ms_;
-
-    // Metrics
-    std::atomic<size_t> hits_{0};               ///< Count of cache hits
-    std::atomic<size_t> misses_{0};            ///< Count of cache misses
+    clock::time_point next_sweep_;                  ///< Only touched by the thread calling maintain()
 };
 
+// Instantiated in cache.cpp
+extern template class BasicCache<LruPolicy>;
+extern template class BasicCache<LfuPolicy>;
+extern template class BasicCache<FifoPolicy>;
+extern template class BasicCache<ArcPolicy>;
+extern template class BasicCache<S3FifoPolicy>;
+extern template class BasicCache<LruPolicy, NoLock>;
+
+/// The cache as used by the server: built-in LRU lists, CLOCK and TinyLFU through CacheOptions.
+using Cache = BasicCache<LruPolicy>;
+
 #endif // CACHE_H
\ No newline at end of file
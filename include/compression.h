@@ -0,0 +1,33 @@
+#pragma once
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * LZ4 block compression for stored values.
+ *
+ * A compressed value is kept as a u32 (little-endian) holding its original
+ * length, followed by one LZ4 block. LZ4 trades ratio for speed: a few GB/s
+ * to decompress, which keeps the cost of a read close to that of the copy.
+ */
+
+/**
+ * Compress `raw` into `out` if that saves at least an eighth of its size.
+ * @return false if the value should be stored as is (`out` is then unspecified)
+ */
+bool compress_value(std::string_view raw, std::string& out);
+
+/// @return original length of a value produced by compress_value()
+size_t decompressed_size(std::string_view packed);
+
+/**
+ * Restore a value produced by compress_value().
+ * @param out Buffer of decompressed_size(packed) bytes
+ * @throws std::runtime_error if the block is corrupt
+ */
+void decompress_value(std::string_view packed, char* out);
+
+#endif // COMPRESSION_H
@@ -0,0 +1,156 @@
+#pragma once
+#ifndef CORE_ENGINE_H
+#define CORE_ENGINE_H
+
+#include "cache.h"
+#include "mpsc_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Shared-nothing engine: one worker thread per core, pinned to it, owning
+ * a private single-shard cache that no other thread touches. Callers do
+ * not lock anything; a request is routed by key hash to the owning core
+ * through that core's lock-free MPSC queue and the caller waits for the
+ * worker to run it. A key's data therefore stays in one core's caches
+ * instead of following whichever HTTP thread asked for it.
+ *
+ * The private caches are CoreCaches, built without shard locks, so every
+ * read of their shards (stats such as a metrics scrape included) is a
+ * request to the owning worker. They start no expiry thread of their own:
+ * each worker refreshes its cache's coarse clock before every request and
+ * runs the expiry sweep itself, waking from its park once per eviction
+ * interval to do so when idle. Batched calls fan out to every owning core
+ * at once and wait for all of them. A caller waits on the request's own
+ * ready word, spinning briefly and then sleeping on it with a futex on
+ * Linux (C++17 has no std::atomic::wait), so completing a request takes
+ * no lock.
+ *
+ * Counters and sizes are summed over the cores.
+ */
+class CoreEngine {
+public:
+    /// A core's private cache: LRU, with shard locks compiled out.
+    using CoreCache = BasicCache<LruPolicy, NoLock>;
+
+    /**
+     * @param options Options of the whole engine; capacity and memory budget are split
+     *                evenly between cores, each core's cache has a single shard
+     * @param cores   Worker threads (0 = one per hardware thread)
+     * @param pin     Pin worker i to CPU i (Linux only, ignored elsewhere)
+     */
+    explicit CoreEngine(const CacheOptions& options, size_t cores = 0, bool pin = true);
+
+    /**
+     * Stops the workers after they drained their queues.
+     */
+    ~CoreEngine();
+
+    CoreEngine(const CoreEngine&) = delete;
+    CoreEngine& operator=(const CoreEngine&) = delete;
+
+    // Same semantics as the Cache methods of the same name
+
+    void put(std::string_view key, std::string_view value, uint64_t ttl_ms = 0);
+    std::optional<std::string> get(std::string_view key);
+    std::optional<ValueRef> get_ref(std::string_view key);
+    bool erase(std::string_view key);
+    std::vector<std::optional<ValueRef>> multi_get_ref(const std::vector<std::string_view>& keys);
+    void multi_put(const std::vector<CacheItem>& items);
+    size_t multi_erase(const std::vector<std::string_view>& keys);
+
+    /// @return number of cores (workers)
+    size_t core_count() const;
+
+    /// @return index of the core that owns the key
+    size_t core_of(std::string_view key) const;
+
+    size_t size() const;
+    size_t capacity() const;
+    size_t capacity_bytes() const;
+    size_t memory_used() const;
+    uint64_t eviction_interval() const;
+    size_t hits() const;
+    size_t misses() const;
+    size_t admission_rejections() const;
+    size_t evictions() const;
+    size_t expirations() const;
+    CompressionStats compression_stats() const;
+    std::vector<SlabAllocator::ClassStats> slab_stats() const;
+
+private:
+    /**
+     * One call to run on a core. Lives on the caller's stack until done;
+     * the work is a plain function pointer and context, so submitting
+     * allocates nothing.
+     */
+    struct Request {
+        static constexpr uint32_t kPending = 0;
+        static constexpr uint32_t kDone = 1;
+        static constexpr uint32_t kSleeping = 2;   ///< Caller is (about to be) asleep on `ready`
+
+        void (*run)(CoreCache& cache, void* context) = nullptr;
+        void* context = nullptr;
+
+        /// Mark the request done and wake its caller if it sleeps. The worker does not touch it afterwards.
+        void complete();
+
+        /// Block (spinning briefly first) until complete() has run.
+        void wait();
+
+        std::atomic<uint32_t> ready{kPending};  ///< Futex word: kPending, kDone or kSleeping
+    };
+
+    struct alignas(64) Core {
+        explicit Core(const CacheOptions& options);
+
+        std::unique_ptr<CoreCache> cache;       ///< Private to the worker
+        MpscQueue<Request*> queue;              ///< Requests routed to this core
+        std::thread worker;
+
+        // Parking, when the queue stayed empty for a while
+        std::mutex park_mutex;
+        std::condition_variable park_cv;
+        std::atomic<bool> sleeping{false};
+    };
+
+    /// Hand a request to a core, waiting for queue space if needed.
+    void submit(Core& core, Request& request) const;
+
+    /// Run fn(cache) on a core and wait for it.
+    template <typename F>
+    void execute(size_t core, F&& fn) const;
+
+    /// Run fn(core, cache) on every core for which wanted(core) is true, all at once, and wait for them.
+    template <typename Wanted, typename F>
+    void fan_out(Wanted&& wanted, F&& fn) const;
+
+    /// Positions of the keys, grouped by owning core.
+    std::vector<std::vector<size_t>> group_by_core(const std::vector<std::string_view>& keys) const;
+
+    /// Run requests routed to the core, and its cache's maintain(), until stopped.
+    void worker_loop(Core& core);
+
+    size_t core_index(size_t hash) const;
+
+    /// Sum of f(cache) over the cores, for counters that any thread may read.
+    template <typename F>
+    size_t sum(F&& f) const;
+
+    /// Sum of f(cache) over the cores, each read by its worker.
+    template <typename F>
+    size_t sum_on_cores(F&& f) const;
+
+    std::vector<std::unique_ptr<Core>> cores_;
+    std::atomic<bool> stop_{false};
+};
+
+#endif // CORE_ENGINE_H
@@ -0,0 +1,120 @@
+#pragma once
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * Epoch-based reclamation for structures that readers traverse without
+ * locks.
+ *
+ * A reader pins the domain for the duration of a lookup: that publishes the
+ * current global epoch in a slot owned by its thread (one store and a fence,
+ * no shared cache line is written). A writer that unlinks an object retires
+ * it instead of freeing it. The global epoch only advances once every pinned
+ * thread has seen the current one, so an object retired in epoch e is freed
+ * once the epoch reaches e + 2: by then no reader can still hold it.
+ *
+ * There is one process-wide domain. Thread slots are claimed on first use and
+ * handed back when the thread exits.
+ */
+class EpochDomain {
+    struct Participant;
+
+public:
+    /**
+     * RAII pin. While any guard of a thread is alive, objects retired after
+     * the pin are not freed. Guards nest.
+     */
+    class Guard {
+    public:
+        Guard() = default;   ///< Not pinned
+        Guard(Guard&& other) noexcept : participant_(std::exchange(other.participant_, nullptr)) {}
+        Guard& operator=(Guard&& other) noexcept {
+            std::swap(participant_, other.participant_);
+            return *this;
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard();
+
+    private:
+        friend class EpochDomain;
+        explicit Guard(Participant* participant) : participant_(participant) {}
+
+        Participant* participant_ = nullptr;
+    };
+
+    /// @return the process-wide domain
+    static EpochDomain& global();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    /// Pin the calling thread.
+    Guard pin();
+
+    /**
+     * Free `object` with `deleter` once no pinned reader can reach it.
+     * PRECONDITION: the object is already unreachable for new readers.
+     */
+    void retire(void* object, void (*deleter)(void*));
+
+    /// Typed retire(): the object is freed with delete.
+    template <typename T>
+    void retire(T* object) {
+        retire(object, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    /**
+     * Advance the epoch if every pinned thread allows it and free what has
+     * become safe. Also runs every few hundred retires.
+     * @return number of objects freed
+     */
+    size_t collect();
+
+    /// @return objects retired but not freed yet
+    size_t pending() const;
+
+    /// @return current global epoch
+    uint64_t epoch() const { return epoch_.load(std::memory_order_relaxed); }
+
+private:
+    /// Per-thread slot; epoch is 0 while the owner is not pinned.
+    struct alignas(64) Participant {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> owned{true};
+        uint32_t depth = 0;                 ///< Nested guards, touched by the owner only
+        Participant* next = nullptr;        ///< Immutable once published
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void* object;
+        void (*deleter)(void*);
+    };
+
+    EpochDomain() = default;
+    ~EpochDomain() = default;
+
+    /// Slot of the calling thread, claimed on first use.
+    Participant* participant();
+
+    /// Move the epoch forward if no pinned thread lags behind.
+    void try_advance();
+
+    static void unpin(Participant* participant);
+
+    std::atomic<uint64_t> epoch_{1};
+    std::atomic<Participant*> participants_{nullptr};   ///< Lock-free list, slots are never freed
+
+    mutable std::mutex retired_mutex_;                  ///< Protects retired_
+    std::vector<Retired> retired_;
+};
+
+#endif // EPOCH_H
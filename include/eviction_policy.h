@@ -0,0 +1,510 @@
+#pragma once
+#ifndef EVICTION_POLICY_H
+#define EVICTION_POLICY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Eviction policies BasicCache is instantiated with (see cache.h). They are
+ * chosen at compile time, so the policy's hooks inline into the cache's hot
+ * paths with no virtual dispatch.
+ *
+ * A policy is a tag type with:
+ * - kName: short lowercase name
+ * - kSharedReads: true if Queue::access() may run under a shared shard lock
+ * - Hook<Node>: per-entry state; the cache entry derives from it, so an
+ *   empty hook costs nothing
+ * - Queue<Node>: per-shard replacement state, driven under the shard lock:
+ *   - set_capacity(entries): entries the shard holds (0 = unknown, e.g.
+ *     bounded by bytes), called once before use
+ *   - insert(node): a new key was stored
+ *   - access(node): a hit
+ *   - remove(node): the node leaves (erase, expiry, update or eviction)
+ *   - victim(keep): node to evict next, never `keep`, nullptr if there is
+ *     nothing else. The cache always evicts what it gets, so a policy may
+ *     record the key in a ghost list here. It may reorder its queues.
+ *   - for_each(f): visit every node, the next victims first; f may free
+ *     the node it is given
+ *   - clear(): forget every node (the cache frees them)
+ *
+ * Queues link nodes through the node's own lru_prev / lru_next pointers and
+ * read its cached `hash`, so a policy adds only its Hook to an entry.
+ */
+
+/**
+ * Intrusive doubly linked list over Node::lru_prev / lru_next, newest at
+ * the head.
+ */
+template <typename Node>
+struct PolicyList {
+    Node* head = nullptr;   ///< Newest node
+    Node* tail = nullptr;   ///< Oldest node
+    size_t size = 0;
+
+    void push_front(Node* node) {
+        node->lru_prev = nullptr;
+        node->lru_next = head;
+        if (head) head->lru_prev = node;
+        head = node;
+        if (!tail) tail = node;
+        ++size;
+    }
+
+    void unlink(Node* node) {
+        if (node->lru_prev) node->lru_prev->lru_next = node->lru_next;
+        else head = node->lru_next;
+        if (node->lru_next) node->lru_next->lru_prev = node->lru_prev;
+        else tail = node->lru_prev;
+        node->lru_prev = node->lru_next = nullptr;
+        --size;
+    }
+
+    /// Oldest node other than `keep`, nullptr if none.
+    Node* oldest_except(const Node* keep) const {
+        Node* node = tail;
+        return node == keep && node != nullptr ? node->lru_prev : node;
+    }
+
+    /// Visit oldest first; f may free the node it is given.
+    template <typename F>
+    void for_each_oldest(F& f) const {
+        for (Node* node = tail; node != nullptr;) {
+            Node* newer = node->lru_prev;
+            f(node);
+            node = newer;
+        }
+    }
+};
+
+/**
+ * Keys recently evicted, remembered by hash only, oldest dropped first.
+ * Two keys with the same hash share an entry, which only makes a ghost hit
+ * slightly more likely.
+ */
+class GhostList {
+public:
+    /// @return true if the hash was in the list; it is removed
+    bool erase(size_t hash) {
+        auto it = where_.find(hash);
+        if (it == where_.end()) {
+            return false;
+        }
+        order_.erase(it->second);
+        where_.erase(it);
+        return true;
+    }
+
+    bool contains(size_t hash) const { return where_.count(hash) != 0; }
+
+    /// Remember a hash as the newest ghost.
+    void push(size_t hash) {
+        erase(hash);
+        order_.push_front(hash);
+        where_[hash] = order_.begin();
+    }
+
+    void pop_oldest() {
+        where_.erase(order_.back());
+        order_.pop_back();
+    }
+
+    size_t size() const { return where_.size(); }
+
+    void clear() {
+        order_.clear();
+        where_.clear();
+    }
+
+private:
+    std::list<size_t> order_;                                        ///< Newest first
+    std::unordered_map<size_t, std::list<size_t>::iterator> where_;  ///< Hash -> position in order_
+};
+
+/**
+ * The cache's built-in recency lists: exact LRU, or CLOCK and W-TinyLFU
+ * admission when selected through CacheOptions. The cache implements it
+ * directly; hook and queue are empty.
+ */
+struct LruPolicy {
+    static constexpr const char* kName = "lru";
+    static constexpr bool kSharedReads = false;   ///< CLOCK is what makes reads shared
+
+    template <typename Node>
+    struct Hook {};
+
+    template <typename Node>
+    class Queue {};
+};
+
+/**
+ * First in, first out: hits change nothing, so reads share the shard lock
+ * and write nothing at all.
+ */
+struct FifoPolicy {
+    static constexpr const char* kName = "fifo";
+    static constexpr bool kSharedReads = true;
+
+    template <typename Node>
+    struct Hook {};
+
+    template <typename Node>
+    class Queue {
+    public:
+        void set_capacity(size_t) {}
+        void insert(Node* node) { list_.push_front(node); }
+        void access(Node*) {}
+        void remove(Node* node) { list_.unlink(node); }
+        Node* victim(const Node* keep) { return list_.oldest_except(keep); }
+
+        template <typename F>
+        void for_each(F&& f) const { list_.for_each_oldest(f); }
+
+        void clear() { list_ = PolicyList<Node>{}; }
+
+    private:
+        PolicyList<Node> list_;
+    };
+};
+
+/**
+ * Least frequently used, with O(1) insert, hit and eviction: nodes sit in
+ * one bucket per hit count and buckets form a list in ascending count, so
+ * a hit moves a node to the next bucket and the victim is the oldest node
+ * of the lowest one. Counts never decay; a key that was hot once stays
+ * until everything else has been evicted.
+ */
+struct LfuPolicy {
+    static constexpr const char* kName = "lfu";
+    static constexpr bool kSharedReads = false;
+
+    template <typename Node>
+    struct Bucket {
+        uint64_t frequency = 0;       ///< Hits + 1 of every node in the bucket
+        PolicyList<Node> nodes;       ///< Newest arrival at the head
+        Bucket* lower = nullptr;      ///< Bucket with the next lower frequency
+        Bucket* higher = nullptr;     ///< Bucket with the next higher frequency
+    };
+
+    template <typename Node>
+    struct Hook {
+        Bucket<Node>* lfu_bucket = nullptr;   ///< Bucket the node is in
+    };
+
+    template <typename Node>
+    class Queue {
+        using Bucket = LfuPolicy::Bucket<Node>;
+
+    public:
+        Queue() = default;
+        ~Queue() {
+            clear();
+            delete spare_;
+        }
+        Queue(const Queue&) = delete;
+        Queue& operator=(const Queue&) = delete;
+
+        void set_capacity(size_t) {}
+
+        void insert(Node* node) {
+            Bucket* bucket = lowest_;
+            if (bucket == nullptr || bucket->frequency != 1) {
+                bucket = add_bucket(1, nullptr, lowest_);
+            }
+            bucket->nodes.push_front(node);
+            node->lfu_bucket = bucket;
+        }
+
+        void access(Node* node) {
+            Bucket* from = node->lfu_bucket;
+            Bucket* to = from->higher;
+            if (to == nullptr || to->frequency != from->frequency + 1) {
+                if (from->nodes.size == 1) {
+                    ++from->frequency;   // Alone in its bucket: the bucket moves up with it
+                    return;
+                }
+                to = add_bucket(from->frequency + 1, from, from->higher);
+            }
+            from->nodes.unlink(node);
+            to->nodes.push_front(node);
+            node->lfu_bucket = to;
+            drop_if_empty(from);
+        }
+
+        void remove(Node* node) {
+            Bucket* bucket = node->lfu_bucket;
+            bucket->nodes.unlink(node);
+            node->lfu_bucket = nullptr;
+            drop_if_empty(bucket);
+        }
+
+        Node* victim(const Node* keep) {
+            for (Bucket* bucket = lowest_; bucket != nullptr; bucket = bucket->higher) {
+                if (Node* node = bucket->nodes.oldest_except(keep)) {
+                    return node;
+                }
+            }
+            return nullptr;
+        }
+
+        template <typename F>
+        void for_each(F&& f) const {
+            for (Bucket* bucket = lowest_; bucket != nullptr; bucket = bucket->higher) {
+                bucket->nodes.for_each_oldest(f);
+            }
+        }
+
+        void clear() {
+            while (lowest_ != nullptr) {
+                delete std::exchange(lowest_, lowest_->higher);
+            }
+        }
+
+    private:
+        Bucket* add_bucket(uint64_t frequency, Bucket* lower, Bucket* higher) {
+            Bucket* bucket = spare_ != nullptr ? std::exchange(spare_, nullptr) : new Bucket();
+            bucket->frequency = frequency;
+            bucket->lower = lower;
+            bucket->higher = higher;
+            if (lower) lower->higher = bucket;
+            else lowest_ = bucket;
+            if (higher) higher->lower = bucket;
+            return bucket;
+        }
+
+        void drop_if_empty(Bucket* bucket) {
+            if (bucket->nodes.size != 0) {
+                return;
+            }
+            if (bucket->lower) bucket->lower->higher = bucket->higher;
+            else lowest_ = bucket->higher;
+            if (bucket->higher) bucket->higher->lower = bucket->lower;
+            *bucket = Bucket{};
+            if (spare_ == nullptr) spare_ = bucket;   // Steady-state hits reuse it instead of allocating
+            else delete bucket;
+        }
+
+        Bucket* lowest_ = nullptr;   ///< Bucket with the lowest frequency, the head of the bucket list
+        Bucket* spare_ = nullptr;    ///< One emptied bucket kept for reuse
+    };
+};
+
+/**
+ * Adaptive Replacement Cache (Megiddo & Modha): a recency list T1 for keys
+ * seen once and a frequency list T2 for keys hit again, plus ghost lists B1
+ * and B2 of keys recently evicted from each. A miss on a B1 ghost means T1
+ * was too small and grows its target share; a miss on a B2 ghost shrinks
+ * it. The victim comes from T1 while T1 is above its target, else from T2.
+ */
+struct ArcPolicy {
+    static constexpr const char* kName = "arc";
+    static constexpr bool kSharedReads = false;
+
+    template <typename Node>
+    struct Hook {
+        bool arc_frequent = false;   ///< In T2 (else T1)
+    };
+
+    template <typename Node>
+    class Queue {
+    public:
+        void set_capacity(size_t entries) { capacity_ = entries; }
+
+        void insert(Node* node) {
+            const size_t c = capacity();
+            if (recent_ghosts_.contains(node->hash)) {
+                target_ = std::min(c, target_ + std::max<size_t>(1, frequent_ghosts_.size() / recent_ghosts_.size()));
+                recent_ghosts_.erase(node->hash);
+                push(node, true);
+            } else if (frequent_ghosts_.contains(node->hash)) {
+                const size_t step = std::max<size_t>(1, recent_ghosts_.size() / frequent_ghosts_.size());
+                target_ -= std::min(target_, step);
+                frequent_ghosts_.erase(node->hash);
+                push(node, true);
+            } else {
+                push(node, false);
+            }
+            trim_ghosts();
+        }
+
+        void access(Node* node) {
+            list_of(node).unlink(node);
+            push(node, true);
+        }
+
+        void remove(Node* node) { list_of(node).unlink(node); }
+
+        Node* victim(const Node* keep) {
+            const bool from_recent = recent_.size > 0 && (recent_.size > target_ || frequent_.size == 0);
+            Node* node = (from_recent ? recent_ : frequent_).oldest_except(keep);
+            if (node == nullptr) {
+                node = (from_recent ? frequent_ : recent_).oldest_except(keep);
+            }
+            if (node != nullptr) {
+                (node->arc_frequent ? frequent_ghosts_ : recent_ghosts_).push(node->hash);   // Trimmed on insert
+            }
+            return node;
+        }
+
+        template <typename F>
+        void for_each(F&& f) const {
+            recent_.for_each_oldest(f);
+            frequent_.for_each_oldest(f);
+        }
+
+        void clear() {
+            recent_ = PolicyList<Node>{};
+            frequent_ = PolicyList<Node>{};
+            recent_ghosts_.clear();
+            frequent_ghosts_.clear();
+            target_ = 0;
+        }
+
+    private:
+        /// Entries the shard holds; when unknown, as many as it holds now.
+        size_t capacity() const { return std::max(capacity_, recent_.size + frequent_.size); }
+
+        PolicyList<Node>& list_of(const Node* node) { return node->arc_frequent ? frequent_ : recent_; }
+
+        void push(Node* node, bool frequent) {
+            node->arc_frequent = frequent;
+            list_of(node).push_front(node);
+        }
+
+        // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+        void trim_ghosts() {
+            const size_t c = capacity();
+            while (recent_ghosts_.size() > 0 && recent_.size + recent_ghosts_.size() > c) {
+                recent_ghosts_.pop_oldest();
+            }
+            while (frequent_ghosts_.size() > 0 &&
+                   recent_.size + frequent_.size + recent_ghosts_.size() + frequent_ghosts_.size() > 2 * c) {
+                frequent_ghosts_.pop_oldest();
+            }
+        }
+
+        PolicyList<Node> recent_;      ///< T1
+        PolicyList<Node> frequent_;    ///< T2
+        GhostList recent_ghosts_;      ///< B1
+        GhostList frequent_ghosts_;    ///< B2
+        size_t target_ = 0;            ///< Target size of T1 (ARC's p)
+        size_t capacity_ = 0;
+    };
+};
+
+/**
+ * S3-FIFO (Yang et al., SOSP '23): three FIFO queues. New keys enter a
+ * small queue holding 10% of the entries; at its tail a key that was hit
+ * moves to the main queue and one that was not is evicted and remembered
+ * in a ghost queue, so most one-hit wonders leave quickly. A key whose
+ * ghost is still there goes straight to main. Main evicts with a 2-bit
+ * hit counter as a CLOCK-style second chance. A hit only bumps the counter,
+ * so reads share the shard lock.
+ */
+struct S3FifoPolicy {
+    static constexpr const char* kName = "s3fifo";
+    static constexpr bool kSharedReads = true;
+    static constexpr uint8_t kMaxFrequency = 3;
+    static constexpr size_t kSmallPercent = 10;
+
+    template <typename Node>
+    struct Hook {
+        std::atomic<uint8_t> s3_frequency{0};   ///< Hits, saturating; bumped by readers under a shared lock
+        bool s3_main = false;                   ///< In the main queue (else small)
+    };
+
+    template <typename Node>
+    class Queue {
+    public:
+        void set_capacity(size_t entries) { capacity_ = entries; }
+
+        void insert(Node* node) {
+            node->s3_frequency.store(0, std::memory_order_relaxed);
+            push(node, ghosts_.erase(node->hash));
+        }
+
+        void access(Node* node) {
+            // Lost increments between racing readers are fine for a saturating counter
+            const uint8_t frequency = node->s3_frequency.load(std::memory_order_relaxed);
+            if (frequency < kMaxFrequency) {
+                node->s3_frequency.store(frequency + 1, std::memory_order_relaxed);
+            }
+        }
+
+        void remove(Node* node) { list_of(node).unlink(node); }
+
+        Node* victim(const Node* keep) {
+            // Every node moves at most once to main and is passed over at most kMaxFrequency + 1 times there
+            const size_t limit = (small_.size + main_.size) * (kMaxFrequency + 3);
+            for (size_t scanned = 0; scanned <= limit; ++scanned) {
+                const bool from_small =
+                    small_.size > 0 && (small_.size * 100 >= capacity() * kSmallPercent || main_.size == 0);
+                if (from_small) {
+                    Node* node = small_.tail;
+                    if (node == keep || node->s3_frequency.load(std::memory_order_relaxed) > 0) {
+                        small_.unlink(node);
+                        node->s3_frequency.store(0, std::memory_order_relaxed);
+                        push(node, true);
+                        continue;
+                    }
+                    ghosts_.push(node->hash);
+                    while (ghosts_.size() > main_target()) {
+                        ghosts_.pop_oldest();
+                    }
+                    return node;
+                }
+
+                Node* node = main_.tail;
+                if (node == nullptr) {
+                    return nullptr;
+                }
+                const uint8_t frequency = node->s3_frequency.load(std::memory_order_relaxed);
+                if (node == keep || frequency > 0) {
+                    if (node != keep) node->s3_frequency.store(frequency - 1, std::memory_order_relaxed);
+                    main_.unlink(node);
+                    main_.push_front(node);
+                    continue;
+                }
+                return node;
+            }
+            return nullptr;   // Only `keep` is left
+        }
+
+        template <typename F>
+        void for_each(F&& f) const {
+            small_.for_each_oldest(f);
+            main_.for_each_oldest(f);
+        }
+
+        void clear() {
+            small_ = PolicyList<Node>{};
+            main_ = PolicyList<Node>{};
+            ghosts_.clear();
+        }
+
+    private:
+        /// Entries the shard holds; when unknown, as many as it holds now.
+        size_t capacity() const { return std::max(capacity_, small_.size + main_.size); }
+
+        size_t main_target() const { return std::max<size_t>(1, capacity() - capacity() * kSmallPercent / 100); }
+
+        PolicyList<Node>& list_of(const Node* node) { return node->s3_main ? main_ : small_; }
+
+        void push(Node* node, bool main) {
+            node->s3_main = main;
+            list_of(node).push_front(node);
+        }
+
+        PolicyList<Node> small_;   ///< Probation FIFO for new keys
+        PolicyList<Node> main_;    ///< FIFO with second chance for keys that proved themselves
+        GhostList ghosts_;         ///< Keys evicted from small without a hit, at most main's size
+        size_t capacity_ = 0;
+    };
+};
+
+#endif // EVICTION_POLICY_H
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef FREQUENCY_SKETCH_H
+#define FREQUENCY_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Count-min sketch of 4-bit counters estimating how often a key was seen
+ * recently (the TinyLFU frequency filter).
+ *
+ * Each key maps to one counter in each of 4 rows; its estimate is the
+ * minimum of those counters. Increments are conservative (only the counters
+ * equal to the minimum grow), which keeps over-estimation from collisions
+ * low. After every sample_size() increments all counters are halved, so old
+ * popularity fades and the sketch follows the current workload.
+ *
+ * Keys are identified by their hash. Not thread-safe: the cache keeps one
+ * sketch per shard and only touches it under the shard lock.
+ */
+class FrequencySketch {
+public:
+    static constexpr unsigned kDepth = 4;          ///< Counters per key
+    static constexpr unsigned kMaxCount = 15;      ///< Counter saturation value
+    static constexpr size_t kSampleFactor = 10;    ///< Increments per counter between agings
+
+    /**
+     * @param expected_items Number of distinct keys the owner can hold;
+     *                       sizes each row to the next power of two
+     */
+    explicit FrequencySketch(size_t expected_items);
+
+    /// Record one occurrence of the key.
+    void increment(size_t hash);
+
+    /// @return estimated recent occurrences of the key, in [0, kMaxCount]
+    unsigned frequency(size_t hash) const;
+
+    /// @return counters per row
+    size_t width() const { return width_; }
+
+    /// @return increments between two agings
+    size_t sample_size() const { return sample_size_; }
+
+private:
+    /// Index of the key's counter in the given row, over all rows.
+    size_t counter_index(size_t hash, unsigned row) const;
+    unsigned counter(size_t index) const;
+
+    /// Halve every counter.
+    void age();
+
+    std::vector<uint64_t> table_;    ///< 16 counters per word, rows laid out back to back
+    size_t width_;                   ///< Counters per row, a power of two
+    size_t sample_size_;
+    size_t additions_ = 0;           ///< Increments since the last aging
+};
+
+#endif // FREQUENCY_SKETCH_H
@@ -0,0 +1,159 @@
+#pragma once
+#ifndef HOT_KEYS_H
+#define HOT_KEYS_H
+
+#include "metrics.h"
+#include "value_ref.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Hot-key detection and per-thread near caches.
+ *
+ * Detection: one read in `sample_every` (counted per thread) is fed to a
+ * Space-Saving top-K sketch. Every `window_samples` samples the keys with
+ * at least 1% of the window's samples (at most K of them) become the hot
+ * set, and the counts are halved so the set follows the workload.
+ *
+ * Near caches: every thread keeps a small private copy of the hot keys it
+ * has read. A near-cache hit reads only thread-private memory plus two
+ * read-mostly words (the generation and the key's version slot), so a key
+ * read by every thread no longer funnels them all into one shard lock and
+ * one index bucket.
+ *
+ * Invalidation is by version stamp. Keys hash to one of kSlots version
+ * slots; the owning cache calls invalidate() for every key it updates or
+ * removes, under the shard lock, which bumps the slot when the slot is
+ * marked hot. A near-cache entry remembers the slot version it was filled
+ * at and is dropped once they differ. Changing the hot set bumps the
+ * generation, which empties every near cache. A fill takes both stamps and
+ * then checks that the slot is still hot, so a copy is only ever stored
+ * under a generation whose writes bump the slot's version.
+ *
+ * Thread-safe; the sketch sits behind a mutex that samples only try to take.
+ */
+class HotKeyTracker {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t kSampleEvery = 64;      ///< Default: one read in this many is sampled
+    static constexpr uint32_t kWindowSamples = 1024;  ///< Default: samples between hot-set refreshes
+    static constexpr size_t kSlots = 1024;            ///< Version slots keys hash into
+
+    /// A key of the current hot set.
+    struct HotKey {
+        std::string key;
+        uint64_t samples = 0;   ///< Sampled reads counted for it (decayed), an estimate
+    };
+
+    /**
+     * @param capacity       Maximum number of hot keys (K), also the size of each near cache
+     * @param sample_every   Sample one read in this many
+     * @param window_samples Samples between two refreshes of the hot set
+     */
+    explicit HotKeyTracker(size_t capacity, uint32_t sample_every = kSampleEvery,
+                           uint32_t window_samples = kWindowSamples);
+
+    HotKeyTracker(const HotKeyTracker&) = delete;
+    HotKeyTracker& operator=(const HotKeyTracker&) = delete;
+
+    /**
+     * Count a read. Sampled reads are recorded in the sketch and should take
+     * the cache's regular path, which keeps hot entries warm in the eviction
+     * policy while their other reads are served from near caches.
+     * @return true if this read was sampled
+     */
+    bool sample(std::string_view key, size_t hash);
+
+    /**
+     * Look the key up in the calling thread's near cache.
+     * @param now Current time; entries past their expiry are dropped
+     * @return private copy of the value, nullopt if absent or stale
+     */
+    std::optional<ValueRef> near_get(std::string_view key, size_t hash, clock::time_point now);
+
+    /// @return true if the key's slot is marked hot, i.e. a read of it should fill the near cache
+    bool is_hot(size_t hash) const;
+
+    /// Stamps to take before reading the value a near cache is filled with.
+    struct Ticket {
+        uint64_t generation = 0;
+        uint64_t version = 0;
+    };
+
+    /**
+     * @return the current stamps of the key's slot, or nullopt if the slot
+     *         is no longer hot: a copy filled then would not be invalidated
+     *         by later writes, so the fill must be skipped
+     */
+    std::optional<Ticket> begin_fill(size_t hash) const;
+
+    /**
+     * Store a value read after begin_fill() in the calling thread's near
+     * cache. The value is copied into a block private to the thread.
+     */
+    void near_put(std::string_view key, size_t hash, const Ticket& ticket, std::string_view value,
+                  clock::time_point expiry, uint32_t flags = 0);
+
+    /// Invalidate near copies of the key. Called by the cache whenever the key's entry changes.
+    void invalidate(size_t hash) {
+        if (is_hot(hash)) {
+            versions_[slot_of(hash)].fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    /// Invalidate every near copy (the cache was cleared).
+    void invalidate_all();
+
+    /// @return the current hot set, hottest first
+    std::vector<HotKey> hot_keys() const;
+
+    /// @return maximum number of hot keys
+    size_t capacity() const { return capacity_; }
+
+    /// @return reads served from near caches
+    uint64_t near_hits() const { return near_hits_.value(); }
+
+    /// @return near-cache lookups, hits included
+    uint64_t near_lookups() const { return near_lookups_.value(); }
+
+private:
+    /// One Space-Saving counter.
+    struct Candidate {
+        std::string key;
+        size_t hash = 0;
+        uint64_t count = 0;
+        uint64_t error = 0;   ///< Count inherited from the evicted key: at least count - error were its own
+    };
+
+    static size_t slot_of(size_t hash) { return hash % kSlots; }
+
+    void record(std::string_view key, size_t hash);
+    void refresh();   // Caller holds mutex_
+
+    const size_t capacity_;
+    const uint32_t sample_every_;
+    const uint32_t window_samples_;
+    const uint64_t id_;                               ///< Tells this tracker's near caches apart
+
+    mutable std::mutex mutex_;                        ///< Protects the sketch and hot_
+    std::vector<Candidate> candidates_;               ///< Space-Saving counters, at most 4K
+    uint32_t window_count_ = 0;                       ///< Samples since the last refresh
+    std::vector<HotKey> hot_;                         ///< Published hot set
+
+    alignas(64) std::atomic<uint64_t> generation_{1}; ///< Bumped when the hot set changes
+    std::atomic<uint64_t> hot_bits_[kSlots / 64] = {}; ///< Slots of the hot keys
+    std::atomic<uint64_t> versions_[kSlots] = {};     ///< Per slot, bumped on writes to hot keys
+
+    Counter near_hits_;
+    Counter near_lookups_;
+};
+
+#endif // HOT_KEYS_H
@@ -0,0 +1,210 @@
+#pragma once
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+/**
+ * Asynchronous logger: logging a message never makes a system call or
+ * takes a lock.
+ *
+ * Every thread that logs gets its own ring of fixed-size records (claimed
+ * on first use, handed back when the thread exits). The message is built
+ * straight into the next free record and published with a release store,
+ * so the only shared state a call touches is its own ring. A background
+ * thread wakes every few milliseconds, formats what the rings hold and
+ * hands it to the sink in one write per batch. When a ring is full the
+ * message is dropped and counted: logging never waits for the sink.
+ *
+ * Messages are concatenations of strings and integers, and are cut at
+ * kMaxMessage bytes. Access logs (one line per request) go through
+ * access(), which also applies the sampling rate.
+ */
+class Logger {
+public:
+    /// Receives formatted lines, a batch at a time. Called from the logger's own thread.
+    using Sink = std::function<void(std::string_view batch)>;
+
+    static constexpr size_t kMaxMessage = 232;          ///< Longer messages are cut
+    static constexpr size_t kDefaultRingRecords = 512;  ///< Per thread
+
+    /**
+     * @param sink         Where lines go (null = standard error)
+     * @param ring_records Records per thread ring, rounded up to a power of two
+     */
+    explicit Logger(Sink sink = nullptr, size_t ring_records = kDefaultRingRecords);
+
+    /// Writes what the rings still hold, then stops the background thread.
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /// @return the process-wide logger, writing to standard error
+    static Logger& global();
+
+    /// @return level for "debug", "info", "warn", "error" or "off"
+    static std::optional<LogLevel> parse_level(std::string_view name);
+
+    /// Messages below this level are discarded at the call site.
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+
+    /// Log one in `every` access lines per thread (1 = all, 0 = none).
+    void set_access_sampling(uint32_t every) { access_every_.store(every, std::memory_order_relaxed); }
+    uint32_t access_sampling() const { return access_every_.load(std::memory_order_relaxed); }
+
+    bool enabled(LogLevel level) const { return level >= this->level() && level != LogLevel::Off; }
+
+    /// Log the concatenation of `parts` (strings, characters and integers).
+    template <typename... Parts>
+    void log(LogLevel level, const Parts&... parts) {
+        if (!enabled(level)) return;
+        Ring& ring = local_ring();
+        write(ring, level, parts...);
+    }
+
+    /// Log an access line at INFO level, subject to access sampling.
+    template <typename... Parts>
+    void access(const Parts&... parts) {
+        const uint32_t every = access_sampling();
+        if (every == 0 || !enabled(LogLevel::Info)) return;
+        Ring& ring = local_ring();
+        if (++ring.access_seen % every != 0) return;
+        write(ring, LogLevel::Info, parts...);
+    }
+
+    /// Write everything logged so far (by any thread) to the sink before returning.
+    void flush();
+
+    /// @return messages dropped because their thread's ring was full
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /// @return messages handed to the sink
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    struct Record {
+        int64_t time_ms;      ///< Wall clock, ms since the epoch
+        LogLevel level;
+        uint8_t length;       ///< Bytes of text in use
+        char text[kMaxMessage];
+    };
+
+    /// Single-producer single-consumer ring: the owning thread writes, whoever holds drain_mutex_ reads.
+    struct Ring {
+        explicit Ring(size_t records);
+
+        alignas(64) std::atomic<uint64_t> tail{0};   ///< Next record to write, producer only
+        uint64_t access_seen = 0;                    ///< Access lines seen, for sampling; producer only
+        alignas(64) std::atomic<uint64_t> head{0};   ///< Next record to read, consumer only
+        std::atomic<bool> owned{true};               ///< A live thread writes here
+        std::unique_ptr<Record[]> records;
+        uint64_t mask;
+    };
+
+    /// Ring of the calling thread, claimed on first use.
+    Ring& local_ring() {
+        thread_local ThreadRings mine;
+        if (mine.last_logger != id_) {
+            mine.last_ring = &mine.find(*this);
+            mine.last_logger = id_;
+        }
+        return *mine.last_ring;
+    }
+
+    /// Rings a thread writes to, one per logger; handed back when the thread exits.
+    struct ThreadRings {
+        uint64_t last_logger = 0;
+        Ring* last_ring = nullptr;
+        std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+
+        Ring& find(Logger& logger);
+        ~ThreadRings();
+    };
+
+    /// Find a ring handed back by an exited thread, or add one.
+    std::shared_ptr<Ring> claim_ring();
+
+    template <typename... Parts>
+    void write(Ring& ring, LogLevel level, const Parts&... parts) {
+        const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail - ring.head.load(std::memory_order_acquire) > ring.mask) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& record = ring.records[tail & ring.mask];
+        record.time_ms = now_ms();
+        record.level = level;
+        size_t length = 0;
+        (append(record.text, length, parts), ...);
+        record.length = static_cast<uint8_t>(length);
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+    template <typename T>
+    static void append(char* text, size_t& length, const T& part) {
+        if constexpr (std::is_same_v<T, char>) {
+            if (length < kMaxMessage) text[length++] = part;
+        } else if constexpr (std::is_integral_v<T>) {
+            const auto result = std::to_chars(text + length, text + kMaxMessage, part);
+            if (result.ec == std::errc()) length = static_cast<size_t>(result.ptr - text);
+        } else {
+            const std::string_view view(part);
+            const size_t n = std::min(view.size(), kMaxMessage - length);
+            std::memcpy(text + length, view.data(), n);
+            length += n;
+        }
+    }
+
+    static int64_t now_ms();
+
+    /// Background thread: drain every few milliseconds until stopped.
+    void run();
+
+    /// Format what every ring holds and hand it to the sink. Caller holds drain_mutex_.
+    void drain();
+
+    const uint64_t id_;   ///< Unique per logger, keys the threads' cached ring
+    const size_t ring_records_;
+    Sink sink_;
+    std::atomic<LogLevel> level_{LogLevel::Info};
+    std::atomic<uint32_t> access_every_{1};
+
+    std::mutex rings_mutex_;                      ///< Protects rings_ (claiming only)
+    std::vector<std::shared_ptr<Ring>> rings_;    ///< Every ring ever claimed, reused once handed back
+
+    std::mutex drain_mutex_;                      ///< One drain at a time; also the rings' consumer side
+    std::string batch_;                           ///< Formatting buffer, under drain_mutex_
+    int64_t stamp_second_ = -1;                   ///< Second stamp_ was formatted for
+    char stamp_[24] = {};                         ///< "[YYYY-MM-DD HH:MM:SS] "
+    uint64_t dropped_reported_ = 0;               ///< Drops already reported in the log
+
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> written_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,136 @@
+#pragma once
+#ifndef MEMCACHED_SERVER_H
+#define MEMCACHED_SERVER_H
+
+#include "cache.h"
+#include "metrics.h"
+#include "replication.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * memcached text protocol front end for a Cache, next to the REST API.
+ *
+ * Commands: get / gets (any number of keys), set, delete, incr, decr,
+ * version and quit, with memcached's replies and error strings. Values are
+ * stored as is, so the REST API and memcached clients see the same bytes.
+ * The 32-bit flags of a set are kept in the value's block header and
+ * echoed by get / gets; incr / decr keep them, writes from the REST API
+ * reset them to 0. The cas unique of gets is a hash of the flags and
+ * value, and there is no cas command.
+ *
+ * Writes are forwarded to the followers like the REST API's: set as a raw
+ * PUT with its TTL, delete as a DELETE, and incr / decr as a PUT of the new
+ * value with the TTL the key has left. As with the REST handlers, the I/O
+ * thread waits for the followers before answering.
+ *
+ * I/O: a few I/O threads, each with its own epoll set in edge-triggered
+ * mode. They share the listening socket (EPOLLEXCLUSIVE wakes one of them
+ * per burst of connections) and keep every connection they accept.
+ * A readiness event reads until the socket runs dry and answers every
+ * complete command in the buffer in order (pipelining). The replies
+ * collect in an output queue that goes out in one gather write per batch.
+ * Small values are copied into the queue. Larger ones are queued as
+ * ValueRefs and sent straight from the cache's block. A batch queues at
+ * most 4 MiB of replies, and a connection whose replies cannot be sent is
+ * not read again until the client catches up.
+ *
+ * Linux only (epoll); start() throws elsewhere.
+ */
+class MemcachedServer {
+public:
+    /**
+     * @param cache       Cache to serve
+     * @param io_threads  Number of I/O threads (0 = up to 4, one per core)
+     * @param replication If set, writes are forwarded to its followers
+     */
+    explicit MemcachedServer(std::shared_ptr<Cache> cache, size_t io_threads = 0,
+                             ReplicationManager* replication = nullptr);
+
+    /// Stops the server if it is running.
+    ~MemcachedServer();
+
+    MemcachedServer(const MemcachedServer&) = delete;
+    MemcachedServer& operator=(const MemcachedServer&) = delete;
+
+    /**
+     * Bind, listen and start the I/O threads; returns once connections are accepted.
+     * @param host Address to bind (IPv4)
+     * @param port Port to bind (0 = any free port, see port())
+     * @throws std::runtime_error if the socket cannot be set up
+     */
+    void start(const std::string& host, int port);
+
+    /// Close every connection and stop the I/O threads.
+    void stop();
+
+    /// @return the bound port (after start())
+    int port() const { return port_; }
+
+    /// @return connections currently open
+    size_t connections() const { return connections_.load(std::memory_order_relaxed); }
+
+    /// @return commands answered since start
+    uint64_t commands() const { return commands_.value(); }
+
+    /// Forward writes to the followers of `replication` from now on (null: stop forwarding).
+    void set_replication(ReplicationManager* replication) {
+        replication_.store(replication, std::memory_order_release);
+    }
+
+private:
+    struct Connection;
+
+    /// One I/O thread and its epoll set.
+    struct Worker {
+        int epoll_fd = -1;
+        std::thread thread;
+    };
+
+    /// Event loop of one I/O thread.
+    void run(Worker& worker);
+
+    /// Accept every pending connection into the worker's epoll set.
+    void accept_all(Worker& worker, std::unordered_map<int, std::unique_ptr<Connection>>& owned);
+
+    /**
+     * Read, answer and write until the connection would block.
+     * @return false if the connection is to be closed
+     */
+    bool serve(Connection& conn);
+
+    /// Answer the complete commands in the input buffer, in order.
+    void process(Connection& conn);
+
+    /**
+     * Answer one command line; `rest` is the input after it (a set's data block).
+     * @return bytes of `rest` consumed, or kNeedMore if the data block is incomplete
+     */
+    size_t execute(Connection& conn, std::string_view line, std::string_view rest);
+
+    /// get / gets.
+    void retrieve(Connection& conn, bool with_cas);
+
+    /// Send queued replies until the queue is empty or the socket is full. @return false on error
+    bool flush(Connection& conn);
+
+    static constexpr size_t kNeedMore = static_cast<size_t>(-1);
+
+    std::shared_ptr<Cache> cache_;
+    std::atomic<ReplicationManager*> replication_;  ///< Set once its followers are added
+    size_t io_threads_;
+    int listen_fd_ = -1;
+    int stop_fd_ = -1;                        ///< eventfd every epoll set watches; written once to stop
+    int port_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> connections_{0};
+    Counter commands_;
+};
+
+#endif // MEMCACHED_SERVER_H
@@ -0,0 +1,211 @@
+#pragma once
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Number of slots every striped metric has: hardware threads rounded up to a power of two, at most 64.
+size_t metric_stripe_count();
+
+/// Stripe index of a new thread, assigned round-robin.
+size_t assign_metric_stripe();
+
+/// Slot the calling thread writes to, fixed on the thread's first update.
+inline size_t metric_stripe() {
+    static thread_local const size_t stripe = assign_metric_stripe();
+    return stripe;
+}
+
+/**
+ * Monotonic counter split over cache-line padded per-thread slots.
+ *
+ * Increments touch only the calling thread's slot, so hot counters do not
+ * bounce a shared line between cores; value() sums the slots.
+ */
+class Counter {
+public:
+    Counter() : slots_(std::make_unique<Slot[]>(metric_stripe_count())) {}
+
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void inc(uint64_t n = 1) { slots_[metric_stripe()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    /// @return sum over the slots (not a point-in-time snapshot under concurrent updates)
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+};
+
+/**
+ * Up/down gauge with the same striped layout as Counter. Meant for values
+ * that are adjusted from many threads (requests in flight); values owned by
+ * one place are better exposed through MetricsRegistry::gauge_fn().
+ */
+class Gauge {
+public:
+    Gauge() : slots_(std::make_unique<Slot[]>(metric_stripe_count())) {}
+
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void add(int64_t n) { slots_[metric_stripe()].value.fetch_add(n, std::memory_order_relaxed); }
+    void inc() { add(1); }
+    void dec() { add(-1); }
+
+    /// @return sum over the slots
+    int64_t value() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<int64_t> value{0};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+};
+
+/**
+ * Histogram with fixed upper bounds, striped like Counter: each thread's
+ * slot holds its own bucket counts and sum on cache lines of its own.
+ */
+class Histogram {
+public:
+    /// Cumulative view of the buckets, as Prometheus renders them.
+    struct Snapshot {
+        std::vector<double> bounds;     ///< Upper bounds, ascending
+        std::vector<uint64_t> buckets;  ///< Cumulative count per bound, then +Inf
+        double sum = 0;                 ///< Sum of observed values
+        uint64_t count = 0;             ///< Number of observations
+    };
+
+    /// @param bounds Upper bounds of the buckets, sorted ascending; +Inf is implicit
+    explicit Histogram(std::vector<double> bounds);
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void observe(double value) {
+        size_t bucket = 0;
+        while (bucket < bounds_.size() && value > bounds_[bucket]) {
+            ++bucket;
+        }
+        const size_t stripe = metric_stripe();
+        cell(stripe, bucket).fetch_add(1, std::memory_order_relaxed);
+
+        // The sum is only contended by threads sharing the stripe
+        std::atomic<uint64_t>& sum = cell(stripe, bounds_.size() + 1);
+        uint64_t old_bits = sum.load(std::memory_order_relaxed);
+        uint64_t new_bits;
+        do {
+            double total;
+            std::memcpy(&total, &old_bits, sizeof(total));
+            total += value;
+            std::memcpy(&new_bits, &total, sizeof(total));
+        } while (!sum.compare_exchange_weak(old_bits, new_bits, std::memory_order_relaxed));
+    }
+
+    Snapshot snapshot() const;
+
+    /// Default latency bounds in seconds, 100 µs to 10 s.
+    static std::vector<double> latency_bounds();
+
+private:
+    // A stripe holds one count per bucket (+Inf last), then the sum as
+    // double bits, on cache lines of its own.
+    struct alignas(64) Line {
+        std::atomic<uint64_t> cells[8] = {};
+    };
+    static constexpr size_t kCellsPerLine = 8;
+
+    std::atomic<uint64_t>& cell(size_t stripe, size_t index) const {
+        return lines_[stripe * lines_per_stripe_ + index / kCellsPerLine].cells[index % kCellsPerLine];
+    }
+
+    std::vector<double> bounds_;
+    size_t lines_per_stripe_;
+    std::unique_ptr<Line[]> lines_;
+};
+
+/**
+ * Named metrics rendered in the Prometheus text format.
+ *
+ * Metrics are created once and updated through the returned reference,
+ * which stays valid for the registry's lifetime; the registry lock is only
+ * taken to register and to render. Values that already live elsewhere (the
+ * cache's own counters, memory in use) are registered as callbacks and read
+ * at render time.
+ *
+ * Labels are given pre-formatted, e.g. `method="GET"`; registering a name
+ * again with other labels adds a series to the same family.
+ */
+class MetricsRegistry {
+public:
+    /// One series of a callback family.
+    struct Sample {
+        std::string labels;   ///< Pre-formatted labels, empty for none
+        double value = 0;
+    };
+
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                         const std::string& labels = "");
+
+    /// Counter whose value is read from fn() at render time.
+    void counter_fn(const std::string& name, const std::string& help, std::function<double()> fn);
+
+    /// Gauge whose value is read from fn() at render time.
+    void gauge_fn(const std::string& name, const std::string& help, std::function<double()> fn);
+
+    /// Gauge family whose series (labels and values) are produced by fn() at render time.
+    void gauge_family_fn(const std::string& name, const std::string& help,
+                         std::function<std::vector<Sample>()> fn);
+
+    /// @return every family in registration order, in the Prometheus text format
+    std::string render() const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<std::unique_ptr<Series>> series;
+        std::function<std::vector<Sample>()> collect;   ///< Set for callback families
+    };
+
+    /// Family with this name, created with the given type and help if new.
+    Family& family(const std::string& name, const std::string& help, Type type);
+
+    Series& series(Family& family, const std::string& labels);
+
+    mutable std::mutex mutex_;                        ///< Protects families_ (not metric values)
+    std::vector<std::unique_ptr<Family>> families_;   ///< In registration order
+};
+
+#endif // METRICS_H
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Bounded lock-free queue for many producers and one consumer (Vyukov's
+ * bounded queue). Every slot carries a sequence number that says whose
+ * turn it is: producers claim a position with one CAS on the tail and
+ * publish with a release store of the slot's sequence; the consumer reads
+ * in order with no atomic read-modify-write at all.
+ *
+ * Head and tail sit on separate cache lines, so the consumer and the
+ * producers only meet on the slots themselves.
+ *
+ * @tparam T Element type, trivially copyable in practice (a pointer)
+ */
+template <typename T>
+class MpscQueue {
+public:
+    /// @param capacity Slots, rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        slots_ = std::make_unique<Slot[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * Append an element. Safe from any number of threads.
+     * @return false if the queue is full
+     */
+    bool try_push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // The consumer has not freed this slot yet
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);   // Another producer took it
+            }
+        }
+    }
+
+    /**
+     * Take the oldest element. Consumer thread only.
+     * @return false if the queue is empty (or its oldest element is still being written)
+     */
+    bool try_pop(T& value) {
+        Slot& slot = slots_[head_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return false;
+        }
+        value = slot.value;
+        slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);   // Free for the next lap
+        ++head_;
+        return true;
+    }
+
+    /// @return true if nothing is ready to pop. Consumer thread only.
+    bool empty() const {
+        return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+    /// @return number of slots
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};   ///< Next position producers claim
+    alignas(64) size_t head_ = 0;               ///< Next position the consumer reads
+};
+
+#endif // MPSC_QUEUE_H
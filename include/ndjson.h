@@ -0,0 +1,110 @@
+#pragma once
+#ifndef NDJSON_H
+#define NDJSON_H
+
+#include "cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * JSON escape sequence for one byte, empty if the byte is written as is.
+ * Matches nlohmann::json::dump(): control characters, quote and backslash.
+ */
+std::string_view json_escape(unsigned char c, char (&buf)[7]);
+
+/// @return true if the bytes are well-formed UTF-8, which is all a JSON string may hold
+bool is_utf8(std::string_view bytes);
+
+/**
+ * Append bytes as a quoted JSON string. Bytes that need no escape are
+ * copied as they are, which is valid JSON for UTF-8 input; with `latin1`,
+ * every byte of 0x80 and above is written as \u00XX instead, so the string
+ * has one character per byte and is valid JSON whatever the bytes.
+ */
+void append_json_string(std::string& out, std::string_view bytes, bool latin1 = false);
+
+/**
+ * Append one bulk export record, newline included:
+ * {"key":"<key>","value":"<value>","ttl":<remaining ms, 0 = none>}
+ *
+ * When the key or the value is not UTF-8, both are written as latin1
+ * strings (see append_json_string) and the record starts with
+ * "encoding":"latin1": a reader gets the bytes back by encoding each
+ * string as Latin-1.
+ */
+void append_ndjson_record(std::string& out, std::string_view key, std::string_view value, uint64_t ttl_ms);
+
+/**
+ * Incremental reader of a bulk import body: newline-delimited records in
+ * the format append_ndjson_record() writes. The fields may come in any
+ * order, "ttl" and "encoding" may be left out, and blank lines are skipped.
+ *
+ * The body is fed as it arrives, in pieces cut anywhere; only a line split
+ * across pieces is copied. Records are parsed straight into a batch whose
+ * strings are reused, and every full batch is handed to the sink, so memory
+ * stays at one batch and one line whatever the body size.
+ *
+ * Strings are parsed by a small dedicated parser rather than a JSON DOM:
+ * besides being faster, it decodes latin1 records back to bytes, and takes
+ * any byte that is not a quote or a backslash as is, so raw non-UTF-8
+ * bytes written by older exports are still imported unchanged.
+ */
+class NdjsonImporter {
+public:
+    /// Receives each batch; the views are valid during the call only.
+    using Sink = std::function<void(const std::vector<CacheItem>&)>;
+
+    static constexpr size_t kDefaultBatch = 1024;
+    static constexpr size_t kMaxLineBytes = 64 * 1024 * 1024;
+
+    /**
+     * @param sink  Stores a batch of records
+     * @param batch Records per batch
+     */
+    explicit NdjsonImporter(Sink sink, size_t batch = kDefaultBatch);
+
+    /**
+     * Parse the complete lines in the next piece of the body.
+     * @throws std::invalid_argument for a malformed line (or one over
+     *         kMaxLineBytes), naming its line number; the records before it
+     *         have been handed to the sink by then
+     */
+    void feed(std::string_view data);
+
+    /// End of the body: parse a last line without newline and hand over the rest. @throws like feed()
+    void finish();
+
+    /// @return records handed to the sink so far
+    uint64_t records() const { return records_; }
+
+private:
+    struct Record {
+        std::string key;
+        std::string value;
+        uint64_t ttl_ms = 0;
+    };
+
+    /// Parse one line (no newline) into the batch, flushing it when full.
+    void add_line(std::string_view line);
+
+    /// Hand the batch to the sink.
+    void flush();
+
+    /// Flush what parsed fine, then throw for the current line.
+    [[noreturn]] void fail(const char* what);
+
+    Sink sink_;
+    size_t batch_size_;
+    std::vector<Record> batch_;      ///< Parsed records; only the first `pending_` are current
+    size_t pending_ = 0;
+    std::vector<CacheItem> items_;   ///< Views of the batch handed to the sink
+    std::string partial_;            ///< Line cut by the end of the previous piece
+    uint64_t line_ = 0;              ///< Lines seen
+    uint64_t records_ = 0;
+};
+
+#endif // NDJSON_H
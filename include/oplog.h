@@ -0,0 +1,147 @@
+#pragma once
+#ifndef OPLOG_H
+#define OPLOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "cache.h"
+
+/**
+ * When the operation log reaches stable storage.
+ */
+enum class FsyncPolicy {
+    ALWAYS,    ///< A write returns once its record is synced; concurrent writers share one sync
+    EVERYSEC,  ///< Synced at most once per second: a crash loses up to about a second of writes
+    NO         ///< Never synced explicitly; the OS flushes when it wants
+};
+
+/// Outcome of OpLog::replay().
+struct OpLogReplayResult {
+    size_t puts = 0;              ///< Put records applied
+    size_t erases = 0;            ///< Erase records applied, expired puts included
+    size_t valid_bytes = 0;       ///< Length of the log up to the last intact record
+    size_t truncated_bytes = 0;   ///< Torn or corrupt tail after it
+};
+
+/**
+ * Append-only log of put / erase operations for durable restarts.
+ *
+ * Writes go through the OpLog, which applies them to the cache and appends
+ * a record while holding a lock striped by key, so the log order matches
+ * the order the cache saw for every key. Appending only copies the record
+ * into a buffer; a background writer hands the whole buffer to the file
+ * and syncs once per batch (group commit) according to the FsyncPolicy.
+ *
+ * Records carry absolute (wall-clock) expiry times and a checksum. Once the
+ * log has doubled since the last rewrite (and is at least 64 MiB), it is
+ * rewritten in the background from the live cache contents, with the
+ * writes made meanwhile appended after them, and swapped in atomically.
+ *
+ * File layout (integers little-endian):
+ *
+ *     header  "DCPPOLOG"  u32 version  u32 reserved
+ *     record  u32 checksum  u8 op  u32 key_len  u32 value_len  i64 expires_at_ms  key  value
+ */
+class OpLog {
+public:
+    /**
+     * Open the log at `path`, replaying it into the cache first if it
+     * exists (a torn tail is cut off). A new log starts with a rewrite, so
+     * it also covers what the cache already holds (e.g. from a snapshot).
+     * @param replayed If not null, receives the replay outcome
+     * @throws std::runtime_error if the file is not an operation log or cannot be opened
+     */
+    OpLog(std::shared_ptr<Cache> cache, std::string path, FsyncPolicy policy,
+          OpLogReplayResult* replayed = nullptr);
+
+    /// Flushes and syncs what is buffered, then stops the background threads.
+    ~OpLog();
+
+    OpLog(const OpLog&) = delete;
+    OpLog& operator=(const OpLog&) = delete;
+
+    // ---------------- Logged writes ----------------
+    // Same semantics as the Cache methods of the same name.
+
+    void put(std::string_view key, std::string_view value, uint64_t ttl_ms = 0);
+    void multi_put(const std::vector<CacheItem>& items);
+    bool erase(std::string_view key);
+    size_t multi_erase(const std::vector<std::string_view>& keys);
+
+    /**
+     * Rewrite the log from the live cache contents and swap it in.
+     * @return false if a rewrite was already running
+     * @throws std::runtime_error on I/O failure (the current log is kept)
+     */
+    bool rewrite();
+
+    /// @return current length of the log file in bytes
+    uint64_t size_bytes() const;
+
+    /// @return sync policy selected at construction
+    FsyncPolicy policy() const;
+
+    /**
+     * Apply a log to the cache. The file is mmap'ed and parsed in one
+     * pass; records are handed in batches to worker threads, each owning a
+     * subset of the shards, so replay runs in parallel while keeping the
+     * per-key order. Parsing stops at the first torn or corrupt record.
+     * @param threads Worker count (0 = hardware threads), capped at the shard count
+     * @throws std::runtime_error if the file is not an operation log
+     */
+    static OpLogReplayResult replay(Cache& cache, const std::string& path, size_t threads = 0);
+
+private:
+    static constexpr size_t kKeyStripes = 256;
+
+    /// Locks for every stripe the keys fall in, taken in stripe order.
+    std::vector<std::unique_lock<std::mutex>> lock_keys(const std::vector<std::string_view>& keys);
+
+    /// Buffer a record for the writer. @return its sequence number
+    uint64_t append(std::string_view record);
+
+    /// Block until the record with this sequence number is synced (ALWAYS only).
+    void wait_durable(uint64_t seq);
+
+    void writer_loop();
+
+    /// Rewrite body; PRECONDITION: rewriting_ was set by the caller.
+    void do_rewrite();
+
+    /// (Re)open path_ for appending.
+    void open_for_append();
+
+    std::shared_ptr<Cache> cache_;
+    std::string path_;
+    FsyncPolicy policy_;
+    std::unique_ptr<std::mutex[]> key_locks_;     ///< Orders apply + append per key
+
+    mutable std::mutex mutex_;                    ///< Protects everything below except file_
+    std::condition_variable wake_writer_;
+    std::condition_variable durable_;             ///< Signalled when durable_seq_ advances
+    std::string pending_;                         ///< Encoded records not yet handed to the file
+    std::string tail_;                            ///< Records appended while a rewrite runs
+    uint64_t appended_seq_ = 0;                   ///< Last record buffered
+    uint64_t durable_seq_ = 0;                    ///< Last record written (and synced under ALWAYS)
+    uint64_t bytes_ = 0;                          ///< File length
+    uint64_t rewrite_base_bytes_ = 0;             ///< File length after the last rewrite
+    uint64_t rewrites_ = 0;                       ///< Completed rewrites (file generation)
+    bool rewriting_ = false;
+    bool stopping_ = false;
+
+    std::mutex io_mutex_;                         ///< Serializes use of file_ (writer vs rewrite swap)
+    std::FILE* file_ = nullptr;
+
+    std::thread writer_;
+    std::thread rewriter_;                        ///< Background rewrite started by the writer
+};
+
+#endif // OPLOG_H
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include "metrics.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Per-client token buckets. Each client (e.g. a remote address) may make
+ * `burst` requests at once and `rate` requests per second on average; a
+ * request that finds its bucket empty is refused.
+ *
+ * Buckets are spread over independently locked stripes by client hash, and
+ * are refilled lazily when the client comes back. A stripe drops the
+ * buckets of clients idle long enough to be full again once it holds more
+ * than a few thousand of them.
+ */
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param rate  Tokens added per second
+     * @param burst Bucket size (at least 1)
+     */
+    RateLimiter(double rate, double burst);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /// Take a token from the client's bucket. @return false if it was empty
+    bool allow(const std::string& client, Clock::time_point now = Clock::now());
+
+    /// @return clients with a bucket
+    size_t clients() const;
+
+    /// @return requests refused since construction
+    uint64_t refused() const { return refused_.value(); }
+
+private:
+    static constexpr size_t kStripes = 16;
+    static constexpr size_t kSweepAbove = 4096;   ///< Per stripe
+
+    struct Bucket {
+        double tokens;
+        Clock::time_point updated;
+    };
+
+    struct Stripe {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Bucket> buckets;
+    };
+
+    /// Drop the buckets that have refilled completely. Caller holds the stripe lock.
+    void sweep(Stripe& stripe, Clock::time_point now);
+
+    const double rate_;
+    const double burst_;
+    Stripe stripes_[kStripes];
+    Counter refused_;
+};
+
+#endif // RATE_LIMITER_H
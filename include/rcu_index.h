@@ -0,0 +1,198 @@
+#pragma once
+#ifndef RCU_INDEX_H
+#define RCU_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "epoch.h"
+
+/**
+ * Open-addressing hash index over intrusive nodes that readers probe with
+ * no lock, while a single writer at a time (the cache's shard lock)
+ * inserts and erases.
+ *
+ * Slots are atomic node pointers probed linearly from the hash; an erased
+ * slot holds a tombstone so probes keep going past it. A node is published
+ * with a release store, so a reader that finds it also sees everything
+ * written to it before insert(). Growing or cleaning up tombstones builds a
+ * new table, swaps it in and retires the old one to the EpochDomain;
+ * readers must therefore be pinned (EpochDomain::pin) while they probe and
+ * while they use what they found, and erased nodes must be retired rather
+ * than freed by the owner.
+ *
+ * @tparam Node Node type
+ * @tparam Hash Pointer to the node's cached hash member
+ */
+template <typename Node, size_t Node::*Hash>
+class RcuIndex {
+public:
+    static constexpr size_t kMinCapacity = 16;
+
+    RcuIndex() : table_(new Table(kMinCapacity)) {}
+
+    ~RcuIndex() { delete table_.load(std::memory_order_relaxed); }
+
+    RcuIndex(const RcuIndex&) = delete;
+    RcuIndex& operator=(const RcuIndex&) = delete;
+
+    /**
+     * Find the node with this hash for which eq(node) is true. Safe to call
+     * concurrently with the writer while pinned.
+     * @return the node, nullptr if absent
+     */
+    template <typename Eq>
+    Node* find(size_t hash, Eq&& eq) const {
+        const Table* table = table_.load(std::memory_order_acquire);
+        for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+            Node* node = table->slots[i].load(std::memory_order_acquire);
+            if (node == nullptr) {
+                return nullptr;
+            }
+            if (node != tombstone() && node->*Hash == hash && eq(node)) {
+                return node;
+            }
+        }
+    }
+
+    /**
+     * Add a node. Writer only.
+     * PRECONDITION: no node with an equal key is indexed.
+     */
+    void insert(Node* node) {
+        Table* table = table_.load(std::memory_order_relaxed);
+        if (size_ + tombstones_ + 1 > max_load(*table)) {
+            // Mostly tombstones: clean up at the same size, otherwise double
+            table = rebuild(size_ + 1 > max_load(*table) / 2 ? table->capacity() * 2 : table->capacity());
+        }
+        if (place(*table, node)) {
+            --tombstones_;
+        }
+        ++size_;
+    }
+
+    /// Remove a node by identity. Writer only. @return false if it was not indexed.
+    bool erase(const Node* node) {
+        Table* table = table_.load(std::memory_order_relaxed);
+        for (size_t i = node->*Hash & table->mask;; i = (i + 1) & table->mask) {
+            Node* slot = table->slots[i].load(std::memory_order_relaxed);
+            if (slot == nullptr) {
+                return false;
+            }
+            if (slot == node) {
+                table->slots[i].store(tombstone(), std::memory_order_release);
+                --size_;
+                ++tombstones_;
+                return true;
+            }
+        }
+    }
+
+    /// Forget every node (the owner retires them) and shrink back. Writer only.
+    void clear() {
+        Table* old = table_.exchange(new Table(kMinCapacity), std::memory_order_acq_rel);
+        EpochDomain::global().retire(old);
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    /// @return number of indexed nodes (writer's view)
+    size_t size() const { return size_; }
+
+    /// @return number of slots
+    size_t capacity() const { return table_.load(std::memory_order_relaxed)->capacity(); }
+
+    /**
+     * Call fn(node) for the nodes whose home slot is one of the next `slots`
+     * slots from `cursor`, starting from 0, in the reverse-binary order of
+     * SwissIndex::scan and with the same guarantee across rebuilds. Caller
+     * holds what excludes the writer (the shard lock).
+     * @return the cursor to continue from, 0 once every slot was visited
+     */
+    template <typename F>
+    size_t scan(size_t cursor, size_t slots, F&& fn) const {
+        const Table* table = table_.load(std::memory_order_relaxed);
+        do {
+            // Nodes of a home slot sit in the run that follows it, up to the next empty slot
+            const size_t home = cursor & table->mask;
+            for (size_t i = home;; i = (i + 1) & table->mask) {
+                Node* node = table->slots[i].load(std::memory_order_relaxed);
+                if (node == nullptr) {
+                    break;
+                }
+                if (node != tombstone() && (node->*Hash & table->mask) == home) {
+                    fn(static_cast<const Node*>(node));
+                }
+            }
+            cursor = next_in_reverse_binary(home, table->mask);
+        } while (cursor != 0 && --slots > 0);
+        return cursor;
+    }
+
+private:
+    struct Table {
+        explicit Table(size_t capacity)
+            : mask(capacity - 1), slots(std::make_unique<std::atomic<Node*>[]>(capacity)) {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        size_t capacity() const { return mask + 1; }
+
+        size_t mask;                                   ///< Capacity - 1, capacity a power of two
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+    };
+
+    /// Marker for an erased slot; never dereferenced.
+    static Node* tombstone() {
+        static char marker;
+        return reinterpret_cast<Node*>(&marker);
+    }
+
+    /// Add one to `slot` counting from its top bit down. @return 0 after the last slot
+    static size_t next_in_reverse_binary(size_t slot, size_t mask) {
+        for (size_t bit = (mask + 1) >> 1; bit != 0; bit >>= 1) {
+            slot ^= bit;
+            if ((slot & bit) != 0) {
+                return slot;
+            }
+        }
+        return 0;
+    }
+
+    static size_t max_load(const Table& table) { return table.capacity() - table.capacity() / 4; }   // 3/4
+
+    /// Store a node in the first free slot of its probe. @return true if that slot was a tombstone
+    static bool place(Table& table, Node* node) {
+        for (size_t i = node->*Hash & table.mask;; i = (i + 1) & table.mask) {
+            Node* slot = table.slots[i].load(std::memory_order_relaxed);
+            if (slot == nullptr || slot == tombstone()) {
+                table.slots[i].store(node, std::memory_order_release);
+                return slot != nullptr;
+            }
+        }
+    }
+
+    // Readers keep probing the old table until they unpin, so it is retired, not freed
+    Table* rebuild(size_t capacity) {
+        Table* old = table_.load(std::memory_order_relaxed);
+        auto* table = new Table(capacity);
+        for (size_t i = 0; i < old->capacity(); ++i) {
+            Node* node = old->slots[i].load(std::memory_order_relaxed);
+            if (node != nullptr && node != tombstone()) {
+                place(*table, node);
+            }
+        }
+        table_.store(table, std::memory_order_release);
+        EpochDomain::global().retire(old);
+        tombstones_ = 0;
+        return table;
+    }
+
+    std::atomic<Table*> table_;
+    size_t size_ = 0;         ///< Live nodes
+    size_t tombstones_ = 0;   ///< Erased slots not reclaimed yet
+};
+
+#endif // RCU_INDEX_H
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "cache.h"
 
 class ReplicationManager {
 public:
@@ -13,13 +14,26 @@ public:
     // Add a follower node
     void addFollower(const std::string& address);
     
-    // Forward a PUT request to all followers
-    void replicatePut(const std::string& key, const std::string& value, uint64_t ttl);
+    // Forward a PUT request to all followers, as JSON or (raw) as an application/octet-stream body;
+    // raw PUTs also carry the value's client flags
+    void replicatePut(const std::string& key, const std::string& value, uint64_t ttl, bool raw = false,
+                      uint32_t flags = 0);
 
     // Forward a DELETE request to all followers
     void replicateDelete(const std::string& key);
 
+    // Forward a batch of PUTs to all followers, one POST /cache/_mset each, or (raw) one
+    // POST /cache/_import of NDJSON records, which carries keys and values of any bytes
+    void replicatePutBatch(const std::vector<CacheItem>& items, bool raw = false);
+
+    // Forward a batch of DELETEs to all followers, one POST /cache/_mdelete each
+    void replicateDeleteBatch(const std::vector<std::string>& keys);
+
 private:
+    // POST a body to every follower
+    void postToFollowers(const std::string& path, const std::string& body, size_t count,
+                         const char* content_type = "application/json");
+
     std::vector<std::string> followers_;
 };
 
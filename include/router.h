@@ -0,0 +1,45 @@
+#pragma once
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Endpoints of the REST API.
+enum class Route : uint8_t {
+    NotFound,
+    CacheKey,      ///< GET / HEAD / PUT / DELETE /cache/<key>
+    MultiGet,      ///< POST /cache/_mget
+    MultiSet,      ///< POST /cache/_mset
+    MultiDelete,   ///< POST /cache/_mdelete
+    Import,        ///< POST /cache/_import
+    Export,        ///< GET /cache/_export
+    Metrics,       ///< GET /metrics
+    HotKeys,       ///< GET /debug/hot_keys
+    Health,        ///< GET /healthz
+};
+
+struct RouteMatch {
+    Route route = Route::NotFound;
+    std::string_view key;   ///< CacheKey only: view into the path
+};
+
+/**
+ * Hand-written router for the API's paths: a few length checks and
+ * comparisons, no regex and no allocation. The key of /cache/<key> is
+ * everything after the prefix, so it may hold any byte, '/' included.
+ *
+ * `path` is expected percent-decoded (httplib decodes the request path
+ * before routing), which is what lets clients send arbitrary keys: they
+ * encode '%', '?', '#' and non-printable bytes as %XX (see encode_key).
+ *
+ * @param method HTTP method as sent ("GET", "PUT", ...)
+ * @param path   Decoded request path, without the query string
+ */
+RouteMatch match_route(std::string_view method, std::string_view path);
+
+/// Percent-encode a key for use in a /cache/<key> URL: every byte but A-Z a-z 0-9 - . _ ~ becomes %XX.
+std::string encode_key(std::string_view key);
+
+#endif // ROUTER_H
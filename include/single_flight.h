@@ -0,0 +1,104 @@
+#pragma once
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Per-key call coalescing: while a call for a key is running, callers for
+ * the same key wait for its result instead of making their own call. The
+ * result (or the exception it threw) is handed to every waiter through a
+ * shared future.
+ *
+ * The call runs on the thread of the caller that started it, with no lock
+ * held. A call must not wait for its own key, directly or not: that
+ * deadlocks.
+ *
+ * @tparam T Result type, copied out to every caller
+ */
+template <typename T>
+class SingleFlight {
+public:
+    SingleFlight() = default;
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    /**
+     * Run fn() for the key, or wait for the call already running for it.
+     * @param joined Set to true if the result is another caller's
+     * @return the result of the call; rethrows what the call threw
+     */
+    template <typename F>
+    T run(const std::string& key, F&& fn, bool* joined = nullptr) {
+        std::promise<T> promise;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto it = calls_.find(key);
+            if (it != calls_.end()) {
+                std::shared_future<T> result = it->second;
+                lock.unlock();
+                if (joined) *joined = true;
+                return result.get();
+            }
+            calls_.emplace(key, promise.get_future().share());
+        }
+        if (joined) *joined = false;
+        return lead(key, promise, std::forward<F>(fn));
+    }
+
+    /**
+     * Run fn() for the key unless a call for it is already running.
+     * @return the result of the call, nullopt if another one was running
+     */
+    template <typename F>
+    std::optional<T> try_run(const std::string& key, F&& fn) {
+        std::promise<T> promise;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!calls_.emplace(key, promise.get_future().share()).second) {
+                return std::nullopt;
+            }
+        }
+        return lead(key, promise, std::forward<F>(fn));
+    }
+
+    /// @return number of keys with a call running
+    size_t in_flight() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_.size();
+    }
+
+private:
+    // Run the call and publish its outcome. Waiters hold their own copy of
+    // the future, so the entry is dropped as soon as the outcome is set.
+    template <typename F>
+    T lead(const std::string& key, std::promise<T>& promise, F&& fn) {
+        try {
+            T result = fn();
+            promise.set_value(result);
+            finish(key);
+            return result;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            finish(key);
+            throw;
+        }
+    }
+
+    void finish(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        calls_.erase(key);
+    }
+
+    mutable std::mutex mutex_;                                   ///< Protects calls_
+    std::unordered_map<std::string, std::shared_future<T>> calls_; ///< Running calls by key
+};
+
+#endif // SINGLE_FLIGHT_H
@@ -0,0 +1,142 @@
+#pragma once
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+/**
+ * Size-classed slab allocator for cache values (memcached style).
+ *
+ * Memory is carved out of fixed-size pages. Each size class hands out
+ * chunks of one size from its own pages and recycles freed chunks through
+ * per-page intrusive free lists, so steady-state allocation never reaches
+ * malloc and internal waste is bounded by the class growth factor. The
+ * biggest class still fits kChunksPerPage chunks in a page, so the unused
+ * tail of a page stays under a ninth of it. Requests larger than the biggest
+ * class fall back to operator new and are reported as the "large" class.
+ *
+ * A page whose chunks have all been returned goes back to operator delete,
+ * except for one empty spare per class that absorbs alloc/free churn at a
+ * page boundary. Pages held beyond the chunks in use are therefore the
+ * partly used pages of each class plus at most one spare per class; a
+ * workload that stops using a size class gives all but that spare back.
+ *
+ * Not thread-safe: the cache gives every shard its own allocator and only
+ * touches it under the shard lock.
+ */
+class SlabAllocator {
+public:
+    static constexpr size_t kDefaultPageSize = 1 << 20;  ///< 1 MiB pages
+    static constexpr size_t kMinPageSize = 4 << 10;      ///< Smallest page page_size_for() picks
+    static constexpr size_t kMinChunkSize = 64;          ///< Smallest chunk
+    static constexpr size_t kChunksPerPage = 8;          ///< Chunks a page holds at least
+    static constexpr double kGrowthFactor = 1.25;        ///< Chunk size ratio between classes
+
+    /**
+     * Per size class usage counters.
+     */
+    struct ClassStats {
+        size_t chunk_size = 0;   ///< Bytes per chunk (0 for the large class)
+        size_t chunks_used = 0;  ///< Chunks currently handed out
+        size_t bytes_used = 0;   ///< Bytes currently handed out
+        size_t pages = 0;        ///< Pages owned by the class
+    };
+
+    /**
+     * @param page_size Size of each page; the largest chunk is an eighth of it
+     */
+    explicit SlabAllocator(size_t page_size = kDefaultPageSize);
+    ~SlabAllocator();
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /**
+     * Page size for an allocator that serves a budget of `budget` bytes: the
+     * largest power of two between kMinPageSize and kDefaultPageSize for which
+     * one partly used page plus one spare in every class stays within an
+     * eighth of the budget.
+     */
+    static size_t page_size_for(size_t budget);
+
+    /**
+     * Allocate a chunk able to hold `size` bytes.
+     * @return pointer to the chunk, nullptr when size is 0
+     */
+    char* allocate(size_t size);
+
+    /**
+     * Return a chunk obtained from allocate() with the same size.
+     */
+    void deallocate(char* chunk, size_t size);
+
+    /**
+     * @return bytes actually consumed by an allocation of `size` bytes
+     */
+    size_t chunk_size(size_t size) const;
+
+    /**
+     * @return usage per size class, in class order, followed by the large class
+     */
+    std::vector<ClassStats> stats() const;
+
+    /**
+     * @return total bytes held in pages plus large allocations
+     */
+    size_t reserved_bytes() const;
+
+    /**
+     * @return size of each page
+     */
+    size_t page_size() const { return page_size_; }
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    struct Page {
+        char* base = nullptr;
+        size_t cls = 0;                  ///< Index of the owning class
+        FreeChunk* free_list = nullptr;  ///< Returned chunks of this page
+        char* cursor = nullptr;          ///< Next never-used chunk
+        char* end = nullptr;             ///< End of the last whole chunk
+        size_t used = 0;                 ///< Chunks handed out
+        Page* prev = nullptr;            ///< Neighbours in the class's list of pages with room
+        Page* next = nullptr;
+
+        bool has_room() const { return free_list != nullptr || cursor != end; }
+    };
+
+    struct SizeClass {
+        size_t chunk_size = 0;
+        Page* with_room = nullptr;       ///< Pages with a free chunk; empty pages at the tail
+        Page* with_room_tail = nullptr;
+        size_t chunks_used = 0;
+        size_t pages = 0;
+        size_t empty_pages = 0;          ///< Pages with no chunk handed out (at most one)
+    };
+
+    /// Index of the smallest class whose chunks fit `size`, classes_.size() for large.
+    size_t class_index(size_t size) const;
+
+    /// Add an empty page to the class's list of pages with room.
+    Page* grow(size_t idx);
+
+    /// Give an empty page back to operator delete.
+    void release(Page* page);
+
+    void push_front(SizeClass& cls, Page* page);
+    void push_back(SizeClass& cls, Page* page);
+    void unlink(SizeClass& cls, Page* page);
+
+    size_t page_size_;
+    std::vector<SizeClass> classes_;
+    std::map<const char*, Page> pages_;  ///< Every page by base address, to find a chunk's page
+    size_t large_chunks_ = 0;
+    size_t large_bytes_ = 0;
+};
+
+#endif // SLAB_ALLOCATOR_H
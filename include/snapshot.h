@@ -0,0 +1,79 @@
+#pragma once
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "cache.h"
+
+/**
+ * Point-in-time snapshots of a Cache, for warm restarts.
+ *
+ * File layout (integers little-endian):
+ *
+ *     header  "DCPPSNAP"  u32 version  u32 reserved  i64 written_at_ms  u64 entry_count
+ *     entry   u32 key_len  u32 value_len  u64 ttl_ms  key bytes  value bytes
+ *
+ * written_at_ms is wall-clock (Unix epoch) time, so the TTL that passed
+ * while the process was down can be subtracted on load; ttl_ms is the
+ * remaining TTL at dump time, 0 for no expiry. Entries are stored shard by
+ * shard, least recently used first.
+ */
+
+/// Outcome of load_snapshot().
+struct SnapshotLoadResult {
+    size_t loaded = 0;    ///< Entries inserted into the cache
+    size_t expired = 0;   ///< Entries skipped because their TTL ran out
+};
+
+/**
+ * Write a snapshot of the cache to `path`.
+ * The file is written next to `path` and renamed over it once complete, so
+ * a crash mid-dump leaves the previous snapshot intact. Shards are dumped
+ * one at a time, see Cache::export_shard().
+ * @return number of entries written
+ * @throws std::runtime_error on I/O failure
+ */
+size_t save_snapshot(const Cache& cache, const std::string& path);
+
+/**
+ * Load a snapshot into the cache: the file is mmap'ed and its entries are
+ * bulk inserted with Cache::multi_put(), skipping those that have expired.
+ * @throws std::runtime_error if the file cannot be read or is not a valid
+ *         snapshot (entries before the damage stay loaded)
+ */
+SnapshotLoadResult load_snapshot(Cache& cache, const std::string& path);
+
+/**
+ * Background thread that saves a snapshot every `interval_ms`.
+ */
+class SnapshotScheduler {
+public:
+    SnapshotScheduler(std::shared_ptr<Cache> cache, std::string path, uint64_t interval_ms);
+    ~SnapshotScheduler();
+
+    SnapshotScheduler(const SnapshotScheduler&) = delete;
+    SnapshotScheduler& operator=(const SnapshotScheduler&) = delete;
+
+    void start();
+    void stop();
+
+private:
+    void loop();
+
+    std::shared_ptr<Cache> cache_;
+    std::string path_;
+    uint64_t interval_ms_;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::mutex mutex_;                 ///< Guards the wait on cv_
+    std::condition_variable cv_;       ///< Wakes the loop early on stop()
+};
+
+#endif // SNAPSHOT_H
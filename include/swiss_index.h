@@ -0,0 +1,276 @@
+#pragma once
+#ifndef SWISS_INDEX_H
+#define SWISS_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+// Define SWISS_INDEX_NO_SIMD to force the portable group matching
+#if !defined(SWISS_INDEX_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SWISS_INDEX_SSE2 1
+#endif
+
+/**
+ * Open-addressing hash index over intrusive nodes, in the style of Swiss
+ * tables.
+ *
+ * Slots are grouped by 16. Every slot has a control byte that is either
+ * empty, deleted, or holds the low 7 bits of the node's hash; a probe loads
+ * the 16 control bytes of a group and compares them all at once (SSE2, with
+ * a portable fallback), so the node itself is only dereferenced on a
+ * fragment match. Groups are probed quadratically and a lookup stops at the
+ * first group with an empty slot.
+ *
+ * The index stores node pointers and reads the full hash cached in the node,
+ * so growing never rehashes keys. Not thread-safe: the cache serializes
+ * access with the shard lock.
+ *
+ * @tparam Node Node type
+ * @tparam Hash Pointer to the node's cached hash member
+ */
+template <typename Node, size_t Node::*Hash>
+class SwissIndex {
+public:
+    static constexpr size_t kGroupSize = 16;
+
+    SwissIndex() { reset(kGroupSize); }
+
+    SwissIndex(const SwissIndex&) = delete;
+    SwissIndex& operator=(const SwissIndex&) = delete;
+
+    /**
+     * Find the node with this hash for which eq(node) is true.
+     * @return the node, nullptr if absent
+     */
+    template <typename Eq>
+    Node* find(size_t hash, Eq&& eq) const {
+        const uint8_t fragment = h2(hash);
+        for (Probe probe(h1(hash), group_mask_);; probe.next()) {
+            const uint8_t* ctrl = &ctrl_[probe.offset()];
+            for (uint32_t bits = match(ctrl, fragment); bits != 0; bits &= bits - 1) {
+                Node* node = slots_[probe.offset() + lowest_bit(bits)];
+                if (eq(node)) {
+                    return node;
+                }
+            }
+            if (match(ctrl, kEmpty) != 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * Add a node.
+     * PRECONDITION: no node with an equal key is indexed.
+     */
+    void insert(Node* node) {
+        if (size_ + deleted_ >= max_load()) {
+            // Mostly tombstones: clean up in place, otherwise double
+            rehash(size_ < max_load() / 2 ? capacity_ : capacity_ * 2);
+        }
+        place(node);
+        ++size_;
+    }
+
+    /// Remove a node by identity. @return false if it was not indexed.
+    bool erase(const Node* node) {
+        const size_t hash = node->*Hash;
+        const uint8_t fragment = h2(hash);
+        for (Probe probe(h1(hash), group_mask_);; probe.next()) {
+            const uint8_t* ctrl = &ctrl_[probe.offset()];
+            for (uint32_t bits = match(ctrl, fragment); bits != 0; bits &= bits - 1) {
+                const size_t index = probe.offset() + lowest_bit(bits);
+                if (slots_[index] == node) {
+                    // A group that still has an empty slot was never probed
+                    // past, so the slot can become empty again.
+                    if (match(ctrl, kEmpty) != 0) {
+                        ctrl_[index] = kEmpty;
+                    } else {
+                        ctrl_[index] = kDeleted;
+                        ++deleted_;
+                    }
+                    slots_[index] = nullptr;
+                    --size_;
+                    return true;
+                }
+            }
+            if (match(ctrl, kEmpty) != 0) {
+                return false;
+            }
+        }
+    }
+
+    /// Forget every node (the owner frees them) and shrink back to one group.
+    void clear() { reset(kGroupSize); }
+
+    /// @return number of indexed nodes
+    size_t size() const { return size_; }
+
+    /// @return number of slots
+    size_t capacity() const { return capacity_; }
+
+    /// @return bytes held by the control bytes and the slot array
+    size_t memory_bytes() const { return capacity_ * (sizeof(uint8_t) + sizeof(Node*)); }
+
+    /**
+     * Call fn(node) for the nodes whose home group is one of the next
+     * `groups` groups from `cursor`, starting from 0. Groups are visited in
+     * reverse-binary order, as Redis SCAN walks its buckets, so a node
+     * indexed for the whole walk is seen exactly once even if the index
+     * grows or is cleaned up between two calls; only after clear() can
+     * nodes come again.
+     * @return the cursor to continue from, 0 once every group was visited
+     */
+    template <typename F>
+    size_t scan(size_t cursor, size_t groups, F&& fn) const {
+        do {
+            // Nodes of a home group sit on its probe, before the first group with an empty slot
+            const size_t home = cursor & group_mask_;
+            for (Probe probe(home, group_mask_);; probe.next()) {
+                const uint8_t* ctrl = &ctrl_[probe.offset()];
+                for (uint32_t bits = ~match_free(ctrl) & 0xFFFF; bits != 0; bits &= bits - 1) {
+                    const Node* node = slots_[probe.offset() + lowest_bit(bits)];
+                    if ((h1(node->*Hash) & group_mask_) == home) {
+                        fn(node);
+                    }
+                }
+                if (match(ctrl, kEmpty) != 0) {
+                    break;
+                }
+            }
+            cursor = next_in_reverse_binary(home, group_mask_);
+        } while (cursor != 0 && --groups > 0);
+        return cursor;
+    }
+
+private:
+    static constexpr uint8_t kEmpty = 0x80;
+    static constexpr uint8_t kDeleted = 0xFE;
+
+    /// Quadratic probe over groups: offsets g, g+1, g+3, g+6, ... (mod group count).
+    class Probe {
+    public:
+        Probe(size_t start, size_t mask) : group_(start & mask), mask_(mask) {}
+        size_t offset() const { return group_ * kGroupSize; }
+        void next() {
+            ++step_;
+            group_ = (group_ + step_) & mask_;
+        }
+
+    private:
+        size_t group_;
+        size_t mask_;
+        size_t step_ = 0;
+    };
+
+    static size_t h1(size_t hash) { return hash >> 7; }
+
+    /// Add one to `bucket` counting from its top bit down. @return 0 after the last bucket
+    static size_t next_in_reverse_binary(size_t bucket, size_t mask) {
+        for (size_t bit = (mask + 1) >> 1; bit != 0; bit >>= 1) {
+            bucket ^= bit;
+            if ((bucket & bit) != 0) {
+                return bucket;
+            }
+        }
+        return 0;
+    }
+    static uint8_t h2(size_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+
+    static unsigned lowest_bit(uint32_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(bits));
+#else
+        unsigned n = 0;
+        while ((bits & 1u) == 0) {
+            bits >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    /// Bit i set when ctrl[i] == value, for the 16 bytes of a group.
+    static uint32_t match(const uint8_t* ctrl, uint8_t value) {
+#ifdef SWISS_INDEX_SSE2
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        __m128i eq = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value)));
+        return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+#else
+        uint32_t bits = 0;
+        for (unsigned i = 0; i < kGroupSize; ++i) {
+            bits |= static_cast<uint32_t>(ctrl[i] == value) << i;
+        }
+        return bits;
+#endif
+    }
+
+    /// Bit i set when ctrl[i] is empty or deleted (high bit set).
+    static uint32_t match_free(const uint8_t* ctrl) {
+#ifdef SWISS_INDEX_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))));
+#else
+        uint32_t bits = 0;
+        for (unsigned i = 0; i < kGroupSize; ++i) {
+            bits |= static_cast<uint32_t>(ctrl[i] >> 7) << i;
+        }
+        return bits;
+#endif
+    }
+
+    size_t max_load() const { return capacity_ - capacity_ / 8; }   // 7/8
+
+    void place(Node* node) {
+        const size_t hash = node->*Hash;
+        for (Probe probe(h1(hash), group_mask_);; probe.next()) {
+            uint32_t free = match_free(&ctrl_[probe.offset()]);
+            if (free != 0) {
+                const size_t index = probe.offset() + lowest_bit(free);
+                if (ctrl_[index] == kDeleted) {
+                    --deleted_;
+                }
+                ctrl_[index] = h2(hash);
+                slots_[index] = node;
+                return;
+            }
+        }
+    }
+
+    void reset(size_t capacity) {
+        capacity_ = capacity;
+        group_mask_ = capacity / kGroupSize - 1;
+        ctrl_ = std::make_unique<uint8_t[]>(capacity);
+        std::memset(ctrl_.get(), kEmpty, capacity);
+        slots_ = std::make_unique<Node*[]>(capacity);
+        size_ = 0;
+        deleted_ = 0;
+    }
+
+    // Re-places every node using its cached hash; keys are never rehashed.
+    void rehash(size_t capacity) {
+        std::unique_ptr<uint8_t[]> old_ctrl = std::move(ctrl_);
+        std::unique_ptr<Node*[]> old_slots = std::move(slots_);
+        const size_t old_capacity = capacity_;
+        const size_t live = size_;
+
+        reset(capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if ((old_ctrl[i] & 0x80) == 0) {
+                place(old_slots[i]);
+            }
+        }
+        size_ = live;
+    }
+
+    std::unique_ptr<uint8_t[]> ctrl_;   ///< Control byte per slot
+    std::unique_ptr<Node*[]> slots_;    ///< Node per slot (nullptr when not full)
+    size_t capacity_ = 0;               ///< Slots, a power of two and a multiple of kGroupSize
+    size_t group_mask_ = 0;             ///< Group count - 1
+    size_t size_ = 0;                   ///< Full slots
+    size_t deleted_ = 0;                ///< Tombstones
+};
+
+#endif // SWISS_INDEX_H
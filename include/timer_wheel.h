@@ -0,0 +1,177 @@
+#pragma once
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Intrusive links a node embeds to be scheduled on a TimerWheel.
+ */
+template <typename Node>
+struct TimerHook {
+    static constexpr uint16_t kUnscheduled = 0xFFFF;
+
+    Node* prev = nullptr;          ///< Previous node in the same slot
+    Node* next = nullptr;          ///< Next node in the same slot
+    uint64_t tick = 0;             ///< Absolute tick at which the node is due
+    uint16_t slot = kUnscheduled;  ///< List the node is currently linked into
+};
+
+/**
+ * Hierarchical timing wheel (4 levels x 64 slots) over intrusive nodes.
+ *
+ * Scheduling and cancelling are O(1). advance() only visits the slots whose
+ * time has come: nodes in level 0 become due, nodes in higher levels are
+ * cascaded down when the level below wraps around. Due nodes are parked on
+ * a separate list so the owner can drain them in bounded batches.
+ *
+ * Not thread-safe: the owner serializes access (the cache uses the shard lock).
+ *
+ * @tparam Node Node type
+ * @tparam Hook Pointer to the node's TimerHook member
+ */
+template <typename Node, TimerHook<Node> Node::*Hook>
+class TimerWheel {
+public:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr unsigned kSlots = 1u << kSlotBits;
+    /// Longest delay representable without re-cascading from the top level
+    static constexpr uint64_t kMaxDelta = (uint64_t{1} << (kLevels * kSlotBits)) - 1;
+
+    TimerWheel() { heads_.fill(nullptr); }
+
+    /**
+     * Schedule a node to become due at the given absolute tick.
+     * PRECONDITION: node is not currently scheduled.
+     */
+    void schedule(Node* node, uint64_t tick) {
+        (node->*Hook).tick = tick;
+        if (tick <= current_) {
+            push(node, kDueSlot);
+            return;
+        }
+        uint64_t delta = tick - current_;
+        if (delta > kMaxDelta) {
+            // Park in the top level; it is re-placed when that slot cascades
+            delta = kMaxDelta;
+            tick = current_ + delta;
+        }
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (uint64_t{1} << ((level + 1) * kSlotBits))) {
+            ++level;
+        }
+        push(node, level * kSlots + static_cast<unsigned>((tick >> (level * kSlotBits)) & (kSlots - 1)));
+    }
+
+    /// Remove a node from whichever slot or due list it is in. No-op if unscheduled.
+    void cancel(Node* node) {
+        auto& hook = node->*Hook;
+        if (hook.slot == TimerHook<Node>::kUnscheduled) {
+            return;
+        }
+        if (hook.prev) (hook.prev->*Hook).next = hook.next;
+        else heads_[hook.slot] = hook.next;
+        if (hook.next) (hook.next->*Hook).prev = hook.prev;
+        hook.prev = hook.next = nullptr;
+        hook.slot = TimerHook<Node>::kUnscheduled;
+        --size_;
+    }
+
+    /// @return true if the node is linked into the wheel or the due list
+    static bool scheduled(const Node* node) {
+        return (node->*Hook).slot != TimerHook<Node>::kUnscheduled;
+    }
+
+    /**
+     * Advance the wheel to now_tick, cascading higher levels as they wrap
+     * and moving every node whose tick has passed onto the due list.
+     */
+    void advance(uint64_t now_tick) {
+        while (current_ < now_tick) {
+            ++current_;
+
+            // Cascade from the highest level whose lower bits all wrapped
+            unsigned top = 0;
+            while (top + 1 < kLevels && (current_ & ((uint64_t{1} << ((top + 1) * kSlotBits)) - 1)) == 0) {
+                ++top;
+            }
+            for (unsigned level = top; level >= 1; --level) {
+                unsigned slot = level * kSlots + static_cast<unsigned>((current_ >> (level * kSlotBits)) & (kSlots - 1));
+                Node* node = take(slot);
+                while (node) {
+                    Node* next = (node->*Hook).next;
+                    (node->*Hook).prev = (node->*Hook).next = nullptr;
+                    (node->*Hook).slot = TimerHook<Node>::kUnscheduled;
+                    --size_;
+                    schedule(node, (node->*Hook).tick);
+                    node = next;
+                }
+            }
+
+            // Level 0 slot for this tick is due as a whole
+            splice_to_due(static_cast<unsigned>(current_ & (kSlots - 1)));
+        }
+    }
+
+    /// Pop one due node, nullptr when none is due.
+    Node* pop_due() {
+        Node* node = heads_[kDueSlot];
+        if (node) {
+            cancel(node);
+        }
+        return node;
+    }
+
+    /// @return true if nodes are waiting on the due list
+    bool has_due() const { return heads_[kDueSlot] != nullptr; }
+
+    /// @return number of scheduled nodes (including due ones)
+    size_t size() const { return size_; }
+
+    /// @return tick the wheel has advanced to
+    uint64_t current_tick() const { return current_; }
+
+    /// Forget every node without touching them (owner frees the nodes).
+    void clear() {
+        heads_.fill(nullptr);
+        size_ = 0;
+    }
+
+private:
+    static constexpr unsigned kDueSlot = kLevels * kSlots;
+
+    void push(Node* node, unsigned slot) {
+        auto& hook = node->*Hook;
+        hook.prev = nullptr;
+        hook.next = heads_[slot];
+        if (hook.next) (hook.next->*Hook).prev = node;
+        heads_[slot] = node;
+        hook.slot = static_cast<uint16_t>(slot);
+        ++size_;
+    }
+
+    Node* take(unsigned slot) {
+        Node* head = heads_[slot];
+        heads_[slot] = nullptr;
+        return head;
+    }
+
+    void splice_to_due(unsigned slot) {
+        Node* node = take(slot);
+        while (node) {
+            Node* next = (node->*Hook).next;
+            --size_;
+            push(node, kDueSlot);
+            node = next;
+        }
+    }
+
+    std::array<Node*, kLevels * kSlots + 1> heads_;  ///< Slot lists, plus the due list last
+    uint64_t current_ = 0;                           ///< Last tick advanced to
+    size_t size_ = 0;                                ///< Scheduled nodes
+};
+
+#endif // TIMER_WHEEL_H
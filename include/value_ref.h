@@ -0,0 +1,168 @@
+#pragma once
+#ifndef VALUE_REF_H
+#define VALUE_REF_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "slab_allocator.h"
+
+class ValueArena;
+
+/**
+ * Header in front of every stored value, in the same slab chunk as its bytes.
+ */
+struct ValueBlock {
+    std::atomic<uint32_t> refs{1};  ///< Holders: the cache entry plus outstanding ValueRefs
+    uint32_t flags = 0;             ///< Opaque client flags stored with the value (memcached set)
+    uint64_t size : 63;             ///< Value length in bytes (as stored)
+    uint64_t compressed : 1;        ///< Bytes are an LZ4 block, see compression.h
+    ValueArena* arena = nullptr;    ///< Arena the chunk goes back to; null for a heap block
+
+    ValueBlock() : size(0), compressed(0) {}
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+/**
+ * Shared handle to an immutable cached value.
+ *
+ * Copying only bumps an atomic reference count. The bytes stay valid and
+ * unchanged after the key is overwritten, erased, evicted or the cache is
+ * destroyed; the chunk returns to its arena when the last handle goes away.
+ * A default-constructed handle holds no block and views as "".
+ */
+class ValueRef {
+public:
+    ValueRef() = default;
+
+    ValueRef(const ValueRef& other) noexcept : block_(other.block_) {
+        if (block_) {
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ValueRef(ValueRef&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+
+    ValueRef& operator=(ValueRef other) noexcept {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+
+    ~ValueRef() { release(); }
+
+    const char* data() const { return block_ ? block_->data() : ""; }
+    size_t size() const { return block_ ? block_->size : 0; }
+    bool empty() const { return size() == 0; }
+    std::string_view view() const { return {data(), size()}; }
+
+    /// @return true if the bytes are a compressed form of the value (see compression.h)
+    bool compressed() const { return block_ && block_->compressed; }
+
+    /// @return the client flags stored with the value, 0 if none
+    uint32_t flags() const { return block_ ? block_->flags : 0; }
+
+    /**
+     * Heap block outside any arena, freed with its last handle. `fill` gets
+     * the block's `size` bytes to write before the handle is returned.
+     * Empty without flags, like an empty value stored in an arena.
+     */
+    template <typename Fill>
+    static ValueRef make(size_t size, Fill&& fill, uint32_t flags = 0);
+
+    /// @return number of holders of the value, 0 for an empty handle
+    uint32_t use_count() const { return block_ ? block_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class ValueArena;
+
+    /// Adopts one reference to the block.
+    explicit ValueRef(ValueBlock* block) : block_(block) {}
+
+    void release();
+
+    ValueBlock* block_ = nullptr;
+};
+
+/**
+ * Thread-safe home for value blocks: a SlabAllocator behind a mutex.
+ *
+ * Blocks are freed by whichever thread drops the last ValueRef, possibly
+ * outside any cache lock, so allocation and release serialize on the arena's
+ * own (leaf) mutex. The arena itself is reference counted by its owner and
+ * its live blocks, and is deleted once the owner released it and the last
+ * block came back.
+ */
+class ValueArena {
+public:
+    /// Create an arena held by the caller; give it up with release_owner().
+    static ValueArena* create(size_t page_size = SlabAllocator::kDefaultPageSize);
+
+    ValueArena(const ValueArena&) = delete;
+    ValueArena& operator=(const ValueArena&) = delete;
+
+    /// Drop the owner's reference; the arena lives on while blocks are out.
+    void release_owner();
+
+    /**
+     * Copy bytes into a new block.
+     * @param compressed Whether the bytes are a compressed value
+     * @param flags      Client flags kept with the value
+     * @return handle holding the only reference, empty when both bytes and flags are
+     */
+    ValueRef store(std::string_view bytes, bool compressed = false, uint32_t flags = 0);
+
+    /// @return slab bytes a stored value of this size occupies, header included
+    size_t chunk_size(size_t value_size) const;
+
+    /// @return slab usage per size class, see SlabAllocator::stats()
+    std::vector<SlabAllocator::ClassStats> stats() const;
+
+private:
+    friend class ValueRef;
+
+    explicit ValueArena(size_t page_size) : slab_(page_size) {}
+    ~ValueArena() = default;
+
+    /// Return a block whose last reference was dropped.
+    void free(ValueBlock* block);
+
+    void unref();
+
+    mutable std::mutex mutex_;       ///< Protects slab_
+    SlabAllocator slab_;
+    std::atomic<size_t> refs_{1};    ///< Owner plus live blocks
+};
+
+inline void ValueRef::release() {
+    if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (block_->arena) {
+            block_->arena->free(block_);
+        } else {
+            block_->~ValueBlock();
+            ::operator delete(block_);
+        }
+    }
+    block_ = nullptr;
+}
+
+template <typename Fill>
+ValueRef ValueRef::make(size_t size, Fill&& fill, uint32_t flags) {
+    if (size == 0 && flags == 0) {
+        return ValueRef();
+    }
+    auto* block = new (::operator new(sizeof(ValueBlock) + size)) ValueBlock();
+    block->size = size;
+    block->flags = flags;
+    ValueRef ref(block);   // Frees the block if fill throws
+    fill(block->data());
+    return ref;
+}
+
+#endif // VALUE_REF_H
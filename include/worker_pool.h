@@ -0,0 +1,81 @@
+#pragma once
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "metrics.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads fed from a bounded FIFO queue.
+ *
+ * submit() refuses a task when the queue is full instead of letting it
+ * grow without limit, so a spike turns into quick refusals rather than
+ * ever longer waits. Every task remembers when it was queued. The worker
+ * that runs it records the wait in an optional histogram and makes it
+ * available to the task through take_queue_wait(), which lets the task
+ * decide that it waited too long to be worth serving.
+ */
+class WorkerPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param threads    Worker threads (at least 1)
+     * @param max_queued Tasks waiting for a worker at most (0 = unbounded)
+     * @param wait       If set, observes every task's queue wait in seconds
+     */
+    WorkerPool(size_t threads, size_t max_queued, Histogram* wait = nullptr);
+
+    /// Runs what is queued, then joins the workers.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Queue a task for the next free worker.
+     * @return false if the queue is full or the pool is shut down
+     */
+    bool submit(std::function<void()> task);
+
+    /// Stop taking tasks, run those already queued and join the workers. Idempotent.
+    void shutdown();
+
+    /// @return tasks waiting for a worker
+    size_t queued() const;
+
+    size_t threads() const { return workers_.size(); }
+
+    /**
+     * Queue wait of the task running on the calling thread, reported once:
+     * later calls from the same task return zero. Zero outside a pool task.
+     */
+    static Clock::duration take_queue_wait();
+
+private:
+    struct Task {
+        std::function<void()> run;
+        Clock::time_point queued_at;
+    };
+
+    void work();
+
+    const size_t max_queued_;
+    Histogram* wait_;
+
+    mutable std::mutex mutex_;     ///< Protects tasks_ and stopping_
+    std::condition_variable ready_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+    std::mutex join_mutex_;        ///< Serializes shutdown()'s joins
+    std::vector<std::thread> workers_;
+};
+
+#endif // WORKER_POOL_H
@@ -1,82 +1,543 @@
 #include "api.h"
+#include "logger.h"
+#include "ndjson.h"
+#include "router.h"
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <chrono>
 #include <ctime>
-#include <time_utils.h>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 using json = nlohmann::json;
 
-CacheAPI::CacheAPI(std::shared_ptr<Cache> cache, ReplicationManager* repl) 
-    : cache_(std::move(cache)), replication_(repl) {}
+void CacheAPI::logRequest(const char* method, const std::string& path, int status) {
+    Logger::global().access(method, ' ', path, " -> ", status);
+}
+
+// Key of a /cache/<key> request, viewed in place inside the (decoded) req.path
+static std::string_view route_key(const httplib::Request& req) {
+    return match_route(req.method, req.path).key;
+}
+
+namespace {
+
+// Strings of a {"keys": [...]} request body; throws on any other shape
+std::vector<std::string> parse_keys(const json& body) {
+    if (!body.contains("keys") || !body["keys"].is_array()) {
+        throw std::invalid_argument("missing 'keys' array");
+    }
+    return body["keys"].get<std::vector<std::string>>();
+}
+
+std::vector<std::string_view> as_views(const std::vector<std::string>& strings) {
+    return std::vector<std::string_view>(strings.begin(), strings.end());
+}
+
+constexpr const char* kOctetStream = "application/octet-stream";
+constexpr const char* kNdjson = "application/x-ndjson";
+
+// GET /cache/_export: index slots walked per shard lock, and bytes handed to the socket at a time
+constexpr size_t kExportSliceSlots = 1024;
+constexpr size_t kExportChunkBytes = 64 * 1024;
+
+// Raw value mode: the request body is an octet stream (PUT), or the client accepts one (GET)
+bool raw_body(const httplib::Request& req) {
+    return req.get_header_value("Content-Type").find(kOctetStream) != std::string::npos;
+}
+bool raw_accepted(const httplib::Request& req) {
+    return req.get_header_value("Accept").find(kOctetStream) != std::string::npos;
+}
+
+// TTL in ms of a raw PUT, from ?ttl= or else the X-TTL header; 0 (no expiry) if neither is set
+uint64_t raw_ttl(const httplib::Request& req) {
+    const std::string text = req.has_param("ttl") ? req.get_param_value("ttl") : req.get_header_value("X-TTL");
+    uint64_t ttl = 0;
+    if (!text.empty()) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), ttl);
+        if (ec != std::errc() || end != text.data() + text.size()) {
+            throw std::invalid_argument("invalid ttl");
+        }
+    }
+    return ttl;
+}
+
+// Client flags of a raw PUT from ?flags= (memcached writes replicated by a leader); 0 if not set
+uint32_t raw_flags(const httplib::Request& req) {
+    const std::string text = req.get_param_value("flags");
+    uint32_t flags = 0;
+    if (!text.empty()) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), flags);
+        if (ec != std::errc() || end != text.data() + text.size()) {
+            throw std::invalid_argument("invalid flags");
+        }
+    }
+    return flags;
+}
+
+/**
+ * Streams {"value": "<escaped value>"} straight out of a cached value
+ * block. Runs without escapes are handed to the socket from the block
+ * itself; only slices that contain escapes are rewritten, one bounded
+ * slice at a time.
+ *
+ * The body can be written from any offset (httplib serves Range requests
+ * that way): the constructor records where each value slice starts in the
+ * escaped output, so an offset maps back to the slice holding it.
+ */
+class JsonValueBody {
+public:
+    explicit JsonValueBody(ValueRef value) : value_(std::move(value)) {
+        const std::string_view bytes = value_.view();
+        char buf[7];
+        size_t escaped = 0;
+        for (size_t pos = 0; pos < bytes.size(); pos += kSliceBytes) {
+            const size_t start = escaped;
+            const std::string_view slice = bytes.substr(pos, kSliceBytes);
+            for (char c : slice) {
+                auto esc = json_escape(static_cast<unsigned char>(c), buf);
+                escaped += esc.empty() ? 1 : esc.size();
+            }
+            slices_.push_back({kPrefix.size() + start, escaped - start == slice.size()});
+        }
+        size_ = kPrefix.size() + escaped + kSuffix.size();
+    }
+
+    size_t size() const { return size_; }
+
+    // Write up to `length` body bytes starting at `offset`
+    bool write(size_t offset, size_t length, httplib::DataSink& sink) {
+        const size_t suffix_start = size_ - kSuffix.size();
+        if (offset < kPrefix.size()) {
+            return sink.write(kPrefix.data() + offset, std::min(length, kPrefix.size() - offset));
+        }
+        if (offset >= suffix_start) {
+            const size_t at = offset - suffix_start;
+            return sink.write(kSuffix.data() + at, std::min(length, kSuffix.size() - at));
+        }
+
+        // Last slice starting at or before offset
+        auto it = std::upper_bound(slices_.begin(), slices_.end(), offset,
+            [](size_t wanted, const Slice& slice) { return wanted < slice.start; });
+        const size_t index = static_cast<size_t>(it - slices_.begin()) - 1;
+        const std::string_view text = escaped_slice(index);
+        const size_t at = offset - slices_[index].start;
+        return sink.write(text.data() + at, std::min(length, text.size() - at));
+    }
+
+private:
+    static constexpr std::string_view kPrefix = "{\"value\":\"";
+    static constexpr std::string_view kSuffix = "\"}";
+    static constexpr size_t kSliceBytes = 64 * 1024;
+
+    struct Slice {
+        size_t start;  ///< Body offset of the slice's escaped text
+        bool clean;    ///< No byte needs an escape, so the block bytes are the text
+    };
+
+    // Escaped text of a value slice: the block bytes themselves when clean
+    std::string_view escaped_slice(size_t index) {
+        const std::string_view slice = value_.view().substr(index * kSliceBytes, kSliceBytes);
+        if (slices_[index].clean) {
+            return slice; // Zero-copy
+        }
+        if (scratch_index_ != index) {
+            char buf[7];
+            scratch_.clear();
+            for (char c : slice) {
+                auto esc = json_escape(static_cast<unsigned char>(c), buf);
+                if (esc.empty()) scratch_.push_back(c);
+                else scratch_.append(esc.data(), esc.size());
+            }
+            scratch_index_ = index;
+        }
+        return scratch_;
+    }
+
+    ValueRef value_;             ///< Keeps the block alive until the response is sent
+    size_t size_ = 0;            ///< Total body length
+    std::vector<Slice> slices_;  ///< One per kSliceBytes of value, in order
+    std::string scratch_;        ///< Escaped copy of one slice, when needed
+    size_t scratch_index_ = SIZE_MAX; ///< Slice held in scratch_
+};
+
+} // namespace
+
+// Cache-side metrics, read from the cache (or the per-core engine) when /metrics is rendered
+template <typename Source>
+static void register_cache_metrics(MetricsRegistry& metrics, std::shared_ptr<Source> cache) {
+    metrics.counter_fn("cache_hits_total", "Total number of cache hits",
+                       [cache]() { return static_cast<double>(cache->hits()); });
+    metrics.counter_fn("cache_misses_total", "Total number of cache misses",
+                       [cache]() { return static_cast<double>(cache->misses()); });
+    metrics.gauge_fn("cache_hit_ratio", "Fraction of lookups served from the cache", [cache]() {
+        const size_t lookups = cache->hits() + cache->misses();
+        return lookups ? static_cast<double>(cache->hits()) / lookups : 0.0;
+    });
+    metrics.counter_fn("cache_admission_rejections_total", "New keys turned away by the TinyLFU admission filter",
+                       [cache]() { return static_cast<double>(cache->admission_rejections()); });
+    metrics.counter_fn("cache_evictions_total", "Entries removed to make room for new ones",
+                       [cache]() { return static_cast<double>(cache->evictions()); });
+    metrics.counter_fn("cache_expirations_total", "Entries removed because their TTL passed",
+                       [cache]() { return static_cast<double>(cache->expirations()); });
+    metrics.gauge_fn("cache_size", "Number of items currently stored in cache",
+                     [cache]() { return static_cast<double>(cache->size()); });
+    metrics.gauge_fn("cache_capacity", "Configured cache capacity",
+                     [cache]() { return static_cast<double>(cache->capacity()); });
+    metrics.gauge_fn("cache_eviction_interval_ms", "Async eviction interval in ms",
+                     [cache]() { return static_cast<double>(cache->eviction_interval()); });
+    metrics.gauge_fn("cache_memory_used_bytes", "Accounted footprint of all entries (key + value chunk + overhead)",
+                     [cache]() { return static_cast<double>(cache->memory_used()); });
+    metrics.gauge_fn("cache_capacity_bytes", "Configured memory budget (0 = bounded by entry count)",
+                     [cache]() { return static_cast<double>(cache->capacity_bytes()); });
+
+    metrics.gauge_fn("cache_compression_ratio", "Original over stored size of the values stored compressed",
+                     [cache]() {
+        const CompressionStats stats = cache->compression_stats();
+        return stats.stored_bytes ? static_cast<double>(stats.raw_bytes) / stats.stored_bytes : 0.0;
+    });
+    metrics.counter_fn("cache_compressed_values_total", "Values stored LZ4-compressed",
+                       [cache]() { return static_cast<double>(cache->compression_stats().compressed); });
+    metrics.counter_fn("cache_incompressible_values_total", "Values over the threshold stored raw because they barely shrank",
+                       [cache]() { return static_cast<double>(cache->compression_stats().incompressible); });
+    metrics.counter_fn("cache_compression_saved_bytes_total", "Bytes saved by compression, summed over stored values",
+                       [cache]() {
+        const CompressionStats stats = cache->compression_stats();
+        return static_cast<double>(stats.raw_bytes - stats.stored_bytes);
+    });
+    metrics.counter_fn("cache_compress_seconds_total", "Time spent compressing values (CPU-bound)",
+                       [cache]() { return cache->compression_stats().compress_ns / 1e9; });
+    metrics.counter_fn("cache_decompress_seconds_total", "Time spent decompressing values on reads (CPU-bound)",
+                       [cache]() { return cache->compression_stats().decompress_ns / 1e9; });
+
+    // Only classes that ever got a page (plus the large class when used)
+    metrics.gauge_family_fn("cache_slab_bytes_used", "Value bytes handed out per slab class", [cache]() {
+        std::vector<MetricsRegistry::Sample> samples;
+        for (const auto& cls : cache->slab_stats()) {
+            if (cls.pages == 0 && cls.chunks_used == 0) continue;
+            samples.push_back({"chunk_size=\"" + (cls.chunk_size ? std::to_string(cls.chunk_size) : "large") + "\"",
+                               static_cast<double>(cls.bytes_used)});
+        }
+        return samples;
+    });
+    metrics.gauge_family_fn("cache_slab_pages", "Pages owned per slab class", [cache]() {
+        std::vector<MetricsRegistry::Sample> samples;
+        for (const auto& cls : cache->slab_stats()) {
+            if (cls.pages == 0) continue;
+            samples.push_back({"chunk_size=\"" + std::to_string(cls.chunk_size) + "\"",
+                               static_cast<double>(cls.pages)});
+        }
+        return samples;
+    });
+
+#ifdef __linux__
+    metrics.gauge_fn("process_resident_memory_bytes", "Resident memory of the whole process", []() {
+        long pages = 0, resident = 0;
+        if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+            std::fclose(statm);
+        }
+        return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE));
+    });
+#endif
+}
+
+// Prometheus label value: backslash, quote and newline escaped
+static std::string label_value(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out.push_back(c);
+    }
+    return out;
+}
+
+// Hot-key tracking: the hot set and how many reads the near caches absorb
+static void register_hot_key_metrics(MetricsRegistry& metrics, std::shared_ptr<Cache> cache) {
+    metrics.counter_fn("cache_near_cache_hits_total", "Reads served from per-thread near caches of hot keys",
+                       [cache]() { return static_cast<double>(cache->near_cache_hits()); });
+    metrics.counter_fn("cache_near_cache_lookups_total", "Reads that looked in a near cache first",
+                       [cache]() { return static_cast<double>(cache->near_cache_lookups()); });
+    metrics.gauge_fn("cache_near_cache_hit_ratio", "Fraction of reads served from near caches", [cache]() {
+        const uint64_t lookups = cache->near_cache_lookups();
+        return lookups ? static_cast<double>(cache->near_cache_hits()) / lookups : 0.0;
+    });
+    metrics.gauge_family_fn("cache_hot_key_sampled_reads", "Sampled reads of each current hot key (decayed)", [cache]() {
+        std::vector<MetricsRegistry::Sample> samples;
+        for (const auto& hot : cache->hot_keys()) {
+            samples.push_back({"key=\"" + label_value(hot.key) + "\"", static_cast<double>(hot.samples)});
+        }
+        return samples;
+    });
+}
+
+// Asynchronous logger: lines written, and lines lost to full rings
+static void register_log_metrics(MetricsRegistry& metrics) {
+    metrics.counter_fn("cache_log_messages_written_total", "Log lines written by the background logger",
+                       []() { return static_cast<double>(Logger::global().written()); });
+    metrics.counter_fn("cache_log_messages_dropped_total", "Log lines dropped because a thread's log ring was full",
+                       []() { return static_cast<double>(Logger::global().dropped()); });
+}
+
+// Read-through: how often misses reach the origin
+static void register_load_metrics(MetricsRegistry& metrics, std::shared_ptr<Cache> cache) {
+    metrics.counter_fn("cache_origin_loads_total", "Values fetched from the origin, early refreshes included",
+                       [cache]() { return static_cast<double>(cache->loads()); });
+    metrics.counter_fn("cache_origin_coalesced_total", "Misses that waited for a fetch already in flight",
+                       [cache]() { return static_cast<double>(cache->coalesced_loads()); });
+    metrics.counter_fn("cache_origin_early_refreshes_total", "Fetches started before the cached value expired",
+                       [cache]() { return static_cast<double>(cache->early_refreshes()); });
+}
+
+namespace {
+constexpr time_t kOriginConnectTimeoutS = 2;
+constexpr time_t kOriginReadTimeoutS = 5;
+
+// Loader fetching GET <base><prefix>/<key> from an origin server
+Cache::Loader origin_loader(const std::string& url) {
+    // Split "http://host:port/prefix" into what httplib::Client takes and the path prefix
+    const size_t scheme = url.find("://");
+    const size_t path = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+    std::string base = path == std::string::npos ? url : url.substr(0, path);
+    std::string prefix = path == std::string::npos ? "" : url.substr(path);
+    while (!prefix.empty() && prefix.back() == '/') prefix.pop_back();
+
+    return [base = std::move(base), prefix = std::move(prefix)](std::string_view key) -> std::optional<std::string> {
+        httplib::Client cli(base.c_str());
+        cli.set_connection_timeout(kOriginConnectTimeoutS);
+        cli.set_read_timeout(kOriginReadTimeoutS);
+        auto res = cli.Get(prefix + "/" + encode_key(key));
+        if (!res) {
+            throw std::runtime_error("origin unreachable");
+        }
+        if (res->status == 404) {
+            return std::nullopt;
+        }
+        if (res->status != 200) {
+            throw std::runtime_error("origin returned " + std::to_string(res->status));
+        }
+        return std::move(res->body);
+    };
+}
+
+// httplib's connection queue backed by a WorkerPool. httplib owns the adapter and
+// shuts it down when listen() returns; a refused connection is closed by httplib.
+class PoolTaskQueue : public httplib::TaskQueue {
+public:
+    PoolTaskQueue(std::shared_ptr<WorkerPool> pool, Counter& refused) : pool_(std::move(pool)), refused_(refused) {}
+
+    bool enqueue(std::function<void()> fn) override {
+        if (pool_->submit(std::move(fn))) {
+            return true;
+        }
+        refused_.inc();
+        return false;
+    }
+
+    void shutdown() override { pool_->shutdown(); }
+
+private:
+    std::shared_ptr<WorkerPool> pool_;
+    Counter& refused_;
+};
+} // namespace
+
+CacheAPI::CacheAPI(std::shared_ptr<Cache> cache, ReplicationManager* repl, OpLog* oplog)
+    : cache_(std::move(cache)), replication_(repl), oplog_(oplog),
+      in_flight_(metrics_.gauge("cache_http_requests_in_flight", "HTTP requests being handled right now")),
+      shed_(metrics_.counter("cache_http_shed_total", "Requests answered 503 because their connection queued too long")) {
+    register_cache_metrics(metrics_, cache_);
+    register_log_metrics(metrics_);
+    if (cache_->hot_key_capacity() > 0) {
+        register_hot_key_metrics(metrics_, cache_);
+    }
+}
+
+CacheAPI::CacheAPI(std::shared_ptr<CoreEngine> engine, ReplicationManager* repl)
+    : engine_(std::move(engine)), replication_(repl), oplog_(nullptr),
+      in_flight_(metrics_.gauge("cache_http_requests_in_flight", "HTTP requests being handled right now")),
+      shed_(metrics_.counter("cache_http_shed_total", "Requests answered 503 because their connection queued too long")) {
+    register_cache_metrics(metrics_, engine_);
+    register_log_metrics(metrics_);
+    metrics_.gauge_fn("cache_engine_cores", "Worker cores of the per-core engine",
+                      [engine = engine_]() { return static_cast<double>(engine->core_count()); });
+}
+
+void CacheAPI::set_origin(const std::string& origin_url, uint64_t ttl_ms) {
+    if (!cache_) {
+        throw std::logic_error("read-through is not available in per-core mode");
+    }
+    if (!origin_) {
+        register_load_metrics(metrics_, cache_);
+    }
+    origin_ = origin_loader(origin_url);
+    origin_ttl_ms_ = ttl_ms;
+}
 
-void CacheAPI::logRequest(const std::string& method, const std::string& path, int status) {
-    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    std::tm tm_buf = safe_localtime(now);
-    std::cerr << "[" << std::put_time(&tm_buf, "%F %T") << "] "
-              << method << " " << path << " -> " << status << std::endl;
+void CacheAPI::set_server_options(const ServerOptions& options) {
+    options_ = options;
+    if (options_.rate_limit > 0 && !rate_limiter_) {
+        rate_limiter_ = std::make_unique<RateLimiter>(
+            options_.rate_limit, options_.rate_limit_burst > 0 ? options_.rate_limit_burst : options_.rate_limit);
+        metrics_.counter_fn("cache_http_rate_limited_total", "Requests answered 429 because the client was over its rate",
+                            [limiter = rate_limiter_.get()]() { return static_cast<double>(limiter->refused()); });
+    }
 }
 
-static std::string make_prometheus_metrics(const Cache &cache) {
-    std::ostringstream ss;
-    ss << "# HELP cache_hits_total Total number of cache hits\n";
-    ss << "# TYPE cache_hits_total counter\n";
-    ss << "cache_hits_total " << cache.hits() << "\n\n";
+bool CacheAPI::admit(const httplib::Request& req, httplib::Response& res, WorkerPool::Clock::duration waited) {
+    if (options_.queue_budget_ms > 0 && waited > std::chrono::milliseconds(options_.queue_budget_ms)) {
+        shed_.inc();
+        res.status = 503;
+        res.set_header("Retry-After", "1");
+    } else if (rate_limiter_ && !rate_limiter_->allow(req.remote_addr)) {
+        res.status = 429;
+        res.set_header("Retry-After", std::to_string(static_cast<long>(std::ceil(1.0 / options_.rate_limit))));
+    } else {
+        return true;
+    }
+    // A streamed request body (POST /cache/_import) is left unread, so the connection cannot be reused
+    res.set_header("Connection", "close");
+    res.set_content(res.status == 503 ? R"({"error":"overloaded"})" : R"({"error":"rate limited"})",
+                    "application/json");
+    return false;
+}
 
-    ss << "# HELP cache_misses_total Total number of cache misses\n";
-    ss << "# TYPE cache_misses_total counter\n";
-    ss << "cache_misses_total " << cache.misses() << "\n\n";
+Histogram& CacheAPI::request_latency(const char* method, const char* route) {
+    return metrics_.histogram(
+        "cache_request_duration_seconds", "Time to handle a request, until the response is ready to send",
+        Histogram::latency_bounds(), std::string("method=\"") + method + "\",route=\"" + route + "\"");
+}
 
-    ss << "# HELP cache_size Number of items currently stored in cache\n";
-    ss << "# TYPE cache_size gauge\n";
-    ss << "cache_size " << cache.size() << "\n\n";
+template <typename Handle>
+void CacheAPI::handle_instrumented(const char* method, Histogram& latency, bool admit, const httplib::Request& req,
+                                   httplib::Response& res, Handle&& handle) {
+    // Only the first request on a connection has waited in the queue
+    const auto waited = WorkerPool::take_queue_wait();
+    if (admit && !this->admit(req, res, waited)) {
+        logRequest(method, req.path, res.status);
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    {
+        // Decrements even if the handler throws (httplib turns that into a 500)
+        struct InFlight {
+            Gauge& gauge;
+            explicit InFlight(Gauge& g) : gauge(g) { gauge.inc(); }
+            ~InFlight() { gauge.dec(); }
+        } in_flight(in_flight_);
+        handle();
+    }
+    latency.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    logRequest(method, req.path, res.status);
+}
+
+httplib::Server::Handler CacheAPI::instrument(const char* method, const char* route, httplib::Server::Handler handler,
+                                              bool admit) {
+    return [this, method, &latency = request_latency(method, route), handler = std::move(handler),
+            admit](const httplib::Request& req, httplib::Response& res) {
+        handle_instrumented(method, latency, admit, req, res, [&] { handler(req, res); });
+    };
+}
 
-    ss << "# HELP cache_capacity Configured cache capacity\n";
-    ss << "# TYPE cache_capacity gauge\n";
-    ss << "cache_capacity " << cache.capacity() << "\n\n";
+httplib::Server::HandlerWithContentReader CacheAPI::instrument(const char* method, const char* route,
+                                                               httplib::Server::HandlerWithContentReader handler) {
+    return [this, method, &latency = request_latency(method, route), handler = std::move(handler)](
+               const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& reader) {
+        handle_instrumented(method, latency, true, req, res, [&] { handler(req, res, reader); });
+    };
+}
 
-    ss << "# HELP cache_eviction_interval_ms Async eviction interval in ms\n";
-    ss << "# TYPE cache_eviction_interval_ms gauge\n";
-    ss << "cache_eviction_interval_ms " << cache.eviction_interval() << "\n";
+void CacheAPI::put_batch(const std::vector<CacheItem>& items, bool raw) {
+    if (oplog_) oplog_->multi_put(items);
+    else if (engine_) engine_->multi_put(items);
+    else cache_->multi_put(items);
 
-    return ss.str();
+    if (replication_) {
+        replication_->replicatePutBatch(items, raw);
+    }
 }
 
 void CacheAPI::start(const std::string& host, int port) {
     // GET /cache/<key>
-    server_.Get(R"(/cache/(\w+))", [this](const httplib::Request& req, httplib::Response& res) {
-        auto key = req.matches[1];
-        auto val = cache_->get(key);
-        if (val.has_value()) {
-            json j = {{"value", val.value()}};
-            res.set_content(j.dump(), "application/json");
+    auto get_key = instrument("GET", "/cache/<key>",
+        [this](const httplib::Request& req, httplib::Response& res) {
+        auto key = route_key(req);
+        std::optional<ValueRef> val;
+        try {
+            val = engine_ ? engine_->get_ref(key)
+                : origin_ ? cache_->get_or_load(key, origin_, origin_ttl_ms_)
+                          : cache_->get_ref(key);
+        } catch (const std::exception& e) {
+            // Only the origin fetch throws
+            res.status = 502;
+            res.set_content(std::string{"{\"error\": \""} + e.what() + "\"}", "application/json");
+            return;
+        }
+        if (val.has_value() && raw_accepted(req)) {
+            // The value bytes as they are, straight from the shared value block
+            const size_t size = val->size();
+            res.set_content_provider(size, kOctetStream,
+                [value = std::move(*val)](size_t offset, size_t length, httplib::DataSink& sink) {
+                    return sink.write(value.view().data() + offset, std::min(length, value.size() - offset));
+                });
+            res.status = 200;
+        } else if (val.has_value()) {
+            // The body is streamed from the shared value block: no copy into json or dump()
+            auto body = std::make_shared<JsonValueBody>(std::move(*val));
+            res.set_content_provider(body->size(), "application/json",
+                [body](size_t offset, size_t length, httplib::DataSink& sink) {
+                    return body->write(offset, length, sink);
+                });
             res.status = 200;
         } else {
             res.status = 404;
             res.set_content(R"({"error": "not found"})", "application/json");
         }
-        logRequest("GET", req.path, res.status);
     });
 
-    // PUT /cache/<key>
-    server_.Put(R"(/cache/(\w+))", [this](const httplib::Request& req, httplib::Response& res) {
+    // PUT /cache/<key>. Requests with a body go through httplib's own routes, which run after
+    // it has read the body; any non-empty key matches, and route_key() takes it from req.path.
+    // An application/octet-stream body is the value itself, with the TTL in ?ttl= or X-TTL
+    // and optional memcached flags in ?flags=.
+    server_.Put(R"(/cache/[\s\S]+)", instrument("PUT", "/cache/<key>",
+        [this](const httplib::Request& req, httplib::Response& res) {
         try {
-            auto key = req.matches[1];
-            auto body_json = json::parse(req.body);
-
-            if (!body_json.contains("value")) {
-                res.status = 400;
-                res.set_content(R"({"error": "missing 'value'"})", "application/json");
-                return;
+            auto key = route_key(req);
+            const bool raw = raw_body(req);
+            json body_json;
+            std::string_view value;
+            uint64_t ttl = 0;
+            uint32_t flags = 0;
+            if (raw) {
+                value = req.body;
+                ttl = raw_ttl(req);
+                flags = raw_flags(req);
+            } else {
+                body_json = json::parse(req.body);
+                if (!body_json.contains("value")) {
+                    res.status = 400;
+                    res.set_content(R"({"error": "missing 'value'"})", "application/json");
+                    return;
+                }
+                value = body_json["value"].get_ref<const std::string&>();
+                ttl = body_json.value("ttl", 0);
             }
 
-            std::string value = body_json["value"];
-            uint64_t ttl = body_json.value("ttl", 0);
-
-            cache_->put(key, value, ttl);
+            if (oplog_) oplog_->put(key, value, ttl);
+            else if (engine_) engine_->put(key, value, ttl);
+            else cache_->put(key, value, ttl, flags);
 
             if (replication_) {
-                replication_->replicatePut(key, value, ttl);
+                replication_->replicatePut(std::string(key), std::string(value), ttl, raw, flags);
             }
 
             res.set_content(R"({"status": "ok"})", "application/json");
@@ -85,41 +546,259 @@ void CacheAPI::start(const std::string& host, int port) {
             res.status = 400;
             res.set_content(std::string{"{\"error\": \""} + e.what() + "\"}", "application/json");
         }
-        logRequest("PUT", req.path, res.status);
-    });
+    }));
 
     // DELETE /cache/<key>
-    server_.Delete(R"(/cache/(\w+))", [this](const httplib::Request& req, httplib::Response& res) {
-        auto key = req.matches[1];
-        if (cache_->erase(key)) {
+    auto delete_key = instrument("DELETE", "/cache/<key>",
+        [this](const httplib::Request& req, httplib::Response& res) {
+        auto key = route_key(req);
+        const bool erased = oplog_ ? oplog_->erase(key) : engine_ ? engine_->erase(key) : cache_->erase(key);
+        if (erased) {
             res.set_content(R"({"status": "deleted"})", "application/json");
             res.status = 200;
 
             if (replication_) {
-                replication_->replicateDelete(key);
+                replication_->replicateDelete(std::string(key));
             }
         } else {
             res.status = 404;
             res.set_content(R"({"error": "not found"})", "application/json");
         }
-        logRequest("DELETE", req.path, res.status);
     });
 
-    // GET /metrics
-    server_.Get("/metrics", [this](const httplib::Request& req, httplib::Response& res) {
-        auto body = make_prometheus_metrics(*cache_);
-        res.set_content(body, "text/plain; version=0.0.4; charset=utf-8");
+    // POST /cache/_mget  {"keys": ["k1", "k2"]} -> {"values": ["v1", null]}, in request order
+    server_.Post("/cache/_mget", instrument("POST", "/cache/_mget",
+        [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto keys = parse_keys(json::parse(req.body));
+            auto values = engine_ ? engine_->multi_get_ref(as_views(keys)) : cache_->multi_get_ref(as_views(keys));
+
+            std::string body = "{\"values\":[";
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i > 0) body.push_back(',');
+                if (values[i]) append_json_string(body, values[i]->view());
+                else body += "null";
+            }
+            body += "]}";
+
+            res.set_content(body, "application/json");
+            res.status = 200;
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(std::string{"{\"error\": \""} + e.what() + "\"}", "application/json");
+        }
+    }));
+
+    // POST /cache/_mset  {"items": [{"key": "k", "value": "v", "ttl": 0}, ...]}
+    server_.Post("/cache/_mset", instrument("POST", "/cache/_mset",
+        [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body_json = json::parse(req.body);
+            if (!body_json.contains("items") || !body_json["items"].is_array()) {
+                res.status = 400;
+                res.set_content(R"({"error": "missing 'items' array"})", "application/json");
+                return;
+            }
+
+            // Validate the whole batch before applying any of it
+            std::vector<CacheItem> items;
+            items.reserve(body_json["items"].size());
+            for (const auto& item : body_json["items"]) {
+                items.push_back({item.at("key").get_ref<const std::string&>(),
+                                 item.at("value").get_ref<const std::string&>(),
+                                 item.value("ttl", uint64_t{0})});
+            }
+
+            put_batch(items);
+
+            res.set_content("{\"status\": \"ok\", \"count\": " + std::to_string(items.size()) + "}",
+                            "application/json");
+            res.status = 200;
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(std::string{"{\"error\": \""} + e.what() + "\"}", "application/json");
+        }
+    }));
+
+    // POST /cache/_mdelete  {"keys": ["k1", "k2"]} -> {"deleted": <keys removed>}
+    server_.Post("/cache/_mdelete", instrument("POST", "/cache/_mdelete",
+        [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto keys = parse_keys(json::parse(req.body));
+            size_t removed = oplog_ ? oplog_->multi_erase(as_views(keys))
+                           : engine_ ? engine_->multi_erase(as_views(keys))
+                                     : cache_->multi_erase(as_views(keys));
+
+            if (replication_ && removed > 0) {
+                replication_->replicateDeleteBatch(keys);
+            }
+
+            res.set_content("{\"status\": \"ok\", \"deleted\": " + std::to_string(removed) + "}",
+                            "application/json");
+            res.status = 200;
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(std::string{"{\"error\": \""} + e.what() + "\"}", "application/json");
+        }
+    }));
+
+    // POST /cache/_import  newline-delimited {"key", "value", "ttl"} records -> {"imported": <records>}
+    server_.Post("/cache/_import", instrument("POST", "/cache/_import",
+        [this](const httplib::Request&, httplib::Response& res, const httplib::ContentReader& content_reader) {
+        // The body is parsed as it arrives and stored a batch at a time, never held whole
+        NdjsonImporter importer([this](const std::vector<CacheItem>& items) { put_batch(items, true); });
+        std::string error;
+        const bool read = content_reader([&importer, &error](const char* data, size_t length) {
+            try {
+                importer.feed({data, length});
+                return true;
+            } catch (const std::exception& e) {
+                error = e.what();
+                return false;   // Stop reading
+            }
+        });
+        if (error.empty() && !read) {
+            error = "request body could not be read";
+        }
+        if (error.empty()) {
+            try {
+                importer.finish();
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        }
+
+        std::string body = "{";
+        if (error.empty()) {
+            res.status = 200;
+            body += "\"status\": \"ok\"";
+        } else {
+            res.status = 400;
+            res.set_header("Connection", "close");   // The rest of the body is left unread
+            body += "\"error\": ";
+            append_json_string(body, error);
+        }
+        body += ", \"imported\": " + std::to_string(importer.records()) + "}";
+        res.set_content(body, "application/json");
+    }));
+
+    // GET /cache/_export -> every live entry as a newline-delimited {"key", "value", "ttl"} record
+    auto export_entries = instrument("GET", "/cache/_export",
+        [this](const httplib::Request&, httplib::Response& res) {
+        if (!cache_) {
+            res.status = 404;
+            res.set_content(R"({"error": "export is not available in per-core mode"})", "application/json");
+            return;
+        }
+        // One slice of the cache per chunk: shard locks are held for kExportSliceSlots slots at a time
+        struct Stream {
+            ExportCursor cursor;
+            std::string buffer;
+        };
+        auto stream = std::make_shared<Stream>();
         res.status = 200;
-        logRequest("GET", req.path, res.status);
+        res.set_chunked_content_provider(kNdjson,
+            [cache = cache_, stream](size_t, httplib::DataSink& sink) {
+            std::string& buffer = stream->buffer;
+            buffer.clear();
+            while (!stream->cursor.done && buffer.size() < kExportChunkBytes) {
+                for (const CacheRecord& record : cache->export_slice(stream->cursor, kExportSliceSlots)) {
+                    append_ndjson_record(buffer, record.key, record.value.view(), record.ttl_ms);
+                }
+            }
+            if (!buffer.empty() && !sink.write(buffer.data(), buffer.size())) {
+                return false;
+            }
+            if (stream->cursor.done) {
+                sink.done();
+            }
+            return true;
+        });
     });
 
-    server_.Get("/healthz", [this](const httplib::Request& req, httplib::Response& res) {
+    // GET /metrics
+    auto metrics = instrument("GET", "/metrics",
+        [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(metrics_.render(), "text/plain; version=0.0.4; charset=utf-8");
+        res.status = 200;
+    }, false);
+
+    // GET /debug/hot_keys -> current hot set and near-cache counters
+    auto hot_keys = instrument("GET", "/debug/hot_keys",
+        [this](const httplib::Request&, httplib::Response& res) {
+        if (!cache_) {
+            res.status = 404;
+            res.set_content(R"({"error": "hot-key tracking is not available in per-core mode"})", "application/json");
+            return;
+        }
+        json keys = json::array();
+        for (const auto& hot : cache_->hot_keys()) {
+            keys.push_back({{"key", hot.key}, {"sampled_reads", hot.samples}});
+        }
+        const uint64_t hits = cache_->near_cache_hits();
+        const uint64_t lookups = cache_->near_cache_lookups();
+        json body = {
+            {"capacity", cache_->hot_key_capacity()},
+            {"hot_keys", keys},
+            {"near_cache", {{"hits", hits}, {"lookups", lookups},
+                            {"hit_ratio", lookups ? static_cast<double>(hits) / lookups : 0.0}}},
+        };
+        // Keys are arbitrary bytes: invalid UTF-8 is replaced rather than failing the dump
+        res.set_content(body.dump(-1, ' ', false, json::error_handler_t::replace), "application/json");
+        res.status = 200;
+    }, false);
+
+    auto health = instrument("GET", "/healthz",
+        [](const httplib::Request&, httplib::Response& res) {
         res.set_content(R"({"status":"ok"})", "application/json");
         res.status = 200;
-        logRequest("GET", req.path, res.status);
+    }, false);
+
+    // Requests without a body are dispatched here, before httplib would try its regex routes
+    // one by one: match_route() classifies the path with a few comparisons and no allocation.
+    server_.set_pre_routing_handler([get_key = std::move(get_key), delete_key = std::move(delete_key),
+                                     metrics = std::move(metrics), hot_keys = std::move(hot_keys),
+                                     health = std::move(health), export_entries = std::move(export_entries)](
+                                        const httplib::Request& req, httplib::Response& res) {
+        const httplib::Server::Handler* handler = nullptr;
+        switch (match_route(req.method, req.path).route) {
+            case Route::CacheKey:
+                if (req.method == "DELETE") handler = &delete_key;
+                else if (req.method != "PUT") handler = &get_key;   // GET or HEAD
+                break;
+            case Route::Metrics: handler = &metrics; break;
+            case Route::HotKeys: handler = &hot_keys; break;
+            case Route::Health: handler = &health; break;
+            case Route::Export: handler = &export_entries; break;
+            default: break;   // Batch POSTs and imports, PUT, and paths that are not found
+        }
+        if (!handler) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+        (*handler)(req, res);
+        return httplib::Server::HandlerResponse::Handled;
     });
 
-    std::cerr << "🚀 Starting REST API on " << host << ":" << port << std::endl;
+    // Connections queue for a bounded pool instead of httplib's default one, so that a
+    // spike turns into refusals and cheap 503s (see admit()) rather than unbounded waits
+    const size_t threads = options_.threads > 0
+        ? options_.threads
+        : std::max<size_t>(8, std::max(1u, std::thread::hardware_concurrency()) - 1);
+    Histogram& queue_wait = metrics_.histogram(
+        "cache_http_queue_wait_seconds", "Time an accepted connection waited for a worker",
+        Histogram::latency_bounds());
+    Counter& refused = metrics_.counter(
+        "cache_http_rejected_connections_total", "Connections closed unserved because the worker queue was full");
+    auto pool = std::make_shared<WorkerPool>(threads, options_.max_queued, &queue_wait);
+    metrics_.gauge_fn("cache_http_queue_depth", "Accepted connections waiting for a worker",
+                      [pool]() { return static_cast<double>(pool->queued()); });
+    metrics_.gauge_fn("cache_http_worker_threads", "Threads serving HTTP connections",
+                      [pool]() { return static_cast<double>(pool->threads()); });
+    server_.new_task_queue = [pool, &refused]() { return new PoolTaskQueue(pool, refused); };
+    server_.set_keep_alive_max_count(options_.keep_alive_max);
+    server_.set_keep_alive_timeout(options_.keep_alive_timeout_s);
+
+    Logger::global().log(LogLevel::Info, "🚀 Starting REST API on ", host, ':', port);
 
     if (!server_.bind_to_port(host.c_str(), port)) {
         throw std::runtime_error("Failed to bind server to port");
@@ -1,18 +1,312 @@
 #include "cache.h"
+#include "compression.h"
 #include <mutex>
 #include <shared_mutex>
+#include <functional>
 #include "algorithm"
+#include <limits>
+#include <stdexcept>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <random>
 
-Cache::Cache(size_t capacity, uint64_t eviction_interval_ms) : 
-        capacity_(capacity), eviction_interval_ms_(eviction_interval_ms)
+namespace {
+constexpr uint64_t kClockResolutionMs = 1;    // Coarse clock refresh period
+constexpr size_t kMaxExpiredPerLock = 256;    // Expiry work per shard lock hold
+constexpr size_t kWindowPercent = 1;          // TinyLFU window share of a shard's budget
+constexpr size_t kProtectedPercent = 80;      // TinyLFU protected share of the main region
+constexpr size_t kAssumedEntryBytes = 256;    // Entry size assumed in byte mode, to size the sketch and policies
+constexpr double kEarlyRefreshBeta = 1.0;     // XFetch: > 1 refreshes earlier, < 1 later
+}
+
+// ---------------- LruList ----------------
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::LruList::push_front(Entry* entry) {
+    entry->lru_prev = nullptr;
+    entry->lru_next = head;
+    if (head) head->lru_prev = entry;
+    head = entry;
+    if (!tail) tail = entry;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::LruList::unlink(Entry* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = nullptr;
+}
+
+// ---------------- Shard: intrusive index + LRU lists ----------------
+
+template <typename Policy, typename SharedMutex>
+BasicCache<Policy, SharedMutex>::Shard::Shard(size_t page_size) : values(ValueArena::create(page_size)) {}
+
+template <typename Policy, typename SharedMutex>
+BasicCache<Policy, SharedMutex>::Shard::~Shard() {
+    clear();
+    values->release_owner();
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::Entry* BasicCache<Policy, SharedMutex>::Shard::find(std::string_view key, size_t hash) const {
+    if (lock_free_index) {
+        return lock_free_index->find(hash, [key](const Entry* e) { return e->key() == key; });
+    }
+    // The full cached hash filters fragment collisions before the key compare
+    return index.find(hash, [key, hash](const Entry* e) { return e->hash == hash && e->key() == key; });
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::Entry* BasicCache<Policy, SharedMutex>::Shard::create(std::string_view key, std::string_view value, bool compressed,
+                                   clock::time_point expiry, size_t hash, Region region, uint32_t flags) {
+    // Single allocation holding key and all links; value bytes come from the arena
+    Entry* entry = Entry::make(key, expiry, hash);
+    entry->region = region;
+    store_value(entry, value, compressed, flags);
+    link(entry);
+    return entry;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::assign_value(Entry* entry, std::string_view value, bool compressed, uint32_t flags) {
+    LruList& list = list_of(entry);
+    bytes_used -= footprint(entry);
+    list.weight -= weight(entry);
+    store_value(entry, value, compressed, flags);
+    if (hot_keys) hot_keys->invalidate(entry->hash);
+    bytes_used += footprint(entry);
+    list.weight += weight(entry);   // Policy queues count entries, so only the LRU lists care
+}
+
+// Values are immutable: readers holding the old block keep it until they drop it
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::store_value(Entry* entry, std::string_view value, bool compressed, uint32_t flags) {
+    entry->value = values->store(value, compressed, flags);
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::Shard::footprint(const Entry* entry) const {
+    return footprint(entry->key_size, entry->value.size());
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::Shard::footprint(size_t key_size, size_t value_size) const {
+    // Node, its index slot and control byte, key bytes and the slab chunk the value block occupies
+    return sizeof(Entry) + sizeof(Entry*) + 1 + key_size + values->chunk_size(value_size);
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::Shard::weight(const Entry* entry) const {
+    return capacity_bytes > 0 ? footprint(entry) : 1;
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::LruList& BasicCache<Policy, SharedMutex>::Shard::list_of(const Entry* entry) {
+    switch (entry->region) {
+        case Region::Window: return window;
+        case Region::Protected: return protected_segment;
+        default: return main;
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::link(Entry* entry) {
+    if (lock_free_index) lock_free_index->insert(entry);
+    else index.insert(entry);
+    ++count;
+    bytes_used += footprint(entry);
+    if constexpr (!kBuiltinLru) {
+        policy.insert(entry);
+        return;
+    }
+    LruList& list = list_of(entry);
+    list.push_front(entry);
+    list.weight += weight(entry);
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::destroy(Entry* entry) {
+    if (hot_keys) hot_keys->invalidate(entry->hash);
+    if (lock_free_index) lock_free_index->erase(entry);
+    else index.erase(entry);
+    --count;
+    bytes_used -= footprint(entry);
+    if constexpr (kBuiltinLru) {
+        LruList& list = list_of(entry);
+        list.unlink(entry);
+        list.weight -= weight(entry);
+    } else {
+        policy.remove(entry);
+    }
+    expiry_wheel.cancel(entry);
+    free(entry);
+}
+
+// Lock-free readers may still be looking at an unlinked node (and its value)
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::free(Entry* entry) {
+    if (lock_free_index) EpochDomain::global().retire(entry, [](void* p) { Entry::release(static_cast<Entry*>(p)); });
+    else Entry::release(entry);
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::touch_to_front(Entry* entry) {
+    LruList& list = list_of(entry);
+    if (entry == list.head) {
+        return;
+    }
+    list.unlink(entry);
+    list.push_front(entry);
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::move_to(Entry* entry, Region region) {
+    LruList& from = list_of(entry);
+    const size_t w = weight(entry);
+    from.unlink(entry);
+    from.weight -= w;
+    entry->region = region;
+    LruList& to = list_of(entry);
+    to.push_front(entry);
+    to.weight += w;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::clear() {
+    if constexpr (!kBuiltinLru) {
+        policy.for_each([this](Entry* e) { free(e); });
+        policy.clear();
+    }
+    for (LruList* list : {&window, &protected_segment, &main}) {
+        for (Entry* e = list->head; e != nullptr;) {
+            Entry* next = e->lru_next;
+            free(e);
+            e = next;
+        }
+        *list = LruList{};
+    }
+    if (lock_free_index) lock_free_index->clear();
+    else index.clear();
+    if (hot_keys) hot_keys->invalidate_all();
+    for (PendingLoad* load : pending_loads) {
+        load->overtaken = true;
+    }
+    count = 0;
+    bytes_used = 0;
+    expiry_wheel.clear();
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::Shard::overtake_loads(size_t hash) {
+    for (PendingLoad* load : pending_loads) {
+        if (load->hash == hash) {
+            load->overtaken = true;   // A hash collision only costs that load its store
+        }
+    }
+}
+
+// ---------------- Cache ----------------
+
+namespace {
+CacheOptions positional_options(size_t capacity, uint64_t eviction_interval_ms, size_t shard_count) {
+    CacheOptions options;
+    options.capacity = capacity;
+    options.eviction_interval_ms = eviction_interval_ms;
+    options.shard_count = shard_count;
+    return options;
+}
+}
+
+template <typename Policy, typename SharedMutex>
+BasicCache<Policy, SharedMutex>::BasicCache(size_t capacity, uint64_t eviction_interval_ms, size_t shard_count) :
+        BasicCache(positional_options(capacity, eviction_interval_ms, shard_count))
 {
-    // Start async eviction thread
-    eviction_thread_ = std::thread([this, eviction_interval_ms]() {
-        eviction_loop(eviction_interval_ms);
-    });
 }
 
-Cache::~Cache(){
+template <typename Policy, typename SharedMutex>
+BasicCache<Policy, SharedMutex>::BasicCache(const CacheOptions& options) :
+        capacity_(options.capacity), capacity_bytes_(options.capacity_bytes),
+        eviction_policy_(options.eviction), admission_policy_(options.admission),
+        lock_free_reads_(options.lock_free_reads),
+        hot_keys_(options.hot_keys > 0 ? std::make_unique<HotKeyTracker>(options.hot_keys) : nullptr),
+        compress_threshold_(options.compress_threshold),
+        epoch_(clock::now()), coarse_now_(epoch_.time_since_epoch().count()),
+        eviction_interval_ms_(std::max<uint64_t>(options.eviction_interval_ms, 1)),
+        next_sweep_(epoch_ + std::chrono::milliseconds(eviction_interval_ms_))
+{
+    if (admission_policy_ == AdmissionPolicy::TINY_LFU && eviction_policy_ != EvictionPolicy::LRU) {
+        // Promotions between segments relink entries, which CLOCK's shared-lock reads cannot do
+        throw std::invalid_argument("TinyLFU admission requires LRU eviction");
+    }
+    if (lock_free_reads_ && eviction_policy_ != EvictionPolicy::CLOCK) {
+        // LRU relinks on every hit, which needs the lock lock-free readers do not take
+        throw std::invalid_argument("Lock-free reads require CLOCK eviction");
+    }
+    if (!kBuiltinLru && (eviction_policy_ != EvictionPolicy::LRU || admission_policy_ != AdmissionPolicy::NONE ||
+                         lock_free_reads_)) {
+        // They are built on the LRU lists, which other policies replace
+        throw std::invalid_argument(std::string("CLOCK, TinyLFU and lock-free reads require the LRU policy, not ") +
+                                    Policy::kName);
+    }
+    if (std::is_same<SharedMutex, NoLock>::value && options.background_expiry) {
+        // The expiry thread would sweep the shards behind the owner's back
+        throw std::invalid_argument("A cache without shard locks requires background_expiry = false");
+    }
+
+    const bool bounded_by_bytes = options.capacity_bytes > 0;
+    const size_t budget = bounded_by_bytes ? options.capacity_bytes : options.capacity;
+    size_t shard_count = options.shard_count;
+
+    // Every shard must be able to hold at least one entry, otherwise keys
+    // hashing to an empty shard could never be stored.
+    shard_count = std::max<size_t>(1, std::min(shard_count, std::max<size_t>(budget, 1)));
+
+    // Under a byte budget, pages shrink with the slice so that the pages a shard
+    // holds beyond its live values stay a small part of it. Every shard gets the
+    // same page size, hence the same size classes.
+    const size_t page_size = bounded_by_bytes ? SlabAllocator::page_size_for(budget / shard_count)
+                                              : SlabAllocator::kDefaultPageSize;
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        auto shard = std::make_unique<Shard>(page_size);
+        // Spread the remainder over the first shards so slices sum to the budget
+        size_t slice = budget / shard_count + (i < budget % shard_count ? 1 : 0);
+        if (bounded_by_bytes) {
+            shard->capacity = std::numeric_limits<size_t>::max();
+            shard->capacity_bytes = slice;
+        } else {
+            shard->capacity = slice;
+        }
+        if (admission_policy_ == AdmissionPolicy::TINY_LFU) {
+            shard->window_capacity = std::max<size_t>(1, slice * kWindowPercent / 100);
+            shard->protected_capacity = (slice - std::min(slice, shard->window_capacity)) * kProtectedPercent / 100;
+            shard->sketch = std::make_unique<FrequencySketch>(bounded_by_bytes ? slice / kAssumedEntryBytes : slice);
+        }
+        if constexpr (!kBuiltinLru) {
+            shard->policy.set_capacity(bounded_by_bytes ? slice / kAssumedEntryBytes : slice);
+        }
+        if (lock_free_reads_) {
+            shard->lock_free_index = std::make_unique<RcuIndex<Entry, &Entry::hash>>();
+        }
+        shard->hot_keys = hot_keys_.get();
+        shards_.push_back(std::move(shard));
+    }
+
+    // Start async eviction thread, unless the owner drives maintain() itself
+    if (options.background_expiry) {
+        eviction_thread_ = std::thread([this]() {
+            eviction_loop();
+        });
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+BasicCache<Policy, SharedMutex>::~BasicCache(){
     // Signal stop and join background thread
     stop_eviction_.store(true);
     if(eviction_thread_.joinable()){
@@ -20,157 +314,1183 @@ Cache::~Cache(){
     }
 }
 
-// PRECONDITION: caller holds mutex_ with a unique_lock
-void Cache::evict_if_needed(){
-    if(map_.size() <= capacity_){
-        return;   // No eviction needed
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::hash_key(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::shard_index(size_t hash) const {
+    if (shards_.size() == 1) {
+        return 0;
     }
+    // Fibonacci mixing so the shard choice does not correlate with the
+    // hash bits the shard's own index uses for group selection.
+    uint64_t h = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((h >> 32) % shards_.size());
+}
 
-    // Evict from the back of the LRU list
-    auto lru_key = lru_list_.back();
-    lru_list_.pop_back();
-    map_.erase(lru_key); // Remove from map
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::shard_of(std::string_view key) const {
+    return shard_index(hash_key(key));
 }
 
-void Cache::put(const std::string& key, const std::string& value, uint64_t ttl_ms){
-    auto now = clock::now();
-    clock::time_point expiry_time;
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::Shard& BasicCache<Policy, SharedMutex>::shard_for(size_t hash) const {
+    return *shards_[shard_index(hash)];
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::clock::time_point BasicCache<Policy, SharedMutex>::now() const {
+    return clock::time_point(clock::duration(coarse_now_.load(std::memory_order_relaxed)));
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::expiry_tick(clock::time_point expiry) const {
+    // Round up so an entry is never swept before its expiry time
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(expiry - epoch_).count();
+    if (ms <= 0) {
+        return 0;
+    }
+    return (static_cast<uint64_t>(ms) + eviction_interval_ms_ - 1) / eviction_interval_ms_;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::schedule_expiry(Shard& shard, Entry* entry) const {
+    if (entry->expiry != clock::time_point::max()) {
+        shard.expiry_wheel.schedule(entry, expiry_tick(entry->expiry));
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::is_expired(const Entry* entry, clock::time_point now) {
+    return entry->expiry != clock::time_point::max() && entry->expiry < now;
+}
+
+// Runs before the new entry is linked so it can never be chosen as its own victim.
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::evict_if_needed(Shard& shard, size_t incoming_bytes, const Entry* keep) const {
+    auto over_budget = [&shard, incoming_bytes]() {
+        if (shard.capacity_bytes > 0) {
+            return shard.bytes_used + incoming_bytes > shard.capacity_bytes;
+        }
+        return shard.count >= shard.capacity;
+    };
+
+    while (shard.count > 0 && over_budget()) {
+        Entry* victim = select_victim(shard, keep);
+        if (victim == nullptr) {
+            return;   // Nothing left but the protected entry
+        }
+        shard.destroy(victim);
+        evictions_.inc();
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::Entry* BasicCache<Policy, SharedMutex>::select_victim(Shard& shard, const Entry* keep) const {
+    if constexpr (!kBuiltinLru) {
+        return shard.policy.victim(keep);
+    }
+
+    // The list tail is the victim for LRU and the clock hand for CLOCK:
+    // referenced entries get a second chance at the front. Two passes are
+    // enough because the first one clears every reference bit.
+    for (size_t scanned = 0; scanned <= 2 * shard.count; ++scanned) {
+        Entry* e = shard.main.tail;
+        if (e == keep) {
+            shard.touch_to_front(e);
+            continue;
+        }
+        if (lock_free_reads_ && e->access_tick.load(std::memory_order_relaxed) != 0) {
+            e->access_tick.store(0, std::memory_order_relaxed);   // Hit since the hand last passed
+            shard.touch_to_front(e);
+            continue;
+        }
+        if (eviction_policy_ == EvictionPolicy::CLOCK && e->referenced.load(std::memory_order_relaxed)) {
+            e->referenced.store(false, std::memory_order_relaxed);
+            shard.touch_to_front(e);
+            continue;
+        }
+        return e;
+    }
+    return nullptr;
+}
+
+// Runs after the new entry is linked into the window.
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::admit_candidates(Shard& shard) const {
+    // Window overflow moves to the MRU end of probation; the first entry
+    // moved is the oldest candidate and later ones sit towards the head.
+    Entry* candidate = nullptr;
+    while (shard.window.weight > shard.window_capacity && shard.window.tail != nullptr) {
+        Entry* e = shard.window.tail;
+        shard.move_to(e, Region::Main);
+        if (candidate == nullptr) {
+            candidate = e;
+        }
+    }
+
+    auto over_budget = [&shard]() {
+        if (shard.capacity_bytes > 0) {
+            return shard.bytes_used > shard.capacity_bytes;
+        }
+        return shard.count > shard.capacity;
+    };
+
+    while (shard.count > 0 && over_budget()) {
+        Entry* victim = shard.main.tail;
+        if (victim == candidate) {
+            victim = shard.protected_segment.tail;   // Probation holds only candidates
+        }
+
+        if (candidate == nullptr) {
+            shard.destroy(victim != nullptr ? victim : shard.window.tail);
+            evictions_.inc();
+            continue;
+        }
+
+        if (victim != nullptr &&
+            shard.sketch->frequency(candidate->hash) > shard.sketch->frequency(victim->hash)) {
+            shard.destroy(victim);
+            evictions_.inc();
+            continue;
+        }
+
+        // Not seen more often than what it would replace: turn it away
+        Entry* next = candidate->lru_prev;
+        shard.destroy(candidate);
+        rejections_.inc();
+        evictions_.inc();
+        candidate = next;
+    }
+}
+
+// PRECONDITION: caller holds shard.mutex (shared is enough if shared_reads()), or is pinned in lock-free mode
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::on_access(Shard& shard, Entry* entry) const {
+    if constexpr (!kBuiltinLru) {
+        shard.policy.access(entry);
+        return;
+    }
+    if (lock_free_reads_) {
+        // At most one store per entry and clock tick, however hot the key
+        const uint32_t tick = access_stamp();
+        if (entry->access_tick.load(std::memory_order_relaxed) != tick) {
+            entry->access_tick.store(tick, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (eviction_policy_ == EvictionPolicy::CLOCK) {
+        // Test before set so hot entries do not keep dirtying their cache line
+        if (!entry->referenced.load(std::memory_order_relaxed)) {
+            entry->referenced.store(true, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (shard.sketch && entry->region == Region::Main) {
+        // A hit on probation promotes to protected, whose overflow is demoted back
+        shard.move_to(entry, Region::Protected);
+        while (shard.protected_segment.weight > shard.protected_capacity &&
+               shard.protected_segment.tail != entry) {
+            shard.move_to(shard.protected_segment.tail, Region::Main);
+        }
+        return;
+    }
+    shard.touch_to_front(entry); // Move to front of its LRU List
+}
+
+template <typename Policy, typename SharedMutex>
+typename BasicCache<Policy, SharedMutex>::clock::time_point BasicCache<Policy, SharedMutex>::expiry_for(uint64_t ttl_ms, clock::time_point now) {
+    if (ttl_ms > 0) {
+        return now + std::chrono::milliseconds(ttl_ms);
+    }
+    return clock::time_point::max(); // Put expiry far in the future
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::remaining_ttl_ms(clock::time_point expiry, clock::time_point now) {
+    if (expiry == clock::time_point::max()) {
+        return 0;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(expiry - now).count();
+    return std::max<uint64_t>(1, static_cast<uint64_t>(std::max<int64_t>(left, 0)));
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::put(std::string_view key, std::string_view value, uint64_t ttl_ms, uint32_t flags){
+    std::string buffer;
+    bool compressed = false;
+    const std::string_view stored = pack(value, buffer, compressed);
+
+    const auto now = this->now();
+    const size_t hash = hash_key(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock<SharedMutex> lock(shard.mutex);
+    put_locked(shard, key, stored, compressed, hash, expiry_for(ttl_ms, now), now, flags);
+}
+
+template <typename Policy, typename SharedMutex>
+std::string_view BasicCache<Policy, SharedMutex>::pack(std::string_view value, std::string& buffer, bool& compressed) const {
+    compressed = false;
+    if (compress_threshold_ == 0 || value.size() < compress_threshold_) {
+        return value;
+    }
+    const auto start = clock::now();
+    compressed = compress_value(value, buffer);
+    compress_ns_.inc(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - start).count()));
+    if (!compressed) {
+        incompressible_values_.inc();
+        return value;
+    }
+    compressed_values_.inc();
+    compress_raw_bytes_.inc(value.size());
+    compress_stored_bytes_.inc(buffer.size());
+    return buffer;
+}
+
+template <typename Policy, typename SharedMutex>
+std::string BasicCache<Policy, SharedMutex>::copy_value(const ValueRef& value) const {
+    if (!value.compressed()) {
+        return std::string(value.view());
+    }
+    const auto start = clock::now();
+    std::string out(decompressed_size(value.view()), '\0');
+    decompress_value(value.view(), &out[0]);
+    decompressions_.inc();
+    decompress_ns_.inc(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - start).count()));
+    return out;
+}
 
-    if(ttl_ms > 0){
-        expiry_time = now + std::chrono::milliseconds(ttl_ms);
+template <typename Policy, typename SharedMutex>
+uint32_t BasicCache<Policy, SharedMutex>::access_stamp() const {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now() - epoch_).count();
+    return static_cast<uint32_t>(ms) | 1u;   // Never 0, which means "not hit"
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::unpack(std::optional<ValueRef>& value) const {
+    if (!value || !value->compressed()) {
+        return;
     }
-    else{
-        expiry_time = clock::time_point::max(); // Put expiry far in the future
+    const auto start = clock::now();
+    const std::string_view packed = value->view();
+    value = ValueRef::make(decompressed_size(packed), [packed](char* out) { decompress_value(packed, out); },
+                           value->flags());
+    decompressions_.inc();
+    decompress_ns_.inc(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - start).count()));
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::put_locked(Shard& shard, std::string_view key, std::string_view value, bool compressed, size_t hash,
+                       clock::time_point expiry_time, clock::time_point now, uint32_t flags) {
+    if (shard.sketch) {
+        shard.sketch->increment(hash);
     }
+    shard.overtake_loads(hash);
 
-    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // An entry larger than the whole memory budget of its shard is never stored
+    const size_t incoming = shard.footprint(key.size(), value.size());
+    const bool fits = shard.capacity_bytes == 0 || incoming <= shard.capacity_bytes;
 
     // Check if key already exists
-    auto it = map_.find(key);
-    if (it != map_.end()) {
-        // If the existing record is expired, remove then fall through to fresh insert
-        if (it->second.expiry != clock::time_point::max() && it->second.expiry < now) {
-            lru_list_.erase(it->second.lru_it);
-            map_.erase(it);
+    if (Entry* existing = shard.find(key, hash)) {
+        // If the existing record is expired (or the new value can't fit), remove then fall through.
+        // Lock-free readers may be reading the entry, so it is replaced rather than updated.
+        if (is_expired(existing, now) || !fits || shard.lock_free_index) {
+            if (is_expired(existing, now)) {
+                expirations_.inc();
+            }
+            shard.destroy(existing);
         } else {
             // Update existing
-            it->second.value = value;
-            it->second.expiry = expiry_time;
-            touch_to_front(it);
+            shard.assign_value(existing, value, compressed, flags);
+            existing->expiry = expiry_time;
+            shard.expiry_wheel.cancel(existing);
+            schedule_expiry(shard, existing);
+            on_access(shard, existing);
+            if (shard.sketch) {
+                admit_candidates(shard);
+            } else if (shard.capacity_bytes > 0) {
+                evict_if_needed(shard, 0, existing); // A bigger value may push the shard over budget
+            }
             return;
         }
     }
 
-    // Insert new key at front of LRU list
-    lru_list_.push_front(key);
+    if (shard.capacity == 0 || !fits) {
+        return;   // Can't store anything
+    }
 
-    // Add entry to map
-    Entry entry{value, expiry_time, lru_list_.begin()};
-    map_[key] = entry;
+    if (shard.sketch) {
+        // New keys enter the window and compete for the main region once they leave it
+        Entry* entry = shard.create(key, value, compressed, expiry_time, hash, Region::Window, flags);
+        schedule_expiry(shard, entry);
+        admit_candidates(shard);
+        return;
+    }
 
     // Check if eviction is needed
-    evict_if_needed();
+    evict_if_needed(shard, incoming);
+
+    Entry* entry = shard.create(key, value, compressed, expiry_time, hash, Region::Main, flags);
+    schedule_expiry(shard, entry);
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<std::string> BasicCache<Policy, SharedMutex>::get(std::string_view key){
+    if (lock_free_reads_) {
+        const size_t hash = hash_key(key);
+        bool fill = false;
+        if (auto near = near_lookup(key, hash, fill)) {
+            return std::string(near->view());
+        }
+
+        // Copied while pinned: not even the value's reference count is written
+        std::optional<std::string> value;
+        Shard& shard = shard_for(hash);
+        visit_pinned(shard, key, hash, [this, &value](const Entry& entry) {
+            value = copy_value(entry.value);
+        });
+        if (fill && value) {
+            fill_near_cache(shard, key, hash);
+        }
+        return value;
+    }
+
+    // The copy is made after the shard lock has been released
+    auto ref = get_ref(key);
+    if (!ref) {
+        return std::nullopt;
+    }
+    return std::string(ref->view());
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::get_ref(std::string_view key){
+    const size_t hash = hash_key(key);
+    bool fill = false;
+    if (auto near = near_lookup(key, hash, fill)) {
+        return near;
+    }
+
+    Shard& shard = shard_for(hash);
+    std::optional<ValueRef> ref;
+    if (shared_reads()) {
+        ref = get_shared(shard, key, hash);
+    } else {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        ref = get_locked(shard, key, hash, now());
+    }
+    unpack(ref);
+    if (fill && ref) {
+        fill_near_cache(shard, key, hash);
+    }
+    return ref;
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::near_lookup(std::string_view key, size_t hash, bool& fill) {
+    fill = false;
+    if (!hot_keys_ || hot_keys_->sample(key, hash)) {
+        return std::nullopt;
+    }
+    auto near = hot_keys_->near_get(key, hash, now());
+    if (near) {
+        hits_.inc();
+    } else {
+        fill = hot_keys_->is_hot(hash);
+    }
+    return near;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::fill_near_cache(Shard& shard, std::string_view key, size_t hash) {
+    // Stamps first: a write after them makes the copy stale, whatever it read
+    const std::optional<HotKeyTracker::Ticket> ticket = hot_keys_->begin_fill(hash);
+    if (!ticket) {
+        return;   // Left the hot set since near_lookup()
+    }
+    std::optional<ValueRef> value;
+    clock::time_point expiry;
+    {
+        std::shared_lock<SharedMutex> lock(shard.mutex);
+        Entry* entry = shard.find(key, hash);
+        if (entry == nullptr || is_expired(entry, now())) {
+            return;
+        }
+        value = entry->value;
+        expiry = entry->expiry;
+    }
+    unpack(value);
+    hot_keys_->near_put(key, hash, *ticket, value->view(), expiry, value->flags());
+}
+
+// ---------------- Read-through loading ----------------
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::get_or_load(std::string_view key, const Loader& loader, uint64_t ttl_ms) {
+    const size_t hash = hash_key(key);
+    Shard& shard = shard_for(hash);
+    HitInfo info;
+    std::optional<ValueRef> ref;
+    if (shared_reads()) {
+        ref = get_shared(shard, key, hash, &info);
+    } else {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        ref = get_locked(shard, key, hash, now(), &info);
+    }
+
+    if (ref) {
+        unpack(ref);
+        if (!refresh_early(info)) {
+            return ref;
+        }
+        // Whoever finds a refresh already running keeps the cached value
+        try {
+            auto fresh = loads_.try_run(std::string(key), [&] { return load(shard, key, hash, loader, ttl_ms); });
+            if (fresh) {
+                early_refreshes_.inc();
+                return *fresh;
+            }
+        } catch (...) {
+            // Still valid until it expires; the load that follows the expiry reports the error
+        }
+        return ref;
+    }
+
+    bool joined = false;
+    auto loaded = loads_.run(std::string(key), [&]() -> std::optional<ValueRef> {
+        // A caller that missed just before the previous load stored its value finds it here
+        if (auto cached = peek(shard, key, hash)) {
+            return cached;
+        }
+        return load(shard, key, hash, loader, ttl_ms);
+    }, &joined);
+    if (joined) {
+        coalesced_loads_.inc();
+    }
+    return loaded;
+}
+
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::refresh_early(const HitInfo& info) const {
+    if (info.load_ms == 0 || info.expiry == clock::time_point::max()) {
+        return false;   // Not loaded, or never expires
+    }
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    // -ln(1 - u) is exponential with mean 1: usually well under the load
+    // cost ahead of expiry, occasionally a few times it
+    const double ahead_ms = -static_cast<double>(info.load_ms) * kEarlyRefreshBeta * std::log(1.0 - u);
+    return now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(ahead_ms))
+        >= info.expiry;
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::peek(Shard& shard, std::string_view key, size_t hash) const {
+    std::optional<ValueRef> value;
+    {
+        std::shared_lock<SharedMutex> lock(shard.mutex);
+        Entry* entry = shard.find(key, hash);
+        if (entry == nullptr || is_expired(entry, now())) {
+            return std::nullopt;
+        }
+        value = entry->value;
+    }
+    unpack(value);
+    return value;
 }
 
-std::optional<std::string> Cache::get(const std::string& key){
-    std::unique_lock<std::shared_mutex> lock(mutex_);
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::load(Shard& shard, std::string_view key, size_t hash, const Loader& loader,
+                                                 uint64_t ttl_ms) {
+    // From here on, a put or erase of the key is newer than anything the loader can return
+    PendingLoad pending;
+    pending.hash = hash;
+    {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        shard.pending_loads.push_back(&pending);
+    }
+    auto withdraw = [&shard, &pending] {   // Under the shard lock
+        auto& loads = shard.pending_loads;
+        loads.erase(std::find(loads.begin(), loads.end(), &pending));
+    };
+
+    loads_started_.inc();
+    const auto start = clock::now();
+    std::optional<std::string> value;
+    try {
+        value = loader(key);
+    } catch (...) {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        withdraw();
+        throw;
+    }
+    const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+    const auto load_ms = static_cast<uint16_t>(std::clamp<int64_t>(took, 1, std::numeric_limits<uint16_t>::max()));
+
+    std::string buffer;
+    bool compressed = false;
+    const std::string_view stored = value ? pack(*value, buffer, compressed) : std::string_view();
+    {
+        const auto now = this->now();
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        withdraw();
+        if (pending.overtaken) {
+            // Left as the writer made it; the callers still get what the loader returned
+        } else if (value) {
+            put_locked(shard, key, stored, compressed, hash, expiry_for(ttl_ms, now), now);
+            if (Entry* entry = shard.find(key, hash)) {
+                entry->load_ms.store(load_ms, std::memory_order_relaxed);
+            }
+        } else if (Entry* entry = shard.find(key, hash)) {
+            shard.destroy(entry);   // Not written since the load started: the stale loaded copy
+        }
+    }
+    if (!value) {
+        return std::nullopt;
+    }
+    // Returned even if admission turned it away
+    return ValueRef::make(value->size(), [&value](char* out) { std::memcpy(out, value->data(), value->size()); });
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::get_locked(Shard& shard, std::string_view key, size_t hash, clock::time_point now,
+                                                       HitInfo* info){
+    if (shard.sketch) {
+        shard.sketch->increment(hash);  // Misses count too: a key asked for often deserves admission
+    }
 
-    auto it = map_.find(key);
-    if(it == map_.end()){
-        misses_++;
+    Entry* entry = shard.find(key, hash);
+    if(entry == nullptr){
+        misses_.inc();
         return std::nullopt; // key not found
     }
 
-    auto now = clock::now();
-    if(it->second.expiry != clock::time_point::max() && it->second.expiry < now){
+    if(is_expired(entry, now)){
         // Key is expired
-        lru_list_.erase(it->second.lru_it); // Remove from LRU list
-        map_.erase(it); // Remove from map
-        misses_++;
+        shard.destroy(entry);
+        expirations_.inc();
+        misses_.inc();
         return std::nullopt;  // Return empty optional
     }
 
-    touch_to_front(it); // Move to front of LRU List
-    hits_++; 
-    return it->second.value; // Return the value
+    on_access(shard, entry);
+    hits_.inc();
+    if (info) {
+        *info = {entry->expiry, entry->load_ms.load(std::memory_order_relaxed)};
+    }
+    return entry->value; // Shares the block, no byte is copied
+}
+
+template <typename Policy, typename SharedMutex>
+template <typename F>
+bool BasicCache<Policy, SharedMutex>::visit_pinned(Shard& shard, std::string_view key, size_t hash, F&& use) {
+    {
+        EpochDomain::Guard pin = EpochDomain::global().pin();
+        Entry* entry = shard.find(key, hash);
+        if (entry == nullptr) {
+            misses_.inc();
+            return false;
+        }
+        if (!is_expired(entry, now())) {
+            on_access(shard, entry);
+            hits_.inc();
+            use(*entry);
+            return true;
+        }
+    }
+    remove_if_expired(shard, key, hash);
+    misses_.inc();
+    return false;
+}
+
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::shared_reads() const {
+    if constexpr (kBuiltinLru) {
+        return eviction_policy_ == EvictionPolicy::CLOCK;
+    }
+    return Policy::kSharedReads;
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<ValueRef> BasicCache<Policy, SharedMutex>::get_shared(Shard& shard, std::string_view key, size_t hash, HitInfo* info){
+    if (shard.lock_free_index) {
+        std::optional<ValueRef> ref;
+        visit_pinned(shard, key, hash, [&ref, info](const Entry& entry) {
+            ref = entry.value;
+            if (info) {
+                *info = {entry.expiry, entry.load_ms.load(std::memory_order_relaxed)};
+            }
+        });
+        return ref;
+    }
+
+    {
+        std::shared_lock<SharedMutex> lock(shard.mutex);
+
+        Entry* entry = shard.find(key, hash);
+        if(entry == nullptr){
+            misses_.inc();
+            return std::nullopt; // key not found
+        }
+
+        if(!is_expired(entry, now())){
+            on_access(shard, entry);
+            hits_.inc();
+            if (info) {
+                *info = {entry->expiry, entry->load_ms.load(std::memory_order_relaxed)};
+            }
+            return entry->value;
+        }
+    }
+
+    // Expired: removal needs the exclusive lock
+    remove_if_expired(shard, key, hash);
+    misses_.inc();
+    return std::nullopt;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::remove_if_expired(Shard& shard, std::string_view key, size_t hash) {
+    // Re-check because another thread may have replaced or removed the entry in between
+    std::unique_lock<SharedMutex> lock(shard.mutex);
+    Entry* entry = shard.find(key, hash);
+    if (entry != nullptr && is_expired(entry, now())) {
+        shard.destroy(entry);
+        expirations_.inc();
+    }
 }
 
-bool Cache::erase(const std::string& key){
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto it = map_.find(key);
-    if (it == map_.end()) return false;
-    lru_list_.erase(it->second.lru_it);
-    map_.erase(it);
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::erase(std::string_view key){
+    const size_t hash = hash_key(key);
+    Shard& shard = shard_for(hash);
+    std::unique_lock<SharedMutex> lock(shard.mutex);
+    shard.overtake_loads(hash);
+    Entry* entry = shard.find(key, hash);
+    if (entry == nullptr) return false;
+    shard.destroy(entry);
     return true;
 }
 
-size_t Cache::size() const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return map_.size();
+template <typename Policy, typename SharedMutex>
+std::optional<uint64_t> BasicCache<Policy, SharedMutex>::incr(std::string_view key, uint64_t delta, uint64_t* ttl_ms,
+                                                 uint32_t* flags) {
+    return add(key, delta, false, ttl_ms, flags);
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<uint64_t> BasicCache<Policy, SharedMutex>::decr(std::string_view key, uint64_t delta, uint64_t* ttl_ms,
+                                                 uint32_t* flags) {
+    return add(key, delta, true, ttl_ms, flags);
+}
+
+template <typename Policy, typename SharedMutex>
+std::optional<uint64_t> BasicCache<Policy, SharedMutex>::add(std::string_view key, uint64_t delta, bool decrement,
+                                                uint64_t* ttl_ms, uint32_t* flags) {
+    const size_t hash = hash_key(key);
+    Shard& shard = shard_for(hash);
+    const auto now = this->now();
+    std::unique_lock<SharedMutex> lock(shard.mutex);
+    Entry* entry = shard.find(key, hash);
+    if (entry == nullptr || is_expired(entry, now)) {
+        return std::nullopt;   // An expired entry is left to the sweep
+    }
+
+    // A number is at most 20 digits, far below any compression threshold
+    const std::string_view text = entry->value_view();
+    uint64_t current = 0;
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), current);
+    if (entry->value.compressed() || text.empty() || parsed.ec != std::errc() ||
+        parsed.ptr != text.data() + text.size()) {
+        throw std::invalid_argument("value is not a decimal number");
+    }
+
+    const uint64_t next = decrement ? (current > delta ? current - delta : 0) : current + delta;
+    char buf[20];
+    const auto printed = std::to_chars(buf, buf + sizeof(buf), next);
+    const uint32_t kept_flags = entry->value.flags();   // Flags survive, as in memcached
+    if (ttl_ms != nullptr) {
+        *ttl_ms = remaining_ttl_ms(entry->expiry, now);
+    }
+    if (flags != nullptr) {
+        *flags = kept_flags;
+    }
+    put_locked(shard, key, std::string_view(buf, static_cast<size_t>(printed.ptr - buf)), false, hash,
+               entry->expiry, now, kept_flags);
+    return next;
+}
+
+// ---------------- Batched operations ----------------
+
+template <typename Policy, typename SharedMutex>
+template <typename F>
+void BasicCache<Policy, SharedMutex>::for_each_shard(const std::vector<size_t>& hashes, F&& fn) const {
+    // (shard, position) pairs sorted by shard, so each shard is visited once
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(hashes.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        order.emplace_back(shard_index(hashes[i]), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<size_t> positions;
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin;
+        positions.clear();
+        while (end < order.size() && order[end].first == order[begin].first) {
+            positions.push_back(order[end].second);
+            ++end;
+        }
+        fn(*shards_[order[begin].first], positions);
+        begin = end;
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+std::vector<std::optional<std::string>> BasicCache<Policy, SharedMutex>::multi_get(const std::vector<std::string_view>& keys){
+    auto refs = multi_get_ref(keys);
+    std::vector<std::optional<std::string>> result(refs.size());
+    for (size_t i = 0; i < refs.size(); ++i) {
+        if (refs[i]) {
+            result[i] = std::string(refs[i]->view());
+        }
+    }
+    return result;
+}
+
+template <typename Policy, typename SharedMutex>
+std::vector<std::optional<ValueRef>> BasicCache<Policy, SharedMutex>::multi_get_ref(const std::vector<std::string_view>& keys){
+    std::vector<size_t> hashes(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        hashes[i] = hash_key(keys[i]);
+    }
+
+    std::vector<std::optional<ValueRef>> result(keys.size());
+    const auto now = this->now();
+    for_each_shard(hashes, [&](Shard& shard, const std::vector<size_t>& positions) {
+        if (!shared_reads()) {
+            std::unique_lock<SharedMutex> lock(shard.mutex);
+            for (size_t i : positions) {
+                result[i] = get_locked(shard, keys[i], hashes[i], now);
+            }
+            return;
+        }
+
+        bool saw_expired = false;
+        {
+            // Lock-free mode pins the epoch instead of sharing the lock
+            std::shared_lock<SharedMutex> lock(shard.mutex, std::defer_lock);
+            EpochDomain::Guard pin;
+            if (shard.lock_free_index) pin = EpochDomain::global().pin();
+            else lock.lock();
+            for (size_t i : positions) {
+                Entry* entry = shard.find(keys[i], hashes[i]);
+                if (entry == nullptr || is_expired(entry, now)) {
+                    saw_expired |= entry != nullptr;
+                    misses_.inc();
+                    continue;
+                }
+                on_access(shard, entry);
+                hits_.inc();
+                result[i] = entry->value;
+            }
+        }
+        if (saw_expired) {
+            // Same re-check as get_shared(), once for the whole batch
+            std::unique_lock<SharedMutex> lock(shard.mutex);
+            for (size_t i : positions) {
+                Entry* entry = shard.find(keys[i], hashes[i]);
+                if (!result[i] && entry != nullptr && is_expired(entry, now)) {
+                    shard.destroy(entry);
+                    expirations_.inc();
+                }
+            }
+        }
+    });
+    for (auto& ref : result) {
+        unpack(ref);
+    }
+    return result;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::multi_put(const std::vector<CacheItem>& items){
+    std::vector<size_t> hashes(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        hashes[i] = hash_key(items[i].key);
+    }
+
+    // Compress up front so no shard lock is held meanwhile
+    std::vector<std::string> buffers(compress_threshold_ > 0 ? items.size() : 0);
+    std::vector<std::string_view> stored(items.size());
+    std::vector<char> compressed(items.size(), 0);
+    for (size_t i = 0; i < items.size(); ++i) {
+        bool packed = false;
+        stored[i] = compress_threshold_ > 0 ? pack(items[i].value, buffers[i], packed) : items[i].value;
+        compressed[i] = packed;
+    }
+
+    const auto now = this->now();
+    for_each_shard(hashes, [&](Shard& shard, const std::vector<size_t>& positions) {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        for (size_t i : positions) {
+            const CacheItem& item = items[i];
+            put_locked(shard, item.key, stored[i], compressed[i], hashes[i], expiry_for(item.ttl_ms, now), now);
+        }
+    });
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::multi_erase(const std::vector<std::string_view>& keys){
+    std::vector<size_t> hashes(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        hashes[i] = hash_key(keys[i]);
+    }
+
+    size_t removed = 0;
+    for_each_shard(hashes, [&](Shard& shard, const std::vector<size_t>& positions) {
+        std::unique_lock<SharedMutex> lock(shard.mutex);
+        for (size_t i : positions) {
+            shard.overtake_loads(hashes[i]);
+            if (Entry* entry = shard.find(keys[i], hashes[i])) {
+                shard.destroy(entry);
+                removed++;
+            }
+        }
+    });
+    return removed;
 }
 
-// PRECONDITION: caller holds mutex_ with a unique_lock
-void Cache::touch_to_front(std::unordered_map<std::string, Entry>::iterator it){
-    // Move the key to the front of the LRU list
-    lru_list_.erase(it->second.lru_it);
-    lru_list_.push_front(it->first);
-    it->second.lru_it = lru_list_.begin(); 
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<SharedMutex> lock(shard->mutex);
+        total += shard->count;
+    }
+    return total;
 }
 
 // This method does not check for the TTL, just does raw check if it is present in cache
-bool Cache::contains(const std::string& key) const{
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return map_.find(key) != map_.end();
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::contains(std::string_view key) const{
+    const size_t hash = hash_key(key);
+    const Shard& shard = shard_for(hash);
+    std::shared_lock<SharedMutex> lock(shard.mutex);
+    return shard.find(key, hash) != nullptr;
 }
 
 // This method does not check for the TTL.
-std::vector<std::string> Cache::keys() const{
-    std::shared_lock<std::shared_mutex> lock(mutex_);
+template <typename Policy, typename SharedMutex>
+std::vector<std::string> BasicCache<Policy, SharedMutex>::keys() const{
     std::vector<std::string> result;
-    result.reserve(map_.size());
-    for(const auto& k : lru_list_){
-        result.push_back(k);
+    for (const auto& shard : shards_) {
+        std::shared_lock<SharedMutex> lock(shard->mutex);
+        result.reserve(result.size() + shard->count);
+        if constexpr (!kBuiltinLru) {
+            // Reverse eviction order, the policy's counterpart of MRU -> LRU
+            const size_t begin = result.size();
+            shard->policy.for_each([&result](const Entry* e) { result.emplace_back(e->key()); });
+            std::reverse(result.begin() + static_cast<std::ptrdiff_t>(begin), result.end());
+            continue;
+        }
+        for (const LruList* list : {&shard->window, &shard->protected_segment, &shard->main}) {
+            for(const Entry* e = list->head; e != nullptr; e = e->lru_next){
+                result.emplace_back(e->key());
+            }
+        }
     }
     return result;
 }
 
-void Cache::clear() {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    map_.clear();
-    lru_list_.clear();
+template <typename Policy, typename SharedMutex>
+std::vector<CacheRecord> BasicCache<Policy, SharedMutex>::export_shard(size_t index) const {
+    const Shard& shard = *shards_.at(index);
+    const auto now = this->now();
+    std::vector<CacheRecord> records;
+
+    std::shared_lock<SharedMutex> lock(shard.mutex);
+    records.reserve(shard.count);
+    auto add = [&records, now](const Entry* e) { add_record(records, e, now); };
+    if constexpr (kBuiltinLru) {
+        // Least valuable region first: probation (or the LRU list), protected, window
+        for (const LruList* list : {&shard.main, &shard.protected_segment, &shard.window}) {
+            for (const Entry* e = list->tail; e != nullptr; e = e->lru_prev) {
+                add(e);
+            }
+        }
+    } else {
+        shard.policy.for_each(add);   // Next victims first
+    }
+    lock.unlock();
+
+    unpack_records(records);
+    return records;
+}
+
+template <typename Policy, typename SharedMutex>
+std::vector<CacheRecord> BasicCache<Policy, SharedMutex>::export_slice(ExportCursor& cursor, size_t slots) const {
+    std::vector<CacheRecord> records;
+    if (cursor.shard >= shards_.size()) {
+        cursor.done = true;
+        return records;
+    }
+    const Shard& shard = *shards_[cursor.shard];
+    const auto now = this->now();
+
+    std::shared_lock<SharedMutex> lock(shard.mutex);
+    auto add = [&records, now](const Entry* e) { add_record(records, e, now); };
+    const size_t next = shard.lock_free_index
+        ? shard.lock_free_index->scan(cursor.scan, std::max<size_t>(slots, 1), add)
+        : shard.index.scan(cursor.scan, std::max<size_t>(slots / shard.index.kGroupSize, 1), add);
+    lock.unlock();
+
+    if (next == 0) {
+        ++cursor.shard;
+    }
+    cursor.scan = next;
+    cursor.done = cursor.shard >= shards_.size();
+
+    unpack_records(records);
+    return records;
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::add_record(std::vector<CacheRecord>& records, const Entry* entry, clock::time_point now) {
+    if (is_expired(entry, now)) {
+        return;
+    }
+    records.push_back({std::string(entry->key()), entry->value, remaining_ttl_ms(entry->expiry, now)});
+}
+
+// Persisted and exported formats hold plain values
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::unpack_records(std::vector<CacheRecord>& records) const {
+    for (CacheRecord& record : records) {
+        if (record.value.compressed()) {
+            std::optional<ValueRef> value(std::move(record.value));
+            unpack(value);
+            record.value = std::move(*value);
+        }
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::clear() {
+    for (auto& shard : shards_) {
+        std::unique_lock<SharedMutex> lock(shard->mutex);
+        shard->clear();
+    }
 }
 
-size_t Cache::capacity() const {
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::capacity() const {
     return capacity_;
 }
 
-uint64_t Cache::eviction_interval() const {
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::capacity_bytes() const {
+    return capacity_bytes_;
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::memory_used() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<SharedMutex> lock(shard->mutex);
+        total += shard->bytes_used;
+    }
+    return total;
+}
+
+template <typename Policy, typename SharedMutex>
+std::vector<SlabAllocator::ClassStats> BasicCache<Policy, SharedMutex>::slab_stats() const {
+    std::vector<SlabAllocator::ClassStats> total;
+    for (const auto& shard : shards_) {
+        std::shared_lock<SharedMutex> lock(shard->mutex);
+        auto stats = shard->values->stats();
+        if (total.empty()) {
+            total = std::move(stats);
+            continue;
+        }
+        // Every shard's allocator uses the same class layout
+        for (size_t i = 0; i < stats.size(); ++i) {
+            total[i].chunks_used += stats[i].chunks_used;
+            total[i].bytes_used += stats[i].bytes_used;
+            total[i].pages += stats[i].pages;
+        }
+    }
+    return total;
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::eviction_interval() const {
     return eviction_interval_ms_;
 }
 
-size_t Cache::hits() const {
-    return hits_.load();
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::shard_count() const {
+    return shards_.size();
+}
+
+template <typename Policy, typename SharedMutex>
+EvictionPolicy BasicCache<Policy, SharedMutex>::eviction_policy() const {
+    return eviction_policy_;
 }
 
-size_t Cache::misses() const {
-    return misses_.load();
+template <typename Policy, typename SharedMutex>
+AdmissionPolicy BasicCache<Policy, SharedMutex>::admission_policy() const {
+    return admission_policy_;
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::hits() const {
+    return hits_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::misses() const {
+    return misses_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::admission_rejections() const {
+    return rejections_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::evictions() const {
+    return evictions_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::expirations() const {
+    return expirations_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+bool BasicCache<Policy, SharedMutex>::lock_free_reads() const {
+    return lock_free_reads_;
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::compress_threshold() const {
+    return compress_threshold_;
+}
+
+template <typename Policy, typename SharedMutex>
+std::vector<HotKeyTracker::HotKey> BasicCache<Policy, SharedMutex>::hot_keys() const {
+    return hot_keys_ ? hot_keys_->hot_keys() : std::vector<HotKeyTracker::HotKey>{};
+}
+
+template <typename Policy, typename SharedMutex>
+size_t BasicCache<Policy, SharedMutex>::hot_key_capacity() const {
+    return hot_keys_ ? hot_keys_->capacity() : 0;
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::near_cache_hits() const {
+    return hot_keys_ ? hot_keys_->near_hits() : 0;
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::near_cache_lookups() const {
+    return hot_keys_ ? hot_keys_->near_lookups() : 0;
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::loads() const {
+    return loads_started_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::coalesced_loads() const {
+    return coalesced_loads_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+uint64_t BasicCache<Policy, SharedMutex>::early_refreshes() const {
+    return early_refreshes_.value();
+}
+
+template <typename Policy, typename SharedMutex>
+CompressionStats BasicCache<Policy, SharedMutex>::compression_stats() const {
+    CompressionStats stats;
+    stats.compressed = compressed_values_.value();
+    stats.incompressible = incompressible_values_.value();
+    stats.raw_bytes = compress_raw_bytes_.value();
+    stats.stored_bytes = compress_stored_bytes_.value();
+    stats.compress_ns = compress_ns_.value();
+    stats.decompressions = decompressions_.value();
+    stats.decompress_ns = decompress_ns_.value();
+    return stats;
 }
 
 // Async eviction
-void Cache::eviction_loop(uint64_t interval_ms){
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::eviction_loop(){
     while(!stop_eviction_.load()){
-        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        std::this_thread::sleep_for(std::chrono::milliseconds(kClockResolutionMs));
+        maintain();
+    }
+}
 
-        auto now = clock::now();
-        std::unique_lock<std::shared_mutex> lock(mutex_);
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::maintain(){
+    auto now = clock::now();
+    coarse_now_.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+    if (now < next_sweep_) {
+        return;
+    }
+    next_sweep_ = now + std::chrono::milliseconds(eviction_interval_ms_);
 
-        for(auto it = map_.begin(); it!=map_.end();){
-            if (it->second.expiry != clock::time_point::max() && it->second.expiry < now) {
-                lru_list_.erase(it->second.lru_it);
-                it = map_.erase(it); // erase returns next iterator
-            } else {
-                ++it;
-            }
+    // Lock one shard at a time so foreground requests on the other
+    // shards keep running while a shard is being swept.
+    for (auto& shard : shards_) {
+        expire_shard(*shard, now);
+    }
+    if (lock_free_reads_) {
+        EpochDomain::global().collect();   // Free what writers retired, once readers moved on
+    }
+}
+
+template <typename Policy, typename SharedMutex>
+void BasicCache<Policy, SharedMutex>::expire_shard(Shard& shard, clock::time_point now){
+    std::unique_lock<SharedMutex> lock(shard.mutex);
+
+    // Only the wheel slots whose tick has passed are visited
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch_).count();
+    shard.expiry_wheel.advance(static_cast<uint64_t>(elapsed_ms) / eviction_interval_ms_);
+
+    size_t budget = kMaxExpiredPerLock;
+    while (Entry* e = shard.expiry_wheel.pop_due()) {
+        if (is_expired(e, now)) {
+            shard.destroy(e);
+            expirations_.inc();
+        } else {
+            // Due by tick but not strictly past expiry yet: retry on the next tick
+            shard.expiry_wheel.schedule(e, shard.expiry_wheel.current_tick() + 1);
+        }
+
+        if (--budget == 0 && shard.expiry_wheel.has_due()) {
+            // Let foreground requests in before continuing with the burst
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            budget = kMaxExpiredPerLock;
         }
     }
-}
\ No newline at end of file
+}
+
+template class BasicCache<LruPolicy>;
+template class BasicCache<LfuPolicy>;
+template class BasicCache<FifoPolicy>;
+template class BasicCache<ArcPolicy>;
+template class BasicCache<S3FifoPolicy>;
+template class BasicCache<LruPolicy, NoLock>;
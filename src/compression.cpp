@@ -0,0 +1,41 @@
+#include "compression.h"
+#include "binary_io.h"
+#include <lz4.h>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kSizePrefix = 4;
+}
+
+bool compress_value(std::string_view raw, std::string& out) {
+    if (raw.size() > LZ4_MAX_INPUT_SIZE) {
+        return false;
+    }
+    const int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+    out.resize(kSizePrefix + static_cast<size_t>(bound));
+    put_le<uint32_t>(&out[0], static_cast<uint32_t>(raw.size()));
+
+    const int written = LZ4_compress_default(raw.data(), &out[kSizePrefix], static_cast<int>(raw.size()), bound);
+    // Not worth a decompression on every read below a 1/8 saving
+    if (written <= 0 || kSizePrefix + static_cast<size_t>(written) > raw.size() - raw.size() / 8) {
+        return false;
+    }
+    out.resize(kSizePrefix + static_cast<size_t>(written));
+    return true;
+}
+
+size_t decompressed_size(std::string_view packed) {
+    return packed.size() < kSizePrefix ? 0 : get_le<uint32_t>(packed.data());
+}
+
+void decompress_value(std::string_view packed, char* out) {
+    if (packed.size() < kSizePrefix) {
+        throw std::runtime_error("compression: corrupt value block");
+    }
+    const size_t size = decompressed_size(packed);
+    const int restored = LZ4_decompress_safe(packed.data() + kSizePrefix, out,
+                                             static_cast<int>(packed.size() - kSizePrefix), static_cast<int>(size));
+    if (restored < 0 || static_cast<size_t>(restored) != size) {
+        throw std::runtime_error("compression: corrupt value block");
+    }
+}
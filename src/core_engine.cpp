@@ -0,0 +1,355 @@
+#include "core_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr size_t kQueueSlots = 1024;   // Requests in flight per core before producers wait
+constexpr int kSpinRounds = 64;        // Empty polls (worker) or checks (caller) before blocking
+
+CacheOptions core_options(CacheOptions options, size_t cores) {
+    options.capacity = std::max<size_t>(options.capacity / cores, 1);
+    if (options.capacity_bytes != 0) {
+        options.capacity_bytes = std::max<size_t>(options.capacity_bytes / cores, 1);
+    }
+    options.shard_count = 1;
+    options.hot_keys = 0;   // Only the owning worker reads a core's cache: nothing to mirror
+    options.background_expiry = false;   // The worker keeps the clock and sweeps, see worker_loop()
+    return options;
+}
+
+// Sleep while word == expected; may return early, callers re-check
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit int");
+    (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)expected;
+    std::this_thread::yield();
+#endif
+}
+
+void futex_wake_one(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+void pin_to_cpu(std::thread& thread, size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(cpu % CPU_SETSIZE), &set);
+    // Best effort: a restricted cpuset just leaves the worker unpinned
+    (void)pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+} // namespace
+
+//-------------------Request-------------------
+
+void CoreEngine::Request::complete() {
+    // The caller may return, and its stack reuse the word, as soon as it sees kDone;
+    // a late wake on that address is at worst a spurious one, which waiters re-check
+    if (ready.exchange(kDone, std::memory_order_acq_rel) == kSleeping) {
+        futex_wake_one(ready);
+    }
+}
+
+void CoreEngine::Request::wait() {
+    for (int i = 0; i < kSpinRounds; ++i) {
+        if (ready.load(std::memory_order_acquire) == kDone) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // Announce the sleep so that complete() knows to wake us; fails only if it already ran
+    uint32_t state = kPending;
+    if (!ready.compare_exchange_strong(state, kSleeping, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return;
+    }
+    while (ready.load(std::memory_order_acquire) != kDone) {
+        futex_wait(ready, kSleeping);
+    }
+}
+
+//-------------------Engine-------------------
+
+CoreEngine::Core::Core(const CacheOptions& options)
+    : cache(std::make_unique<CoreCache>(options)), queue(kQueueSlots) {}
+
+CoreEngine::CoreEngine(const CacheOptions& options, size_t cores, bool pin) {
+    if (cores == 0) {
+        cores = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    const CacheOptions per_core = core_options(options, cores);
+    cores_.reserve(cores);
+    for (size_t i = 0; i < cores; ++i) {
+        cores_.push_back(std::make_unique<Core>(per_core));
+    }
+    for (size_t i = 0; i < cores; ++i) {
+        Core& core = *cores_[i];
+        core.worker = std::thread([this, &core] { worker_loop(core); });
+        if (pin) {
+            pin_to_cpu(core.worker, i % cpus);
+        }
+    }
+}
+
+CoreEngine::~CoreEngine() {
+    stop_.store(true, std::memory_order_release);
+    for (auto& core : cores_) {
+        {
+            std::lock_guard<std::mutex> lock(core->park_mutex);
+            core->park_cv.notify_one();
+        }
+        if (core->worker.joinable()) {
+            core->worker.join();
+        }
+    }
+}
+
+void CoreEngine::worker_loop(Core& core) {
+    CoreCache& cache = *core.cache;
+    const auto sweep_interval = std::chrono::milliseconds(cache.eviction_interval());
+    Request* request = nullptr;
+    int idle = 0;
+    for (;;) {
+        if (core.queue.try_pop(request)) {
+            cache.maintain();   // Current clock for the request, and the sweep when it is due
+            request->run(cache, request->context);
+            request->complete();
+            idle = 0;
+            continue;
+        }
+        if (stop_.load(std::memory_order_acquire)) {
+            return;   // Queue drained; callers are gone by the time the engine is destroyed
+        }
+        if (++idle < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Park. The flag store and the producer's push are both followed by a
+        // full fence, so either the producer sees us asleep or we see its request.
+        // Wake once per eviction interval anyway, to sweep expired entries.
+        cache.maintain();
+        std::unique_lock<std::mutex> lock(core.park_mutex);
+        core.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        core.park_cv.wait_for(lock, sweep_interval, [&] {
+            return !core.queue.empty() || stop_.load(std::memory_order_acquire);
+        });
+        core.sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void CoreEngine::submit(Core& core, Request& request) const {
+    while (!core.queue.try_push(&request)) {
+        std::this_thread::yield();   // Owner is saturated; wait for a slot
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (core.sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(core.park_mutex);
+        core.park_cv.notify_one();
+    }
+}
+
+template <typename F>
+void CoreEngine::execute(size_t core, F&& fn) const {
+    using Fn = std::remove_reference_t<F>;
+    Request request;
+    request.context = &fn;
+    request.run = [](CoreCache& cache, void* context) { (*static_cast<Fn*>(context))(cache); };
+    submit(*cores_[core], request);
+    request.wait();
+}
+
+template <typename Wanted, typename F>
+void CoreEngine::fan_out(Wanted&& wanted, F&& fn) const {
+    using Fn = std::remove_reference_t<F>;
+    struct Task {
+        Fn* fn;
+        size_t core;
+    };
+    std::vector<Task> tasks(cores_.size(), Task{&fn, 0});
+    std::vector<Request> requests(cores_.size());
+    for (size_t c = 0; c < cores_.size(); ++c) {
+        if (!wanted(c)) continue;
+        tasks[c].core = c;
+        requests[c].context = &tasks[c];
+        requests[c].run = [](CoreCache& cache, void* context) {
+            auto* task = static_cast<Task*>(context);
+            (*task->fn)(task->core, cache);
+        };
+        submit(*cores_[c], requests[c]);
+    }
+    for (size_t c = 0; c < cores_.size(); ++c) {
+        if (wanted(c)) {
+            requests[c].wait();
+        }
+    }
+}
+
+size_t CoreEngine::core_index(size_t hash) const {
+    // Fibonacci mix and high bits: the private caches index on the low bits
+    // of the same hash, which are all alike within one core otherwise
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 32) % cores_.size();
+}
+
+size_t CoreEngine::core_of(std::string_view key) const {
+    return core_index(std::hash<std::string_view>{}(key));
+}
+
+std::vector<std::vector<size_t>> CoreEngine::group_by_core(const std::vector<std::string_view>& keys) const {
+    std::vector<std::vector<size_t>> groups(cores_.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        groups[core_of(keys[i])].push_back(i);
+    }
+    return groups;
+}
+
+void CoreEngine::put(std::string_view key, std::string_view value, uint64_t ttl_ms) {
+    execute(core_of(key), [&](CoreCache& cache) { cache.put(key, value, ttl_ms); });
+}
+
+std::optional<std::string> CoreEngine::get(std::string_view key) {
+    std::optional<std::string> result;
+    execute(core_of(key), [&](CoreCache& cache) { result = cache.get(key); });
+    return result;
+}
+
+std::optional<ValueRef> CoreEngine::get_ref(std::string_view key) {
+    std::optional<ValueRef> result;
+    execute(core_of(key), [&](CoreCache& cache) { result = cache.get_ref(key); });
+    return result;
+}
+
+bool CoreEngine::erase(std::string_view key) {
+    bool erased = false;
+    execute(core_of(key), [&](CoreCache& cache) { erased = cache.erase(key); });
+    return erased;
+}
+
+std::vector<std::optional<ValueRef>> CoreEngine::multi_get_ref(const std::vector<std::string_view>& keys) {
+    std::vector<std::optional<ValueRef>> results(keys.size());
+    const auto groups = group_by_core(keys);
+    fan_out([&groups](size_t core) { return !groups[core].empty(); }, [&](size_t core, CoreCache& cache) {
+        std::vector<std::string_view> owned;
+        owned.reserve(groups[core].size());
+        for (size_t i : groups[core]) owned.push_back(keys[i]);
+        auto values = cache.multi_get_ref(owned);
+        for (size_t j = 0; j < values.size(); ++j) {
+            results[groups[core][j]] = std::move(values[j]);
+        }
+    });
+    return results;
+}
+
+void CoreEngine::multi_put(const std::vector<CacheItem>& items) {
+    std::vector<std::vector<size_t>> groups(cores_.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        groups[core_of(items[i].key)].push_back(i);
+    }
+    fan_out([&groups](size_t core) { return !groups[core].empty(); }, [&](size_t core, CoreCache& cache) {
+        std::vector<CacheItem> owned;
+        owned.reserve(groups[core].size());
+        for (size_t i : groups[core]) owned.push_back(items[i]);
+        cache.multi_put(owned);
+    });
+}
+
+size_t CoreEngine::multi_erase(const std::vector<std::string_view>& keys) {
+    std::vector<size_t> erased(cores_.size(), 0);
+    const auto groups = group_by_core(keys);
+    fan_out([&groups](size_t core) { return !groups[core].empty(); }, [&](size_t core, CoreCache& cache) {
+        std::vector<std::string_view> owned;
+        owned.reserve(groups[core].size());
+        for (size_t i : groups[core]) owned.push_back(keys[i]);
+        erased[core] = cache.multi_erase(owned);
+    });
+    size_t total = 0;
+    for (size_t count : erased) total += count;
+    return total;
+}
+
+//-------------------Stats (summed over cores)-------------------
+
+template <typename F>
+size_t CoreEngine::sum(F&& f) const {
+    size_t total = 0;
+    for (const auto& core : cores_) {
+        total += f(*core->cache);
+    }
+    return total;
+}
+
+template <typename F>
+size_t CoreEngine::sum_on_cores(F&& f) const {
+    std::vector<size_t> parts(cores_.size(), 0);
+    fan_out([](size_t) { return true; }, [&](size_t core, CoreCache& cache) { parts[core] = f(cache); });
+    size_t total = 0;
+    for (size_t part : parts) total += part;
+    return total;
+}
+
+size_t CoreEngine::core_count() const { return cores_.size(); }
+size_t CoreEngine::size() const { return sum_on_cores([](const CoreCache& c) { return c.size(); }); }
+size_t CoreEngine::capacity() const { return sum([](const CoreCache& c) { return c.capacity(); }); }
+size_t CoreEngine::capacity_bytes() const { return sum([](const CoreCache& c) { return c.capacity_bytes(); }); }
+size_t CoreEngine::memory_used() const { return sum_on_cores([](const CoreCache& c) { return c.memory_used(); }); }
+uint64_t CoreEngine::eviction_interval() const { return cores_.front()->cache->eviction_interval(); }
+size_t CoreEngine::hits() const { return sum([](const CoreCache& c) { return c.hits(); }); }
+size_t CoreEngine::misses() const { return sum([](const CoreCache& c) { return c.misses(); }); }
+size_t CoreEngine::admission_rejections() const { return sum([](const CoreCache& c) { return c.admission_rejections(); }); }
+size_t CoreEngine::evictions() const { return sum([](const CoreCache& c) { return c.evictions(); }); }
+size_t CoreEngine::expirations() const { return sum([](const CoreCache& c) { return c.expirations(); }); }
+
+CompressionStats CoreEngine::compression_stats() const {
+    CompressionStats total;
+    for (const auto& core : cores_) {
+        const CompressionStats stats = core->cache->compression_stats();
+        total.compressed += stats.compressed;
+        total.incompressible += stats.incompressible;
+        total.raw_bytes += stats.raw_bytes;
+        total.stored_bytes += stats.stored_bytes;
+        total.compress_ns += stats.compress_ns;
+        total.decompressions += stats.decompressions;
+        total.decompress_ns += stats.decompress_ns;
+    }
+    return total;
+}
+
+std::vector<SlabAllocator::ClassStats> CoreEngine::slab_stats() const {
+    std::vector<std::vector<SlabAllocator::ClassStats>> per_core(cores_.size());
+    fan_out([](size_t) { return true; }, [&](size_t core, CoreCache& cache) { per_core[core] = cache.slab_stats(); });
+    std::vector<SlabAllocator::ClassStats> total;
+    for (auto& stats : per_core) {
+        if (total.empty()) {
+            total = std::move(stats);
+            continue;
+        }
+        for (size_t i = 0; i < stats.size() && i < total.size(); ++i) {   // Same classes in every cache
+            total[i].chunks_used += stats[i].chunks_used;
+            total[i].bytes_used += stats[i].bytes_used;
+            total[i].pages += stats[i].pages;
+        }
+    }
+    return total;
+}
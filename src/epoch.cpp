@@ -0,0 +1,127 @@
+#include "epoch.h"
+
+namespace {
+constexpr size_t kCollectEvery = 256;   // Retires between automatic collections
+}
+
+EpochDomain::Guard::~Guard() {
+    if (participant_ != nullptr) {
+        unpin(participant_);
+    }
+}
+
+EpochDomain& EpochDomain::global() {
+    // Never destroyed: threads may still unpin or retire during static destruction
+    static EpochDomain* domain = new EpochDomain();
+    return *domain;
+}
+
+EpochDomain::Participant* EpochDomain::participant() {
+    struct Slot {
+        Participant* participant = nullptr;
+        ~Slot() {
+            if (participant != nullptr) {
+                participant->epoch.store(0, std::memory_order_release);
+                participant->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Slot slot;
+    if (slot.participant != nullptr) {
+        return slot.participant;
+    }
+
+    // Reuse the slot of a thread that has exited
+    for (Participant* p = participants_.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+        bool owned = false;
+        if (!p->owned.load(std::memory_order_relaxed) &&
+            p->owned.compare_exchange_strong(owned, true, std::memory_order_acq_rel)) {
+            p->depth = 0;
+            slot.participant = p;
+            return p;
+        }
+    }
+
+    auto* p = new Participant();
+    Participant* head = participants_.load(std::memory_order_relaxed);
+    do {
+        p->next = head;
+    } while (!participants_.compare_exchange_weak(head, p, std::memory_order_release, std::memory_order_relaxed));
+    slot.participant = p;
+    return p;
+}
+
+EpochDomain::Guard EpochDomain::pin() {
+    Participant* p = participant();
+    if (p->depth++ == 0) {
+        p->epoch.store(epoch_.load(std::memory_order_relaxed), std::memory_order_release);
+        // Publish the pin before any pointer is read; pairs with the fence in try_advance()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return Guard(p);
+}
+
+void EpochDomain::unpin(Participant* participant) {
+    if (--participant->depth == 0) {
+        participant->epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochDomain::retire(void* object, void (*deleter)(void*)) {
+    // The unlink that preceded this call is ordered before the epoch read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    bool due;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back({epoch, object, deleter});
+        due = retired_.size() % kCollectEvery == 0;
+    }
+    if (due) {
+        collect();
+    }
+}
+
+void EpochDomain::try_advance() {
+    uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (Participant* p = participants_.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+        // Acquire: whatever the thread read before it unpinned or re-pinned happens before a free
+        const uint64_t pinned = p->epoch.load(std::memory_order_acquire);
+        if (pinned != 0 && pinned != epoch) {
+            return;   // Still reading in an older epoch
+        }
+    }
+    epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_release, std::memory_order_relaxed);
+}
+
+size_t EpochDomain::collect() {
+    // Two steps are what an object retired now needs, if no reader is in the way
+    try_advance();
+    try_advance();
+    const uint64_t safe = epoch_.load(std::memory_order_acquire);
+
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        size_t kept = 0;
+        for (Retired& r : retired_) {
+            if (r.epoch + 2 <= safe) {
+                ready.push_back(r);
+            } else {
+                retired_[kept++] = r;
+            }
+        }
+        retired_.resize(kept);
+    }
+    // Deleters run unlocked: they may take other locks (e.g. a value arena's)
+    for (const Retired& r : ready) {
+        r.deleter(r.object);
+    }
+    return ready.size();
+}
+
+size_t EpochDomain::pending() const {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    return retired_.size();
+}
@@ -0,0 +1,72 @@
+#include "frequency_sketch.h"
+#include <algorithm>
+
+namespace {
+constexpr size_t kCountersPerWord = 16;
+constexpr size_t kMinWidth = kCountersPerWord;
+constexpr size_t kMaxWidth = size_t{1} << 26;
+
+// One odd multiplier per row so the rows hash independently
+constexpr uint64_t kRowSeeds[FrequencySketch::kDepth] = {
+    0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull, 0x9ae16a3b2f90404full, 0xcbf29ce484222325ull
+};
+}
+
+FrequencySketch::FrequencySketch(size_t expected_items) {
+    size_t width = kMinWidth;
+    while (width < expected_items && width < kMaxWidth) {
+        width <<= 1;
+    }
+    width_ = width;
+    sample_size_ = kSampleFactor * width;
+    table_.assign(kDepth * width / kCountersPerWord, 0);
+}
+
+size_t FrequencySketch::counter_index(size_t hash, unsigned row) const {
+    uint64_t h = (static_cast<uint64_t>(hash) + kRowSeeds[row]) * kRowSeeds[row];
+    h ^= h >> 32;
+    return row * width_ + static_cast<size_t>(h & (width_ - 1));
+}
+
+unsigned FrequencySketch::counter(size_t index) const {
+    return static_cast<unsigned>((table_[index / kCountersPerWord] >> ((index % kCountersPerWord) * 4)) & 0xF);
+}
+
+void FrequencySketch::increment(size_t hash) {
+    size_t index[kDepth];
+    unsigned min = kMaxCount;
+    for (unsigned row = 0; row < kDepth; ++row) {
+        index[row] = counter_index(hash, row);
+        min = std::min(min, counter(index[row]));
+    }
+    if (min == kMaxCount) {
+        return;   // Saturated
+    }
+
+    // Conservative update: only the counters that define the estimate grow
+    for (unsigned row = 0; row < kDepth; ++row) {
+        if (counter(index[row]) == min) {
+            table_[index[row] / kCountersPerWord] += uint64_t{1} << ((index[row] % kCountersPerWord) * 4);
+        }
+    }
+
+    if (++additions_ >= sample_size_) {
+        age();
+    }
+}
+
+unsigned FrequencySketch::frequency(size_t hash) const {
+    unsigned min = kMaxCount;
+    for (unsigned row = 0; row < kDepth; ++row) {
+        min = std::min(min, counter(counter_index(hash, row)));
+    }
+    return min;
+}
+
+void FrequencySketch::age() {
+    // Shift every nibble right by one; the mask drops the bit shifted in from the neighbour
+    for (uint64_t& word : table_) {
+        word = (word >> 1) & 0x7777777777777777ull;
+    }
+    additions_ /= 2;
+}
@@ -0,0 +1,204 @@
+#include "hot_keys.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t kCandidatesPerHotKey = 4;   // Space-Saving counters kept per hot key
+constexpr size_t kMinCandidates = 16;
+constexpr uint32_t kMinSharePercent = 1;     // Share of a window's samples that makes a key hot
+constexpr size_t kNearCachesPerThread = 8;   // Trackers a thread keeps near caches for
+
+std::atomic<uint64_t> next_tracker_id{1};
+
+struct NearEntry {
+    std::string key;
+    size_t hash = 0;
+    uint64_t version = 0;
+    HotKeyTracker::clock::time_point expiry;
+    ValueRef value;   ///< Private heap block, only this thread holds it
+};
+
+struct NearCache {
+    uint64_t owner = 0;       ///< Tracker id
+    uint64_t generation = 0;  ///< Hot-set generation the entries belong to
+    std::vector<NearEntry> entries;
+    size_t next_victim = 0;
+};
+
+// The calling thread's near cache for a tracker. Ids are never reused, so
+// the cache of a destroyed tracker just ages out of the list.
+NearCache& near_cache(uint64_t owner) {
+    thread_local std::vector<NearCache> caches;
+    for (auto& cache : caches) {
+        if (cache.owner == owner) return cache;
+    }
+    if (caches.size() == kNearCachesPerThread) {
+        caches.erase(caches.begin());
+    }
+    caches.push_back(NearCache{owner, 0, {}, 0});
+    return caches.back();
+}
+} // namespace
+
+HotKeyTracker::HotKeyTracker(size_t capacity, uint32_t sample_every, uint32_t window_samples)
+    : capacity_(std::max<size_t>(capacity, 1)), sample_every_(std::max<uint32_t>(sample_every, 1)),
+      window_samples_(std::max<uint32_t>(window_samples, 1)), id_(next_tracker_id.fetch_add(1)) {
+    candidates_.reserve(std::max(kMinCandidates, capacity_ * kCandidatesPerHotKey));
+}
+
+bool HotKeyTracker::sample(std::string_view key, size_t hash) {
+    thread_local uint32_t reads = 0;
+    if (++reads % sample_every_ != 0) {
+        return false;
+    }
+    record(key, hash);
+    return true;
+}
+
+void HotKeyTracker::record(std::string_view key, size_t hash) {
+    // A sample lost to contention is just one sample less
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    auto it = std::find_if(candidates_.begin(), candidates_.end(),
+                           [&](const Candidate& c) { return c.hash == hash && c.key == key; });
+    if (it != candidates_.end()) {
+        ++it->count;
+    } else if (candidates_.size() < candidates_.capacity()) {
+        candidates_.push_back({std::string(key), hash, 1, 0});
+    } else {
+        // Space-Saving: the newcomer inherits the smallest count, an upper bound of what it missed
+        auto min = std::min_element(candidates_.begin(), candidates_.end(),
+                                    [](const Candidate& a, const Candidate& b) { return a.count < b.count; });
+        min->key.assign(key.data(), key.size());
+        min->hash = hash;
+        min->error = min->count;
+        ++min->count;
+    }
+
+    if (++window_count_ >= window_samples_) {
+        refresh();
+    }
+}
+
+void HotKeyTracker::refresh() {
+    // By guaranteed count: a key that inherited its count is not hot on that alone
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Candidate& a, const Candidate& b) { return a.count - a.error > b.count - b.error; });
+
+    const uint64_t min_count = std::max<uint64_t>(2, uint64_t{window_samples_} * kMinSharePercent / 100);
+    std::vector<HotKey> hot;
+    uint64_t bits[kSlots / 64] = {};
+    for (const auto& c : candidates_) {
+        if (hot.size() == capacity_ || c.count - c.error < min_count) break;
+        hot.push_back({c.key, c.count - c.error});
+        bits[slot_of(c.hash) / 64] |= uint64_t{1} << (slot_of(c.hash) % 64);
+    }
+
+    const bool changed = hot.size() != hot_.size() ||
+        !std::all_of(hot.begin(), hot.end(), [this](const HotKey& h) {
+            return std::any_of(hot_.begin(), hot_.end(), [&h](const HotKey& old) { return old.key == h.key; });
+        });
+    if (changed) {
+        // Slots first, generation second: a fill that reads the new
+        // generation also sees its key's slot cleared and is skipped, and
+        // one that read the old generation is emptied with it. The other way
+        // round, a fill could take the new generation while the slot still
+        // looked hot, and the copy would outlive writes that no longer bump
+        // the slot's version.
+        for (size_t w = 0; w < kSlots / 64; ++w) {
+            hot_bits_[w].store(bits[w], std::memory_order_release);
+        }
+        generation_.fetch_add(1, std::memory_order_acq_rel);
+    }
+    hot_ = std::move(hot);
+
+    // Age: halve every count, forget what decayed to nothing
+    for (auto& c : candidates_) {
+        c.count /= 2;
+        c.error /= 2;
+    }
+    candidates_.erase(std::remove_if(candidates_.begin(), candidates_.end(),
+                                     [](const Candidate& c) { return c.count == 0; }),
+                      candidates_.end());
+    window_count_ = 0;
+}
+
+bool HotKeyTracker::is_hot(size_t hash) const {
+    const size_t slot = slot_of(hash);
+    return (hot_bits_[slot / 64].load(std::memory_order_acquire) >> (slot % 64)) & 1;
+}
+
+std::optional<ValueRef> HotKeyTracker::near_get(std::string_view key, size_t hash, clock::time_point now) {
+    near_lookups_.inc();
+    NearCache& near = near_cache(id_);
+    const uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (near.generation != generation) {
+        near.entries.clear();
+        near.generation = generation;
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i < near.entries.size(); ++i) {
+        NearEntry& entry = near.entries[i];
+        if (entry.hash != hash || entry.key != key) continue;
+        const bool expired = entry.expiry != clock::time_point::max() && entry.expiry < now;
+        if (expired || entry.version != versions_[slot_of(hash)].load(std::memory_order_acquire)) {
+            near.entries[i] = std::move(near.entries.back());
+            near.entries.pop_back();
+            return std::nullopt;
+        }
+        near_hits_.inc();
+        return entry.value;
+    }
+    return std::nullopt;
+}
+
+std::optional<HotKeyTracker::Ticket> HotKeyTracker::begin_fill(size_t hash) const {
+    Ticket ticket;
+    ticket.generation = generation_.load(std::memory_order_acquire);
+    ticket.version = versions_[slot_of(hash)].load(std::memory_order_acquire);
+    // After the generation: the key may have left the hot set since the read decided to fill
+    if (!is_hot(hash)) {
+        return std::nullopt;
+    }
+    return ticket;
+}
+
+void HotKeyTracker::near_put(std::string_view key, size_t hash, const Ticket& ticket, std::string_view value,
+                             clock::time_point expiry, uint32_t flags) {
+    NearCache& near = near_cache(id_);
+    if (ticket.generation != near.generation) {
+        if (ticket.generation < near.generation) {
+            return;   // Read under an older hot set
+        }
+        near.entries.clear();
+        near.generation = ticket.generation;
+    }
+
+    NearEntry entry{std::string(key), hash, ticket.version, expiry,
+                    ValueRef::make(value.size(), [value](char* out) { std::memcpy(out, value.data(), value.size()); },
+                                   flags)};
+    for (auto& existing : near.entries) {
+        if (existing.hash == hash && existing.key == key) {
+            existing = std::move(entry);
+            return;
+        }
+    }
+    if (near.entries.size() < capacity_) {
+        near.entries.push_back(std::move(entry));
+    } else {
+        near.entries[near.next_victim++ % capacity_] = std::move(entry);
+    }
+}
+
+void HotKeyTracker::invalidate_all() {
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+std::vector<HotKeyTracker::HotKey> HotKeyTracker::hot_keys() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hot_;
+}
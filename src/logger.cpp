@@ -0,0 +1,176 @@
+#include "logger.h"
+#include "time_utils.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr auto kDrainInterval = std::chrono::milliseconds(20);
+
+std::atomic<uint64_t> next_logger_id{1};
+
+const char* level_tag(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG ";
+        case LogLevel::Warn: return "WARN ";
+        case LogLevel::Error: return "ERROR ";
+        default: return "";   // INFO lines keep the plain access log format
+    }
+}
+
+// Unbuffered write of a whole batch to standard error
+void write_stderr(std::string_view batch) {
+    while (!batch.empty()) {
+#ifdef _WIN32
+        const int n = _write(2, batch.data(), static_cast<unsigned>(batch.size()));
+#else
+        const ssize_t n = ::write(2, batch.data(), batch.size());
+#endif
+        if (n <= 0) return;
+        batch.remove_prefix(static_cast<size_t>(n));
+    }
+}
+} // namespace
+
+Logger::Ring::Ring(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    records = std::make_unique<Record[]>(size);
+    mask = size - 1;
+}
+
+Logger::Logger(Sink sink, size_t ring_records)
+    : id_(next_logger_id.fetch_add(1, std::memory_order_relaxed)),
+      ring_records_(ring_records),
+      sink_(sink ? std::move(sink) : Sink(write_stderr)) {
+    thread_ = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+    flush();
+}
+
+Logger& Logger::global() {
+    static Logger logger;
+    return logger;
+}
+
+std::optional<LogLevel> Logger::parse_level(std::string_view name) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warn") return LogLevel::Warn;
+    if (name == "error") return LogLevel::Error;
+    if (name == "off") return LogLevel::Off;
+    return std::nullopt;
+}
+
+Logger::Ring& Logger::ThreadRings::find(Logger& logger) {
+    // Rings of loggers that are gone are only held here: let them go
+    for (auto it = rings.begin(); it != rings.end();) {
+        it = it->second.use_count() == 1 ? rings.erase(it) : it + 1;
+    }
+    for (auto& [id, ring] : rings) {
+        if (id == logger.id_) return *ring;
+    }
+    rings.emplace_back(logger.id_, logger.claim_ring());
+    return *rings.back().second;
+}
+
+Logger::ThreadRings::~ThreadRings() {
+    // What is still in the rings gets written; the next new thread reuses them
+    for (auto& [id, ring] : rings) {
+        ring->owned.store(false, std::memory_order_release);
+    }
+}
+
+std::shared_ptr<Logger::Ring> Logger::claim_ring() {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto& ring : rings_) {
+        bool owned = false;
+        if (ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+            return ring;
+        }
+    }
+    rings_.push_back(std::make_shared<Ring>(ring_records_));
+    return rings_.back();
+}
+
+int64_t Logger::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    drain();
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stopping_) {
+        stop_cv_.wait_for(lock, kDrainInterval);
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void Logger::drain() {
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings.reserve(rings_.size());
+        for (auto& ring : rings_) rings.push_back(ring.get());
+    }
+
+    batch_.clear();
+    uint64_t lines = 0;
+    auto line = [this](int64_t time_ms, LogLevel level, std::string_view text) {
+        const int64_t second = time_ms / 1000;
+        if (second != stamp_second_) {
+            std::tm tm_buf = safe_localtime(static_cast<std::time_t>(second));
+            std::strftime(stamp_, sizeof(stamp_), "[%F %T] ", &tm_buf);
+            stamp_second_ = second;
+        }
+        batch_ += stamp_;
+        batch_ += level_tag(level);
+        batch_ += text;
+        batch_ += '\n';
+    };
+
+    // Per thread in order; threads are not merged by time
+    for (Ring* ring : rings) {
+        const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        for (; head != tail; ++head) {
+            const Record& record = ring->records[head & ring->mask];
+            line(record.time_ms, record.level, std::string_view(record.text, record.length));
+            ++lines;
+        }
+        ring->head.store(head, std::memory_order_release);
+    }
+
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        const std::string note = "logger dropped " + std::to_string(dropped - dropped_reported_) +
+                                 " messages (ring full)";
+        line(now_ms(), LogLevel::Warn, note);
+        dropped_reported_ = dropped;
+    }
+
+    if (!batch_.empty()) {
+        sink_(batch_);
+        written_.fetch_add(lines, std::memory_order_relaxed);
+    }
+}
@@ -1,13 +1,39 @@
 #include "api.h"
 #include "cache.h"
+#include "core_engine.h"
 #include "replication.h"
 #include "leader_elector.h"
+#include "snapshot.h"
+#include "oplog.h"
+#include "memcached_server.h"
+#include "logger.h"
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <memory>
 
 int main(int argc, char* argv[]) {
     std::string role = "leader";
     int port = 5000;
+    size_t shards = 1;
+    size_t capacity_bytes = 0;
+    size_t compress_threshold = 0;
+    EvictionPolicy eviction = EvictionPolicy::LRU;
+    AdmissionPolicy admission = AdmissionPolicy::NONE;
+    bool lock_free_reads = false;
+    bool per_core = false;
+    size_t hot_keys = 0;
+    std::string origin_url;
+    uint64_t origin_ttl_ms = 60000;
+    int memcached_port = 0;
+    size_t memcached_threads = 0;
+    ServerOptions server_options;
+    LogLevel log_level = LogLevel::Info;
+    uint32_t access_log_sample = 1;
+    std::string snapshot_path;
+    uint64_t snapshot_interval_s = 300;
+    std::string aof_path;
+    FsyncPolicy aof_fsync = FsyncPolicy::EVERYSEC;
     std::vector<std::string> followers;
     std::string self_url = "http://127.0.0.1:" + std::to_string(port);
 
@@ -19,21 +45,190 @@ int main(int argc, char* argv[]) {
             self_url = "http://127.0.0.1:" + std::to_string(port);
         }
         else if (arg == "--followers" && i + 1 < argc) followers.push_back(argv[++i]);
+        else if (arg == "--shards" && i + 1 < argc) shards = std::stoul(argv[++i]);
+        else if (arg == "--capacity-bytes" && i + 1 < argc) capacity_bytes = std::stoull(argv[++i]);
+        else if (arg == "--compress-threshold" && i + 1 < argc) compress_threshold = std::stoull(argv[++i]);
+        else if (arg == "--lock-free-reads") lock_free_reads = true;
+        else if (arg == "--hot-keys" && i + 1 < argc) hot_keys = std::stoul(argv[++i]);
+        else if (arg == "--origin" && i + 1 < argc) origin_url = argv[++i];
+        else if (arg == "--origin-ttl" && i + 1 < argc) origin_ttl_ms = std::stoull(argv[++i]);
+        else if (arg == "--memcached-port" && i + 1 < argc) memcached_port = std::stoi(argv[++i]);
+        else if (arg == "--memcached-threads" && i + 1 < argc) memcached_threads = std::stoul(argv[++i]);
+        else if (arg == "--http-threads" && i + 1 < argc) server_options.threads = std::stoul(argv[++i]);
+        else if (arg == "--http-max-queue" && i + 1 < argc) server_options.max_queued = std::stoul(argv[++i]);
+        else if (arg == "--http-queue-budget-ms" && i + 1 < argc) server_options.queue_budget_ms = std::stoull(argv[++i]);
+        else if (arg == "--http-keep-alive-max" && i + 1 < argc) server_options.keep_alive_max = std::stoul(argv[++i]);
+        else if (arg == "--http-keep-alive-timeout" && i + 1 < argc) server_options.keep_alive_timeout_s = std::stol(argv[++i]);
+        else if (arg == "--rate-limit" && i + 1 < argc) server_options.rate_limit = std::stod(argv[++i]);
+        else if (arg == "--rate-limit-burst" && i + 1 < argc) server_options.rate_limit_burst = std::stod(argv[++i]);
+        else if (arg == "--access-log-sample" && i + 1 < argc) access_log_sample = std::stoul(argv[++i]);
+        else if (arg == "--log-level" && i + 1 < argc) {
+            std::string level = argv[++i];
+            auto parsed = Logger::parse_level(level);
+            if (!parsed) {
+                std::cerr << "Unknown log level: " << level << " (expected debug|info|warn|error|off)" << std::endl;
+                return 1;
+            }
+            log_level = *parsed;
+        }
+        else if (arg == "--snapshot-path" && i + 1 < argc) snapshot_path = argv[++i];
+        else if (arg == "--snapshot-interval" && i + 1 < argc) snapshot_interval_s = std::stoull(argv[++i]);
+        else if (arg == "--aof-path" && i + 1 < argc) aof_path = argv[++i];
+        else if (arg == "--aof-fsync" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "always") aof_fsync = FsyncPolicy::ALWAYS;
+            else if (policy == "everysec") aof_fsync = FsyncPolicy::EVERYSEC;
+            else if (policy == "no") aof_fsync = FsyncPolicy::NO;
+            else {
+                std::cerr << "Unknown fsync policy: " << policy << " (expected always|everysec|no)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--engine" && i + 1 < argc) {
+            std::string engine = argv[++i];
+            if (engine == "shared") per_core = false;
+            else if (engine == "per-core") per_core = true;
+            else {
+                std::cerr << "Unknown engine: " << engine << " (expected shared|per-core)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--eviction" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "lru") eviction = EvictionPolicy::LRU;
+            else if (policy == "clock") eviction = EvictionPolicy::CLOCK;
+            else {
+                std::cerr << "Unknown eviction policy: " << policy << " (expected lru|clock)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--admission" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "none") admission = AdmissionPolicy::NONE;
+            else if (policy == "tinylfu") admission = AdmissionPolicy::TINY_LFU;
+            else {
+                std::cerr << "Unknown admission policy: " << policy << " (expected none|tinylfu)" << std::endl;
+                return 1;
+            }
+        }
     }
 
-    auto cache = std::make_shared<Cache>(100, 100); // 100 ms
+    Logger::global().set_level(log_level);
+    Logger::global().set_access_sampling(access_log_sample); // 1 = every request, 0 = none
+
+    CacheOptions options;
+    options.capacity = 100;
+    options.capacity_bytes = capacity_bytes; // When set, bounds the cache by memory instead
+    options.eviction_interval_ms = 100; // 100 ms
+    options.shard_count = shards;
+    options.eviction = eviction;
+    options.admission = admission;
+    options.compress_threshold = compress_threshold; // 0 keeps every value raw
+    options.lock_free_reads = lock_free_reads;
+    options.hot_keys = hot_keys; // 0 = no hot-key near caches
+    if (admission == AdmissionPolicy::TINY_LFU && eviction != EvictionPolicy::LRU) {
+        std::cerr << "--admission tinylfu requires --eviction lru" << std::endl;
+        return 1;
+    }
+    if (lock_free_reads && eviction != EvictionPolicy::CLOCK) {
+        std::cerr << "--lock-free-reads requires --eviction clock" << std::endl;
+        return 1;
+    }
+    if (per_core && (!snapshot_path.empty() || !aof_path.empty() || hot_keys > 0 || !origin_url.empty() ||
+                     memcached_port > 0)) {
+        std::cerr << "--engine per-core does not support --snapshot-path, --aof-path, --hot-keys, --origin"
+                  << " or --memcached-port" << std::endl;
+        return 1;
+    }
+    if (memcached_port > 0 && !aof_path.empty()) {
+        std::cerr << "--memcached-port does not support --aof-path (its writes would not be logged)" << std::endl;
+        return 1;
+    }
+
+    // Either one shared cache, or one private cache per core (--shards is ignored then)
+    std::shared_ptr<Cache> cache;
+    std::shared_ptr<CoreEngine> engine;
+    if (per_core) {
+        engine = std::make_shared<CoreEngine>(options);
+        std::cerr << "Per-core engine with " << engine->core_count() << " cores" << std::endl;
+    } else {
+        cache = std::make_shared<Cache>(options);
+    }
     ReplicationManager repl;
 
+    // Warm restart from the last snapshot, then keep taking new ones
+    std::unique_ptr<SnapshotScheduler> snapshots;
+    if (!snapshot_path.empty()) {
+        if (std::ifstream(snapshot_path).good()) {
+            try {
+                auto start = std::chrono::steady_clock::now();
+                SnapshotLoadResult loaded = load_snapshot(*cache, snapshot_path);
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                std::cerr << "Loaded " << loaded.loaded << " entries from " << snapshot_path << " in " << ms
+                          << " ms (" << loaded.expired << " expired)" << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "Snapshot load failed: " << e.what() << std::endl;
+            }
+        }
+        if (snapshot_interval_s > 0) {
+            snapshots = std::make_unique<SnapshotScheduler>(cache, snapshot_path, snapshot_interval_s * 1000);
+            snapshots->start();
+        }
+    }
+
+    // Replay the operation log on top of the snapshot; from here on every write is logged
+    std::unique_ptr<OpLog> oplog;
+    if (!aof_path.empty()) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            OpLogReplayResult replayed;
+            oplog = std::make_unique<OpLog>(cache, aof_path, aof_fsync, &replayed);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cerr << "Replayed " << replayed.puts << " puts and " << replayed.erases << " erases from "
+                      << aof_path << " in " << ms << " ms" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Operation log failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // memcached clients share the cache with the REST API, on their own port and I/O threads
+    std::unique_ptr<MemcachedServer> memcached;
+    if (memcached_port > 0) {
+        try {
+            memcached = std::make_unique<MemcachedServer>(cache, memcached_threads);
+            memcached->start("0.0.0.0", memcached_port);
+            std::cerr << "memcached protocol on port " << memcached->port() << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "memcached listener failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     // Manage API through unique_ptr so we can recreate if promoted
     std::unique_ptr<CacheAPI> api;
+    auto make_api = [&](ReplicationManager* replication) {
+        auto made = engine ? std::make_unique<CacheAPI>(engine, replication)
+                           : std::make_unique<CacheAPI>(cache, replication, oplog.get());
+        if (!engine && !origin_url.empty()) {
+            made->set_origin(origin_url, origin_ttl_ms);   // Misses are fetched from the origin
+        }
+        made->set_server_options(server_options);
+        return made;
+    };
 
     if (role == "leader") {
         for (auto& f : followers) {
             repl.addFollower(f);
         }
-        api = std::make_unique<CacheAPI>(cache, &repl);
+        api = make_api(&repl);
+        if (memcached) {
+            memcached->set_replication(&repl);
+        }
     } else {
-        api = std::make_unique<CacheAPI>(cache, nullptr);
+        api = make_api(nullptr);
     }
 
     // Leader elector (interval=2000ms, threshold=3)
@@ -49,7 +244,10 @@ int main(int argc, char* argv[]) {
                 repl.addFollower(f);
             }
             // Recreate API with replication enabled
-            api = std::make_unique<CacheAPI>(cache, &repl);
+            api = make_api(&repl);
+            if (memcached) {
+                memcached->set_replication(&repl);
+            }
         }
     );
 
@@ -58,5 +256,14 @@ int main(int argc, char* argv[]) {
     api->start("0.0.0.0", port);
 
     elector.stop();
+    if (memcached) {
+        memcached->stop();
+    }
+    if (snapshots) {
+        snapshots->stop();
+    }
+    if (!snapshot_path.empty()) {
+        save_snapshot(*cache, snapshot_path);   // Final snapshot on shutdown
+    }
     return 0;
 }
\ No newline at end of file
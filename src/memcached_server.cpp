@@ -0,0 +1,547 @@
+#include "memcached_server.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr size_t kMaxKeyBytes = 250;                 // memcached's key limit
+constexpr size_t kMaxLineBytes = 2048;               // Command line, data block excluded
+constexpr size_t kMaxGetKeys = 2048;                 // Keys one get/gets line may name
+constexpr size_t kMaxGetLineBytes = 8 + kMaxGetKeys * (kMaxKeyBytes + 1);
+constexpr size_t kMaxValueBytes = 1 << 20;           // memcached's default item size limit
+constexpr size_t kInitialInput = 16 * 1024;          // Input buffer of a new connection
+constexpr size_t kMaxPendingOutput = 4 << 20;        // Reply bytes queued per batch before they are sent
+constexpr size_t kCopyBelow = 512;                   // Smaller values are copied into the output queue
+constexpr size_t kTextChunk = 16 * 1024;             // Reply text is appended to a chunk up to this size
+constexpr int kMaxIov = 64;                          // Buffers per gather write
+constexpr int kMaxEvents = 128;
+constexpr int64_t kMaxRelativeExptime = 60 * 60 * 24 * 30;   // Larger exptimes are Unix timestamps
+
+bool parse_u64(std::string_view text, uint64_t& out) {
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), out);
+    return !text.empty() && parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+}
+
+bool parse_i64(std::string_view text, int64_t& out) {
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), out);
+    return !text.empty() && parsed.ec == std::errc() && parsed.ptr == text.data() + text.size();
+}
+
+// cas unique for gets: FNV-1a of the flags and value, so it changes when either does
+uint64_t cas_of(uint32_t flags, std::string_view value) {
+    uint64_t hash = 1469598103934665603ull;
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((flags >> shift) & 0xFF)) * 1099511628211ull;
+    }
+    for (char c : value) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/// One piece of the output queue: reply text, or a value sent from its block.
+struct Chunk {
+    std::string text;
+    ValueRef value;
+    bool by_ref = false;
+
+    std::string_view view() const { return by_ref ? value.view() : std::string_view(text); }
+};
+} // namespace
+
+/// Per-connection state, owned by the I/O thread that accepted it.
+struct MemcachedServer::Connection {
+    int fd = -1;
+    std::unique_ptr<char[]> in;         ///< Input buffer; unparsed bytes are [in_begin, in_end)
+    size_t in_capacity = 0;
+    size_t in_begin = 0;
+    size_t in_end = 0;
+    size_t discard = 0;                 ///< Data bytes of a refused set still to skip
+    std::deque<Chunk> out;              ///< Replies not sent yet
+    size_t out_offset = 0;              ///< Bytes of out.front() already sent
+    size_t out_bytes = 0;               ///< Unsent bytes in `out`
+    bool closing = false;               ///< quit or a fatal protocol error: close once `out` is sent
+    std::vector<std::string_view> tokens;
+
+    ~Connection() {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    std::string_view input() const { return {in.get() + in_begin, in_end - in_begin}; }
+
+    void reply(std::string_view text) {
+        if (out.empty() || out.back().by_ref || out.back().text.size() + text.size() > kTextChunk) {
+            out.emplace_back();
+        }
+        out.back().text.append(text.data(), text.size());
+        out_bytes += text.size();
+    }
+
+    void reply_value(ValueRef value) {
+        if (value.size() < kCopyBelow) {
+            reply(value.view());
+            return;
+        }
+        out_bytes += value.size();
+        out.emplace_back();
+        out.back().value = std::move(value);
+        out.back().by_ref = true;
+    }
+
+    // Room for at least one more read at the end of the buffer
+    void reserve_input() {
+        if (in_begin == in_end) {
+            in_begin = in_end = 0;
+        }
+        if (in_end < in_capacity) {
+            return;
+        }
+        if (in_begin > 0) {
+            std::memmove(in.get(), in.get() + in_begin, in_end - in_begin);
+            in_end -= in_begin;
+            in_begin = 0;
+            return;
+        }
+        in_capacity *= 2;   // A command (with its data block) larger than the buffer
+        std::unique_ptr<char[]> grown(new char[in_capacity]);
+        std::memcpy(grown.get(), in.get(), in_end);
+        in = std::move(grown);
+    }
+};
+
+MemcachedServer::MemcachedServer(std::shared_ptr<Cache> cache, size_t io_threads, ReplicationManager* replication)
+    : cache_(std::move(cache)),
+      replication_(replication),
+      io_threads_(io_threads ? io_threads : std::min<size_t>(4, std::max(1u, std::thread::hardware_concurrency()))) {}
+
+MemcachedServer::~MemcachedServer() {
+    stop();
+}
+
+#ifdef __linux__
+
+void MemcachedServer::start(const std::string& host, int port) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("memcached: cannot create socket");
+    }
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        stop();
+        throw std::runtime_error("memcached: invalid address " + host);
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, SOMAXCONN) < 0) {
+        stop();
+        throw std::runtime_error("memcached: cannot listen on " + host + ":" + std::to_string(port));
+    }
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    for (size_t i = 0; i < io_threads_; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        // Level-triggered and never read: once written, it wakes every loop for good
+        epoll_event stop_event{};
+        stop_event.events = EPOLLIN;
+        stop_event.data.ptr = &stop_fd_;
+        epoll_event listen_event{};
+        listen_event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        listen_event.data.ptr = &listen_fd_;
+        if (worker->epoll_fd < 0 || stop_fd_ < 0 ||
+            ::epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, stop_fd_, &stop_event) < 0 ||
+            ::epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, listen_fd_, &listen_event) < 0) {
+            if (worker->epoll_fd >= 0) ::close(worker->epoll_fd);
+            stop();
+            throw std::runtime_error("memcached: cannot set up epoll");
+        }
+        workers_.push_back(std::move(worker));
+    }
+    for (auto& worker : workers_) {
+        Worker& w = *worker;
+        w.thread = std::thread([this, &w] { run(w); });
+    }
+}
+
+void MemcachedServer::stop() {
+    if (stop_fd_ >= 0) {
+        const uint64_t one = 1;
+        (void)!::write(stop_fd_, &one, sizeof(one));
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+        ::close(worker->epoll_fd);
+    }
+    workers_.clear();
+    if (stop_fd_ >= 0) ::close(stop_fd_);
+    if (listen_fd_ >= 0) ::close(listen_fd_);
+    stop_fd_ = listen_fd_ = -1;
+}
+
+void MemcachedServer::run(Worker& worker) {
+    std::unordered_map<int, std::unique_ptr<Connection>> owned;
+    epoll_event events[kMaxEvents];
+    for (;;) {
+        const int ready = ::epoll_wait(worker.epoll_fd, events, kMaxEvents, -1);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &stop_fd_) {
+                connections_.fetch_sub(owned.size(), std::memory_order_relaxed);
+                return;   // Connections close as `owned` goes
+            }
+            if (tag == &listen_fd_) {
+                accept_all(worker, owned);
+                continue;
+            }
+            auto* conn = static_cast<Connection*>(tag);
+            if (!serve(*conn)) {
+                ::epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+                owned.erase(conn->fd);
+                connections_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    connections_.fetch_sub(owned.size(), std::memory_order_relaxed);
+}
+
+void MemcachedServer::accept_all(Worker& worker, std::unordered_map<int, std::unique_ptr<Connection>>& owned) {
+    for (;;) {
+        const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;   // EAGAIN, or out of descriptors: the rest wait in the backlog
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->in.reset(new char[kInitialInput]);
+        conn->in_capacity = kInitialInput;
+
+        // Registered once for both directions; edge-triggered, so serve() always runs until EAGAIN
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = conn.get();
+        if (::epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            continue;   // Closed by the Connection
+        }
+        owned.emplace(fd, std::move(conn));
+        connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool MemcachedServer::serve(Connection& conn) {
+    for (;;) {
+        if (!flush(conn)) {
+            return false;
+        }
+        if (conn.out_bytes > 0) {
+            return true;   // Socket full: EPOLLOUT resumes once the client reads, input waits till then
+        }
+        if (conn.closing) {
+            return false;
+        }
+
+        process(conn);
+        if (conn.out_bytes > 0 || conn.closing) {
+            continue;   // Send what was answered before reading on
+        }
+
+        conn.reserve_input();
+        const ssize_t got = ::read(conn.fd, conn.in.get() + conn.in_end, conn.in_capacity - conn.in_end);
+        if (got > 0) {
+            conn.in_end += static_cast<size_t>(got);
+            continue;
+        }
+        if (got == 0) {
+            return false;   // Peer closed
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool MemcachedServer::flush(Connection& conn) {
+    while (conn.out_bytes > 0) {
+        iovec iov[kMaxIov];
+        int count = 0;
+        size_t offset = conn.out_offset;
+        for (auto it = conn.out.begin(); it != conn.out.end() && count < kMaxIov; ++it) {
+            const std::string_view piece = it->view().substr(offset);
+            offset = 0;
+            iov[count].iov_base = const_cast<char*>(piece.data());
+            iov[count].iov_len = piece.size();
+            ++count;
+        }
+
+        // writev() with MSG_NOSIGNAL: a client that went away must not raise SIGPIPE
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+        ssize_t sent = ::sendmsg(conn.fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        conn.out_bytes -= static_cast<size_t>(sent);
+        while (sent > 0) {
+            const size_t left = conn.out.front().view().size() - conn.out_offset;
+            if (static_cast<size_t>(sent) < left) {
+                conn.out_offset += static_cast<size_t>(sent);
+                break;
+            }
+            sent -= static_cast<ssize_t>(left);
+            conn.out.pop_front();   // Releases the value block of a by-reference chunk
+            conn.out_offset = 0;
+        }
+    }
+    return true;
+}
+
+#else
+
+void MemcachedServer::start(const std::string&, int) {
+    throw std::runtime_error("memcached front end requires Linux (epoll)");
+}
+
+void MemcachedServer::stop() {}
+
+#endif // __linux__
+
+void MemcachedServer::process(Connection& conn) {
+    while (conn.out_bytes < kMaxPendingOutput && !conn.closing) {
+        const std::string_view pending = conn.input();
+        if (conn.discard > 0) {
+            const size_t skipped = std::min(conn.discard, pending.size());
+            conn.in_begin += skipped;
+            conn.discard -= skipped;
+            if (conn.discard > 0) break;
+            continue;
+        }
+
+        const size_t eol = pending.find('\n');
+        if (eol == std::string_view::npos) {
+            // Multi-key gets legitimately run far past the storage command limit
+            const bool retrieval = pending.rfind("get ", 0) == 0 || pending.rfind("gets ", 0) == 0;
+            if (pending.size() > (retrieval ? kMaxGetLineBytes : kMaxLineBytes)) {
+                conn.reply("CLIENT_ERROR line too long\r\n");
+                conn.closing = true;
+            }
+            break;
+        }
+        std::string_view line = pending.substr(0, eol);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        const size_t consumed = execute(conn, line, pending.substr(eol + 1));
+        if (consumed == kNeedMore) {
+            break;
+        }
+        conn.in_begin += eol + 1 + consumed;
+        commands_.inc();
+    }
+}
+
+size_t MemcachedServer::execute(Connection& conn, std::string_view line, std::string_view rest) {
+    auto& tokens = conn.tokens;
+    tokens.clear();
+    for (size_t pos = 0; pos < line.size();) {
+        const size_t end = std::min(line.find(' ', pos), line.size());
+        if (end > pos) tokens.push_back(line.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    if (tokens.empty()) {
+        conn.reply("ERROR\r\n");
+        return 0;
+    }
+
+    const std::string_view command = tokens[0];
+    const bool noreply = tokens.back() == "noreply";
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        if (tokens[i].size() > kMaxKeyBytes) {
+            conn.reply("CLIENT_ERROR bad command line format\r\n");
+            return 0;
+        }
+    }
+
+    if (command == "get" || command == "gets") {
+        if (tokens.size() < 2) {
+            conn.reply("ERROR\r\n");
+            return 0;
+        }
+        retrieve(conn, command == "gets");
+        return 0;
+    }
+
+    if (command == "set") {
+        uint64_t flags = 0, bytes = 0;
+        int64_t exptime = 0;
+        if ((tokens.size() != 5 && !(tokens.size() == 6 && noreply)) || !parse_u64(tokens[2], flags) ||
+            flags > std::numeric_limits<uint32_t>::max() || !parse_i64(tokens[3], exptime) ||
+            !parse_u64(tokens[4], bytes)) {
+            conn.reply("CLIENT_ERROR bad command line format\r\n");
+            return 0;
+        }
+        if (bytes > kMaxValueBytes) {
+            conn.reply("SERVER_ERROR object too large for cache\r\n");
+            conn.discard = bytes + 2;   // Skip the data block as it arrives
+            return 0;
+        }
+        if (rest.size() < bytes + 2) {
+            return kNeedMore;
+        }
+        if (rest.substr(bytes, 2) != "\r\n") {
+            // Longer than announced: skip the rest of the line rather than run it as a command
+            conn.reply("CLIENT_ERROR bad data chunk\r\n");
+            const size_t eol = rest.find('\n', bytes);
+            return eol == std::string_view::npos ? bytes + 2 : eol + 1;
+        }
+
+        const std::string_view key = tokens[1];
+        // memcached exptime: seconds from now, or a Unix time past 30 days; negative = already expired
+        int64_t ttl_s = exptime;
+        if (exptime > kMaxRelativeExptime) {
+            ttl_s = exptime - static_cast<int64_t>(std::time(nullptr));
+            if (ttl_s <= 0) ttl_s = -1;
+        }
+        ReplicationManager* replication = replication_.load(std::memory_order_acquire);
+        if (ttl_s < 0) {
+            cache_->erase(key);
+            if (replication) replication->replicateDelete(std::string(key));
+        } else {
+            const std::string_view value = rest.substr(0, bytes);
+            const uint64_t ttl_ms = static_cast<uint64_t>(ttl_s) * 1000;
+            cache_->put(key, value, ttl_ms, static_cast<uint32_t>(flags));
+            // Values may be any bytes, so they travel as octet streams
+            if (replication) {
+                replication->replicatePut(std::string(key), std::string(value), ttl_ms, true,
+                                          static_cast<uint32_t>(flags));
+            }
+        }
+        if (!noreply) conn.reply("STORED\r\n");
+        return bytes + 2;
+    }
+
+    if (command == "delete") {
+        if (tokens.size() < 2 || tokens.size() > 3 || (tokens.size() == 3 && !noreply)) {
+            conn.reply("CLIENT_ERROR bad command line format\r\n");
+            return 0;
+        }
+        const bool erased = cache_->erase(tokens[1]);
+        ReplicationManager* replication = replication_.load(std::memory_order_acquire);
+        if (erased && replication) {
+            replication->replicateDelete(std::string(tokens[1]));
+        }
+        if (!noreply) conn.reply(erased ? "DELETED\r\n" : "NOT_FOUND\r\n");
+        return 0;
+    }
+
+    if (command == "incr" || command == "decr") {
+        uint64_t delta = 0;
+        if (tokens.size() < 3 || tokens.size() > 4 || (tokens.size() == 4 && !noreply)) {
+            conn.reply("ERROR\r\n");
+            return 0;
+        }
+        if (!parse_u64(tokens[2], delta)) {
+            conn.reply("CLIENT_ERROR invalid numeric delta argument\r\n");
+            return 0;
+        }
+        std::optional<uint64_t> value;
+        uint64_t ttl_ms = 0;
+        uint32_t flags = 0;
+        try {
+            value = command == "incr" ? cache_->incr(tokens[1], delta, &ttl_ms, &flags)
+                                      : cache_->decr(tokens[1], delta, &ttl_ms, &flags);
+        } catch (const std::invalid_argument&) {
+            conn.reply("CLIENT_ERROR cannot increment or decrement non-numeric value\r\n");
+            return 0;
+        }
+        char buf[24];
+        char* end = value ? std::to_chars(buf, buf + 20, *value).ptr : buf;
+        ReplicationManager* replication = replication_.load(std::memory_order_acquire);
+        if (value && replication) {
+            // Followers get the result, not the delta, so a retried request cannot count twice
+            replication->replicatePut(std::string(tokens[1]), std::string(buf, static_cast<size_t>(end - buf)), ttl_ms,
+                                      true, flags);
+        }
+        if (noreply) return 0;
+        if (!value) {
+            conn.reply("NOT_FOUND\r\n");
+            return 0;
+        }
+        *end++ = '\r';
+        *end++ = '\n';
+        conn.reply(std::string_view(buf, static_cast<size_t>(end - buf)));
+        return 0;
+    }
+
+    if (command == "version") {
+        conn.reply("VERSION DistributedCachePP\r\n");
+        return 0;
+    }
+    if (command == "quit") {
+        conn.closing = true;
+        return 0;
+    }
+    conn.reply("ERROR\r\n");
+    return 0;
+}
+
+void MemcachedServer::retrieve(Connection& conn, bool with_cas) {
+    const std::vector<std::string_view> keys(conn.tokens.begin() + 1, conn.tokens.end());
+    std::vector<std::optional<ValueRef>> values;
+    if (keys.size() == 1) {
+        values.push_back(cache_->get_ref(keys[0]));
+    } else {
+        values = cache_->multi_get_ref(keys);   // Each shard lock once
+    }
+
+    char number[24];
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (!values[i]) continue;
+        const ValueRef& value = *values[i];
+        conn.reply("VALUE ");
+        conn.reply(keys[i]);
+        conn.reply(" ");
+        conn.reply(std::string_view(number, static_cast<size_t>(std::to_chars(number, number + 20, value.flags()).ptr - number)));
+        conn.reply(" ");
+        conn.reply(std::string_view(number, static_cast<size_t>(std::to_chars(number, number + 20, value.size()).ptr - number)));
+        if (with_cas) {
+            conn.reply(" ");
+            conn.reply(std::string_view(number, static_cast<size_t>(
+                std::to_chars(number, number + 20, cas_of(value.flags(), value.view())).ptr - number)));
+        }
+        conn.reply("\r\n");
+        conn.reply_value(std::move(*values[i]));
+        conn.reply("\r\n");
+    }
+    conn.reply("END\r\n");
+}
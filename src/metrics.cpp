@@ -0,0 +1,207 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+namespace {
+constexpr size_t kMaxStripes = 64;
+
+std::atomic<size_t> g_next_stripe{0};
+
+// Series name with its labels, plus an optional extra label (histogram `le`)
+std::string series_name(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) {
+        return name;
+    }
+    std::string out = name + "{" + labels;
+    if (!labels.empty() && !extra.empty()) {
+        out += ",";
+    }
+    return out + extra + "}";
+}
+
+// Whole numbers (counts, bytes) in full, anything else in the stream's default notation
+std::string format_value(double value) {
+    constexpr double kExactInteger = 9007199254740992.0;   // 2^53
+    if (std::abs(value) < kExactInteger && value == std::trunc(value)) {
+        return std::to_string(static_cast<int64_t>(value));
+    }
+    std::ostringstream ss;
+    ss << value;
+    return ss.str();
+}
+}
+
+size_t metric_stripe_count() {
+    static const size_t count = [] {
+        size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t stripes = 1;
+        while (stripes < threads && stripes < kMaxStripes) {
+            stripes <<= 1;
+        }
+        return stripes;
+    }();
+    return count;
+}
+
+size_t assign_metric_stripe() {
+    return g_next_stripe.fetch_add(1, std::memory_order_relaxed) & (metric_stripe_count() - 1);
+}
+
+// ---------------- Counter / Gauge ----------------
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < metric_stripe_count(); ++i) {
+        total += slots_[i].value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t Gauge::value() const {
+    int64_t total = 0;
+    for (size_t i = 0; i < metric_stripe_count(); ++i) {
+        total += slots_[i].value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// ---------------- Histogram ----------------
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      // Buckets, +Inf and the sum
+      lines_per_stripe_((bounds_.size() + 2 + kCellsPerLine - 1) / kCellsPerLine),
+      lines_(std::make_unique<Line[]>(lines_per_stripe_ * metric_stripe_count())) {
+    std::sort(bounds_.begin(), bounds_.end());
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.bounds = bounds_;
+    snap.buckets.assign(bounds_.size() + 1, 0);
+    for (size_t stripe = 0; stripe < metric_stripe_count(); ++stripe) {
+        for (size_t b = 0; b <= bounds_.size(); ++b) {
+            snap.buckets[b] += cell(stripe, b).load(std::memory_order_relaxed);
+        }
+        uint64_t bits = cell(stripe, bounds_.size() + 1).load(std::memory_order_relaxed);
+        double sum;
+        std::memcpy(&sum, &bits, sizeof(sum));
+        snap.sum += sum;
+    }
+    for (size_t b = 1; b < snap.buckets.size(); ++b) {
+        snap.buckets[b] += snap.buckets[b - 1];
+    }
+    snap.count = snap.buckets.back();
+    return snap;
+}
+
+std::vector<double> Histogram::latency_bounds() {
+    return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+// ---------------- MetricsRegistry ----------------
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, Type type) {
+    for (auto& f : families_) {
+        if (f->name == name) {
+            return *f;
+        }
+    }
+    families_.push_back(std::make_unique<Family>(Family{name, help, type, {}, nullptr}));
+    return *families_.back();
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(Family& family, const std::string& labels) {
+    for (auto& s : family.series) {
+        if (s->labels == labels) {
+            return *s;
+        }
+    }
+    family.series.push_back(std::make_unique<Series>());
+    family.series.back()->labels = labels;
+    return *family.series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(family(name, help, Type::Counter), labels);
+    if (!s.counter) {
+        s.counter = std::make_unique<Counter>();
+    }
+    return *s.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(family(name, help, Type::Gauge), labels);
+    if (!s.gauge) {
+        s.gauge = std::make_unique<Gauge>();
+    }
+    return *s.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      std::vector<double> bounds, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(family(name, help, Type::Histogram), labels);
+    if (!s.histogram) {
+        s.histogram = std::make_unique<Histogram>(std::move(bounds));
+    }
+    return *s.histogram;
+}
+
+void MetricsRegistry::counter_fn(const std::string& name, const std::string& help, std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, Type::Counter).collect = [fn = std::move(fn)]() {
+        return std::vector<Sample>{{"", fn()}};
+    };
+}
+
+void MetricsRegistry::gauge_fn(const std::string& name, const std::string& help, std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, Type::Gauge).collect = [fn = std::move(fn)]() {
+        return std::vector<Sample>{{"", fn()}};
+    };
+}
+
+void MetricsRegistry::gauge_family_fn(const std::string& name, const std::string& help,
+                                      std::function<std::vector<Sample>()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, Type::Gauge).collect = std::move(fn);
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream ss;
+    for (const auto& f : families_) {
+        ss << "# HELP " << f->name << " " << f->help << "\n";
+        ss << "# TYPE " << f->name << " "
+           << (f->type == Type::Counter ? "counter" : f->type == Type::Gauge ? "gauge" : "histogram") << "\n";
+
+        if (f->collect) {
+            for (const auto& sample : f->collect()) {
+                ss << series_name(f->name, sample.labels) << " " << format_value(sample.value) << "\n";
+            }
+        }
+        for (const auto& s : f->series) {
+            if (s->counter) {
+                ss << series_name(f->name, s->labels) << " " << s->counter->value() << "\n";
+            } else if (s->gauge) {
+                ss << series_name(f->name, s->labels) << " " << s->gauge->value() << "\n";
+            } else if (s->histogram) {
+                auto snap = s->histogram->snapshot();
+                for (size_t b = 0; b < snap.bounds.size(); ++b) {
+                    ss << series_name(f->name + "_bucket", s->labels, "le=\"" + format_value(snap.bounds[b]) + "\"")
+                       << " " << snap.buckets[b] << "\n";
+                }
+                ss << series_name(f->name + "_bucket", s->labels, "le=\"+Inf\"") << " " << snap.count << "\n";
+                ss << series_name(f->name + "_sum", s->labels) << " " << format_value(snap.sum) << "\n";
+                ss << series_name(f->name + "_count", s->labels) << " " << snap.count << "\n";
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
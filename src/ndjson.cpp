@@ -0,0 +1,331 @@
+#include "ndjson.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+std::string_view json_escape(unsigned char c, char (&buf)[7]) {
+    switch (c) {
+        case '"': return "\\\"";
+        case '\\': return "\\\\";
+        case '\b': return "\\b";
+        case '\f': return "\\f";
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        default:
+            if (c >= 0x20) return {};
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            return {buf, 6};
+    }
+}
+
+bool is_utf8(std::string_view bytes) {
+    const auto* s = reinterpret_cast<const unsigned char*>(bytes.data());
+    const size_t n = bytes.size();
+    for (size_t i = 0; i < n;) {
+        const unsigned char c = s[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        // Second byte bounds rule out overlong forms, surrogates and code points past U+10FFFF
+        size_t length = 0;
+        unsigned char low = 0x80, high = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            length = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            length = 3;
+            if (c == 0xE0) low = 0xA0;
+            if (c == 0xED) high = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            length = 4;
+            if (c == 0xF0) low = 0x90;
+            if (c == 0xF4) high = 0x8F;
+        } else {
+            return false;
+        }
+        if (n - i < length || s[i + 1] < low || s[i + 1] > high) return false;
+        for (size_t k = 2; k < length; ++k) {
+            if ((s[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+void append_json_string(std::string& out, std::string_view bytes, bool latin1) {
+    char buf[7];
+    out.push_back('"');
+    for (char c : bytes) {
+        const auto byte = static_cast<unsigned char>(c);
+        auto esc = json_escape(byte, buf);
+        if (latin1 && byte >= 0x80) {
+            std::snprintf(buf, sizeof(buf), "\\u%04x", byte);
+            esc = {buf, 6};
+        }
+        if (esc.empty()) out.push_back(c);
+        else out.append(esc.data(), esc.size());
+    }
+    out.push_back('"');
+}
+
+void append_ndjson_record(std::string& out, std::string_view key, std::string_view value, uint64_t ttl_ms) {
+    const bool latin1 = !is_utf8(key) || !is_utf8(value);
+    out += latin1 ? "{\"encoding\":\"latin1\",\"key\":" : "{\"key\":";
+    append_json_string(out, key, latin1);
+    out += ",\"value\":";
+    append_json_string(out, value, latin1);
+    out += ",\"ttl\":";
+    char digits[20];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), ttl_ms);
+    out.append(digits, end);
+    out += "}\n";
+}
+
+namespace {
+
+// Parser of one import record; every method returns an error message, or nullptr on success
+class RecordParser {
+public:
+    explicit RecordParser(std::string_view line) : s_(line) {}
+
+    const char* parse(std::string& key, std::string& value, uint64_t& ttl_ms) {
+        bool has_key = false;
+        bool has_value = false;
+        bool latin1 = false;
+        ttl_ms = 0;
+
+        skip_space();
+        if (!consume('{')) return "expected an object";
+        skip_space();
+        if (!consume('}')) {
+            for (;;) {
+                skip_space();
+                if (const char* error = parse_string(name_)) return error;
+                skip_space();
+                if (!consume(':')) return "expected ':' after a field name";
+                skip_space();
+
+                const char* error = nullptr;
+                if (name_ == "key") {
+                    error = parse_string(key);
+                    has_key = true;
+                } else if (name_ == "value") {
+                    error = parse_string(value);
+                    has_value = true;
+                } else if (name_ == "ttl") {
+                    error = parse_uint(ttl_ms);
+                } else if (name_ == "encoding") {
+                    error = parse_string(name_);
+                    if (!error && name_ != "latin1") error = "unknown encoding (expected latin1)";
+                    latin1 = true;
+                } else {
+                    return "unknown field (expected key, value, ttl and encoding)";
+                }
+                if (error) return error;
+
+                skip_space();
+                if (consume(',')) continue;
+                if (consume('}')) break;
+                return "expected ',' or '}'";
+            }
+        }
+        skip_space();
+        if (pos_ != s_.size()) return "unexpected text after the record";
+        if (!has_key) return "missing key";
+        if (!has_value) return "missing value";
+        if (latin1 && (!to_latin1(key) || !to_latin1(value))) {
+            return "character above U+00FF in a latin1 record";
+        }
+        return nullptr;
+    }
+
+private:
+    void skip_space() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t')) ++pos_;
+    }
+
+    bool consume(char c) {
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    const char* parse_uint(uint64_t& out) {
+        auto [end, ec] = std::from_chars(s_.data() + pos_, s_.data() + s_.size(), out);
+        if (ec != std::errc()) return "ttl must be a non-negative integer (ms)";
+        pos_ = static_cast<size_t>(end - s_.data());
+        return nullptr;
+    }
+
+    bool hex4(uint32_t& out) {
+        if (s_.size() - pos_ < 4) return false;
+        auto [end, ec] = std::from_chars(s_.data() + pos_, s_.data() + pos_ + 4, out, 16);
+        if (ec != std::errc() || end != s_.data() + pos_ + 4) return false;
+        pos_ += 4;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    // Turn the UTF-8 of code points up to U+00FF back into one byte each, in place
+    static bool to_latin1(std::string& text) {
+        size_t out = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const auto c = static_cast<unsigned char>(text[i]);
+            if (c < 0x80) {
+                text[out++] = text[i];
+                continue;
+            }
+            if ((c != 0xC2 && c != 0xC3) || i + 1 == text.size()) return false;
+            const auto next = static_cast<unsigned char>(text[++i]);
+            if ((next & 0xC0) != 0x80) return false;
+            text[out++] = static_cast<char>(((c & 0x1F) << 6) | (next & 0x3F));
+        }
+        text.resize(out);
+        return true;
+    }
+
+    // Any byte but a quote or a backslash is taken as is
+    const char* parse_string(std::string& out) {
+        if (!consume('"')) return "expected a string";
+        out.clear();
+        for (;;) {
+            size_t run = pos_;
+            while (run < s_.size() && s_[run] != '"' && s_[run] != '\\') ++run;
+            out.append(s_.data() + pos_, run - pos_);
+            pos_ = run;
+            if (pos_ == s_.size()) return "unterminated string";
+            if (s_[pos_++] == '"') return nullptr;
+            if (pos_ == s_.size()) return "unterminated string";   // Backslash at the very end
+
+            const char escape = s_[pos_++];
+            switch (escape) {
+                case '"': case '\\': case '/': out.push_back(escape); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!hex4(cp)) return "invalid \\u escape";
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        uint32_t low = 0;
+                        if (!consume('\\') || !consume('u') || !hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                            return "unpaired surrogate in \\u escape";
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        return "unpaired surrogate in \\u escape";
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default: return "invalid escape";
+            }
+        }
+    }
+
+    std::string_view s_;
+    size_t pos_ = 0;
+    std::string name_;
+};
+
+} // namespace
+
+NdjsonImporter::NdjsonImporter(Sink sink, size_t batch)
+    : sink_(std::move(sink)), batch_size_(batch > 0 ? batch : 1) {}
+
+void NdjsonImporter::feed(std::string_view data) {
+    size_t start = 0;
+    while (start < data.size()) {
+        const void* newline = std::memchr(data.data() + start, '\n', data.size() - start);
+        if (newline == nullptr) {
+            if (partial_.size() + (data.size() - start) > kMaxLineBytes) {
+                ++line_;
+                fail("line too long");
+            }
+            partial_.append(data.data() + start, data.size() - start);
+            return;
+        }
+        const size_t end = static_cast<size_t>(static_cast<const char*>(newline) - data.data());
+        if (partial_.empty()) {
+            add_line(data.substr(start, end - start));   // Parsed in place
+        } else {
+            partial_.append(data.data() + start, end - start);
+            add_line(partial_);
+            partial_.clear();
+        }
+        start = end + 1;
+    }
+}
+
+void NdjsonImporter::finish() {
+    if (!partial_.empty()) {
+        const std::string last = std::move(partial_);
+        partial_.clear();
+        add_line(last);
+    }
+    flush();
+}
+
+void NdjsonImporter::add_line(std::string_view line) {
+    ++line_;
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.find_first_not_of(" \t") == std::string_view::npos) {
+        return;
+    }
+
+    if (batch_.size() <= pending_) {
+        batch_.resize(pending_ + 1);   // Grows to one batch, then its strings are reused
+    }
+    Record& record = batch_[pending_];
+    RecordParser parser(line);
+    if (const char* error = parser.parse(record.key, record.value, record.ttl_ms)) {
+        fail(error);
+    }
+    if (++pending_ == batch_size_) {
+        flush();
+    }
+}
+
+void NdjsonImporter::flush() {
+    if (pending_ == 0) {
+        return;
+    }
+    items_.clear();
+    for (size_t i = 0; i < pending_; ++i) {
+        items_.push_back({batch_[i].key, batch_[i].value, batch_[i].ttl_ms});
+    }
+    sink_(items_);
+    records_ += pending_;
+    pending_ = 0;
+}
+
+void NdjsonImporter::fail(const char* what) {
+    flush();
+    throw std::invalid_argument("line " + std::to_string(line_) + ": " + what);
+}
@@ -0,0 +1,498 @@
+#include "oplog.h"
+#include "binary_io.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char kMagic[8] = {'D', 'C', 'P', 'P', 'O', 'L', 'O', 'G'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 8 + 4 + 4;
+constexpr size_t kRecordHeaderSize = 4 + 1 + 4 + 4 + 8;
+constexpr uint8_t kOpPut = 1;
+constexpr uint8_t kOpErase = 2;
+
+constexpr uint64_t kMinRewriteBytes = 64ull << 20;   // Don't bother compacting small logs
+constexpr size_t kReplayBatch = 4096;                // Records per worker hand-off
+constexpr size_t kReplayQueueDepth = 16;             // Batches buffered per worker
+
+uint32_t checksum(const char* data, size_t size) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return h;
+}
+
+std::string header() {
+    std::string out(kHeaderSize, '\0');
+    std::memcpy(&out[0], kMagic, sizeof(kMagic));
+    put_le<uint32_t>(&out[8], kVersion);
+    return out;
+}
+
+void encode(std::string& out, uint8_t op, std::string_view key, std::string_view value, int64_t expires_at_ms) {
+    const size_t start = out.size();
+    out.resize(start + kRecordHeaderSize);
+    char* h = &out[start];
+    h[4] = static_cast<char>(op);
+    put_le<uint32_t>(h + 5, static_cast<uint32_t>(key.size()));
+    put_le<uint32_t>(h + 9, static_cast<uint32_t>(value.size()));
+    put_le<int64_t>(h + 13, expires_at_ms);
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+    put_le<uint32_t>(&out[start], checksum(out.data() + start + 4, out.size() - start - 4));
+}
+
+int64_t expires_at(uint64_t ttl_ms) {
+    return ttl_ms == 0 ? 0 : wall_clock_ms() + static_cast<int64_t>(ttl_ms);
+}
+
+bool sync_file(std::FILE* file) {
+    if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    return ::fdatasync(::fileno(file)) == 0;   // Data only: the length change is covered too
+#else
+    return ::fsync(::fileno(file)) == 0;
+#endif
+}
+
+bool write_all(std::FILE* file, const std::string& bytes) {
+    return bytes.empty() || std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+}
+
+// ---------------- Replay ----------------
+
+struct ReplayOp {
+    bool erase;
+    std::string_view key;
+    std::string_view value;
+    uint64_t ttl_ms;
+};
+
+// Apply ops in order, batching runs of the same kind
+void apply_ops(Cache& cache, const std::vector<ReplayOp>& ops) {
+    std::vector<CacheItem> puts;
+    std::vector<std::string_view> erases;
+    for (const ReplayOp& op : ops) {
+        if (op.erase) {
+            if (!puts.empty()) { cache.multi_put(puts); puts.clear(); }
+            erases.push_back(op.key);
+        } else {
+            if (!erases.empty()) { cache.multi_erase(erases); erases.clear(); }
+            puts.push_back({op.key, op.value, op.ttl_ms});
+        }
+    }
+    if (!puts.empty()) cache.multi_put(puts);
+    if (!erases.empty()) cache.multi_erase(erases);
+}
+
+/// Applies the batches of the shards it owns, in arrival order.
+class ReplayWorker {
+public:
+    explicit ReplayWorker(Cache& cache) : cache_(cache), thread_([this] { run(); }) {}
+
+    void push(std::vector<ReplayOp> batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [this] { return queue_.size() < kReplayQueueDepth; });
+        queue_.push_back(std::move(batch));
+        ready_.notify_one();
+    }
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        ready_.notify_one();
+        thread_.join();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            ready_.wait(lock, [this] { return !queue_.empty() || done_; });
+            if (queue_.empty()) return;
+            std::vector<ReplayOp> batch = std::move(queue_.front());
+            queue_.pop_front();
+            space_.notify_one();
+            lock.unlock();
+            apply_ops(cache_, batch);
+            lock.lock();
+        }
+    }
+
+    Cache& cache_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::deque<std::vector<ReplayOp>> queue_;
+    bool done_ = false;
+    std::thread thread_;
+};
+} // namespace
+
+// ---------------- OpLog ----------------
+
+OpLog::OpLog(std::shared_ptr<Cache> cache, std::string path, FsyncPolicy policy, OpLogReplayResult* replayed)
+    : cache_(std::move(cache)), path_(std::move(path)), policy_(policy),
+      key_locks_(std::make_unique<std::mutex[]>(kKeyStripes)) {
+    std::error_code ec;
+    if (std::filesystem::exists(path_, ec) && std::filesystem::file_size(path_, ec) > 0) {
+        OpLogReplayResult result = replay(*cache_, path_);
+        if (result.truncated_bytes > 0) {
+            std::cerr << "[OpLog] Dropping " << result.truncated_bytes << " torn bytes at the end of " << path_
+                      << std::endl;
+            std::filesystem::resize_file(path_, result.valid_bytes);
+        }
+        if (replayed) *replayed = result;
+        bytes_ = rewrite_base_bytes_ = result.valid_bytes;
+        open_for_append();
+    } else {
+        rewriting_ = true;
+        do_rewrite();   // Header plus whatever the cache already holds
+    }
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+OpLog::~OpLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;   // No new background rewrite from here on
+    }
+    if (rewriter_.joinable()) rewriter_.join();
+    wake_writer_.notify_all();
+    writer_.join();
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void OpLog::open_for_append() {
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (file_ == nullptr) {
+        throw std::runtime_error("oplog: cannot open " + path_);
+    }
+    std::setvbuf(file_, nullptr, _IONBF, 0);   // Batches are written whole
+}
+
+std::vector<std::unique_lock<std::mutex>> OpLog::lock_keys(const std::vector<std::string_view>& keys) {
+    std::vector<size_t> stripes;
+    stripes.reserve(keys.size());
+    for (std::string_view key : keys) {
+        stripes.push_back(std::hash<std::string_view>{}(key) % kKeyStripes);
+    }
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(stripes.size());
+    for (size_t stripe : stripes) {
+        locks.emplace_back(key_locks_[stripe]);
+    }
+    return locks;
+}
+
+uint64_t OpLog::append(std::string_view record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool was_empty = pending_.empty();
+    pending_.append(record.data(), record.size());
+    if (rewriting_) {
+        tail_.append(record.data(), record.size());
+    }
+    if (was_empty) {
+        wake_writer_.notify_one();
+    }
+    return ++appended_seq_;
+}
+
+void OpLog::wait_durable(uint64_t seq) {
+    if (policy_ != FsyncPolicy::ALWAYS) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    durable_.wait(lock, [this, seq] { return durable_seq_ >= seq; });
+}
+
+void OpLog::put(std::string_view key, std::string_view value, uint64_t ttl_ms) {
+    std::string record;
+    encode(record, kOpPut, key, value, expires_at(ttl_ms));
+    uint64_t seq;
+    {
+        auto locks = lock_keys({key});
+        cache_->put(key, value, ttl_ms);
+        seq = append(record);
+    }
+    wait_durable(seq);   // Outside the key lock, so writers of this key can join the same sync
+}
+
+void OpLog::multi_put(const std::vector<CacheItem>& items) {
+    std::string records;
+    std::vector<std::string_view> keys;
+    keys.reserve(items.size());
+    for (const CacheItem& item : items) {
+        encode(records, kOpPut, item.key, item.value, expires_at(item.ttl_ms));
+        keys.push_back(item.key);
+    }
+    uint64_t seq;
+    {
+        auto locks = lock_keys(keys);
+        cache_->multi_put(items);
+        seq = append(records);
+    }
+    wait_durable(seq);
+}
+
+bool OpLog::erase(std::string_view key) {
+    std::string record;
+    encode(record, kOpErase, key, {}, 0);
+    uint64_t seq;
+    {
+        auto locks = lock_keys({key});
+        if (!cache_->erase(key)) {
+            return false;   // Nothing changed, nothing to log
+        }
+        seq = append(record);
+    }
+    wait_durable(seq);
+    return true;
+}
+
+size_t OpLog::multi_erase(const std::vector<std::string_view>& keys) {
+    std::string records;
+    for (std::string_view key : keys) {
+        encode(records, kOpErase, key, {}, 0);
+    }
+    size_t removed;
+    uint64_t seq = 0;
+    {
+        auto locks = lock_keys(keys);
+        removed = cache_->multi_erase(keys);
+        if (removed > 0) {
+            seq = append(records);
+        }
+    }
+    wait_durable(seq);
+    return removed;
+}
+
+void OpLog::writer_loop() {
+    using steady = std::chrono::steady_clock;
+    auto last_sync = steady::now();
+    bool unsynced = false;
+    std::string batch;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_writer_.wait_for(lock, std::chrono::seconds(1), [this] { return !pending_.empty() || stopping_; });
+        const bool stop = stopping_ && pending_.empty();
+        batch.clear();
+        batch.swap(pending_);
+        const uint64_t seq = appended_seq_;
+        const uint64_t generation = rewrites_;
+        // Take the file before letting appends in, so a rewrite cannot swap
+        // files between taking this batch and writing it
+        std::unique_lock<std::mutex> io(io_mutex_);
+        lock.unlock();
+
+        {
+            if (!write_all(file_, batch)) {
+                std::cerr << "[OpLog] Write to " << path_ << " failed" << std::endl;
+            }
+            unsynced = unsynced || !batch.empty();
+            const bool due = policy_ == FsyncPolicy::ALWAYS ||
+                             (policy_ == FsyncPolicy::EVERYSEC && steady::now() - last_sync >= std::chrono::seconds(1)) ||
+                             stop;
+            if (unsynced && due) {
+                if (!sync_file(file_)) {
+                    std::cerr << "[OpLog] Sync of " << path_ << " failed" << std::endl;
+                }
+                last_sync = steady::now();
+                unsynced = false;
+            }
+            io.unlock();
+        }
+
+        lock.lock();
+        if (generation == rewrites_) {
+            bytes_ += batch.size();   // Otherwise the rewrite already measured the new file
+        }
+        durable_seq_ = std::max(durable_seq_, seq);
+        durable_.notify_all();
+        if (stop) {
+            return;
+        }
+
+        if (!rewriting_ && !stopping_ && bytes_ >= kMinRewriteBytes && bytes_ >= 2 * rewrite_base_bytes_) {
+            rewriting_ = true;
+            if (rewriter_.joinable()) rewriter_.join();   // The previous rewrite has finished
+            rewriter_ = std::thread([this] {
+                try {
+                    do_rewrite();
+                } catch (const std::exception& e) {
+                    std::cerr << "[OpLog] " << e.what() << std::endl;
+                }
+            });
+        }
+    }
+}
+
+bool OpLog::rewrite() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rewriting_) return false;
+        rewriting_ = true;
+    }
+    do_rewrite();
+    return true;
+}
+
+void OpLog::do_rewrite() {
+    // Clears rewriting_ however the rewrite ends
+    struct Done {
+        OpLog& log;
+        ~Done() {
+            std::lock_guard<std::mutex> lock(log.mutex_);
+            log.rewriting_ = false;
+            log.tail_.clear();
+        }
+    } done{*this};
+
+    // Appends made from here on are also captured in tail_. Earlier ones
+    // were applied to the cache before, so the export below covers them.
+    const std::string tmp_path = path_ + ".rewrite";
+    std::FILE* tmp = std::fopen(tmp_path.c_str(), "wb");
+    if (tmp == nullptr) {
+        throw std::runtime_error("oplog: cannot open " + tmp_path);
+    }
+
+    std::string buffer = header();
+    bool ok = true;
+    for (size_t shard = 0; shard < cache_->shard_count() && ok; ++shard) {
+        for (const CacheRecord& record : cache_->export_shard(shard)) {
+            encode(buffer, kOpPut, record.key, record.value.view(), expires_at(record.ttl_ms));
+            if (buffer.size() >= (1u << 20)) {
+                ok = ok && write_all(tmp, buffer);
+                buffer.clear();
+            }
+        }
+    }
+    ok = ok && write_all(tmp, buffer);
+
+    // Swap: block appends briefly while the captured tail goes in
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> io(io_mutex_);
+    ok = ok && write_all(tmp, tail_) && sync_file(tmp);
+    const auto size = static_cast<uint64_t>(std::ftell(tmp));
+    ok = std::fclose(tmp) == 0 && ok;
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp_path, path_, ec);
+    }
+    if (!ok || ec) {
+        std::filesystem::remove(tmp_path, ec);
+        throw std::runtime_error("oplog: rewrite of " + path_ + " failed");
+    }
+
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+    open_for_append();
+    // Everything buffered is already in the new file, via the export or the tail
+    pending_.clear();
+    durable_seq_ = appended_seq_;
+    durable_.notify_all();
+    bytes_ = rewrite_base_bytes_ = size;
+    ++rewrites_;
+}
+
+uint64_t OpLog::size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+FsyncPolicy OpLog::policy() const {
+    return policy_;
+}
+
+OpLogReplayResult OpLog::replay(Cache& cache, const std::string& path, size_t threads) {
+    MappedFile file(path);
+    const char* data = file.data();
+    const size_t size = file.size();
+    if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+        get_le<uint32_t>(data + 8) != kVersion) {
+        throw std::runtime_error("oplog: " + path + " is not an operation log");
+    }
+
+    if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, cache.shard_count());
+    std::vector<std::unique_ptr<ReplayWorker>> workers;
+    if (threads > 1) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.push_back(std::make_unique<ReplayWorker>(cache));
+        }
+    }
+    std::vector<std::vector<ReplayOp>> batches(std::max<size_t>(threads, 1));
+
+    const int64_t now_ms = wall_clock_ms();
+    OpLogReplayResult result;
+    size_t pos = kHeaderSize;
+    while (size - pos >= kRecordHeaderSize) {
+        const char* h = data + pos;
+        const size_t key_len = get_le<uint32_t>(h + 5);
+        const size_t value_len = get_le<uint32_t>(h + 9);
+        const size_t length = kRecordHeaderSize + key_len + value_len;
+        const uint8_t op = static_cast<uint8_t>(h[4]);
+        if (size - pos < length || (op != kOpPut && op != kOpErase) ||
+            get_le<uint32_t>(h) != checksum(h + 4, length - 4)) {
+            break;   // Torn write or corruption: everything after it is dropped
+        }
+        const int64_t expiry = get_le<int64_t>(h + 13);
+        pos += length;
+
+        // An expired put ends the key's life just like an erase
+        ReplayOp rop{op == kOpErase || (expiry != 0 && expiry <= now_ms),
+                     std::string_view(h + kRecordHeaderSize, key_len),
+                     std::string_view(h + kRecordHeaderSize + key_len, value_len),
+                     expiry == 0 ? 0 : static_cast<uint64_t>(expiry - now_ms)};
+        if (rop.erase) ++result.erases;
+        else ++result.puts;
+
+        const size_t worker = workers.empty() ? 0 : cache.shard_of(rop.key) % workers.size();
+        batches[worker].push_back(rop);
+        if (batches[worker].size() == kReplayBatch) {
+            if (workers.empty()) apply_ops(cache, batches[worker]);
+            else workers[worker]->push(std::move(batches[worker]));
+            batches[worker] = {};
+            batches[worker].reserve(kReplayBatch);
+        }
+    }
+
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (workers.empty()) apply_ops(cache, batches[i]);
+        else workers[i]->push(std::move(batches[i]));
+    }
+    for (auto& worker : workers) {
+        worker->finish();
+    }
+
+    result.valid_bytes = pos;
+    result.truncated_bytes = size - pos;
+    return result;
+}
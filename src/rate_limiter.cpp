@@ -0,0 +1,51 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <functional>
+
+RateLimiter::RateLimiter(double rate, double burst) : rate_(rate), burst_(std::max(burst, 1.0)) {}
+
+bool RateLimiter::allow(const std::string& client, Clock::time_point now) {
+    Stripe& stripe = stripes_[std::hash<std::string>{}(client) % kStripes];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+
+    auto it = stripe.buckets.find(client);
+    if (it == stripe.buckets.end()) {
+        if (stripe.buckets.size() >= kSweepAbove) {
+            sweep(stripe, now);
+        }
+        it = stripe.buckets.emplace(client, Bucket{burst_, now}).first;
+    }
+
+    Bucket& bucket = it->second;
+    const double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+    if (elapsed > 0) {
+        bucket.tokens = std::min(burst_, bucket.tokens + elapsed * rate_);
+        bucket.updated = now;
+    }
+    if (bucket.tokens < 1.0) {
+        refused_.inc();
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+size_t RateLimiter::clients() const {
+    size_t total = 0;
+    for (const auto& stripe : stripes_) {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        total += stripe.buckets.size();
+    }
+    return total;
+}
+
+void RateLimiter::sweep(Stripe& stripe, Clock::time_point now) {
+    for (auto it = stripe.buckets.begin(); it != stripe.buckets.end();) {
+        const double elapsed = std::chrono::duration<double>(now - it->second.updated).count();
+        if (it->second.tokens + elapsed * rate_ >= burst_) {
+            it = stripe.buckets.erase(it);   // Same as a new bucket
+        } else {
+            ++it;
+        }
+    }
+}
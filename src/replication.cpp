@@ -1,33 +1,45 @@
 #include "replication.h"
+#include "logger.h"
+#include "ndjson.h"
+#include "router.h"
 #include "httplib.h"
-#include <iostream>
+#include <nlohmann/json.hpp>
 
 ReplicationManager::ReplicationManager() = default;
 
 void ReplicationManager::addFollower(const std::string& address){
     followers_.push_back(address);
-    std::cerr << "Added follower: " << address << std::endl;
+    Logger::global().log(LogLevel::Info, "Added follower: ", address);
 }
 
-void ReplicationManager::replicatePut(const std::string& key, const std::string& value, uint64_t ttl){
+void ReplicationManager::replicatePut(const std::string& key, const std::string& value, uint64_t ttl, bool raw,
+                                      uint32_t flags){
+    // Raw values may be any bytes, which JSON cannot carry: they go as they are
+    std::string path = "/cache/" + encode_key(key) + (raw ? "?ttl=" + std::to_string(ttl) : "");
+    if (raw && flags != 0) {
+        path += "&flags=" + std::to_string(flags);
+    }
+    const std::string body = raw ? value
+        : nlohmann::json{{"value", value}, {"ttl", ttl}}.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    const char* content_type = raw ? "application/octet-stream" : "application/json";
+
     for(const auto& follower: followers_){
         try {
             httplib::Client cli(follower.c_str());
             cli.set_read_timeout(2, 0); // 2 seconds timeout
             cli.set_write_timeout(2, 0);
 
-            std::string body = "{\"value\":\"" + value + "\", \"ttl\":" + std::to_string(ttl) + "}";
-            auto res = cli.Put(("/cache/" + key).c_str(), body, "application/json");
+            auto res = cli.Put(path.c_str(), body, content_type);
 
             if(res && res->status == 200){
-                std::cerr << "Replicated PUT " << key << " -> " << follower << std::endl; 
+                Logger::global().log(LogLevel::Info, "Replicated PUT ", key, " -> ", follower);
             }
             else {
-                std::cerr << "Failed PUT replication to " << follower << std::endl;
+                Logger::global().log(LogLevel::Warn, "Failed PUT replication to ", follower);
             }
         }
         catch(...){
-            std::cerr << "Exception during PUT replication to " << follower << std::endl;
+            Logger::global().log(LogLevel::Warn, "Exception during PUT replication to ", follower);
         }
     }
 }
@@ -39,16 +51,65 @@ void ReplicationManager::replicateDelete(const std::string& key){
             cli.set_read_timeout(2, 0); // 2 seconds timeout
             cli.set_write_timeout(2, 0);
 
-            auto res = cli.Delete(("/cache/" + key).c_str());
+            auto res = cli.Delete(("/cache/" + encode_key(key)).c_str());
+            if(res && res->status == 200){
+                Logger::global().log(LogLevel::Info, "Replicated DELETE ", key, " -> ", follower);
+            }
+            else {
+                Logger::global().log(LogLevel::Warn, "Failed DELETE replication to ", follower);
+            }
+        }
+        catch(...){
+            Logger::global().log(LogLevel::Warn, "Exception during DELETE replication to ", follower);
+        }
+    }
+}
+
+void ReplicationManager::replicatePutBatch(const std::vector<CacheItem>& items, bool raw){
+    if(items.empty() || followers_.empty()){
+        return;
+    }
+    if(raw){
+        // Imported records may hold any bytes, which a JSON dump would throw on
+        std::string body;
+        for(const auto& item: items){
+            append_ndjson_record(body, item.key, item.value, item.ttl_ms);
+        }
+        postToFollowers("/cache/_import", body, items.size(), "application/x-ndjson");
+        return;
+    }
+    nlohmann::json list = nlohmann::json::array();
+    for(const auto& item: items){
+        list.push_back({{"key", item.key}, {"value", item.value}, {"ttl", item.ttl_ms}});
+    }
+    postToFollowers("/cache/_mset", nlohmann::json{{"items", std::move(list)}}.dump(), items.size());
+}
+
+void ReplicationManager::replicateDeleteBatch(const std::vector<std::string>& keys){
+    if(keys.empty() || followers_.empty()){
+        return;
+    }
+    postToFollowers("/cache/_mdelete", nlohmann::json{{"keys", keys}}.dump(), keys.size());
+}
+
+void ReplicationManager::postToFollowers(const std::string& path, const std::string& body, size_t count,
+                                         const char* content_type){
+    for(const auto& follower: followers_){
+        try{
+            httplib::Client cli(follower.c_str());
+            cli.set_read_timeout(2, 0); // 2 seconds timeout
+            cli.set_write_timeout(2, 0);
+
+            auto res = cli.Post(path.c_str(), body, content_type);
             if(res && res->status == 200){
-                std::cerr << "Replicated DELETE " << key << " -> " << follower << std::endl;
+                Logger::global().log(LogLevel::Info, "Replicated ", path, " (", count, " keys) -> ", follower);
             }
             else {
-                std::cerr << "Failed DELETE replication to " << follower << std::endl;
+                Logger::global().log(LogLevel::Warn, "Failed ", path, " replication to ", follower);
             }
         }
         catch(...){
-            std::cerr << "Exception during DELETE replication to " << follower << std::endl;
+            Logger::global().log(LogLevel::Warn, "Exception during ", path, " replication to ", follower);
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,57 @@
+#include "router.h"
+
+namespace {
+constexpr std::string_view kCachePrefix = "/cache/";
+
+bool unreserved(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '.' || c == '_' || c == '~';
+}
+} // namespace
+
+RouteMatch match_route(std::string_view method, std::string_view path) {
+    const bool read = method == "GET" || method == "HEAD";
+
+    if (path.size() > kCachePrefix.size() && path.compare(0, kCachePrefix.size(), kCachePrefix) == 0) {
+        const std::string_view rest = path.substr(kCachePrefix.size());
+        if (method == "POST") {
+            // Batch endpoints only exist for POST, so GET /cache/_mget is still a key
+            if (rest == "_mget") return {Route::MultiGet, {}};
+            if (rest == "_mset") return {Route::MultiSet, {}};
+            if (rest == "_mdelete") return {Route::MultiDelete, {}};
+            if (rest == "_import") return {Route::Import, {}};
+            return {};
+        }
+        if (read && rest == "_export") {
+            return {Route::Export, {}};   // Shadows the key "_export" for reads
+        }
+        if (read || method == "PUT" || method == "DELETE") {
+            return {Route::CacheKey, rest};
+        }
+        return {};
+    }
+
+    if (read) {
+        if (path == "/metrics") return {Route::Metrics, {}};
+        if (path == "/healthz") return {Route::Health, {}};
+        if (path == "/debug/hot_keys") return {Route::HotKeys, {}};
+    }
+    return {};
+}
+
+std::string encode_key(std::string_view key) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(key.size());
+    for (char c : key) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (unreserved(byte)) {
+            out.push_back(c);
+        } else {
+            out.push_back('%');
+            out.push_back(kHex[byte >> 4]);
+            out.push_back(kHex[byte & 0xF]);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,194 @@
+#include "slab_allocator.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+
+namespace {
+
+/// Size of the class after `size`: geometric growth rounded to 8 bytes.
+size_t next_chunk_size(size_t size) {
+    size_t next = static_cast<size_t>(static_cast<double>(size) * SlabAllocator::kGrowthFactor);
+    return std::max(size + 8, (next + 7) & ~size_t{7});
+}
+
+/// Number of size classes an allocator with pages of `page_size` bytes has.
+size_t class_count(size_t page_size) {
+    const size_t largest = page_size / SlabAllocator::kChunksPerPage;
+    size_t count = 1;
+    for (size_t size = SlabAllocator::kMinChunkSize; size < largest; size = next_chunk_size(size)) {
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+SlabAllocator::SlabAllocator(size_t page_size)
+    : page_size_(std::max(page_size, kMinChunkSize * kChunksPerPage)) {
+    // Geometric chunk sizes rounded to 8 bytes, capped so a page holds kChunksPerPage
+    const size_t largest = page_size_ / kChunksPerPage;
+    for (size_t size = kMinChunkSize; size < largest; size = next_chunk_size(size)) {
+        SizeClass cls;
+        cls.chunk_size = size;
+        classes_.push_back(cls);
+    }
+    SizeClass last;
+    last.chunk_size = largest;
+    classes_.push_back(last);
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (auto& [base, page] : pages_) {
+        ::operator delete(page.base);
+    }
+}
+
+size_t SlabAllocator::page_size_for(size_t budget) {
+    size_t page_size = kDefaultPageSize;
+    while (page_size > kMinPageSize && 2 * class_count(page_size) * page_size > budget / 8) {
+        page_size /= 2;
+    }
+    return page_size;
+}
+
+size_t SlabAllocator::class_index(size_t size) const {
+    auto it = std::lower_bound(classes_.begin(), classes_.end(), size,
+        [](const SizeClass& cls, size_t wanted) { return cls.chunk_size < wanted; });
+    return static_cast<size_t>(it - classes_.begin());
+}
+
+void SlabAllocator::push_front(SizeClass& cls, Page* page) {
+    page->prev = nullptr;
+    page->next = cls.with_room;
+    (cls.with_room ? cls.with_room->prev : cls.with_room_tail) = page;
+    cls.with_room = page;
+}
+
+void SlabAllocator::push_back(SizeClass& cls, Page* page) {
+    page->next = nullptr;
+    page->prev = cls.with_room_tail;
+    (cls.with_room_tail ? cls.with_room_tail->next : cls.with_room) = page;
+    cls.with_room_tail = page;
+}
+
+void SlabAllocator::unlink(SizeClass& cls, Page* page) {
+    (page->prev ? page->prev->next : cls.with_room) = page->next;
+    (page->next ? page->next->prev : cls.with_room_tail) = page->prev;
+    page->prev = page->next = nullptr;
+}
+
+SlabAllocator::Page* SlabAllocator::grow(size_t idx) {
+    SizeClass& cls = classes_[idx];
+    char* base = static_cast<char*>(::operator new(page_size_));
+    Page& page = pages_[base];
+    page.base = base;
+    page.cls = idx;
+    page.cursor = base;
+    page.end = base + (page_size_ / cls.chunk_size) * cls.chunk_size;
+    cls.pages++;
+    cls.empty_pages++;
+    push_back(cls, &page);
+    return &page;
+}
+
+void SlabAllocator::release(Page* page) {
+    SizeClass& cls = classes_[page->cls];
+    unlink(cls, page);
+    cls.pages--;
+    cls.empty_pages--;
+    char* base = page->base;
+    pages_.erase(base);
+    ::operator delete(base);
+}
+
+char* SlabAllocator::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    size_t idx = class_index(size);
+    if (idx == classes_.size()) {
+        large_chunks_++;
+        large_bytes_ += size;
+        return static_cast<char*>(::operator new(size));
+    }
+
+    SizeClass& cls = classes_[idx];
+    // Partly used pages come first, so the spare is only touched once they are full
+    Page* page = cls.with_room ? cls.with_room : grow(idx);
+    char* chunk;
+    if (page->free_list) {
+        chunk = reinterpret_cast<char*>(page->free_list);
+        page->free_list = page->free_list->next;
+    } else {
+        chunk = page->cursor;
+        page->cursor += cls.chunk_size;
+    }
+    if (page->used++ == 0) {
+        cls.empty_pages--;
+    }
+    if (!page->has_room()) {
+        unlink(cls, page);
+    }
+    cls.chunks_used++;
+    return chunk;
+}
+
+void SlabAllocator::deallocate(char* chunk, size_t size) {
+    if (chunk == nullptr) {
+        return;
+    }
+
+    size_t idx = class_index(size);
+    if (idx == classes_.size()) {
+        large_chunks_--;
+        large_bytes_ -= size;
+        ::operator delete(chunk);
+        return;
+    }
+
+    SizeClass& cls = classes_[idx];
+    Page* page = &std::prev(pages_.upper_bound(chunk))->second;
+    const bool was_full = !page->has_room();
+    auto* free_chunk = reinterpret_cast<FreeChunk*>(chunk);
+    free_chunk->next = page->free_list;
+    page->free_list = free_chunk;
+    cls.chunks_used--;
+
+    if (--page->used > 0) {
+        if (was_full) {
+            push_front(cls, page);
+        }
+        return;
+    }
+    if (!was_full) {
+        unlink(cls, page);
+    }
+    push_back(cls, page);
+    cls.empty_pages++;
+    if (cls.empty_pages > 1) {
+        release(page);
+    }
+}
+
+size_t SlabAllocator::chunk_size(size_t size) const {
+    if (size == 0) {
+        return 0;
+    }
+    size_t idx = class_index(size);
+    return idx == classes_.size() ? size : classes_[idx].chunk_size;
+}
+
+std::vector<SlabAllocator::ClassStats> SlabAllocator::stats() const {
+    std::vector<ClassStats> result;
+    result.reserve(classes_.size() + 1);
+    for (const auto& cls : classes_) {
+        result.push_back({cls.chunk_size, cls.chunks_used, cls.chunks_used * cls.chunk_size, cls.pages});
+    }
+    result.push_back({0, large_chunks_, large_bytes_, 0});
+    return result;
+}
+
+size_t SlabAllocator::reserved_bytes() const {
+    return pages_.size() * page_size_ + large_bytes_;
+}
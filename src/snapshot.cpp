@@ -0,0 +1,217 @@
+#include "snapshot.h"
+#include "binary_io.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char kMagic[8] = {'D', 'C', 'P', 'P', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 8 + 4 + 4 + 8 + 8;
+constexpr size_t kEntryHeaderSize = 4 + 4 + 8;
+constexpr size_t kEntryCountOffset = 8 + 4 + 4 + 8;
+constexpr size_t kLoadBatch = 4096;              // Entries per multi_put()
+constexpr size_t kWriteBuffer = 1 << 20;
+
+// ---------------- Writing ----------------
+
+class SnapshotFile {
+public:
+    explicit SnapshotFile(const std::string& path) : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("snapshot: cannot open " + path);
+        }
+        std::setvbuf(file_, nullptr, _IOFBF, kWriteBuffer);
+    }
+
+    ~SnapshotFile() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+            std::remove(path_.c_str());   // Abandoned (an exception is on its way)
+        }
+    }
+
+    void write(const void* data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+            throw std::runtime_error("snapshot: write to " + path_ + " failed");
+        }
+    }
+
+    void patch(long offset, const void* data, size_t size) {
+        if (std::fseek(file_, offset, SEEK_SET) != 0) {
+            throw std::runtime_error("snapshot: seek in " + path_ + " failed");
+        }
+        write(data, size);
+    }
+
+    /// Flush to stable storage and close.
+    void commit() {
+        bool ok = std::fflush(file_) == 0;
+#ifndef _WIN32
+        ok = ok && ::fsync(::fileno(file_)) == 0;
+#endif
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        if (!ok) {
+            std::remove(path_.c_str());
+            throw std::runtime_error("snapshot: flushing " + path_ + " failed");
+        }
+    }
+
+private:
+    std::string path_;
+    std::FILE* file_;
+};
+
+} // namespace
+
+size_t save_snapshot(const Cache& cache, const std::string& path) {
+    const std::string tmp_path = path + ".tmp";
+    SnapshotFile file(tmp_path);
+
+    char header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    put_le<uint32_t>(header + 8, kVersion);
+    put_le<int64_t>(header + 16, wall_clock_ms());
+    file.write(header, sizeof(header));
+
+    uint64_t written = 0;
+    for (size_t shard = 0; shard < cache.shard_count(); ++shard) {
+        // The shard lock is only held inside export_shard(); writing happens unlocked
+        for (const CacheRecord& record : cache.export_shard(shard)) {
+            char entry[kEntryHeaderSize];
+            put_le<uint32_t>(entry, static_cast<uint32_t>(record.key.size()));
+            put_le<uint32_t>(entry + 4, static_cast<uint32_t>(record.value.size()));
+            put_le<uint64_t>(entry + 8, record.ttl_ms);
+            file.write(entry, sizeof(entry));
+            file.write(record.key.data(), record.key.size());
+            file.write(record.value.data(), record.value.size());
+            ++written;
+        }
+    }
+
+    char count[8];
+    put_le<uint64_t>(count, written);
+    file.patch(static_cast<long>(kEntryCountOffset), count, sizeof(count));
+    file.commit();
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+#ifdef _WIN32
+        // rename() does not replace an existing file on Windows
+        std::remove(path.c_str());
+        if (std::rename(tmp_path.c_str(), path.c_str()) == 0) {
+            return static_cast<size_t>(written);
+        }
+#endif
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("snapshot: cannot replace " + path);
+    }
+    return static_cast<size_t>(written);
+}
+
+SnapshotLoadResult load_snapshot(Cache& cache, const std::string& path) {
+    MappedFile file(path);
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("snapshot: " + path + " is not a snapshot");
+    }
+    if (get_le<uint32_t>(data + 8) != kVersion) {
+        throw std::runtime_error("snapshot: " + path + " has an unsupported version");
+    }
+    // Time the process was down counts against every TTL
+    const int64_t age = wall_clock_ms() - get_le<int64_t>(data + 16);
+    const uint64_t elapsed_ms = age > 0 ? static_cast<uint64_t>(age) : 0;
+    const uint64_t count = get_le<uint64_t>(data + kEntryCountOffset);
+
+    SnapshotLoadResult result;
+    std::vector<CacheItem> batch;
+    batch.reserve(kLoadBatch);
+    size_t pos = kHeaderSize;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (size - pos < kEntryHeaderSize) {
+            throw std::runtime_error("snapshot: " + path + " is truncated");
+        }
+        const size_t key_len = get_le<uint32_t>(data + pos);
+        const size_t value_len = get_le<uint32_t>(data + pos + 4);
+        const uint64_t ttl_ms = get_le<uint64_t>(data + pos + 8);
+        pos += kEntryHeaderSize;
+        if (size - pos < key_len + value_len) {
+            throw std::runtime_error("snapshot: " + path + " is truncated");
+        }
+
+        // Views point into the mapping; multi_put() copies them into the cache
+        std::string_view key(data + pos, key_len);
+        std::string_view value(data + pos + key_len, value_len);
+        pos += key_len + value_len;
+
+        if (ttl_ms != 0 && ttl_ms <= elapsed_ms) {
+            ++result.expired;
+            continue;
+        }
+        batch.push_back({key, value, ttl_ms == 0 ? 0 : ttl_ms - elapsed_ms});
+        if (batch.size() == kLoadBatch) {
+            cache.multi_put(batch);
+            result.loaded += batch.size();
+            batch.clear();
+        }
+    }
+    cache.multi_put(batch);
+    result.loaded += batch.size();
+
+    if (pos != size) {
+        throw std::runtime_error("snapshot: " + path + " has trailing bytes");
+    }
+    return result;
+}
+
+// ---------------- SnapshotScheduler ----------------
+
+SnapshotScheduler::SnapshotScheduler(std::shared_ptr<Cache> cache, std::string path, uint64_t interval_ms)
+    : cache_(std::move(cache)), path_(std::move(path)), interval_ms_(interval_ms) {}
+
+SnapshotScheduler::~SnapshotScheduler() {
+    stop();
+}
+
+void SnapshotScheduler::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread([this] { loop(); });
+}
+
+void SnapshotScheduler::stop() {
+    if (!running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);   // Pairs with the wait so the wakeup is not lost
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void SnapshotScheduler::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_.load()) {
+        if (cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return !running_.load(); })) {
+            break;
+        }
+        lock.unlock();
+        try {
+            auto start = std::chrono::steady_clock::now();
+            size_t entries = save_snapshot(*cache_, path_);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cerr << "[Snapshot] Saved " << entries << " entries to " << path_ << " in " << ms << " ms" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[Snapshot] " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
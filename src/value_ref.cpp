@@ -0,0 +1,61 @@
+#include "value_ref.h"
+#include <cstring>
+#include <new>
+
+ValueArena* ValueArena::create(size_t page_size) {
+    return new ValueArena(page_size);
+}
+
+void ValueArena::release_owner() {
+    unref();
+}
+
+void ValueArena::unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+ValueRef ValueArena::store(std::string_view bytes, bool compressed, uint32_t flags) {
+    if (bytes.empty() && flags == 0) {
+        return ValueRef();
+    }
+
+    const size_t total = sizeof(ValueBlock) + bytes.size();
+    char* chunk;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunk = slab_.allocate(total);
+    }
+    refs_.fetch_add(1, std::memory_order_relaxed);
+
+    auto* block = new (chunk) ValueBlock();
+    block->compressed = compressed;
+    block->flags = flags;
+    block->size = bytes.size();
+    block->arena = this;
+    if (!bytes.empty()) {
+        std::memcpy(block->data(), bytes.data(), bytes.size());
+    }
+    return ValueRef(block);
+}
+
+void ValueArena::free(ValueBlock* block) {
+    const size_t total = sizeof(ValueBlock) + block->size;
+    block->~ValueBlock();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slab_.deallocate(reinterpret_cast<char*>(block), total);
+    }
+    unref();
+}
+
+size_t ValueArena::chunk_size(size_t value_size) const {
+    // The class layout never changes after construction, so no lock is needed
+    return value_size == 0 ? 0 : slab_.chunk_size(sizeof(ValueBlock) + value_size);
+}
+
+std::vector<SlabAllocator::ClassStats> ValueArena::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slab_.stats();
+}
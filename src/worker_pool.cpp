@@ -0,0 +1,74 @@
+#include "worker_pool.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+thread_local WorkerPool::Clock::duration current_wait{0};
+}
+
+WorkerPool::WorkerPool(size_t threads, size_t max_queued, Histogram* wait)
+    : max_queued_(max_queued), wait_(wait) {
+    threads = std::max<size_t>(threads, 1);
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+bool WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || (max_queued_ > 0 && tasks_.size() >= max_queued_)) {
+            return false;
+        }
+        tasks_.push_back({std::move(task), Clock::now()});
+    }
+    ready_.notify_one();
+    return true;
+}
+
+void WorkerPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    std::lock_guard<std::mutex> lock(join_mutex_);   // httplib and the destructor may both get here
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+size_t WorkerPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+WorkerPool::Clock::duration WorkerPool::take_queue_wait() {
+    return std::exchange(current_wait, Clock::duration{0});
+}
+
+void WorkerPool::work() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;   // Stopping, and everything queued has run
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        current_wait = Clock::now() - task.queued_at;
+        if (wait_) {
+            wait_->observe(std::chrono::duration<double>(current_wait).count());
+        }
+        task.run();
+        current_wait = Clock::duration{0};
+    }
+}
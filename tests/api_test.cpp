@@ -1,9 +1,13 @@
 #include <gtest/gtest.h>
 #include <thread>
+#include <atomic>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include "../include/cache.h"
 #include "../include/api.h"
+#include "../include/router.h"
+#include "../include/ndjson.h"
 #include <httplib.h>
 
 using json = nlohmann::json;
@@ -57,6 +61,10 @@ TEST(ApiTest, BasicCRUD){
     ASSERT_TRUE(metrics_res != nullptr);
     EXPECT_EQ(metrics_res->status, 200);
     EXPECT_NE(metrics_res->body.find("cache_hits_total"), std::string::npos);
+    EXPECT_NE(metrics_res->body.find("cache_evictions_total"), std::string::npos);
+    EXPECT_NE(metrics_res->body.find(
+                  R"(cache_request_duration_seconds_bucket{method="PUT",route="/cache/<key>",le="0.0001"})"),
+              std::string::npos);
 
     // Clean shutdown
     api.stop();
@@ -79,6 +87,113 @@ TEST(ApiTest, InvalidPut) {
     server_thread.join();
 }
 
+TEST(ApiTest, GetStreamsLargeAndEscapedValues) {
+    auto cache = std::make_shared<Cache>(10);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5003); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Larger than one streamed slice, with escapes on both sides of a slice boundary
+    std::string big(200 * 1024, 'x');
+    big[10] = '"';
+    big[64 * 1024] = '\n';
+    big[150 * 1024] = '\\';
+    cache->put("big", big);
+    cache->put("quoted", "say \"hi\"\tnow\x01");
+    cache->put("empty", "");
+
+    httplib::Client cli("127.0.0.1", 5003);
+    for (const auto& [key, expected] : {std::pair<std::string, std::string>{"big", big},
+                                        {"quoted", "say \"hi\"\tnow\x01"},
+                                        {"empty", ""}}) {
+        auto res = cli.Get("/cache/" + key);
+        ASSERT_TRUE(res != nullptr);
+        EXPECT_EQ(res->status, 200);
+        EXPECT_EQ(res->get_header_value("Content-Type"), "application/json");
+        EXPECT_EQ(res->body, json({{"value", expected}}).dump());
+    }
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, RangeRequestsOnStreamedValues) {
+    auto cache = std::make_shared<Cache>(10);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5015); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Escapes in the first slice shift every later slice in the output
+    std::string big(200 * 1024, 'x');
+    for (size_t i = 0; i < 1000; i++) big[i * 7] = '"';
+    big[64 * 1024] = '\n';
+    big[150 * 1024] = '\\';
+    cache->put("big", big);
+    const std::string full = json({{"value", big}}).dump();
+
+    httplib::Client cli("127.0.0.1", 5015);
+    auto res = cli.Get("/cache/big");
+    ASSERT_TRUE(res != nullptr);
+    ASSERT_EQ(res->body, full);
+
+    // Ranges inside the prefix, starting mid-escape, across slice boundaries, and the tail
+    for (const auto& [first, last] : {std::pair<size_t, size_t>{0, 4},
+                                      {11, 12},
+                                      {5000, 70000},
+                                      {64 * 1024 + 900, 64 * 1024 + 1100},
+                                      {100000, full.size() - 1},
+                                      {full.size() - 1, full.size() - 1}}) {
+        res = cli.Get("/cache/big", {httplib::make_range_header({{first, last}})});
+        ASSERT_TRUE(res != nullptr);
+        EXPECT_EQ(res->status, 206);
+        EXPECT_EQ(res->body, full.substr(first, last - first + 1)) << first << "-" << last;
+    }
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, BulkGetSetAndDelete) {
+    auto cache = std::make_shared<Cache>(100, 100, 4);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5004); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    httplib::Client cli("127.0.0.1", 5004);
+    json items = json::array({{{"key", "a"}, {"value", "Apple"}},
+                              {{"key", "b"}, {"value", "say \"hi\""}, {"ttl", 60000}},
+                              {{"key", "c"}, {"value", "Cherry"}}});
+    auto res = cli.Post("/cache/_mset", json({{"items", items}}).dump(), "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(json::parse(res->body)["count"], 3);
+    EXPECT_EQ(cache->get("b").value(), "say \"hi\"");
+
+    res = cli.Post("/cache/_mget", R"({"keys": ["c", "missing", "b"]})", "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(json::parse(res->body), json({{"values", {"Cherry", nullptr, "say \"hi\""}}}));
+
+    res = cli.Post("/cache/_mdelete", R"({"keys": ["a", "c", "missing"]})", "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(json::parse(res->body)["deleted"], 2);
+    EXPECT_EQ(cache->size(), 1);
+
+    // A malformed item rejects the whole batch
+    res = cli.Post("/cache/_mset", R"({"items": [{"key": "d", "value": "Date"}, {"key": "e"}]})",
+                   "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 400);
+    EXPECT_FALSE(cache->contains("d"));
+
+    res = cli.Post("/cache/_mget", R"({"keys": "a"})", "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 400);
+
+    api.stop();
+    server_thread.join();
+}
+
 TEST(ApiTest, HealthzEndpointRespondsOk) {
     // Setup cache + API
     auto cache = std::make_shared<Cache>(10, 1000);
@@ -106,4 +221,342 @@ TEST(ApiTest, HealthzEndpointRespondsOk) {
     // Shutdown
     api.stop();
     if (server_thread.joinable()) server_thread.join();
-}
\ No newline at end of file
+}
+TEST(ApiTest, HotKeysAreReported) {
+    CacheOptions options;
+    options.capacity = 100;
+    options.hot_keys = 4;
+    auto cache = std::make_shared<Cache>(options);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5005); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    cache->put("flag", "on");
+    for (int i = 0; i < 200000 && cache->hot_keys().empty(); ++i) {
+        cache->get_ref("flag");
+    }
+
+    httplib::Client cli("127.0.0.1", 5005);
+    auto res = cli.Get("/debug/hot_keys");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    auto body = json::parse(res->body);
+    EXPECT_EQ(body["capacity"], 4);
+    ASSERT_EQ(body["hot_keys"].size(), 1);
+    EXPECT_EQ(body["hot_keys"][0]["key"], "flag");
+    EXPECT_GT(body["near_cache"]["hits"].get<uint64_t>(), 0);
+
+    auto metrics_res = cli.Get("/metrics");
+    ASSERT_TRUE(metrics_res != nullptr);
+    EXPECT_NE(metrics_res->body.find("cache_near_cache_hit_ratio"), std::string::npos);
+    EXPECT_NE(metrics_res->body.find(R"(cache_hot_key_sampled_reads{key="flag"})"), std::string::npos);
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, KeysMayHoldAnyByte) {
+    auto cache = std::make_shared<Cache>(100);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5008); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    httplib::Client cli("127.0.0.1", 5008);
+
+    for (const std::string& key : std::vector<std::string>{"user:42/profile", "a.b-c", "with space?#", "100%",
+                                                           std::string("nul\0byte", 8)}) {
+        const std::string path = "/cache/" + encode_key(key);
+        auto res = cli.Put(path, R"({"value":"v"})", "application/json");
+        ASSERT_TRUE(res != nullptr);
+        EXPECT_EQ(res->status, 200) << path;
+        EXPECT_EQ(cache->get(key).value_or(""), "v") << path;
+
+        res = cli.Get(path);
+        ASSERT_TRUE(res != nullptr);
+        EXPECT_EQ(res->status, 200) << path;
+        res = cli.Delete(path);
+        ASSERT_TRUE(res != nullptr);
+        EXPECT_EQ(res->status, 200) << path;
+        EXPECT_FALSE(cache->contains(key));
+    }
+
+    // '/' may also be sent unencoded
+    cache->put("dir/file", "x");
+    auto res = cli.Get("/cache/dir/file");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+
+    // Batch names are only reserved for POST
+    cache->put("_mget", "plain key");
+    res = cli.Get("/cache/_mget");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    res = cli.Get("/cache/");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 404);
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, RawOctetStreamValues) {
+    auto cache = std::make_shared<Cache>(100, 20);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5009); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    httplib::Client cli("127.0.0.1", 5009);
+
+    std::string binary(70000, '\0');
+    for (size_t i = 0; i < binary.size(); ++i) binary[i] = static_cast<char>(i * 31);
+    auto res = cli.Put("/cache/blob", binary, "application/octet-stream");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(cache->get("blob").value(), binary);   // Stored as sent
+
+    res = cli.Get("/cache/blob", {{"Accept", "application/octet-stream"}});
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(res->get_header_value("Content-Type"), "application/octet-stream");
+    EXPECT_EQ(res->body, binary);
+
+    // JSON stays the default, for both directions
+    cache->put("text", "plain");
+    res = cli.Get("/cache/text");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(json::parse(res->body)["value"], "plain");
+
+    // TTL from the query string or the X-TTL header, in ms
+    res = cli.Put("/cache/short?ttl=50", "a", "application/octet-stream");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    res = cli.Put("/cache/header", {{"X-TTL", "50"}}, "b", "application/octet-stream");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_TRUE(cache->contains("short"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_FALSE(cache->get("short").has_value());
+    EXPECT_FALSE(cache->get("header").has_value());
+
+    res = cli.Put("/cache/bad?ttl=soon", "c", "application/octet-stream");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 400);
+    EXPECT_FALSE(cache->contains("bad"));
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, ReadThroughFetchesMissesFromOrigin) {
+    // Stand-in origin: GET /values/<key> -> "origin-<key>" after a slow lookup, 404 for "missing"
+    std::atomic<int> fetches{0};
+    httplib::Server origin;
+    origin.Get(R"(/values/(\w+))", [&fetches](const httplib::Request& req, httplib::Response& res) {
+        fetches.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const std::string key = req.matches[1];
+        if (key == "missing") {
+            res.status = 404;
+            return;
+        }
+        res.set_content("origin-" + key, "application/octet-stream");
+    });
+    std::thread origin_thread([&origin]() { origin.listen("127.0.0.1", 5006); });
+
+    auto cache = std::make_shared<Cache>(100);
+    CacheAPI api(cache);
+    api.set_origin("http://127.0.0.1:5006/values/", 60000);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5007); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    httplib::Client cli("127.0.0.1", 5007);
+    auto res = cli.Get("/cache/alpha");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(json::parse(res->body)["value"], "origin-alpha");
+    res = cli.Get("/cache/alpha");   // Served from the cache now
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(fetches.load(), 1);
+
+    res = cli.Get("/cache/missing");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 404);
+    EXPECT_EQ(fetches.load(), 2);
+
+    // Concurrent misses of one key: a single fetch
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 6; ++i) {
+        clients.emplace_back([]() {
+            httplib::Client c("127.0.0.1", 5007);
+            auto r = c.Get("/cache/beta");
+            ASSERT_TRUE(r != nullptr);
+            EXPECT_EQ(r->status, 200);
+        });
+    }
+    for (auto& c : clients) c.join();
+    EXPECT_EQ(fetches.load(), 3);
+
+    auto metrics_res = cli.Get("/metrics");
+    ASSERT_TRUE(metrics_res != nullptr);
+    EXPECT_NE(metrics_res->body.find("cache_origin_loads_total 3"), std::string::npos);
+
+    // Origin down: the miss is reported as a bad gateway
+    origin.stop();
+    origin_thread.join();
+    res = cli.Get("/cache/gamma");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 502);
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, ShedsRequestsThatQueuedPastTheBudget) {
+    auto cache = std::make_shared<Cache>(10);
+    CacheAPI api(cache);
+    ServerOptions options;
+    options.threads = 1;
+    options.queue_budget_ms = 20;
+    options.keep_alive_timeout_s = 1;
+    api.set_server_options(options);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5010); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // A keep-alive connection holds the only worker until it has been idle for a second
+    httplib::Client holder("127.0.0.1", 5010);
+    holder.set_keep_alive(true);
+    auto res = holder.Get("/healthz");
+    ASSERT_TRUE(res != nullptr);
+
+    httplib::Client cli("127.0.0.1", 5010);
+    res = cli.Get("/cache/foo");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 503);
+    EXPECT_EQ(res->get_header_value("Retry-After"), "1");
+
+    auto metrics_res = cli.Get("/metrics");   // Exempt, though it queued too
+    ASSERT_TRUE(metrics_res != nullptr);
+    EXPECT_EQ(metrics_res->status, 200);
+    EXPECT_NE(metrics_res->body.find("cache_http_shed_total 1"), std::string::npos);
+    EXPECT_NE(metrics_res->body.find("cache_http_queue_wait_seconds_count"), std::string::npos);
+    EXPECT_NE(metrics_res->body.find("cache_http_queue_depth"), std::string::npos);
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, RateLimitsEachClient) {
+    auto cache = std::make_shared<Cache>(10);
+    CacheAPI api(cache);
+    ServerOptions options;
+    options.rate_limit = 1;
+    options.rate_limit_burst = 2;
+    api.set_server_options(options);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5011); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    httplib::Client cli("127.0.0.1", 5011);
+    auto res = cli.Put("/cache/foo", R"({"value":"bar"})", "application/json");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    res = cli.Get("/cache/foo");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    res = cli.Get("/cache/foo");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 429);
+    EXPECT_EQ(res->get_header_value("Retry-After"), "1");
+
+    res = cli.Get("/healthz");   // Not limited
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    res = cli.Get("/metrics");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_NE(res->body.find("cache_http_rate_limited_total 1"), std::string::npos);
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, ImportAndExportNdjson) {
+    auto cache = std::make_shared<Cache>(1000, 100, 4);
+    CacheAPI api(cache);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5012); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    httplib::Client cli("127.0.0.1", 5012);
+
+    // Streamed in chunks, as a warm-up script would send it
+    std::string body;
+    for (int i = 0; i < 500; i++) {
+        body += R"({"key":"k)" + std::to_string(i) + R"(","value":"v)" + std::to_string(i) + "\"" +
+                (i % 2 ? R"(,"ttl":60000)" : "") + "}\n";
+    }
+    size_t sent = 0;
+    auto res = cli.Post("/cache/_import",
+        [&body, &sent](size_t, httplib::DataSink& sink) {
+            const size_t n = std::min<size_t>(1000, body.size() - sent);
+            sink.write(body.data() + sent, n);
+            sent += n;
+            if (sent == body.size()) sink.done();
+            return true;
+        }, "application/x-ndjson");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(json::parse(res->body)["imported"], 500);
+    EXPECT_EQ(cache->get("k42").value(), "v42");
+
+    res = cli.Get("/cache/_export");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    size_t lines = 0;
+    for (size_t start = 0; start < res->body.size(); ++lines) {
+        const size_t end = res->body.find('\n', start);
+        json record = json::parse(res->body.substr(start, end - start));
+        const int i = std::stoi(record["key"].get<std::string>().substr(1));
+        EXPECT_EQ(record["value"], "v" + std::to_string(i));
+        if (i % 2) EXPECT_GT(record["ttl"].get<uint64_t>(), 0u);
+        else EXPECT_EQ(record["ttl"], 0);
+        start = end + 1;
+    }
+    EXPECT_EQ(lines, 500u);
+
+    // A bad record stops the import; the records before it are kept
+    httplib::Client bad("127.0.0.1", 5012);
+    res = bad.Post("/cache/_import", "{\"key\":\"x\",\"value\":\"1\"}\n{\"key\":\"y\"}\n", "application/x-ndjson");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 400);
+    EXPECT_EQ(json::parse(res->body)["imported"], 1);
+    EXPECT_NE(json::parse(res->body)["error"].get<std::string>().find("line 2"), std::string::npos);
+    EXPECT_TRUE(cache->contains("x"));
+
+    api.stop();
+    server_thread.join();
+}
+
+TEST(ApiTest, ImportReplicatesBytesThatAreNotUtf8) {
+    auto follower_cache = std::make_shared<Cache>(100, 100);
+    CacheAPI follower(follower_cache);
+    std::thread follower_thread([&follower]() { follower.start("127.0.0.1", 5014); });
+
+    auto cache = std::make_shared<Cache>(100, 100);
+    ReplicationManager repl;
+    repl.addFollower("http://127.0.0.1:5014");
+    CacheAPI api(cache, &repl);
+    std::thread server_thread([&api]() { api.start("127.0.0.1", 5013); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const std::string key("k\xc3", 2);
+    const std::string value("\xff\xfe\x80", 3);
+    std::string body;
+    append_ndjson_record(body, key, value, 0);
+    httplib::Client cli("127.0.0.1", 5013);
+    auto res = cli.Post("/cache/_import", body, "application/x-ndjson");
+    ASSERT_TRUE(res != nullptr);
+    EXPECT_EQ(res->status, 200);
+    EXPECT_EQ(cache->get(key).value_or(""), value);
+    EXPECT_EQ(follower_cache->get(key).value_or(""), value);
+
+    api.stop();
+    server_thread.join();
+    follower.stop();
+    follower_thread.join();
+}
@@ -1,10 +1,26 @@
 #include "cache.h"
 #include <gtest/gtest.h>
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <algorithm>
+#include <future>
+#include <set>
+#include <shared_mutex>
+#include <iostream>
+#include <stdexcept>
 
 using namespace std::chrono_literals;
 
+// Reaches into a cache's shards for tests that need to hold a shard lock
+struct CacheTestAccess {
+    template <typename C>
+    static std::shared_mutex& shard_mutex(C& cache, size_t shard) {
+        return cache.shards_[shard]->mutex;
+    }
+};
+
 TEST(CacheTest, BasicPutGet) {
     Cache cache(3);
     cache.put("A", "Apple");
@@ -92,6 +108,23 @@ TEST(CacheTest, VeryLargeTTL) {
     EXPECT_EQ(cache.get("A").value(), "Apple");
 }
 
+TEST(CacheTest, IncrAndDecrNumericValues) {
+    Cache cache(10);
+    cache.put("Hits", "41", 60000);
+    EXPECT_EQ(cache.incr("Hits", 1).value(), 42);
+    EXPECT_EQ(cache.get("Hits").value(), "42");
+    EXPECT_EQ(cache.decr("Hits", 50).value(), 0);   // Stops at 0
+    cache.put("Max", "18446744073709551615");
+    EXPECT_EQ(cache.incr("Max", 2).value(), 1);     // Wraps at 2^64
+
+    EXPECT_FALSE(cache.incr("Missing", 1).has_value());
+    cache.put("Word", "ten");
+    EXPECT_THROW(cache.incr("Word", 1), std::invalid_argument);
+    cache.put("Empty", "");
+    EXPECT_THROW(cache.decr("Empty", 1), std::invalid_argument);
+    EXPECT_EQ(cache.get("Word").value(), "ten");
+}
+
 TEST(CacheTest, GetFromEmptyCache) {
     Cache cache(3);
     EXPECT_FALSE(cache.get("A").has_value());
@@ -120,6 +153,816 @@ TEST(CacheTest, ConcurrentAccess) {
     SUCCEED(); // If no crash, we're good
 }
 
+TEST(CacheTest, ShardsLockIndependently) {
+    Cache cache(1000, 100, 16);
+    std::string a = "Key0", b;
+    for (int i = 1; b.empty(); i++) {
+        std::string key = "Key" + std::to_string(i);
+        if (cache.shard_of(key) != cache.shard_of(a)) b = key;
+    }
+    cache.put(a, "A");
+    cache.put(b, "B");
+
+    // A writer is inside a's shard: b's shard keeps serving, a's waits
+    std::unique_lock<std::shared_mutex> lock(CacheTestAccess::shard_mutex(cache, cache.shard_of(a)));
+    auto other = std::async(std::launch::async, [&] { cache.put(b, "B2"); return cache.get(b); });
+    ASSERT_EQ(other.wait_for(2s), std::future_status::ready);
+    EXPECT_EQ(other.get().value(), "B2");
+
+    auto same = std::async(std::launch::async, [&] { return cache.get(a); });
+    EXPECT_EQ(same.wait_for(100ms), std::future_status::timeout);
+    lock.unlock();
+    EXPECT_EQ(same.get().value(), "A");
+}
+
+TEST(CacheTest, KeysOfAnyLengthLiveInTheEntry) {
+    Cache cache(10);
+    const std::string long_key(300, 'k');
+    const std::string binary_key("\0\xff key", 6);
+    cache.put("", "Empty");
+    cache.put(long_key, "Long");
+    cache.put(binary_key, "Binary");
+    EXPECT_EQ(cache.get("").value(), "Empty");
+    EXPECT_EQ(cache.get(long_key).value(), "Long");
+    EXPECT_EQ(cache.get(binary_key).value(), "Binary");
+    EXPECT_EQ(cache.keys(), (std::vector<std::string>{binary_key, long_key, ""}));
+
+    // The accounted footprint grows by exactly the extra key bytes
+    Cache sized(10);
+    sized.put("A", "Value");
+    const size_t short_entry = sized.memory_used();
+    sized.put(std::string(101, 'B'), "Value");
+    EXPECT_EQ(sized.memory_used() - short_entry, short_entry + 100);
+}
+
+TEST(CacheTest, KeysFollowRecencyOrder) {
+    Cache cache(4);
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry");
+    cache.get("A");            // Hit relinks A to the MRU end
+    cache.put("B", "Blueberry"); // Update relinks B to the MRU end
+
+    std::vector<std::string> expected{"B", "A", "C"};
+    EXPECT_EQ(cache.keys(), expected);
+    EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(CacheTest, IndexGrowthKeepsAllEntries) {
+    Cache cache(10000);
+    for (int i = 0; i < 5000; i++) {
+        cache.put("Key" + std::to_string(i), "Value" + std::to_string(i));
+    }
+    EXPECT_EQ(cache.size(), 5000);
+    for (int i = 0; i < 5000; i += 97) {
+        auto v = cache.get("Key" + std::to_string(i));
+        ASSERT_TRUE(v.has_value());
+        EXPECT_EQ(*v, "Value" + std::to_string(i));
+    }
+    for (int i = 0; i < 5000; i += 2) {
+        EXPECT_TRUE(cache.erase("Key" + std::to_string(i)));
+    }
+    EXPECT_EQ(cache.size(), 2500);
+    EXPECT_FALSE(cache.contains("Key0"));
+    EXPECT_TRUE(cache.contains("Key1"));
+}
+
+//-------------------Sharded Cache Tests-------------------
+
+TEST(ShardedCacheTest, ShardCountIsClampedToCapacity) {
+    Cache cache(4, 100, 16);
+    EXPECT_EQ(cache.shard_count(), 4);
+
+    Cache zero(0, 100, 8);
+    EXPECT_EQ(zero.shard_count(), 1);
+
+    Cache defaulted(10);
+    EXPECT_EQ(defaulted.shard_count(), 1);
+}
+
+TEST(ShardedCacheTest, PutGetAcrossShards) {
+    Cache cache(1000, 100, 8);
+    for (int i = 0; i < 200; i++) {
+        cache.put("Key" + std::to_string(i), "Value" + std::to_string(i));
+    }
+    for (int i = 0; i < 200; i++) {
+        auto v = cache.get("Key" + std::to_string(i));
+        ASSERT_TRUE(v.has_value());
+        EXPECT_EQ(*v, "Value" + std::to_string(i));
+    }
+    EXPECT_TRUE(cache.erase("Key7"));
+    EXPECT_FALSE(cache.contains("Key7"));
+}
+
+TEST(ShardedCacheTest, AggregatesSizeKeysAndMetrics) {
+    Cache cache(1000, 100, 8);
+    for (int i = 0; i < 100; i++) {
+        cache.put("Key" + std::to_string(i), "V");
+    }
+    EXPECT_EQ(cache.size(), 100);
+
+    auto keys = cache.keys();
+    ASSERT_EQ(keys.size(), 100);
+    std::sort(keys.begin(), keys.end());
+    EXPECT_TRUE(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+
+    for (int i = 0; i < 100; i++) {
+        cache.get("Key" + std::to_string(i));
+        cache.get("Missing" + std::to_string(i));
+    }
+    EXPECT_EQ(cache.hits(), 100);
+    EXPECT_EQ(cache.misses(), 100);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_TRUE(cache.keys().empty());
+}
+
+TEST(ShardedCacheTest, CapacityIsSlicedAcrossShards) {
+    Cache cache(64, 100, 8);
+    EXPECT_EQ(cache.capacity(), 64);
+
+    for (int i = 0; i < 1000; i++) {
+        cache.put("Key" + std::to_string(i), "V");
+    }
+    // Each shard evicts independently, so the total never exceeds capacity
+    EXPECT_LE(cache.size(), 64);
+    EXPECT_GT(cache.size(), 0);
+}
+
+TEST(ShardedCacheTest, AsyncEvictionSweepsAllShards) {
+    Cache cache(100, 50, 4);
+    for (int i = 0; i < 20; i++) {
+        cache.put("Key" + std::to_string(i), "V", 50);
+    }
+    cache.put("Survivor", "V", 5000);
+    std::this_thread::sleep_for(300ms);
+
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_TRUE(cache.contains("Survivor"));
+}
+
+//-------------------CLOCK Eviction Tests-------------------
+
+static CacheOptions clock_options(size_t capacity, size_t shards = 1) {
+    CacheOptions options;
+    options.capacity = capacity;
+    options.shard_count = shards;
+    options.eviction = EvictionPolicy::CLOCK;
+    return options;
+}
+
+TEST(ClockEvictionTest, DefaultPolicyIsLRU) {
+    Cache cache(3);
+    EXPECT_EQ(cache.eviction_policy(), EvictionPolicy::LRU);
+
+    Cache clock_cache(clock_options(3));
+    EXPECT_EQ(clock_cache.eviction_policy(), EvictionPolicy::CLOCK);
+    EXPECT_EQ(clock_cache.capacity(), 3);
+}
+
+TEST(ClockEvictionTest, ReferencedEntryGetsSecondChance) {
+    Cache cache(clock_options(3));
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry");
+    cache.get("A"); // Sets A's reference bit, B is the first unreferenced entry
+    cache.put("D", "Durian");
+
+    EXPECT_FALSE(cache.contains("B"));
+    EXPECT_TRUE(cache.contains("A"));
+    EXPECT_TRUE(cache.contains("C"));
+    EXPECT_TRUE(cache.contains("D"));
+}
+
+TEST(ClockEvictionTest, AllReferencedFallsBackToOldest) {
+    Cache cache(clock_options(3));
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry");
+    cache.get("A");
+    cache.get("B");
+    cache.get("C");
+    cache.put("D", "Durian"); // Hand clears every bit, then evicts A
+
+    EXPECT_FALSE(cache.contains("A"));
+    EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(ClockEvictionTest, ExpiredEntryIsRemovedOnRead) {
+    Cache cache(clock_options(3));
+    cache.put("A", "Apple", 50);
+    std::this_thread::sleep_for(80ms);
+
+    EXPECT_FALSE(cache.get("A").has_value());
+    EXPECT_FALSE(cache.contains("A"));
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(ClockEvictionTest, ConcurrentReadersShareTheLock) {
+    for (EvictionPolicy eviction : {EvictionPolicy::CLOCK, EvictionPolicy::LRU}) {
+        CacheOptions options = clock_options(100);
+        options.eviction = eviction;
+        Cache cache(options);
+        cache.put("A", "Apple");
+
+        // Another reader is inside the shard: a CLOCK hit shares the lock, an LRU hit must wait
+        std::shared_lock<std::shared_mutex> reader(CacheTestAccess::shard_mutex(cache, 0));
+        auto hit = std::async(std::launch::async, [&] { return cache.get("A"); });
+        if (eviction == EvictionPolicy::CLOCK) {
+            ASSERT_EQ(hit.wait_for(2s), std::future_status::ready);
+        } else {
+            EXPECT_EQ(hit.wait_for(100ms), std::future_status::timeout);
+        }
+        reader.unlock();
+        EXPECT_EQ(hit.get().value(), "Apple");
+    }
+}
+
+//-------------------Lock-Free Read Tests-------------------
+
+static CacheOptions lock_free_options(size_t capacity, size_t shards = 1) {
+    CacheOptions options = clock_options(capacity, shards);
+    options.lock_free_reads = true;
+    return options;
+}
+
+TEST(LockFreeReadTest, RequiresClockEviction) {
+    CacheOptions options;
+    options.capacity = 10;
+    options.lock_free_reads = true;
+    EXPECT_THROW(Cache{options}, std::invalid_argument);
+
+    Cache cache(lock_free_options(10));
+    EXPECT_TRUE(cache.lock_free_reads());
+    EXPECT_FALSE(Cache(clock_options(10)).lock_free_reads());
+}
+
+TEST(LockFreeReadTest, BasicOperations) {
+    Cache cache(lock_free_options(100, 4));
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("A", "Apricot");   // Replaces the entry instead of updating it
+    EXPECT_EQ(cache.get("A").value(), "Apricot");
+    EXPECT_EQ(cache.get_ref("B")->view(), "Banana");
+    EXPECT_FALSE(cache.get("C").has_value());
+    EXPECT_EQ(cache.size(), 2);
+
+    auto values = cache.multi_get({"A", "C", "B"});
+    EXPECT_EQ(values[0].value(), "Apricot");
+    EXPECT_FALSE(values[1].has_value());
+    EXPECT_EQ(values[2].value(), "Banana");
+
+    EXPECT_TRUE(cache.erase("A"));
+    EXPECT_FALSE(cache.get("A").has_value());
+    EXPECT_EQ(cache.hits(), 4);
+    EXPECT_EQ(cache.misses(), 3);
+}
+
+TEST(LockFreeReadTest, HitEntryGetsSecondChance) {
+    Cache cache(lock_free_options(3));
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry");
+    cache.get("A"); // Stamps A, B is the first entry not hit since insertion
+    cache.put("D", "Durian");
+
+    EXPECT_FALSE(cache.contains("B"));
+    EXPECT_TRUE(cache.contains("A"));
+    EXPECT_TRUE(cache.contains("C"));
+    EXPECT_TRUE(cache.contains("D"));
+}
+
+TEST(LockFreeReadTest, ExpiredEntryIsRemovedOnRead) {
+    Cache cache(lock_free_options(3));
+    cache.put("A", "Apple", 50);
+    std::this_thread::sleep_for(80ms);
+
+    EXPECT_FALSE(cache.get("A").has_value());
+    EXPECT_FALSE(cache.contains("A"));
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(LockFreeReadTest, IndexGrowthAndClearKeepReadersSafe) {
+    Cache cache(lock_free_options(100000));
+    for (int i = 0; i < 20000; i++) {
+        cache.put("Key" + std::to_string(i), "Value" + std::to_string(i));
+    }
+    for (int i = 0; i < 20000; i += 97) {
+        ASSERT_EQ(cache.get("Key" + std::to_string(i)).value(), "Value" + std::to_string(i));
+    }
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_FALSE(cache.get("Key0").has_value());
+}
+
+TEST(LockFreeReadTest, ReadersRaceWithWriters) {
+    // Every value starts with its key, so a reader can tell a torn or freed value apart
+    Cache cache(lock_free_options(64, 2));
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> bad{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            for (size_t i = 0; !stop.load(); ++i) {
+                const std::string key = "k" + std::to_string((i + t) % 100);
+                if (i % 2 == 0) {
+                    auto value = cache.get(key);
+                    if (value && value->compare(0, key.size() + 1, key + ":") != 0) bad++;
+                } else if (auto ref = cache.get_ref(key)) {
+                    if (ref->view().substr(0, key.size() + 1) != key + ":") bad++;
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 200; ++round) {
+        for (int k = 0; k < 100; ++k) {
+            const std::string key = "k" + std::to_string(k);
+            if ((k + round) % 5 == 0) {
+                cache.erase(key);
+            } else {
+                cache.put(key, key + ":" + std::string(static_cast<size_t>(round % 64), 'x'), k % 3 ? 0 : 5);
+            }
+        }
+    }
+    stop = true;
+    for (auto& r : readers) r.join();
+
+    EXPECT_EQ(bad.load(), 0);
+    EXPECT_LE(cache.size(), 64);
+}
+
+TEST(LockFreeReadTest, ReadsDoNotWaitForWriters) {
+    Cache cache(lock_free_options(100));
+    cache.put("A", "Apple");
+
+    // A writer holds the shard exclusively; lookups take no shard lock at all
+    std::unique_lock<std::shared_mutex> writer(CacheTestAccess::shard_mutex(cache, 0));
+    auto reads = std::async(std::launch::async, [&] {
+        return std::make_pair(cache.get("A"), cache.get("Missing"));
+    });
+    ASSERT_EQ(reads.wait_for(2s), std::future_status::ready);
+    writer.unlock();
+    auto [hit, miss] = reads.get();
+    EXPECT_EQ(hit.value(), "Apple");
+    EXPECT_FALSE(miss.has_value());
+}
+
+//-------------------Memory-Bounded Cache Tests-------------------
+
+static CacheOptions byte_options(size_t capacity_bytes, size_t shards = 1) {
+    CacheOptions options;
+    options.capacity_bytes = capacity_bytes;
+    options.shard_count = shards;
+    return options;
+}
+
+TEST(MemoryBoundedCacheTest, AccountsKeyValueAndOverhead) {
+    Cache cache(100);
+    EXPECT_EQ(cache.memory_used(), 0);
+
+    cache.put("A", std::string(10, 'a'));
+    size_t small = cache.memory_used();
+    EXPECT_GT(small, 10u + 1u); // Overhead is accounted, not just raw bytes
+
+    cache.put("B", std::string(5000, 'b'));
+    EXPECT_GE(cache.memory_used(), small + 5000);
+
+    cache.erase("B");
+    EXPECT_EQ(cache.memory_used(), small);
+    cache.clear();
+    EXPECT_EQ(cache.memory_used(), 0);
+}
+
+TEST(MemoryBoundedCacheTest, EvictsUntilFootprintFits) {
+    Cache cache(byte_options(64 * 1024));
+    EXPECT_EQ(cache.capacity_bytes(), 64 * 1024);
+
+    for (int i = 0; i < 100; i++) {
+        cache.put("Key" + std::to_string(i), std::string(4000, 'v'));
+        EXPECT_LE(cache.memory_used(), 64 * 1024);
+    }
+    EXPECT_LT(cache.size(), 100);
+    EXPECT_GT(cache.size(), 0);
+    // Most recent entries survive
+    EXPECT_TRUE(cache.contains("Key99"));
+    EXPECT_FALSE(cache.contains("Key0"));
+}
+
+TEST(MemoryBoundedCacheTest, LargeValueDisplacesManySmallOnes) {
+    Cache cache(byte_options(32 * 1024));
+    for (int i = 0; i < 50; i++) {
+        cache.put("Small" + std::to_string(i), "flag");
+    }
+    EXPECT_EQ(cache.size(), 50);
+
+    cache.put("Big", std::string(30 * 1024, 'x'));
+    EXPECT_TRUE(cache.contains("Big"));
+    EXPECT_LT(cache.size(), 50);
+    EXPECT_LE(cache.memory_used(), 32 * 1024);
+}
+
+TEST(MemoryBoundedCacheTest, OversizedValueIsRejected) {
+    Cache cache(byte_options(4 * 1024));
+    cache.put("A", "small");
+    cache.put("Huge", std::string(8 * 1024, 'x'));
+    EXPECT_FALSE(cache.contains("Huge"));
+    EXPECT_TRUE(cache.contains("A"));
+
+    // Growing an existing key past the budget drops it instead of keeping stale data
+    cache.put("A", std::string(8 * 1024, 'x'));
+    EXPECT_FALSE(cache.contains("A"));
+}
+
+TEST(MemoryBoundedCacheTest, GrowingValueEvictsOthers) {
+    Cache cache(byte_options(16 * 1024));
+    cache.put("A", std::string(100, 'a'));
+    cache.put("B", std::string(6000, 'b'));
+    cache.put("C", std::string(6000, 'c'));
+    cache.put("A", std::string(9000, 'a')); // A becomes MRU, B is the LRU victim
+
+    EXPECT_TRUE(cache.contains("A"));
+    EXPECT_FALSE(cache.contains("B"));
+    EXPECT_LE(cache.memory_used(), 16 * 1024);
+    EXPECT_EQ(cache.get("A").value(), std::string(9000, 'a'));
+}
+
+TEST(MemoryBoundedCacheTest, ReportsSlabUsage) {
+    Cache cache(byte_options(1 << 20, 4));
+    for (int i = 0; i < 100; i++) {
+        // With the block header this still fits the smallest class
+        cache.put("Key" + std::to_string(i), std::string(SlabAllocator::kMinChunkSize - sizeof(ValueBlock), 'v'));
+    }
+    auto stats = cache.slab_stats();
+    ASSERT_FALSE(stats.empty());
+    EXPECT_EQ(stats[0].chunk_size, SlabAllocator::kMinChunkSize);
+    EXPECT_EQ(stats[0].chunks_used, 100);
+    EXPECT_EQ(stats[0].bytes_used, 100 * SlabAllocator::kMinChunkSize);
+}
+
+TEST(MemoryBoundedCacheTest, PagesStayCloseToTheBudget) {
+    const size_t budget = 16 << 20;
+    const size_t shards = 4;
+    Cache cache(byte_options(budget, shards));
+
+    auto class_of = [&](size_t value_size) {
+        for (const auto& cls : cache.slab_stats()) {
+            if (cls.chunk_size >= sizeof(ValueBlock) + value_size) {
+                return cls;
+            }
+        }
+        return SlabAllocator::ClassStats{};
+    };
+    auto reserved = [&] {
+        auto stats = cache.slab_stats();
+        size_t page_size = stats[stats.size() - 2].chunk_size * SlabAllocator::kChunksPerPage;
+        size_t pages = 0;
+        for (const auto& cls : stats) {
+            pages += cls.pages;
+        }
+        return pages * page_size;
+    };
+
+    // Fill the budget twice over with one value size, then move to another
+    for (size_t i = 0; i < 2 * budget / 200; i++) {
+        cache.put("Small" + std::to_string(i), std::string(200, 's'));
+    }
+    ASSERT_GT(class_of(200).pages, shards);
+    EXPECT_LE(reserved(), budget + budget / 4);
+
+    for (size_t i = 0; i < 2 * budget / 600; i++) {
+        cache.put("Large" + std::to_string(i), std::string(600, 'l'));
+    }
+    ASSERT_GT(class_of(600).chunks_used, 0u);
+    ASSERT_NE(class_of(600).chunk_size, class_of(200).chunk_size);
+
+    // The abandoned class keeps at most one spare page per shard
+    EXPECT_EQ(class_of(200).chunks_used, 0u);
+    EXPECT_LE(class_of(200).pages, shards);
+    EXPECT_LE(reserved(), budget + budget / 4);
+}
+
+//-------------------Zero-copy Read Tests-------------------
+
+TEST(ValueRefTest, GetRefSharesTheStoredBlock) {
+    Cache cache(10);
+    cache.put("A", std::string(100 * 1024, 'a'));
+
+    auto first = cache.get_ref("A");
+    auto second = cache.get_ref("A");
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first->data(), second->data()); // Same bytes, nothing copied
+    EXPECT_EQ(first->use_count(), 3);         // Entry + two handles
+    EXPECT_EQ(first->view(), std::string(100 * 1024, 'a'));
+    EXPECT_EQ(cache.hits(), 2);
+
+    EXPECT_FALSE(cache.get_ref("Missing").has_value());
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(ValueRefTest, HandleOutlivesOverwriteEvictionAndCache) {
+    std::optional<ValueRef> old_value;
+    std::optional<ValueRef> evicted;
+    {
+        Cache cache(2);
+        cache.put("A", "Apple");
+        cache.put("B", "Banana");
+        old_value = cache.get_ref("A");
+        evicted = cache.get_ref("B");
+
+        cache.put("A", "Apricot");  // Readers keep the old immutable block
+        cache.put("C", "Cherry");   // Evicts B
+        EXPECT_FALSE(cache.contains("B"));
+        EXPECT_EQ(cache.get("A").value(), "Apricot");
+        EXPECT_EQ(old_value->view(), "Apple");
+        EXPECT_EQ(old_value->use_count(), 1);
+    }
+    // The arena stays alive until the last handle is dropped
+    EXPECT_EQ(old_value->view(), "Apple");
+    EXPECT_EQ(evicted->view(), "Banana");
+}
+
+TEST(ValueRefTest, ReadersRaceWithWriters) {
+    Cache cache(100, 100, 4);
+    for (int i = 0; i < 20; i++) {
+        cache.put("Key" + std::to_string(i), std::string(1000, 'a'));
+    }
+
+    std::atomic<bool> torn{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, &torn, t]() {
+            for (int i = 0; i < 5000; i++) {
+                std::string key = "Key" + std::to_string(i % 20);
+                if (t == 0) {
+                    cache.put(key, std::string(1000, static_cast<char>('a' + i % 26)));
+                    continue;
+                }
+                auto ref = cache.get_ref(key);
+                if (!ref) continue;
+                // A value never changes under a reader
+                auto view = ref->view();
+                if (view.find_first_not_of(view.front()) != std::string_view::npos) torn = true;
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_FALSE(torn.load());
+}
+
+//-------------------TinyLFU Admission Tests-------------------
+
+static CacheOptions tinylfu_options(size_t capacity, size_t shards = 1) {
+    CacheOptions options;
+    options.capacity = capacity;
+    options.shard_count = shards;
+    options.admission = AdmissionPolicy::TINY_LFU;
+    return options;
+}
+
+// Hit ratio on a hot set that is read repeatedly, interrupted by one long scan of cold keys
+static double hot_set_hit_ratio_after_scan(Cache& cache) {
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 200; i++) {
+            std::string key = "Hot" + std::to_string(i);
+            if (!cache.get(key)) cache.put(key, "value");
+        }
+    }
+    for (int i = 0; i < 5000; i++) {
+        std::string key = "Scan" + std::to_string(i);
+        if (!cache.get(key)) cache.put(key, "value");
+    }
+
+    size_t hits = 0;
+    for (int i = 0; i < 200; i++) {
+        if (cache.get("Hot" + std::to_string(i))) hits++;
+    }
+    return hits / 200.0;
+}
+
+TEST(TinyLfuAdmissionTest, RequiresLruEviction) {
+    CacheOptions options = tinylfu_options(10);
+    options.eviction = EvictionPolicy::CLOCK;
+    EXPECT_THROW(Cache cache(options), std::invalid_argument);
+
+    Cache cache(tinylfu_options(10));
+    EXPECT_EQ(cache.admission_policy(), AdmissionPolicy::TINY_LFU);
+    EXPECT_EQ(Cache(10).admission_policy(), AdmissionPolicy::NONE);
+}
+
+TEST(TinyLfuAdmissionTest, ScanDoesNotFlushWorkingSet) {
+    Cache lru(1000);
+    Cache tinylfu(tinylfu_options(1000));
+
+    double lru_ratio = hot_set_hit_ratio_after_scan(lru);
+    double tinylfu_ratio = hot_set_hit_ratio_after_scan(tinylfu);
+    std::cout << "[ tinylfu  ] hot set hit ratio after scan: lru=" << lru_ratio
+              << " tinylfu=" << tinylfu_ratio << std::endl;
+
+    EXPECT_EQ(lru_ratio, 0.0);
+    EXPECT_GT(tinylfu_ratio, 0.8);
+    EXPECT_LE(tinylfu.size(), 1000);
+    EXPECT_GT(tinylfu.admission_rejections(), 0);
+}
+
+TEST(TinyLfuAdmissionTest, FrequentKeyDisplacesColdVictim) {
+    Cache cache(tinylfu_options(100));
+    for (int i = 0; i < 100; i++) {
+        cache.put("Cold" + std::to_string(i), "value");
+    }
+    EXPECT_EQ(cache.size(), 100);
+
+    // Requested often before it is stored, so it beats the cold victim
+    for (int i = 0; i < 5; i++) {
+        cache.get("Popular");
+    }
+    cache.put("Popular", "value");
+    cache.put("Next", "value"); // Pushes Popular out of the window
+
+    EXPECT_TRUE(cache.contains("Popular"));
+    EXPECT_EQ(cache.size(), 100);
+}
+
+TEST(TinyLfuAdmissionTest, UpdatesAndErasesKeepAccounting) {
+    Cache cache(tinylfu_options(10));
+    for (int i = 0; i < 10; i++) {
+        cache.put("Key" + std::to_string(i), "v1");
+    }
+    for (int i = 0; i < 10; i++) {
+        cache.put("Key" + std::to_string(i), "v2"); // Hits promote to protected
+        EXPECT_EQ(cache.get("Key" + std::to_string(i)).value(), "v2");
+    }
+    EXPECT_EQ(cache.size(), 10);
+    EXPECT_EQ(cache.keys().size(), 10);
+
+    cache.erase("Key3");
+    EXPECT_EQ(cache.size(), 9);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    cache.put("A", "Apple");
+    EXPECT_EQ(cache.get("A").value(), "Apple");
+}
+
+TEST(TinyLfuAdmissionTest, MemoryBoundedStaysWithinBudget) {
+    CacheOptions options = byte_options(64 * 1024, 2);
+    options.admission = AdmissionPolicy::TINY_LFU;
+    Cache cache(options);
+
+    for (int i = 0; i < 500; i++) {
+        cache.put("Key" + std::to_string(i % 150), std::string(100 + (i % 7) * 300, 'v'));
+        EXPECT_LE(cache.memory_used(), 64 * 1024);
+    }
+    EXPECT_GT(cache.size(), 0);
+}
+
+//-------------------Batched Operation Tests-------------------
+
+TEST(MultiOpsTest, MultiGetReturnsValuesInRequestOrder) {
+    Cache cache(100, 100, 4);
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry");
+
+    auto values = cache.multi_get({"C", "Missing", "A", "B", "A"});
+    ASSERT_EQ(values.size(), 5);
+    EXPECT_EQ(values[0].value(), "Cherry");
+    EXPECT_FALSE(values[1].has_value());
+    EXPECT_EQ(values[2].value(), "Apple");
+    EXPECT_EQ(values[3].value(), "Banana");
+    EXPECT_EQ(values[4].value(), "Apple");
+    EXPECT_EQ(cache.hits(), 4);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_TRUE(cache.multi_get({}).empty());
+}
+
+TEST(MultiOpsTest, MultiPutAppliesDuplicatesInOrder) {
+    Cache cache(100, 100, 4);
+    std::vector<std::string> keys, values;
+    for (int i = 0; i < 50; i++) {
+        keys.push_back("Key" + std::to_string(i));
+        values.push_back("Value" + std::to_string(i));
+    }
+    std::vector<CacheItem> items;
+    for (size_t i = 0; i < keys.size(); i++) {
+        items.push_back({keys[i], values[i]});
+    }
+    items.push_back({"Key7", "Last"});
+    cache.multi_put(items);
+
+    EXPECT_EQ(cache.size(), 50);
+    EXPECT_EQ(cache.get("Key7").value(), "Last");
+    EXPECT_EQ(cache.get("Key49").value(), "Value49");
+}
+
+TEST(MultiOpsTest, MultiPutHonoursTtlAndCapacity) {
+    Cache cache(3);
+    cache.multi_put({{"A", "Apple", 50}, {"B", "Banana"}, {"C", "Cherry"}, {"D", "Date"}});
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_FALSE(cache.contains("A")); // Least recently written
+
+    cache.multi_put({{"E", "Elder", 50}});
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto values = cache.multi_get({"E", "D"});
+    EXPECT_FALSE(values[0].has_value());
+    EXPECT_EQ(values[1].value(), "Date");
+}
+
+TEST(MultiOpsTest, MultiEraseCountsRemovedKeys) {
+    Cache cache(100, 100, 4);
+    cache.multi_put({{"A", "Apple"}, {"B", "Banana"}, {"C", "Cherry"}});
+    EXPECT_EQ(cache.multi_erase({"A", "C", "Missing", "A"}), 2);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_TRUE(cache.contains("B"));
+}
+
+TEST(MultiOpsTest, ClockMultiGetRemovesExpiredEntries) {
+    CacheOptions options;
+    options.capacity = 10;
+    options.eviction_interval_ms = 10000; // Keep the background sweep out of the way
+    options.eviction = EvictionPolicy::CLOCK;
+    Cache cache(options);
+    cache.multi_put({{"A", "Apple", 20}, {"B", "Banana"}});
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+
+    auto refs = cache.multi_get_ref({"A", "B"});
+    EXPECT_FALSE(refs[0].has_value());
+    EXPECT_EQ(refs[1]->view(), "Banana");
+    EXPECT_FALSE(cache.contains("A"));
+}
+
+//-------------------Export Slice Tests-------------------
+
+// Walk the whole cache `slots` index slots at a time; `between` runs after every slice
+template <typename Between>
+static std::vector<CacheRecord> export_all(const Cache& cache, size_t slots, Between&& between) {
+    std::vector<CacheRecord> all;
+    ExportCursor cursor;
+    while (!cursor.done) {
+        for (auto& record : cache.export_slice(cursor, slots)) {
+            all.push_back(std::move(record));
+        }
+        between();
+    }
+    return all;
+}
+
+TEST(ExportSliceTest, ReturnsEveryLiveEntryOnce) {
+    Cache cache(1000, 100, 4);
+    for (int i = 0; i < 300; i++) {
+        cache.put("Key" + std::to_string(i), "Value" + std::to_string(i), i % 2 ? 60000 : 0);
+    }
+    cache.put("Gone", "Soon", 20);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+
+    size_t slices = 0;
+    auto records = export_all(cache, 16, [&slices] { ++slices; });
+    EXPECT_GT(slices, 4u);   // More than one slice per shard
+    ASSERT_EQ(records.size(), 300u);
+
+    std::vector<std::string> keys;
+    for (const auto& record : records) {
+        keys.push_back(record.key);
+        const int i = std::stoi(record.key.substr(3));
+        EXPECT_EQ(record.value.view(), "Value" + std::to_string(i));
+        if (i % 2) {
+            EXPECT_GT(record.ttl_ms, 0u);
+            EXPECT_LE(record.ttl_ms, 60000u);
+        } else {
+            EXPECT_EQ(record.ttl_ms, 0u);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+TEST(ExportSliceTest, ReturnsEveryEntryOnceWhenTheIndexGrowsMidWalk) {
+    for (bool lock_free : {false, true}) {
+        CacheOptions options = lock_free ? lock_free_options(100000) : CacheOptions{};
+        options.capacity = 100000;
+        Cache cache(options);
+        for (int i = 0; i < 100; i++) {
+            cache.put("Key" + std::to_string(i), "Value");
+        }
+        int added = 0;
+        auto records = export_all(cache, 8, [&] {
+            for (int j = 0; j < 20; j++, added++) {
+                cache.put("New" + std::to_string(added), "Value");   // Forces rebuilds of the index
+            }
+        });
+        EXPECT_GT(added, 400);   // Several times the starting size
+
+        std::multiset<std::string> keys;
+        for (const auto& record : records) {
+            keys.insert(record.key);
+        }
+        for (int i = 0; i < 100; i++) {
+            EXPECT_EQ(keys.count("Key" + std::to_string(i)), 1u) << "lock_free=" << lock_free << " Key" << i;
+        }
+    }
+}
+
 //-------------------Async Eviction Tests-------------------
 
 TEST(CacheAsyncEvictionTest, EvictsExpiredKey){
@@ -133,6 +976,22 @@ TEST(CacheAsyncEvictionTest, EvictsExpiredKey){
     EXPECT_EQ(cache.size(), 0);  // cache shall be empty
 }
 
+TEST(CacheAsyncEvictionTest, OwnerDrivesMaintenanceWithoutBackgroundThread){
+    CacheOptions options;
+    options.capacity = 10;
+    options.eviction_interval_ms = 20;
+    options.background_expiry = false;
+    Cache cache(options);
+
+    cache.put("A", "expired", 30);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(cache.size(), 1);   // Nobody refreshed the clock or swept
+
+    cache.maintain();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.expirations(), 1);
+}
+
 TEST(CacheAsyncEvictionTest, KeepsUnexpiredKey){
     Cache cache(10);
 
@@ -164,6 +1023,33 @@ TEST(CacheAsyncEvictionTest, EvictsOnlyExpiredKey){
     EXPECT_EQ(keys[0], "long");
 }
 
+TEST(CacheAsyncEvictionTest, OverwriteWithoutTTLCancelsExpiry){
+    Cache cache(10);
+
+    cache.put("A", "short", 100);
+    cache.put("A", "forever");  // no TTL anymore
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+    ASSERT_TRUE(cache.contains("A"));
+    EXPECT_EQ(cache.get("A").value(), "forever");
+}
+
+TEST(CacheAsyncEvictionTest, ExpiresLargeBurstAcrossBatches){
+    Cache cache(20000, 50, 4);
+
+    for (int i = 0; i < 10000; i++) {
+        cache.put("Burst" + std::to_string(i), "V", 50);
+    }
+    for (int i = 0; i < 100; i++) {
+        cache.put("Keep" + std::to_string(i), "V", 60000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    EXPECT_EQ(cache.size(), 100);
+    EXPECT_TRUE(cache.contains("Keep0"));
+    EXPECT_FALSE(cache.contains("Burst0"));
+}
+
 //-------------------Extra Utility Tests-------------------
 
 TEST(CacheUtilityTest, ClearRemovesAllKeys) {
@@ -195,4 +1081,17 @@ TEST(CacheUtilityTest, EvictionIntervalReturnsConfiguredValue) {
 
     Cache defaultCache(5); // default should be 100ms
     EXPECT_EQ(defaultCache.eviction_interval(), 100);
-}
\ No newline at end of file
+}
+TEST(CacheUtilityTest, CountsEvictionsAndExpirations) {
+    Cache cache(2, 20);
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("C", "Cherry"); // Evicts A
+    EXPECT_EQ(cache.evictions(), 1);
+
+    cache.put("D", "Date", 10);    // Evicts B, expires in the background
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(cache.evictions(), 2);
+    EXPECT_EQ(cache.expirations(), 1);
+    EXPECT_FALSE(cache.contains("D"));
+}
@@ -0,0 +1,147 @@
+#include "cache.h"
+#include "compression.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// JSON-ish text that compresses well
+std::string json_blob(size_t size, int seed = 0) {
+    std::string out = "[";
+    for (int i = 0; out.size() < size; ++i) {
+        out += "{\"id\":" + std::to_string(seed * 100000 + i) + ",\"name\":\"user\",\"active\":true},";
+    }
+    out.resize(size);
+    return out;
+}
+
+// Bytes that do not compress at all
+std::string random_bytes(size_t size) {
+    std::mt19937 rng(42);
+    std::string out(size, '\0');
+    for (char& c : out) c = static_cast<char>(rng());
+    return out;
+}
+
+CacheOptions compressing(size_t threshold, size_t capacity = 100) {
+    CacheOptions options;
+    options.capacity = capacity;
+    options.compress_threshold = threshold;
+    return options;
+}
+}
+
+TEST(CompressionTest, RoundTripsAValue) {
+    const std::string raw = json_blob(8192);
+    std::string packed;
+    ASSERT_TRUE(compress_value(raw, packed));
+    EXPECT_LT(packed.size(), raw.size() / 4);
+    ASSERT_EQ(decompressed_size(packed), raw.size());
+
+    std::string restored(decompressed_size(packed), '\0');
+    decompress_value(packed, &restored[0]);
+    EXPECT_EQ(restored, raw);
+}
+
+TEST(CompressionTest, RefusesValuesThatDoNotShrink) {
+    std::string packed;
+    EXPECT_FALSE(compress_value(random_bytes(4096), packed));
+}
+
+TEST(CompressionTest, DetectsCorruption) {
+    std::string packed;
+    ASSERT_TRUE(compress_value(json_blob(4096), packed));
+    packed.resize(packed.size() / 2);
+    std::string out(4096, '\0');
+    EXPECT_THROW(decompress_value(packed, &out[0]), std::runtime_error);
+    EXPECT_THROW(decompress_value("ab", &out[0]), std::runtime_error);
+}
+
+TEST(CompressionTest, CacheStoresLargeValuesCompressed) {
+    CacheOptions options = compressing(1024);
+    options.capacity_bytes = 1 << 20;
+    Cache cache(options);
+    const std::string big = json_blob(16384);
+    cache.put("Big", big);
+    cache.put("Small", "tiny");
+
+    EXPECT_EQ(cache.get("Big").value(), big);
+    EXPECT_EQ(cache.get("Small").value(), "tiny");
+    auto ref = cache.get_ref("Big");
+    ASSERT_TRUE(ref.has_value());
+    EXPECT_FALSE(ref->compressed());   // Readers always see the original bytes
+    EXPECT_EQ(ref->view(), big);
+
+    // Memory is accounted at the compressed size
+    EXPECT_LT(cache.memory_used(), big.size() / 2);
+
+    CompressionStats stats = cache.compression_stats();
+    EXPECT_EQ(stats.compressed, 1);
+    EXPECT_EQ(stats.incompressible, 0);
+    EXPECT_EQ(stats.raw_bytes, big.size());
+    EXPECT_LT(stats.stored_bytes, big.size() / 4);
+    EXPECT_EQ(stats.decompressions, 2);
+}
+
+TEST(CompressionTest, IncompressibleValuesAreStoredRaw) {
+    Cache cache(compressing(1024));
+    const std::string noise = random_bytes(4096);
+    cache.put("Noise", noise);
+
+    EXPECT_EQ(cache.get("Noise").value(), noise);
+    CompressionStats stats = cache.compression_stats();
+    EXPECT_EQ(stats.compressed, 0);
+    EXPECT_EQ(stats.incompressible, 1);
+    EXPECT_EQ(stats.decompressions, 0);
+}
+
+TEST(CompressionTest, OffByDefault) {
+    Cache cache(100);
+    cache.put("Big", json_blob(16384));
+    EXPECT_EQ(cache.compress_threshold(), 0);
+    EXPECT_EQ(cache.compression_stats().compressed, 0);
+    EXPECT_EQ(cache.compression_stats().incompressible, 0);
+}
+
+TEST(CompressionTest, BatchesAndUpdatesMixRawAndCompressed) {
+    Cache cache(compressing(1024, 100));
+    std::vector<std::string> values = {json_blob(4096, 1), "short", random_bytes(2048), json_blob(2048, 2)};
+    cache.multi_put({{"A", values[0], 0}, {"B", values[1], 0}, {"C", values[2], 0}, {"D", values[3], 0}});
+
+    auto got = cache.multi_get({"A", "B", "C", "D", "Missing"});
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_TRUE(got[i].has_value()) << i;
+        EXPECT_EQ(*got[i], values[i]) << i;
+    }
+    EXPECT_FALSE(got[4].has_value());
+    EXPECT_EQ(cache.compression_stats().compressed, 2);
+
+    // Compressed to raw and back on update
+    cache.put("A", "now short");
+    EXPECT_EQ(cache.get("A").value(), "now short");
+    cache.put("B", values[0]);
+    EXPECT_EQ(cache.get("B").value(), values[0]);
+}
+
+TEST(CompressionTest, ExportHoldsPlainValues) {
+    Cache cache(compressing(1024));
+    const std::string big = json_blob(8192);
+    cache.put("Big", big, 60000);
+
+    auto records = cache.export_shard(0);
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_FALSE(records[0].value.compressed());
+    EXPECT_EQ(records[0].value.view(), big);
+}
+
+TEST(CompressionTest, HandleOutlivesTheEntry) {
+    Cache cache(compressing(1024));
+    const std::string big = json_blob(8192);
+    cache.put("Big", big);
+    auto ref = cache.get_ref("Big");
+    cache.erase("Big");
+    cache.clear();
+    EXPECT_EQ(ref->view(), big);
+    EXPECT_EQ(ref->use_count(), 1);
+}
@@ -0,0 +1,203 @@
+#include "core_engine.h"
+#include "mpsc_queue.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+CacheOptions engine_options(size_t capacity) {
+    CacheOptions options;
+    options.capacity = capacity;
+    options.eviction_interval_ms = 20;
+    return options;
+}
+}
+
+//-------------------MPSC Queue Tests-------------------
+
+TEST(MpscQueueTest, PopsInOrderAndReportsFull) {
+    MpscQueue<int> queue(3);   // Rounded up to 4
+    EXPECT_EQ(queue.capacity(), 4);
+    EXPECT_TRUE(queue.empty());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push(i));
+    }
+    EXPECT_FALSE(queue.try_push(4));
+
+    int value = -1;
+    for (int lap = 0; lap < 3; ++lap) {   // Slots are reused lap after lap
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.try_pop(value));
+            EXPECT_EQ(value, lap * 4 + i);
+            EXPECT_TRUE(queue.try_push(lap * 4 + i + 4));
+        }
+    }
+    while (queue.try_pop(value)) {}
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(MpscQueueTest, ManyProducersKeepTheirOwnOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 20000;
+    MpscQueue<int> queue(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < kPerProducer; ++i) {
+                while (!queue.try_push(p * kPerProducer + i)) std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    int received = 0;
+    while (received < kProducers * kPerProducer) {
+        int value = 0;
+        if (!queue.try_pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int producer = value / kPerProducer;
+        EXPECT_EQ(value % kPerProducer, next[producer]);
+        next[producer] = value % kPerProducer + 1;
+        ++received;
+    }
+    for (auto& p : producers) p.join();
+    EXPECT_TRUE(queue.empty());
+}
+
+//-------------------Engine Tests-------------------
+
+TEST(CoreEngineTest, BasicOperations) {
+    CoreEngine engine(engine_options(100), 4, false);
+    EXPECT_EQ(engine.core_count(), 4);
+    engine.put("A", "Apple");
+    engine.put("B", "Banana");
+    engine.put("A", "Apricot");
+    EXPECT_EQ(engine.get("A").value(), "Apricot");
+    EXPECT_EQ(engine.get_ref("B")->view(), "Banana");
+    EXPECT_FALSE(engine.get("C").has_value());
+    EXPECT_EQ(engine.size(), 2);
+    EXPECT_EQ(engine.capacity(), 100);
+
+    EXPECT_TRUE(engine.erase("A"));
+    EXPECT_FALSE(engine.erase("A"));
+    EXPECT_EQ(engine.size(), 1);
+    EXPECT_EQ(engine.hits(), 2);
+    EXPECT_EQ(engine.misses(), 1);
+}
+
+TEST(CoreEngineTest, BatchesSpanCores) {
+    CoreEngine engine(engine_options(1000), 3, false);
+    std::vector<std::string> keys, values;
+    for (int i = 0; i < 60; ++i) {
+        keys.push_back("Key" + std::to_string(i));
+        values.push_back("Value" + std::to_string(i));
+    }
+    std::vector<CacheItem> items;
+    for (int i = 0; i < 60; ++i) {
+        items.push_back({keys[i], values[i]});
+    }
+    engine.multi_put(items);
+
+    std::vector<bool> used(engine.core_count(), false);
+    for (const auto& key : keys) used[engine.core_of(key)] = true;
+    for (bool u : used) EXPECT_TRUE(u);   // The test is moot if one core owns everything
+
+    std::vector<std::string_view> lookup(keys.begin(), keys.end());
+    lookup.push_back("Missing");
+    auto found = engine.multi_get_ref(lookup);
+    ASSERT_EQ(found.size(), 61);
+    for (int i = 0; i < 60; ++i) {
+        EXPECT_EQ(found[i]->view(), values[i]) << i;
+    }
+    EXPECT_FALSE(found[60].has_value());
+
+    std::vector<std::string_view> doomed(lookup.begin(), lookup.begin() + 30);
+    doomed.push_back("Missing");
+    EXPECT_EQ(engine.multi_erase(doomed), 30);
+    EXPECT_EQ(engine.size(), 30);
+}
+
+TEST(CoreEngineTest, CapacityIsSplitBetweenCores) {
+    CoreEngine engine(engine_options(40), 4, false);
+    for (int i = 0; i < 1000; ++i) {
+        engine.put("Key" + std::to_string(i), "Value");
+    }
+    EXPECT_LE(engine.size(), 40);
+    EXPECT_EQ(engine.size() + engine.evictions(), 1000);
+}
+
+TEST(CoreEngineTest, ExpiredEntriesAreRemoved) {
+    CoreEngine engine(engine_options(10), 2, false);
+    engine.put("Short", "1", 30);
+    engine.put("Long", "2", 60000);
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(engine.get("Short").has_value());
+    EXPECT_EQ(engine.get("Long").value(), "2");
+}
+
+TEST(CoreEngineTest, IdleWorkersSweepExpiredEntries) {
+    CoreEngine engine(engine_options(10), 2, false);
+    engine.put("Short", "1", 30);
+    engine.put("Other", "2", 30);
+    std::this_thread::sleep_for(200ms);   // No requests: only the parked workers' timed wake-ups run
+    EXPECT_EQ(engine.size(), 0);
+    EXPECT_EQ(engine.expirations(), 2);
+}
+
+TEST(CoreEngineTest, ConcurrentCallersSeeTheirWrites) {
+    CoreEngine engine(engine_options(100000), 2);
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t) {
+        callers.emplace_back([&engine, t] {
+            for (int i = 0; i < 2000; ++i) {
+                const std::string key = "T" + std::to_string(t) + "-" + std::to_string(i);
+                engine.put(key, std::to_string(i));
+                EXPECT_EQ(engine.get(key).value(), std::to_string(i));
+                if (i % 10 == 0) {
+                    std::this_thread::sleep_for(1ms);   // Lets the workers park and be woken again
+                }
+            }
+        });
+    }
+    for (auto& c : callers) c.join();
+    EXPECT_EQ(engine.size(), 8000);
+    EXPECT_EQ(engine.hits(), 8000);
+}
+
+TEST(CoreEngineTest, StatsAreReadWhileWorkersWrite) {
+    CoreEngine engine(engine_options(100000), 2, false);
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 0; i < 5000; ++i) {
+            engine.put("Key" + std::to_string(i), std::string(100, 'v'));
+        }
+        done = true;
+    });
+    while (!done) {   // A metrics scrape: the shards are read by their owners
+        EXPECT_LE(engine.size(), 5000);
+        EXPECT_FALSE(engine.slab_stats().empty());
+        (void)engine.memory_used();
+    }
+    writer.join();
+    EXPECT_EQ(engine.size(), 5000);
+    EXPECT_GT(engine.memory_used(), 5000u * 100);
+}
+
+TEST(CoreEngineTest, PrivateCachesHaveNoExpiryThread) {
+    CacheOptions options = engine_options(10);
+    EXPECT_THROW(CoreEngine::CoreCache{options}, std::invalid_argument);   // background_expiry is on
+    options.background_expiry = false;
+    CoreEngine::CoreCache cache(options);
+    cache.put("A", "1");
+    EXPECT_EQ(cache.get("A").value(), "1");
+}
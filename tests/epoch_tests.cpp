@@ -0,0 +1,176 @@
+#include "epoch.h"
+#include "rcu_index.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Node {
+    Node(size_t h, int k) : hash(h), key(k) {}
+    size_t hash;
+    int key;
+};
+
+using Index = RcuIndex<Node, &Node::hash>;
+
+Node* find(const Index& index, size_t hash, int key) {
+    return index.find(hash, [key](const Node* n) { return n->key == key; });
+}
+
+// Retire a flag-setting marker, so a test can see when it is freed
+void retire_marker(std::atomic<bool>& freed) {
+    EpochDomain::global().retire(&freed, [](void* p) { static_cast<std::atomic<bool>*>(p)->store(true); });
+}
+}
+
+TEST(EpochTest, UnpinnedRetireIsFreedByCollect) {
+    std::atomic<bool> freed{false};
+    retire_marker(freed);
+    EpochDomain::global().collect();
+    EXPECT_TRUE(freed.load());
+}
+
+TEST(EpochTest, PinnedReaderHoldsBackReclamation) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool pinned = false;
+    bool release = false;
+
+    std::thread reader([&] {
+        auto guard = EpochDomain::global().pin();
+        std::unique_lock<std::mutex> lock(mutex);
+        pinned = true;
+        cv.notify_all();
+        cv.wait(lock, [&] { return release; });
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return pinned; });
+    }
+
+    std::atomic<bool> freed{false};
+    retire_marker(freed);
+    for (int i = 0; i < 10; ++i) {
+        EpochDomain::global().collect();
+    }
+    EXPECT_FALSE(freed.load());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    reader.join();
+    EpochDomain::global().collect();
+    EXPECT_TRUE(freed.load());
+}
+
+TEST(EpochTest, GuardsNestAndMove) {
+    std::atomic<bool> freed{false};
+    EpochDomain::Guard outer = EpochDomain::global().pin();
+    {
+        auto inner = EpochDomain::global().pin();
+    }
+    retire_marker(freed);
+    EpochDomain::global().collect();
+    EXPECT_FALSE(freed.load());   // Still pinned by the outer guard
+
+    EpochDomain::Guard moved = std::move(outer);
+    EpochDomain::global().collect();
+    EXPECT_FALSE(freed.load());
+
+    moved = EpochDomain::Guard();   // The pinned guard is destroyed with the temporary
+    EpochDomain::global().collect();
+    EXPECT_TRUE(freed.load());
+}
+
+TEST(RcuIndexTest, InsertFindErase) {
+    Index index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 100; ++i) {
+        nodes.push_back(std::make_unique<Node>(i % 7, i));   // Long collision chains
+        index.insert(nodes.back().get());
+    }
+    EXPECT_EQ(index.size(), 100);
+    EXPECT_GE(index.capacity(), 128);
+
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(find(index, i % 7, i), nodes[i].get()) << i;
+    }
+    EXPECT_EQ(find(index, 3, 1000), nullptr);
+
+    for (int i = 0; i < 100; i += 2) {
+        EXPECT_TRUE(index.erase(nodes[i].get()));
+    }
+    EXPECT_FALSE(index.erase(nodes[0].get()));
+    EXPECT_EQ(index.size(), 50);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(find(index, i % 7, i) != nullptr, i % 2 == 1) << i;   // Probes go past tombstones
+    }
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_EQ(index.capacity(), Index::kMinCapacity);
+    EXPECT_EQ(find(index, 1, 1), nullptr);
+    EpochDomain::global().collect();
+}
+
+TEST(RcuIndexTest, ChurnDoesNotGrowTheTable) {
+    Index index;
+    Node resident(1, 1);
+    index.insert(&resident);
+    for (int i = 0; i < 10000; ++i) {
+        Node temp(static_cast<size_t>(i) * 2654435761u, -i);
+        index.insert(&temp);
+        ASSERT_TRUE(index.erase(&temp));
+    }
+    EXPECT_EQ(index.size(), 1);
+    EXPECT_EQ(index.capacity(), Index::kMinCapacity);   // Tombstones are cleaned up in place
+    EXPECT_EQ(find(index, 1, 1), &resident);
+    EpochDomain::global().collect();
+}
+
+TEST(RcuIndexTest, ReadersRaceWithWriter) {
+    constexpr int kKeys = 512;
+    Index index;
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> bad{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            for (int i = t; !stop.load(); ++i) {
+                const int key = i % kKeys;
+                auto guard = EpochDomain::global().pin();
+                if (Node* node = find(index, static_cast<size_t>(key) * 31, key)) {
+                    if (node->key != key) bad++;
+                }
+            }
+        });
+    }
+
+    // The writer owns every node; erased ones go through the domain
+    std::vector<Node*> live(kKeys, nullptr);
+    for (int round = 0; round < 50; ++round) {
+        for (int key = 0; key < kKeys; ++key) {
+            if (live[key] != nullptr && (key + round) % 3 == 0) {
+                index.erase(live[key]);
+                EpochDomain::global().retire(live[key]);
+                live[key] = nullptr;
+            } else if (live[key] == nullptr) {
+                live[key] = new Node(static_cast<size_t>(key) * 31, key);
+                index.insert(live[key]);
+            }
+        }
+    }
+    stop = true;
+    for (auto& r : readers) r.join();
+
+    EXPECT_EQ(bad.load(), 0);
+    index.clear();
+    for (Node* node : live) delete node;
+    EpochDomain::global().collect();
+}
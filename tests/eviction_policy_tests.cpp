@@ -0,0 +1,272 @@
+#include "cache.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+//-------------------Common Tests (every policy)-------------------
+
+template <typename Policy>
+class PolicyTest : public ::testing::Test {};
+
+using Policies = ::testing::Types<LruPolicy, LfuPolicy, FifoPolicy, ArcPolicy, S3FifoPolicy>;
+TYPED_TEST_SUITE(PolicyTest, Policies);
+
+TYPED_TEST(PolicyTest, BasicOperations) {
+    BasicCache<TypeParam> cache(10);
+    cache.put("A", "Apple");
+    cache.put("B", "Banana");
+    cache.put("A", "Apricot");
+    EXPECT_EQ(cache.get("A").value(), "Apricot");
+    EXPECT_EQ(cache.get_ref("B")->view(), "Banana");
+    EXPECT_FALSE(cache.get("C").has_value());
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.keys().size(), 2);
+
+    EXPECT_TRUE(cache.erase("A"));
+    EXPECT_FALSE(cache.erase("A"));
+    EXPECT_FALSE(cache.contains("A"));
+    EXPECT_EQ(cache.size(), 1);
+
+    auto values = cache.multi_get({"B", "A"});
+    EXPECT_EQ(values[0].value(), "Banana");
+    EXPECT_FALSE(values[1].has_value());
+}
+
+TYPED_TEST(PolicyTest, StaysWithinCapacity) {
+    BasicCache<TypeParam> cache(100, 100, 4);
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = "Key" + std::to_string(i);
+        cache.put(key, "Value");
+        if (i % 3 == 0) cache.get(key);
+        if (i % 7 == 0) cache.get("Key" + std::to_string(i / 2));
+    }
+    EXPECT_LE(cache.size(), 100);
+    EXPECT_EQ(cache.size() + cache.evictions(), 1000);
+}
+
+TYPED_TEST(PolicyTest, StaysWithinMemoryBudget) {
+    CacheOptions options;
+    options.capacity_bytes = 64 * 1024;
+    options.shard_count = 2;
+    BasicCache<TypeParam> cache(options);
+    for (int i = 0; i < 2000; ++i) {
+        cache.put("Key" + std::to_string(i), std::string(static_cast<size_t>(100 + i % 300), 'x'));
+        if (i % 4 == 0) cache.get("Key" + std::to_string(i / 2));
+    }
+    EXPECT_GT(cache.size(), 0);
+    EXPECT_LE(cache.memory_used(), options.capacity_bytes);
+}
+
+TYPED_TEST(PolicyTest, ExpiredEntriesAreRemoved) {
+    BasicCache<TypeParam> cache(10, 20);
+    cache.put("Short", "1", 30);
+    cache.put("Long", "2", 60000);
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(cache.get("Short").has_value());
+    EXPECT_FALSE(cache.contains("Short"));
+    EXPECT_EQ(cache.get("Long").value(), "2");
+}
+
+TYPED_TEST(PolicyTest, ExportRestoresContents) {
+    BasicCache<TypeParam> source(50, 100, 2);
+    for (int i = 0; i < 80; ++i) {
+        source.put("Key" + std::to_string(i), "Value" + std::to_string(i));
+        if (i % 5 == 0) source.get("Key" + std::to_string(i));
+    }
+
+    BasicCache<TypeParam> target(50, 100, 2);
+    for (size_t shard = 0; shard < source.shard_count(); ++shard) {
+        std::vector<CacheItem> items;
+        auto records = source.export_shard(shard);
+        for (const auto& record : records) {
+            items.push_back({record.key, record.value.view(), record.ttl_ms});
+        }
+        target.multi_put(items);
+    }
+    EXPECT_EQ(target.size(), source.size());
+    for (const auto& key : source.keys()) {
+        EXPECT_EQ(target.get(key), source.get(key)) << key;
+    }
+}
+
+TYPED_TEST(PolicyTest, ClearResetsEveryQueue) {
+    BasicCache<TypeParam> cache(20);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            cache.put("Key" + std::to_string(i), "Value");
+            cache.get("Key" + std::to_string(i % 10));
+        }
+        cache.clear();
+        EXPECT_EQ(cache.size(), 0);
+        EXPECT_EQ(cache.memory_used(), 0);
+        EXPECT_TRUE(cache.keys().empty());
+    }
+}
+
+TYPED_TEST(PolicyTest, ConcurrentMixedWorkload) {
+    BasicCache<TypeParam> cache(200, 100, 4);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&cache, t] {
+            for (int i = 0; i < 5000; ++i) {
+                const std::string key = "Key" + std::to_string((t * 7919 + i * 31) % 500);
+                switch (i % 10) {
+                    case 0: cache.put(key, "Value" + std::to_string(i)); break;
+                    case 1: cache.erase(key); break;
+                    case 2: cache.multi_get({key, "Missing"}); break;
+                    default: cache.get(key); break;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    EXPECT_LE(cache.size(), 200);
+    EXPECT_EQ(cache.hits() + cache.misses(), static_cast<size_t>(4) * 5000 * 9 / 10);
+}
+
+TYPED_TEST(PolicyTest, OnlyLruTakesLruOptions) {
+    CacheOptions options;
+    options.capacity = 10;
+    options.eviction = EvictionPolicy::CLOCK;
+    if (std::is_same<TypeParam, LruPolicy>::value) {
+        EXPECT_NO_THROW(BasicCache<TypeParam>{options});
+    } else {
+        EXPECT_THROW(BasicCache<TypeParam>{options}, std::invalid_argument);
+        options.eviction = EvictionPolicy::LRU;
+        options.admission = AdmissionPolicy::TINY_LFU;
+        EXPECT_THROW(BasicCache<TypeParam>{options}, std::invalid_argument);
+    }
+}
+
+//-------------------Policy Behaviour Tests-------------------
+
+TEST(LfuPolicyTest, EvictsTheLeastFrequentlyUsed) {
+    BasicCache<LfuPolicy> cache(3);
+    cache.put("A", "1");
+    cache.put("B", "2");
+    cache.put("C", "3");
+    cache.get("A");
+    cache.get("A");
+    cache.get("B");
+    cache.put("D", "4");   // C has the fewest hits
+    EXPECT_FALSE(cache.contains("C"));
+
+    cache.put("E", "5");   // D is new, with as few hits as C had
+    EXPECT_FALSE(cache.contains("D"));
+    EXPECT_TRUE(cache.contains("A"));
+    EXPECT_TRUE(cache.contains("B"));
+    EXPECT_TRUE(cache.contains("E"));
+}
+
+TEST(LfuPolicyTest, TiesGoToTheOldest) {
+    BasicCache<LfuPolicy> cache(3);
+    cache.put("A", "1");
+    cache.put("B", "2");
+    cache.put("C", "3");
+    for (const char* key : {"C", "B", "A"}) cache.get(key);   // All at two hits, C the first there
+    cache.put("D", "4");
+    EXPECT_FALSE(cache.contains("C"));
+    EXPECT_EQ(cache.keys().front(), "A");   // Most valuable first
+}
+
+TEST(FifoPolicyTest, HitsDoNotChangeTheOrder) {
+    BasicCache<FifoPolicy> cache(3);
+    cache.put("A", "1");
+    cache.put("B", "2");
+    cache.put("C", "3");
+    for (int i = 0; i < 10; ++i) cache.get("A");
+    cache.put("B", "updated");   // Updates keep the position too
+    cache.put("D", "4");
+    EXPECT_FALSE(cache.contains("A"));
+    cache.put("E", "5");
+    EXPECT_FALSE(cache.contains("B"));
+    EXPECT_TRUE(cache.contains("C"));
+}
+
+TEST(ArcPolicyTest, RepeatedKeysSurviveAScan) {
+    BasicCache<ArcPolicy> arc(4);
+    BasicCache<LruPolicy> lru(4);
+
+    auto run = [](auto& cache) {
+        cache.put("A", "1");
+        cache.put("B", "2");
+        cache.get("A");
+        cache.get("B");
+        for (int i = 0; i < 20; ++i) {
+            cache.put("Scan" + std::to_string(i), "x");
+        }
+    };
+    run(arc);
+    run(lru);
+    EXPECT_TRUE(arc.contains("A"));
+    EXPECT_TRUE(arc.contains("B"));
+    EXPECT_FALSE(lru.contains("A"));   // Plain LRU is flushed by the scan
+}
+
+TEST(ArcPolicyTest, KeyRequestedAgainAfterEvictionIsKept) {
+    BasicCache<ArcPolicy> cache(3);
+    cache.put("X", "0");
+    cache.get("X");        // Frequent, so recent keys leave a ghost when evicted
+    cache.put("A", "1");
+    cache.put("B", "2");
+    cache.put("C", "3");   // A leaves, its ghost stays
+    EXPECT_FALSE(cache.contains("A"));
+
+    cache.put("A", "1");   // Ghost hit: A comes back as a frequent key
+    for (int i = 0; i < 10; ++i) {
+        cache.put("New" + std::to_string(i), "x");
+    }
+    EXPECT_TRUE(cache.contains("A"));
+}
+
+TEST(S3FifoPolicyTest, OneHitWondersLeaveFirst) {
+    BasicCache<S3FifoPolicy> cache(10);
+    for (int i = 0; i < 5; ++i) {
+        cache.put("Hot" + std::to_string(i), "h");
+        cache.get("Hot" + std::to_string(i));
+    }
+    for (int i = 0; i < 50; ++i) {
+        cache.put("Scan" + std::to_string(i), "x");
+    }
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(cache.contains("Hot" + std::to_string(i))) << i;
+    }
+    EXPECT_FALSE(cache.contains("Scan0"));
+}
+
+TEST(S3FifoPolicyTest, GhostHitGoesToMain) {
+    BasicCache<S3FifoPolicy> cache(10);
+    for (int i = 0; i < 15; ++i) {
+        cache.put("Scan" + std::to_string(i), "x");
+    }
+    ASSERT_FALSE(cache.contains("Scan0"));
+
+    cache.put("Scan0", "again");   // Remembered by the ghost queue
+    for (int i = 20; i < 40; ++i) {
+        cache.put("Scan" + std::to_string(i), "x");
+    }
+    EXPECT_EQ(cache.get("Scan0").value(), "again");
+}
+
+TEST(S3FifoPolicyTest, HitsShareTheShardLock) {
+    BasicCache<S3FifoPolicy> cache(1000);
+    for (int i = 0; i < 100; ++i) {
+        cache.put("Key" + std::to_string(i), "Value");
+    }
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&cache] {
+            for (int i = 0; i < 10000; ++i) {
+                cache.get("Key" + std::to_string(i % 100));
+            }
+        });
+    }
+    for (auto& r : readers) r.join();
+    EXPECT_EQ(cache.hits(), 40000);
+    EXPECT_EQ(cache.policy_name(), std::string("s3fifo"));
+}
@@ -0,0 +1,67 @@
+#include "frequency_sketch.h"
+#include <gtest/gtest.h>
+#include <functional>
+#include <string>
+
+static size_t key_hash(int i) {
+    return std::hash<std::string>{}("Key" + std::to_string(i));
+}
+
+TEST(FrequencySketchTest, SizedToPowerOfTwo) {
+    FrequencySketch sketch(1000);
+    EXPECT_EQ(sketch.width(), 1024);
+    EXPECT_EQ(sketch.sample_size(), FrequencySketch::kSampleFactor * 1024);
+
+    FrequencySketch tiny(0);
+    EXPECT_GT(tiny.width(), 0);
+}
+
+TEST(FrequencySketchTest, CountsOccurrences) {
+    FrequencySketch sketch(1024);
+    EXPECT_EQ(sketch.frequency(key_hash(1)), 0);
+    for (int i = 0; i < 5; i++) {
+        sketch.increment(key_hash(1));
+    }
+    sketch.increment(key_hash(2));
+
+    EXPECT_EQ(sketch.frequency(key_hash(1)), 5);
+    EXPECT_EQ(sketch.frequency(key_hash(2)), 1);
+}
+
+TEST(FrequencySketchTest, SaturatesAtMaxCount) {
+    FrequencySketch sketch(1024);
+    for (int i = 0; i < 100; i++) {
+        sketch.increment(key_hash(1));
+    }
+    EXPECT_EQ(sketch.frequency(key_hash(1)), FrequencySketch::kMaxCount);
+}
+
+TEST(FrequencySketchTest, AgingHalvesCounts) {
+    FrequencySketch sketch(16);
+    for (int i = 0; i < 12; i++) {
+        sketch.increment(key_hash(1));
+    }
+    unsigned before = sketch.frequency(key_hash(1));
+    EXPECT_EQ(before, 12);
+
+    // Enough distinct keys to reach the sample size and trigger one aging
+    size_t additions = 12;
+    for (int i = 1000; additions < sketch.sample_size(); i++, additions++) {
+        sketch.increment(key_hash(i));
+    }
+    EXPECT_LE(sketch.frequency(key_hash(1)), before / 2 + 1);
+}
+
+TEST(FrequencySketchTest, UnseenKeysEstimateLow) {
+    FrequencySketch sketch(1024);
+    for (int i = 0; i < 1024; i++) {
+        sketch.increment(key_hash(i));
+    }
+
+    // Collisions may over-estimate, but rarely by much
+    int high = 0;
+    for (int i = 100000; i < 101000; i++) {
+        if (sketch.frequency(key_hash(i)) > 1) high++;
+    }
+    EXPECT_LT(high, 50);
+}
@@ -0,0 +1,270 @@
+#include "cache.h"
+#include "hot_keys.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+size_t hash_of(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+// Every read sampled, hot set refreshed every 100 samples
+void read_mix(HotKeyTracker& tracker, const std::string& hot, int rounds) {
+    for (int i = 0; i < rounds; ++i) {
+        tracker.sample(hot, hash_of(hot));
+        const std::string cold = "Cold" + std::to_string(i);
+        tracker.sample(cold, hash_of(cold));
+    }
+}
+
+bool contains_key(const std::vector<HotKeyTracker::HotKey>& keys, const std::string& key) {
+    return std::any_of(keys.begin(), keys.end(), [&key](const HotKeyTracker::HotKey& h) { return h.key == key; });
+}
+
+// Reads the key until the cache calls it hot (default sampling: 1 in 64, refresh every 1024 samples)
+void make_hot(Cache& cache, const std::string& key) {
+    for (int i = 0; i < 200000 && !contains_key(cache.hot_keys(), key); ++i) {
+        cache.get_ref(key);
+    }
+    ASSERT_TRUE(contains_key(cache.hot_keys(), key));
+}
+
+CacheOptions hot_options() {
+    CacheOptions options;
+    options.capacity = 1000;
+    options.shard_count = 4;
+    options.eviction_interval_ms = 20;
+    options.hot_keys = 4;
+    return options;
+}
+}
+
+//-------------------Tracker Tests-------------------
+
+TEST(HotKeyTrackerTest, FindsTheHeavyHitter) {
+    HotKeyTracker tracker(2, 1, 100);
+    EXPECT_TRUE(tracker.hot_keys().empty());
+    read_mix(tracker, "Flag", 60);
+
+    auto hot = tracker.hot_keys();
+    ASSERT_EQ(hot.size(), 1);   // Cold keys were read once each
+    EXPECT_EQ(hot[0].key, "Flag");
+    EXPECT_TRUE(tracker.is_hot(hash_of("Flag")));
+}
+
+TEST(HotKeyTrackerTest, HotSetFollowsTheWorkload) {
+    HotKeyTracker tracker(1, 1, 100);
+    read_mix(tracker, "Old", 60);
+    ASSERT_EQ(tracker.hot_keys()[0].key, "Old");
+    for (int i = 0; i < 4; ++i) {
+        read_mix(tracker, "New", 50);   // Old's count halves every window
+    }
+    auto hot = tracker.hot_keys();
+    ASSERT_EQ(hot.size(), 1);
+    EXPECT_EQ(hot[0].key, "New");
+}
+
+TEST(HotKeyTrackerTest, NearCacheIsInvalidatedByVersion) {
+    HotKeyTracker tracker(2, 1, 100);
+    read_mix(tracker, "Flag", 60);
+    const size_t hash = hash_of("Flag");
+    const auto forever = HotKeyTracker::clock::time_point::max();
+    const auto now = HotKeyTracker::clock::now();
+
+    tracker.near_put("Flag", hash, *tracker.begin_fill(hash), "on", forever);
+    auto value = tracker.near_get("Flag", hash, now);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value->view(), "on");
+    EXPECT_FALSE(tracker.near_get("Other", hash_of("Other"), now).has_value());
+
+    tracker.invalidate(hash);
+    EXPECT_FALSE(tracker.near_get("Flag", hash, now).has_value());
+
+    // A copy read before a write is stale at once
+    auto ticket = *tracker.begin_fill(hash);
+    tracker.invalidate(hash);
+    tracker.near_put("Flag", hash, ticket, "off", forever);
+    EXPECT_FALSE(tracker.near_get("Flag", hash, now).has_value());
+
+    tracker.near_put("Flag", hash, *tracker.begin_fill(hash), "off", forever);
+    tracker.invalidate_all();
+    EXPECT_FALSE(tracker.near_get("Flag", hash, now).has_value());
+
+    tracker.near_put("Flag", hash, *tracker.begin_fill(hash), "off", now + 10ms);
+    EXPECT_TRUE(tracker.near_get("Flag", hash, now).has_value());
+    EXPECT_FALSE(tracker.near_get("Flag", hash, now + 20ms).has_value());
+    EXPECT_EQ(tracker.near_hits(), 2);
+}
+
+TEST(HotKeyTrackerTest, KeyLeavingTheHotSetDuringAFillIsNotServedStale) {
+    HotKeyTracker tracker(1, 1, 100);
+    read_mix(tracker, "Flag", 60);
+    const size_t hash = hash_of("Flag");
+    const auto forever = HotKeyTracker::clock::time_point::max();
+    ASSERT_TRUE(tracker.is_hot(hash));   // A read decides to fill
+
+    // The fill takes its stamps, then the key leaves the set and is overwritten
+    auto ticket = tracker.begin_fill(hash);
+    ASSERT_TRUE(ticket.has_value());
+    for (int i = 0; i < 4; ++i) {
+        read_mix(tracker, "New", 50);
+    }
+    ASSERT_FALSE(tracker.is_hot(hash));
+    tracker.invalidate(hash);   // No version bump any more
+    tracker.near_put("Flag", hash, *ticket, "on", forever);
+    EXPECT_FALSE(tracker.near_get("Flag", hash, HotKeyTracker::clock::now()).has_value());
+
+    // A fill that starts once the key has left is skipped
+    EXPECT_FALSE(tracker.begin_fill(hash).has_value());
+}
+
+TEST(HotKeyTrackerTest, NearCachesArePerThread) {
+    HotKeyTracker tracker(2, 1, 100);
+    read_mix(tracker, "Flag", 60);
+    const size_t hash = hash_of("Flag");
+    tracker.near_put("Flag", hash, *tracker.begin_fill(hash), "on", HotKeyTracker::clock::time_point::max());
+
+    bool seen = true;
+    std::thread other([&] { seen = tracker.near_get("Flag", hash, HotKeyTracker::clock::now()).has_value(); });
+    other.join();
+    EXPECT_FALSE(seen);
+    EXPECT_TRUE(tracker.near_get("Flag", hash, HotKeyTracker::clock::now()).has_value());
+}
+
+//-------------------Cache Tests-------------------
+
+TEST(HotKeyCacheTest, HotKeyIsServedFromTheNearCache) {
+    Cache cache(hot_options());
+    EXPECT_EQ(cache.hot_key_capacity(), 4);
+    cache.put("Flag", "on");
+    for (int i = 0; i < 100; ++i) {
+        cache.put("Key" + std::to_string(i), "Value");
+    }
+    make_hot(cache, "Flag");
+
+    const uint64_t near_hits = cache.near_cache_hits();
+    const size_t hits = cache.hits();
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(cache.get("Flag").value(), "on");
+    }
+    EXPECT_GT(cache.near_cache_hits(), near_hits + 900);
+    EXPECT_EQ(cache.hits(), hits + 1000);   // Near hits are hits
+    EXPECT_GE(cache.near_cache_lookups(), cache.near_cache_hits());
+}
+
+TEST(HotKeyCacheTest, WritesInvalidateNearCopies) {
+    Cache cache(hot_options());
+    cache.put("Flag", "on");
+    make_hot(cache, "Flag");
+    ASSERT_EQ(cache.get("Flag").value(), "on");
+    ASSERT_EQ(cache.get("Flag").value(), "on");
+
+    cache.put("Flag", "off");
+    EXPECT_EQ(cache.get("Flag").value(), "off");
+    EXPECT_EQ(cache.get_ref("Flag")->view(), "off");
+
+    cache.multi_put({{"Flag", "multi"}});
+    EXPECT_EQ(cache.get("Flag").value(), "multi");
+
+    EXPECT_TRUE(cache.erase("Flag"));
+    EXPECT_FALSE(cache.get("Flag").has_value());
+
+    cache.put("Flag", "back");
+    EXPECT_EQ(cache.get("Flag").value(), "back");
+    cache.clear();
+    EXPECT_FALSE(cache.get("Flag").has_value());
+}
+
+TEST(HotKeyCacheTest, KeyThatLeftTheHotSetReadsItsLatestValue) {
+    Cache cache(hot_options());
+    cache.put("Flag", "on");
+    make_hot(cache, "Flag");
+    ASSERT_EQ(cache.get("Flag").value(), "on");
+    ASSERT_EQ(cache.get("Flag").value(), "on");
+
+    for (int i = 0; i < 4; ++i) {
+        cache.put("Other" + std::to_string(i), "Value");
+    }
+    for (int i = 0; i < 2000000 && contains_key(cache.hot_keys(), "Flag"); ++i) {
+        cache.get_ref("Other" + std::to_string(i % 4));
+    }
+    ASSERT_FALSE(contains_key(cache.hot_keys(), "Flag"));
+
+    cache.put("Flag", "off");
+    EXPECT_EQ(cache.get("Flag").value(), "off");
+    EXPECT_EQ(cache.get("Flag").value(), "off");
+}
+
+TEST(HotKeyCacheTest, NearCopiesExpire) {
+    Cache cache(hot_options());
+    cache.put("Flag", "on");
+    make_hot(cache, "Flag");
+    cache.put("Flag", "on", 200);
+    EXPECT_EQ(cache.get("Flag").value(), "on");
+    EXPECT_EQ(cache.get("Flag").value(), "on");
+    std::this_thread::sleep_for(300ms);
+    EXPECT_FALSE(cache.get("Flag").has_value());
+}
+
+TEST(HotKeyCacheTest, ReadersNeverGoBackInTime) {
+    Cache cache(hot_options());
+    cache.put("Flag", "0");
+    make_hot(cache, "Flag");
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::atomic<int> regressions{0};
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            int last = 0;
+            while (!done.load()) {
+                const int seen = std::stoi(cache.get("Flag").value());
+                if (seen < last) regressions.fetch_add(1);
+                last = seen;
+            }
+            const int final_value = std::stoi(cache.get("Flag").value());
+            if (final_value != 500) regressions.fetch_add(1);
+        });
+    }
+    for (int v = 1; v <= 500; ++v) {
+        cache.put("Flag", std::to_string(v));
+        if (v % 50 == 0) std::this_thread::sleep_for(1ms);
+    }
+    done.store(true);
+    for (auto& r : readers) r.join();
+    EXPECT_EQ(regressions.load(), 0);
+}
+
+TEST(HotKeyCacheTest, OffByDefault) {
+    Cache cache(100);
+    cache.put("Flag", "on");
+    for (int i = 0; i < 100000; ++i) {
+        cache.get_ref("Flag");
+    }
+    EXPECT_TRUE(cache.hot_keys().empty());
+    EXPECT_EQ(cache.hot_key_capacity(), 0);
+    EXPECT_EQ(cache.near_cache_lookups(), 0);
+}
+
+TEST(HotKeyCacheTest, WorksWithLockFreeReads) {
+    CacheOptions options = hot_options();
+    options.eviction = EvictionPolicy::CLOCK;
+    options.lock_free_reads = true;
+    Cache cache(options);
+    cache.put("Flag", "on");
+    make_hot(cache, "Flag");
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(cache.get("Flag").value(), "on");
+    }
+    EXPECT_GT(cache.near_cache_hits(), 0);
+    cache.put("Flag", "off");
+    EXPECT_EQ(cache.get("Flag").value(), "off");
+}
@@ -0,0 +1,129 @@
+#include "logger.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// Sink collecting every line, with the timestamp cut off
+struct Lines {
+    std::mutex mutex;
+    std::vector<std::string> lines;
+
+    Logger::Sink sink() {
+        return [this](std::string_view batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::istringstream in{std::string(batch)};
+            for (std::string line; std::getline(in, line);) {
+                EXPECT_EQ(line.front(), '[');
+                lines.push_back(line.substr(line.find("] ") + 2));
+            }
+        };
+    }
+
+    std::vector<std::string> take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::move(lines);
+    }
+};
+}
+
+TEST(LoggerTest, LevelsAndFormatting) {
+    Lines out;
+    Logger logger(out.sink());
+    logger.log(LogLevel::Info, "GET ", std::string("/cache/a"), " -> ", 200);
+    logger.log(LogLevel::Debug, "not shown");
+    logger.log(LogLevel::Warn, "Failed PUT replication to ", std::string_view("b:5000"), ' ', -1);
+    logger.set_level(LogLevel::Debug);
+    logger.log(LogLevel::Debug, "count=", size_t{42});
+    logger.set_level(LogLevel::Off);
+    logger.log(LogLevel::Error, "not shown either");
+    logger.flush();
+
+    EXPECT_EQ(out.take(), (std::vector<std::string>{"GET /cache/a -> 200", "WARN Failed PUT replication to b:5000 -1",
+                                                     "DEBUG count=42"}));
+    EXPECT_EQ(logger.written(), 3u);
+    EXPECT_EQ(logger.dropped(), 0u);
+}
+
+TEST(LoggerTest, LongMessagesAreCut) {
+    Lines out;
+    Logger logger(out.sink());
+    logger.log(LogLevel::Info, std::string(300, 'x'), 12345);
+    logger.flush();
+    auto lines = out.take();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0], std::string(Logger::kMaxMessage, 'x'));
+}
+
+TEST(LoggerTest, AccessLinesAreSampled) {
+    Lines out;
+    Logger logger(out.sink());
+    logger.set_access_sampling(4);
+    for (int i = 0; i < 100; ++i) logger.access("GET /cache/k -> ", 200);
+    logger.set_access_sampling(0);
+    logger.access("GET /cache/k -> ", 200);
+    logger.log(LogLevel::Info, "other lines are not sampled");
+    logger.flush();
+    auto lines = out.take();
+    EXPECT_EQ(lines.size(), 26u);
+    EXPECT_EQ(lines.back(), "other lines are not sampled");
+}
+
+TEST(LoggerTest, FullRingDropsAndCounts) {
+    // A sink that hangs: logging must still return at once
+    std::atomic<bool> release{false};
+    std::atomic<int> batches{0};
+    std::string last;
+    Logger logger([&](std::string_view batch) {
+        if (batches.fetch_add(1) == 0) {
+            while (!release.load()) std::this_thread::sleep_for(1ms);
+        }
+        last = std::string(batch);
+    }, 16);
+
+    logger.log(LogLevel::Info, "first");
+    while (batches.load() == 0) std::this_thread::sleep_for(1ms);   // The drain is now stuck in the sink
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i) logger.log(LogLevel::Info, "line ", i);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 100ms);
+    EXPECT_EQ(logger.dropped(), 100u - 16u);
+
+    release.store(true);
+    logger.flush();
+    EXPECT_NE(last.find("line 15\n"), std::string::npos);
+    EXPECT_EQ(last.find("line 16\n"), std::string::npos);
+    EXPECT_NE(last.find("WARN logger dropped 84 messages (ring full)"), std::string::npos);
+}
+
+TEST(LoggerTest, ManyThreadsKeepTheirOrder) {
+    Lines out;
+    Logger logger(out.sink(), 4096);
+    for (int round = 0; round < 2; ++round) {   // The second round reuses the exited threads' rings
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&logger, t] {
+                for (int i = 0; i < 500; ++i) logger.log(LogLevel::Info, "t", t, ' ', i);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        logger.flush();
+    }
+
+    std::vector<int> next(8, 0);
+    for (const auto& line : out.take()) {
+        const int t = std::stoi(line.substr(1));
+        const int i = std::stoi(line.substr(line.find(' ') + 1));
+        EXPECT_EQ(i, next[t] % 500);
+        ++next[t];
+    }
+    for (int count : next) EXPECT_EQ(count, 1000);
+    EXPECT_EQ(logger.dropped(), 0u);
+}
@@ -0,0 +1,252 @@
+#include "memcached_server.h"
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// Blocking text-protocol client
+class Client {
+public:
+    explicit Client(int port) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        connected_ = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        timeval timeout{5, 0};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    ~Client() { ::close(fd_); }
+
+    bool connected() const { return connected_; }
+
+    void send(const std::string& bytes) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            const ssize_t n = ::send(fd_, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // Everything received until the buffer ends with `terminator` (or the peer closes)
+    std::string read_until(const std::string& terminator) {
+        while (buffer_.size() < terminator.size() ||
+               buffer_.compare(buffer_.size() - terminator.size(), terminator.size(), terminator) != 0) {
+            char chunk[65536];
+            const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+        std::string out;
+        out.swap(buffer_);
+        return out;
+    }
+
+    std::string call(const std::string& request, const std::string& terminator = "\r\n") {
+        send(request);
+        return read_until(terminator);
+    }
+
+    // true once the server has closed the connection
+    bool closed() {
+        char byte;
+        return ::recv(fd_, &byte, 1, 0) == 0;
+    }
+
+private:
+    int fd_ = -1;
+    bool connected_ = false;
+    std::string buffer_;
+};
+
+struct Server {
+    std::shared_ptr<Cache> cache = std::make_shared<Cache>(1000, 20, 4);
+    MemcachedServer server{cache, 2};
+    Server() { server.start("127.0.0.1", 0); }
+};
+}
+
+TEST(MemcachedTest, SetGetDelete) {
+    Server s;
+    Client c(s.server.port());
+    ASSERT_TRUE(c.connected());
+
+    EXPECT_EQ(c.call("set greeting 0 0 5\r\nhello\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("get greeting\r\n", "END\r\n"), "VALUE greeting 0 5\r\nhello\r\nEND\r\n");
+    EXPECT_EQ(s.cache->get("greeting").value(), "hello");   // Same cache as the REST API
+
+    s.cache->put("from_rest", "value\r\nwith CRLF");
+    EXPECT_EQ(c.call("get from_rest\r\n", "END\r\n"), "VALUE from_rest 0 16\r\nvalue\r\nwith CRLF\r\nEND\r\n");
+
+    EXPECT_EQ(c.call("delete greeting\r\n"), "DELETED\r\n");
+    EXPECT_EQ(c.call("delete greeting\r\n"), "NOT_FOUND\r\n");
+    EXPECT_EQ(c.call("get greeting\r\n", "END\r\n"), "END\r\n");
+}
+
+TEST(MemcachedTest, MultiGetAndGets) {
+    Server s;
+    Client c(s.server.port());
+    c.call("set a 0 0 1\r\n1\r\n");
+    c.call("set b 0 0 2\r\n22\r\n");
+    EXPECT_EQ(c.call("get a missing b\r\n", "END\r\n"), "VALUE a 0 1\r\n1\r\nVALUE b 0 2\r\n22\r\nEND\r\n");
+
+    const std::string first = c.call("gets a\r\n", "END\r\n");
+    EXPECT_EQ(first.rfind("VALUE a 0 1 ", 0), 0u);
+    EXPECT_EQ(c.call("gets a\r\n", "END\r\n"), first);   // Unchanged value, same cas
+    c.call("set a 0 0 1\r\n2\r\n");
+    EXPECT_NE(c.call("gets a\r\n", "END\r\n"), first);
+}
+
+TEST(MemcachedTest, MultiGetLongerThanACommandLine) {
+    Server s;
+    Client c(s.server.port());
+    c.call("set present 0 0 3\r\nyes\r\n");
+    std::string line = "get";
+    for (int i = 0; i < 40; ++i) {
+        line += " " + std::string(200, static_cast<char>('a' + i % 26)) + std::to_string(i);
+    }
+    line += " present\r\n";
+    ASSERT_GT(line.size(), 2048u);
+    EXPECT_EQ(c.call(line, "END\r\n"), "VALUE present 0 3\r\nyes\r\nEND\r\n");
+
+    // Other commands keep the short line limit
+    EXPECT_EQ(c.call("set " + std::string(4096, 'k')), "CLIENT_ERROR line too long\r\n");
+    EXPECT_TRUE(c.closed());
+}
+
+TEST(MemcachedTest, FlagsAreKeptWithTheValue) {
+    Server s;
+    Client c(s.server.port());
+    EXPECT_EQ(c.call("set a 42 0 1\r\n1\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("set big 4294967295 0 2\r\n22\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("set empty 7 0 0\r\n\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("get a big empty\r\n", "END\r\n"),
+              "VALUE a 42 1\r\n1\r\nVALUE big 4294967295 2\r\n22\r\nVALUE empty 7 0\r\n\r\nEND\r\n");
+    EXPECT_EQ(c.call("gets a\r\n", "END\r\n").rfind("VALUE a 42 1 ", 0), 0u);
+
+    // incr keeps them; a new set replaces them, and so does a REST put
+    EXPECT_EQ(c.call("incr a 1\r\n"), "2\r\n");
+    EXPECT_EQ(c.call("get a\r\n", "END\r\n"), "VALUE a 42 1\r\n2\r\nEND\r\n");
+    auto cas = [&c] {
+        std::string line = c.call("gets a\r\n", "END\r\n");
+        line = line.substr(0, line.find('\r'));
+        return line.substr(line.rfind(' ') + 1);
+    };
+    const std::string before = cas();
+    c.call("set a 5 0 1\r\n2\r\n");
+    EXPECT_EQ(c.call("get a\r\n", "END\r\n"), "VALUE a 5 1\r\n2\r\nEND\r\n");
+    EXPECT_NE(cas(), before);   // Same bytes, new flags
+    s.cache->put("a", "3");
+    EXPECT_EQ(c.call("get a\r\n", "END\r\n"), "VALUE a 0 1\r\n3\r\nEND\r\n");
+
+    EXPECT_EQ(c.call("set a 4294967296 0 1\r\n"), "CLIENT_ERROR bad command line format\r\n");
+}
+
+TEST(MemcachedTest, IncrAndDecr) {
+    Server s;
+    Client c(s.server.port());
+    c.call("set n 0 0 2\r\n10\r\n");
+    EXPECT_EQ(c.call("incr n 5\r\n"), "15\r\n");
+    EXPECT_EQ(c.call("decr n 100\r\n"), "0\r\n");
+    EXPECT_EQ(c.call("incr missing 1\r\n"), "NOT_FOUND\r\n");
+    c.call("set word 0 0 3\r\nabc\r\n");
+    EXPECT_EQ(c.call("incr word 1\r\n"), "CLIENT_ERROR cannot increment or decrement non-numeric value\r\n");
+    EXPECT_EQ(c.call("incr n x\r\n"), "CLIENT_ERROR invalid numeric delta argument\r\n");
+    EXPECT_EQ(s.cache->get("n").value(), "0");
+}
+
+TEST(MemcachedTest, PipelinedCommandsAnswerInOrder) {
+    Server s;
+    Client c(s.server.port());
+    std::string batch, expected;
+    for (int i = 0; i < 200; ++i) {
+        const std::string key = "k" + std::to_string(i);
+        const std::string value = "v" + std::to_string(i);
+        batch += "set " + key + " 0 0 " + std::to_string(value.size()) + (i % 2 ? " noreply" : "") + "\r\n" + value + "\r\n";
+        batch += "get " + key + "\r\n";
+        if (i % 2 == 0) expected += "STORED\r\n";
+        expected += "VALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+    }
+    batch += "version\r\n";
+    expected += "VERSION DistributedCachePP\r\n";
+    EXPECT_EQ(c.call(batch, "VERSION DistributedCachePP\r\n"), expected);
+}
+
+TEST(MemcachedTest, CommandsSplitAcrossPackets) {
+    Server s;
+    Client c(s.server.port());
+    for (const char* piece : {"se", "t split 0 0 11\r", "\nhello", " worl", "d\r\nget sp", "lit\r\n"}) {
+        c.send(piece);
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ(c.read_until("END\r\n"), "STORED\r\nVALUE split 0 11\r\nhello world\r\nEND\r\n");
+}
+
+TEST(MemcachedTest, LargeValues) {
+    Server s;
+    Client c(s.server.port());
+    const std::string big(600 * 1024, 'x');   // Sent from the cache's block
+    EXPECT_EQ(c.call("set big 0 0 " + std::to_string(big.size()) + "\r\n" + big + "\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("get big big\r\n", "END\r\n"),
+              "VALUE big 0 614400\r\n" + big + "\r\nVALUE big 0 614400\r\n" + big + "\r\nEND\r\n");
+
+    // Over the item size limit: refused, and the data block is skipped
+    const std::string huge(2 << 20, 'y');
+    EXPECT_EQ(c.call("set huge 0 0 " + std::to_string(huge.size()) + "\r\n" + huge + "\r\n"),
+              "SERVER_ERROR object too large for cache\r\n");
+    EXPECT_EQ(c.call("get huge\r\n", "END\r\n"), "END\r\n");
+}
+
+TEST(MemcachedTest, Expiry) {
+    Server s;
+    Client c(s.server.port());
+    EXPECT_EQ(c.call("set short 0 1 1\r\na\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("set gone 0 -1 1\r\nb\r\n"), "STORED\r\n");
+    EXPECT_EQ(c.call("get gone\r\n", "END\r\n"), "END\r\n");
+    const std::string later = std::to_string(std::time(nullptr) + 3600);
+    EXPECT_EQ(c.call("set absolute 0 " + later + " 1\r\nc\r\n"), "STORED\r\n");
+    std::this_thread::sleep_for(1200ms);
+    EXPECT_EQ(c.call("get short absolute\r\n", "END\r\n"), "VALUE absolute 0 1\r\nc\r\nEND\r\n");
+}
+
+TEST(MemcachedTest, ProtocolErrors) {
+    Server s;
+    Client c(s.server.port());
+    EXPECT_EQ(c.call("bogus\r\n"), "ERROR\r\n");
+    EXPECT_EQ(c.call("set k 0 0\r\n"), "CLIENT_ERROR bad command line format\r\n");
+    EXPECT_EQ(c.call("get " + std::string(251, 'k') + "\r\n"), "CLIENT_ERROR bad command line format\r\n");
+    EXPECT_EQ(c.call("set k 0 0 2\r\nabcd\r\n"), "CLIENT_ERROR bad data chunk\r\n");
+    EXPECT_EQ(c.call("get k\r\n", "END\r\n"), "END\r\n");
+    c.send("quit\r\n");
+    EXPECT_TRUE(c.closed());
+}
+
+TEST(MemcachedTest, ManyClients) {
+    Server s;
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 8; ++t) {
+        clients.emplace_back([&s, t] {
+            Client c(s.server.port());
+            for (int i = 0; i < 200; ++i) {
+                const std::string key = "t" + std::to_string(t) + "-" + std::to_string(i % 20);
+                const std::string value = std::to_string(i);
+                EXPECT_EQ(c.call("set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n"),
+                          "STORED\r\n");
+                EXPECT_EQ(c.call("get " + key + "\r\n", "END\r\n"),
+                          "VALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n");
+            }
+        });
+    }
+    for (auto& c : clients) c.join();
+    EXPECT_EQ(s.server.commands(), 8u * 400u);
+}
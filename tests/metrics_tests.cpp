@@ -0,0 +1,75 @@
+#include "metrics.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MetricsTest, CounterSumsAcrossThreads) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 10000; i++) counter.inc();
+        });
+    }
+    for (auto& th : threads) th.join();
+    counter.inc(5);
+    EXPECT_EQ(counter.value(), 80005);
+}
+
+TEST(MetricsTest, GaugeGoesUpAndDown) {
+    Gauge gauge;
+    gauge.inc();
+    gauge.inc();
+    std::thread([&gauge]() { gauge.dec(); }).join();
+    EXPECT_EQ(gauge.value(), 1);
+    gauge.add(-3);
+    EXPECT_EQ(gauge.value(), -2);
+}
+
+TEST(MetricsTest, HistogramBucketsAreCumulative) {
+    Histogram histogram({0.1, 1, 10});
+    for (double v : {0.05, 0.1, 0.5, 5.0, 50.0}) {
+        histogram.observe(v);
+    }
+    std::thread([&histogram]() { histogram.observe(0.5); }).join();
+
+    auto snap = histogram.snapshot();
+    EXPECT_EQ(snap.buckets, (std::vector<uint64_t>{2, 4, 5, 6}));
+    EXPECT_EQ(snap.count, 6);
+    EXPECT_DOUBLE_EQ(snap.sum, 56.15);
+}
+
+TEST(MetricsTest, RegistryRendersPrometheusText) {
+    MetricsRegistry registry;
+    Counter& gets = registry.counter("requests_total", "Requests served", "method=\"GET\"");
+    Counter& puts = registry.counter("requests_total", "Requests served", "method=\"PUT\"");
+    EXPECT_EQ(&gets, &registry.counter("requests_total", "Requests served", "method=\"GET\""));
+    gets.inc(3);
+    puts.inc();
+    registry.gauge_fn("memory_bytes", "Memory in use", []() { return 123456789.0; });
+    registry.gauge_fn("ratio", "A fraction", []() { return 0.25; });
+    registry.histogram("latency_seconds", "Latency", {0.5, 1}).observe(0.75);
+
+    const std::string text = registry.render();
+    EXPECT_NE(text.find("# TYPE requests_total counter\n"
+                        "requests_total{method=\"GET\"} 3\n"
+                        "requests_total{method=\"PUT\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("memory_bytes 123456789\n"), std::string::npos);
+    EXPECT_NE(text.find("ratio 0.25\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE latency_seconds histogram\n"
+                        "latency_seconds_bucket{le=\"0.5\"} 0\n"
+                        "latency_seconds_bucket{le=\"1\"} 1\n"
+                        "latency_seconds_bucket{le=\"+Inf\"} 1\n"
+                        "latency_seconds_sum 0.75\n"
+                        "latency_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(MetricsTest, CallbackFamilyRendersLabelledSeries) {
+    MetricsRegistry registry;
+    registry.gauge_family_fn("slab_pages", "Pages per class", []() {
+        return std::vector<MetricsRegistry::Sample>{{"chunk_size=\"64\"", 2}, {"chunk_size=\"128\"", 1}};
+    });
+    const std::string text = registry.render();
+    EXPECT_NE(text.find("slab_pages{chunk_size=\"64\"} 2\nslab_pages{chunk_size=\"128\"} 1\n"), std::string::npos);
+}
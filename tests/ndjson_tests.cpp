@@ -0,0 +1,139 @@
+#include "ndjson.h"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Stored {
+    std::string key;
+    std::string value;
+    uint64_t ttl_ms;
+};
+
+// Importer that copies every record it is handed and counts the batches
+struct Collector {
+    std::vector<Stored> records;
+    size_t batches = 0;
+    NdjsonImporter importer;
+
+    explicit Collector(size_t batch = NdjsonImporter::kDefaultBatch)
+        : importer([this](const std::vector<CacheItem>& items) {
+              ++batches;
+              for (const auto& item : items) {
+                  records.push_back({std::string(item.key), std::string(item.value), item.ttl_ms});
+              }
+          }, batch) {}
+};
+
+} // namespace
+
+TEST(NdjsonTest, RecordsRoundTripAnyBytes) {
+    const std::string key("bin\0\xff\x01\"\\/key", 12);
+    const std::string value = "line\nbreak \t tab \xc3\xa9 \x7f";
+    std::string body;
+    append_ndjson_record(body, key, value, 1500);
+    append_ndjson_record(body, "plain", "", 0);
+    EXPECT_EQ(body.back(), '\n');
+    EXPECT_EQ(body.substr(body.find("{\"key\":\"plain")), "{\"key\":\"plain\",\"value\":\"\",\"ttl\":0}\n");
+
+    Collector out;
+    out.importer.feed(body);
+    out.importer.finish();
+    ASSERT_EQ(out.records.size(), 2u);
+    EXPECT_EQ(out.records[0].key, key);
+    EXPECT_EQ(out.records[0].value, value);
+    EXPECT_EQ(out.records[0].ttl_ms, 1500u);
+    EXPECT_EQ(out.records[1].key, "plain");
+    EXPECT_EQ(out.importer.records(), 2u);
+}
+
+TEST(NdjsonTest, BinaryRecordsAreValidJson) {
+    std::string binary;
+    for (int b = 0; b < 256; b++) binary.push_back(static_cast<char>(b));
+    const std::string utf8 = "caf\xc3\xa9 \xf0\x9f\x98\x80";
+    std::string body;
+    append_ndjson_record(body, "bin", binary, 0);
+    append_ndjson_record(body, utf8, "\xc3\xa9\xff", 0);   // UTF-8 key, value cut mid-character
+    append_ndjson_record(body, utf8, utf8, 0);
+
+    // Every line parses as JSON; only records that are not UTF-8 are latin1
+    std::vector<nlohmann::json> lines;
+    for (size_t pos = 0; pos < body.size();) {
+        const size_t end = body.find('\n', pos);
+        lines.push_back(nlohmann::json::parse(body.substr(pos, end - pos)));
+        pos = end + 1;
+    }
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0]["encoding"], "latin1");
+    EXPECT_EQ(lines[1]["encoding"], "latin1");
+    EXPECT_FALSE(lines[2].contains("encoding"));
+    EXPECT_EQ(lines[2]["value"], utf8);
+
+    Collector out;
+    out.importer.feed(body);
+    out.importer.finish();
+    ASSERT_EQ(out.records.size(), 3u);
+    EXPECT_EQ(out.records[0].value, binary);
+    EXPECT_EQ(out.records[1].key, utf8);
+    EXPECT_EQ(out.records[1].value, "\xc3\xa9\xff");
+    EXPECT_EQ(out.records[2].value, utf8);
+
+    EXPECT_TRUE(is_utf8(utf8));
+    for (const char* bad : {"\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xe2\x82"}) {
+        EXPECT_FALSE(is_utf8(bad)) << bad;   // Overlong, surrogate, past U+10FFFF, truncated
+    }
+}
+
+TEST(NdjsonTest, ParsesAcrossPiecesAndBatches) {
+    std::string body;
+    for (int i = 0; i < 10; i++) {
+        append_ndjson_record(body, "k" + std::to_string(i), "v" + std::to_string(i), i);
+    }
+    body += "\r\n  \n";                                                   // Blank lines
+    body += R"( { "ttl" : 7 , "value" : "é😀\n" , "key" : "esc" } )";   // No final newline
+
+    Collector out(4);
+    for (char c : body) {
+        out.importer.feed(std::string_view(&c, 1));   // Worst case: one byte at a time
+    }
+    EXPECT_EQ(out.records.size(), 8u);   // Two full batches so far
+    out.importer.finish();
+
+    ASSERT_EQ(out.records.size(), 11u);
+    EXPECT_EQ(out.batches, 3u);
+    EXPECT_EQ(out.records[9].key, "k9");
+    EXPECT_EQ(out.records[9].ttl_ms, 9u);
+    EXPECT_EQ(out.records[10].key, "esc");
+    EXPECT_EQ(out.records[10].value, "\xc3\xa9\xf0\x9f\x98\x80\n");
+    EXPECT_EQ(out.records[10].ttl_ms, 7u);
+}
+
+TEST(NdjsonTest, MalformedLinesAreReportedAfterTheRecordsBeforeThem) {
+    const std::vector<std::pair<std::string, std::string>> bad = {
+        {"[1]", "expected an object"},
+        {R"({"key":"a"})", "missing value"},
+        {R"({"key":"a","value":"b","extra":1})", "unknown field"},
+        {R"({"key":"a","value":"b","encoding":"utf16"})", "unknown encoding"},
+        {R"({"encoding":"latin1","key":"a","value":"\u0100"})", "above U+00FF"},
+        {R"({"key":"a","value":"b","ttl":-1})", "ttl"},
+        {R"({"key":"a","value":"b})", "unterminated string"},
+        {R"({"key":"a","value":"\ud800"})", "surrogate"},
+        {R"({"key":"a","value":"\q"})", "invalid escape"},
+        {R"({"key":"a","value":"b"} x)", "unexpected text"},
+    };
+    for (const auto& [line, message] : bad) {
+        Collector out;
+        try {
+            out.importer.feed("{\"key\":\"ok\",\"value\":\"1\"}\n" + line + "\n");
+            FAIL() << line;
+        } catch (const std::invalid_argument& e) {
+            EXPECT_NE(std::string(e.what()).find("line 2: "), std::string::npos) << e.what();
+            EXPECT_NE(std::string(e.what()).find(message), std::string::npos) << e.what();
+        }
+        ASSERT_EQ(out.records.size(), 1u) << line;
+        EXPECT_EQ(out.records[0].key, "ok");
+    }
+}
@@ -0,0 +1,238 @@
+#include "oplog.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Log file in the test's working directory, removed at the end
+class OpLogTest : public ::testing::Test {
+protected:
+    void TearDown() override { std::remove(path.c_str()); }
+
+    std::string path = ::testing::UnitTest::GetInstance()->current_test_info()->name() + std::string(".aof");
+};
+
+TEST_F(OpLogTest, ReplaysPutsAndErases) {
+    {
+        OpLog log(std::make_shared<Cache>(100), path, FsyncPolicy::NO);
+        log.put("A", "Apple");
+        log.put("B", std::string("bin\0ary", 7));
+        log.put("C", "Cherry");
+        log.put("A", "Apricot");
+        EXPECT_TRUE(log.erase("C"));
+        EXPECT_FALSE(log.erase("Missing"));
+        log.multi_put({{"D", "Date", 0}, {"E", "Elder", 60000}});
+        EXPECT_EQ(log.multi_erase({"E", "Missing"}), 1);
+    }
+
+    auto cache = std::make_shared<Cache>(100);
+    OpLogReplayResult result;
+    OpLog log(cache, path, FsyncPolicy::NO, &result);
+    EXPECT_EQ(result.puts, 6);
+    EXPECT_EQ(result.erases, 3);   // "Missing" is logged once, by the batch that removed "E"
+    EXPECT_EQ(result.truncated_bytes, 0);
+    EXPECT_EQ(cache->size(), 3);
+    EXPECT_EQ(cache->get("A").value(), "Apricot");
+    EXPECT_EQ(cache->get("B").value(), std::string("bin\0ary", 7));
+    EXPECT_EQ(cache->get("D").value(), "Date");
+    EXPECT_FALSE(cache->contains("C"));
+    EXPECT_FALSE(cache->contains("E"));
+}
+
+TEST_F(OpLogTest, NewLogStartsWithTheCacheContents) {
+    auto cache = std::make_shared<Cache>(100);
+    cache->put("Preloaded", "1");   // e.g. from a snapshot
+    {
+        OpLog log(cache, path, FsyncPolicy::NO);
+        log.put("Logged", "2");
+    }
+
+    Cache target(100);
+    OpLog::replay(target, path);
+    EXPECT_EQ(target.get("Preloaded").value(), "1");
+    EXPECT_EQ(target.get("Logged").value(), "2");
+}
+
+TEST_F(OpLogTest, CutsOffATornTail) {
+    {
+        OpLog log(std::make_shared<Cache>(100), path, FsyncPolicy::NO);
+        log.put("A", "Apple");
+        log.put("B", "Banana");
+    }
+    const auto intact = std::filesystem::file_size(path);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "\x12\x34 half a record";   // Crash in the middle of a write
+    }
+
+    auto cache = std::make_shared<Cache>(100);
+    OpLogReplayResult result;
+    {
+        OpLog log(cache, path, FsyncPolicy::NO, &result);
+        EXPECT_EQ(result.valid_bytes, intact);
+        EXPECT_EQ(result.truncated_bytes, 16);
+        EXPECT_EQ(std::filesystem::file_size(path), intact);
+        log.put("C", "Cherry");   // Appended after the cut, not after the garbage
+    }
+    EXPECT_EQ(cache->get("B").value(), "Banana");
+
+    Cache target(100);
+    result = OpLog::replay(target, path);
+    EXPECT_EQ(result.truncated_bytes, 0);
+    EXPECT_EQ(target.get("C").value(), "Cherry");
+}
+
+TEST_F(OpLogTest, StopsAtACorruptRecord) {
+    {
+        OpLog log(std::make_shared<Cache>(100), path, FsyncPolicy::NO);
+        log.put("A", "Apple");
+        log.put("B", "Banana");
+    }
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('X');   // Last byte of "Banana"
+    }
+
+    Cache target(100);
+    OpLogReplayResult result = OpLog::replay(target, path);
+    EXPECT_EQ(result.puts, 1);
+    EXPECT_GT(result.truncated_bytes, 0);
+    EXPECT_TRUE(target.contains("A"));
+    EXPECT_FALSE(target.contains("B"));
+}
+
+TEST_F(OpLogTest, RejectsOtherFiles) {
+    std::ofstream(path) << "not an operation log";
+    Cache target(100);
+    EXPECT_THROW(OpLog::replay(target, path), std::runtime_error);
+    EXPECT_THROW(OpLog(std::make_shared<Cache>(100), path, FsyncPolicy::NO), std::runtime_error);
+}
+
+TEST_F(OpLogTest, ExpiryIsAbsolute) {
+    {
+        OpLog log(std::make_shared<Cache>(100), path, FsyncPolicy::NO);
+        log.put("Forever", "1");
+        log.put("Long", "2", 60000);
+        log.put("Short", "3", 30);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));   // Short runs out while "down"
+
+    Cache target(100);
+    target.put("Short", "stale");   // An expired put still ends the key
+    OpLogReplayResult result = OpLog::replay(target, path);
+    EXPECT_EQ(result.puts, 2);
+    EXPECT_EQ(result.erases, 1);
+    EXPECT_TRUE(target.contains("Forever"));
+    EXPECT_TRUE(target.contains("Long"));
+    EXPECT_FALSE(target.contains("Short"));
+}
+
+TEST_F(OpLogTest, RewriteCompactsToTheLiveContents) {
+    {
+        OpLog log(std::make_shared<Cache>(100), path, FsyncPolicy::EVERYSEC);
+        for (int i = 0; i < 1000; ++i) {
+            log.put("Hot", "value" + std::to_string(i));
+        }
+        log.put("Gone", "x");
+        log.erase("Gone");
+        log.put("Cold", "y");
+
+        // size_bytes() counts what the writer has handed to the file; let it catch up
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (log.size_bytes() < 1000 * 30 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const uint64_t before = log.size_bytes();
+        ASSERT_TRUE(log.rewrite());
+        EXPECT_LT(log.size_bytes(), before / 10);
+        EXPECT_EQ(log.size_bytes(), std::filesystem::file_size(path));
+
+        log.put("After", "z");   // Writes keep going to the new file
+    }
+
+    Cache target(100);
+    OpLogReplayResult result = OpLog::replay(target, path);
+    EXPECT_EQ(result.puts, 3);
+    EXPECT_EQ(result.erases, 0);
+    EXPECT_EQ(target.get("Hot").value(), "value999");
+    EXPECT_EQ(target.get("Cold").value(), "y");
+    EXPECT_EQ(target.get("After").value(), "z");
+    EXPECT_FALSE(target.contains("Gone"));
+}
+
+TEST_F(OpLogTest, RewriteKeepsConcurrentWrites) {
+    auto cache = std::make_shared<Cache>(100000, 100, 8);
+    OpLog log(cache, path, FsyncPolicy::NO);
+    for (int i = 0; i < 10000; ++i) {
+        log.put("k" + std::to_string(i), "old");
+    }
+
+    std::thread writer([&] {
+        for (int i = 0; i < 10000; ++i) {
+            log.put("k" + std::to_string(i), "new");
+        }
+    });
+    while (log.rewrite()) {
+        if (cache->get("k9999") == std::optional<std::string>("new")) break;
+    }
+    writer.join();
+    log.rewrite();
+
+    Cache target(100000, 100, 8);
+    OpLog::replay(target, path);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(target.get("k" + std::to_string(i)).value(), "new") << i;
+    }
+}
+
+TEST_F(OpLogTest, AlwaysIsDurableOnReturn) {
+    OpLog log(std::make_shared<Cache>(1000), path, FsyncPolicy::ALWAYS);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&log, t] {
+            for (int i = 0; i < 50; ++i) {
+                log.put("t" + std::to_string(t) + "-" + std::to_string(i), "v");
+            }
+        });
+    }
+    for (auto& w : writers) w.join();
+
+    // Still open: everything acknowledged is already in the file
+    Cache target(1000);
+    OpLogReplayResult result = OpLog::replay(target, path);
+    EXPECT_EQ(result.puts, 200);
+    EXPECT_EQ(target.size(), 200);
+}
+
+TEST_F(OpLogTest, ParallelReplayKeepsPerKeyOrder) {
+    {
+        OpLog log(std::make_shared<Cache>(100000, 100, 16), path, FsyncPolicy::NO);
+        for (int round = 0; round < 5; ++round) {
+            for (int i = 0; i < 5000; ++i) {
+                log.put("k" + std::to_string(i), "r" + std::to_string(round));
+            }
+            for (int i = round; i < 5000; i += 7) {
+                log.erase("k" + std::to_string(i));
+            }
+        }
+    }
+
+    Cache serial(100000, 100, 16);
+    Cache parallel(100000, 100, 16);
+    OpLogReplayResult one = OpLog::replay(serial, path, 1);
+    OpLogReplayResult many = OpLog::replay(parallel, path, 4);
+    EXPECT_EQ(one.puts, many.puts);
+    EXPECT_EQ(one.erases, many.erases);
+    EXPECT_EQ(serial.size(), parallel.size());
+    for (int i = 0; i < 5000; ++i) {
+        std::string key = "k" + std::to_string(i);
+        ASSERT_EQ(serial.get(key), parallel.get(key)) << key;
+    }
+    EXPECT_FALSE(parallel.contains("k4"));          // Erased in the last round
+    EXPECT_EQ(parallel.get("k5").value(), "r4");
+}
@@ -0,0 +1,47 @@
+#include "rate_limiter.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+TEST(RateLimiterTest, AllowsABurstThenRefills) {
+    RateLimiter limiter(10, 3);   // 10/s, 3 at once
+    const auto t0 = RateLimiter::Clock::now();
+
+    EXPECT_TRUE(limiter.allow("a", t0));
+    EXPECT_TRUE(limiter.allow("a", t0));
+    EXPECT_TRUE(limiter.allow("a", t0));
+    EXPECT_FALSE(limiter.allow("a", t0));
+    EXPECT_EQ(limiter.refused(), 1u);
+
+    EXPECT_FALSE(limiter.allow("a", t0 + 50ms));   // Half a token so far
+    EXPECT_TRUE(limiter.allow("a", t0 + 100ms));
+    EXPECT_FALSE(limiter.allow("a", t0 + 100ms));
+
+    // A long pause refills up to the burst only
+    const auto later = t0 + 10s;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(limiter.allow("a", later));
+    }
+    EXPECT_FALSE(limiter.allow("a", later));
+}
+
+TEST(RateLimiterTest, ClientsHaveTheirOwnBuckets) {
+    RateLimiter limiter(1, 1);
+    const auto now = RateLimiter::Clock::now();
+    EXPECT_TRUE(limiter.allow("10.0.0.1", now));
+    EXPECT_FALSE(limiter.allow("10.0.0.1", now));
+    EXPECT_TRUE(limiter.allow("10.0.0.2", now));
+    EXPECT_EQ(limiter.clients(), 2u);
+}
+
+TEST(RateLimiterTest, ForgetsIdleClients) {
+    RateLimiter limiter(100, 1);
+    const auto t0 = RateLimiter::Clock::now();
+    for (int i = 0; i < 100000; ++i) {
+        limiter.allow("client-" + std::to_string(i), t0 + std::chrono::milliseconds(i));
+    }
+    // Buckets idle for 10 ms or more are full again and get dropped as the stripes grow
+    EXPECT_LT(limiter.clients(), 16u * 4096 + 16);
+}
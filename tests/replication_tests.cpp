@@ -2,7 +2,15 @@
 #include <httplib.h>
 #include "replication.h"
 #include "cache.h"
+#include "memcached_server.h"
+#include "ndjson.h"
 #include <nlohmann/json.hpp>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 using json = nlohmann::json;
 
 // A tiny fake follower server for capturing requests
@@ -14,6 +22,9 @@ public:
         server_.Put("/cache/(.*)", [&](const httplib::Request& req, httplib::Response& res) {
             lastPutKey = req.matches[1];
             lastPutBody = req.body;
+            lastPutContentType = req.get_header_value("Content-Type");
+            lastPutTtl = req.get_param_value("ttl");
+            lastPutFlags = req.get_param_value("flags");
             res.set_content(R"({"status":"ok"})", "application/json");
         });
 
@@ -22,6 +33,14 @@ public:
             res.set_content(R"({"status":"deleted"})", "application/json");
         });
 
+        server_.Post("/cache/(.*)", [&](const httplib::Request& req, httplib::Response& res) {
+            lastPostPath = req.path;
+            lastPostBody = req.body;
+            lastPostContentType = req.get_header_value("Content-Type");
+            postCount++;
+            res.set_content(R"({"status":"ok"})", "application/json");
+        });
+
         thread_ = std::thread([&]() {
             server_.listen("127.0.0.1", port_);
         });
@@ -37,7 +56,14 @@ public:
 
     std::string lastPutKey;
     std::string lastPutBody;
+    std::string lastPutContentType;
+    std::string lastPutTtl;
+    std::string lastPutFlags;
     std::string lastDeleteKey;
+    std::string lastPostPath;
+    std::string lastPostBody;
+    std::string lastPostContentType;
+    int postCount = 0;
 
 private:
     httplib::Server server_;
@@ -61,6 +87,24 @@ TEST(ReplicationTest, ReplicatesPutToFollower) {
     EXPECT_NE(follower.lastPutBody.find("bar"), std::string::npos);
 }
 
+TEST(ReplicationTest, ReplicatesRawPutAsOctetStream) {
+    FakeFollower follower(6004);
+    follower.start();
+
+    ReplicationManager repl;
+    repl.addFollower("http://127.0.0.1:6004");
+
+    const std::string binary("\0\xff\"{", 4);   // Not something JSON could carry
+    repl.replicatePut("bin", binary, 42, true);
+
+    follower.stop();
+
+    EXPECT_EQ(follower.lastPutKey, "bin");
+    EXPECT_EQ(follower.lastPutBody, binary);
+    EXPECT_EQ(follower.lastPutContentType, "application/octet-stream");
+    EXPECT_EQ(follower.lastPutTtl, "42");
+}
+
 TEST(ReplicationTest, ReplicatesDeleteToFollower) {
     FakeFollower follower(6002);
     follower.start();
@@ -76,6 +120,55 @@ TEST(ReplicationTest, ReplicatesDeleteToFollower) {
     EXPECT_EQ(follower.lastDeleteKey, "foo");
 }
 
+TEST(ReplicationTest, ReplicatesBatchesAsOneRequest) {
+    FakeFollower follower(6003);
+    follower.start();
+
+    ReplicationManager repl;
+    repl.addFollower("http://127.0.0.1:6003");
+
+    repl.replicatePutBatch({{"foo", "bar", 42}, {"baz", "qux"}});
+    EXPECT_EQ(follower.postCount, 1);
+    EXPECT_EQ(follower.lastPostPath, "/cache/_mset");
+    auto items = json::parse(follower.lastPostBody)["items"];
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(items[0]["key"], "foo");
+    EXPECT_EQ(items[0]["value"], "bar");
+    EXPECT_EQ(items[0]["ttl"], 42);
+
+    repl.replicateDeleteBatch({"foo", "baz"});
+    follower.stop();
+
+    EXPECT_EQ(follower.postCount, 2);
+    EXPECT_EQ(follower.lastPostPath, "/cache/_mdelete");
+    EXPECT_EQ(json::parse(follower.lastPostBody)["keys"], json({"foo", "baz"}));
+}
+
+TEST(ReplicationTest, ReplicatesRawBatchesAsNdjson) {
+    FakeFollower follower(6005);
+    follower.start();
+
+    ReplicationManager repl;
+    repl.addFollower("http://127.0.0.1:6005");
+
+    const std::string binary("\xff\xfe\n\"", 4);   // Not valid UTF-8
+    EXPECT_NO_THROW(repl.replicatePutBatch({{"bin", binary, 42}, {"txt", "v"}}, true));
+    follower.stop();
+
+    EXPECT_EQ(follower.postCount, 1);
+    EXPECT_EQ(follower.lastPostPath, "/cache/_import");
+    EXPECT_EQ(follower.lastPostContentType, "application/x-ndjson");
+    std::vector<std::string> values;
+    NdjsonImporter importer([&values](const std::vector<CacheItem>& items) {
+        for (const auto& item : items) values.emplace_back(item.value);
+    });
+    importer.feed(follower.lastPostBody);
+    importer.finish();
+    ASSERT_EQ(values.size(), 2);
+    EXPECT_EQ(values[0], binary);
+    EXPECT_EQ(values[1], "v");
+}
+
 TEST(ReplicationTest, HandlesUnreachableFollowerGracefully) {
     // Do not start follower (simulate unreachable node)
     ReplicationManager repl;
@@ -148,3 +241,52 @@ TEST(ReplicationTest, StressReplicationToFollowers) {
     t1.join();
     t2.join();
 }
+
+#ifdef __linux__
+TEST(ReplicationTest, ReplicatesMemcachedWrites) {
+    FakeFollower follower(6005);
+    follower.start();
+
+    ReplicationManager repl;
+    repl.addFollower("http://127.0.0.1:6005");
+    auto cache = std::make_shared<Cache>(100);
+    MemcachedServer server(cache, 1, &repl);
+    server.start("127.0.0.1", 0);
+
+    // One blocking client; a reply only comes once the followers have the write
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(server.port()));
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    auto call = [fd](const std::string& request) {
+        ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        char reply[256];
+        const ssize_t n = ::recv(fd, reply, sizeof(reply), 0);
+        return std::string(reply, n > 0 ? static_cast<size_t>(n) : 0);
+    };
+
+    EXPECT_EQ(call("set counter 9 60 2\r\n10\r\n"), "STORED\r\n");
+    EXPECT_EQ(follower.lastPutKey, "counter");
+    EXPECT_EQ(follower.lastPutBody, "10");
+    EXPECT_EQ(follower.lastPutContentType, "application/octet-stream");
+    EXPECT_EQ(follower.lastPutTtl, "60000");
+    EXPECT_EQ(follower.lastPutFlags, "9");
+
+    // incr goes out as a put of the new value, keeping the TTL the key has left and its flags
+    EXPECT_EQ(call("incr counter 5\r\n"), "15\r\n");
+    EXPECT_EQ(follower.lastPutBody, "15");
+    EXPECT_EQ(follower.lastPutFlags, "9");
+    const uint64_t ttl = std::stoull(follower.lastPutTtl);
+    EXPECT_GT(ttl, 50000u);
+    EXPECT_LE(ttl, 60000u);
+
+    EXPECT_EQ(call("delete counter\r\n"), "DELETED\r\n");
+    EXPECT_EQ(follower.lastDeleteKey, "counter");
+
+    ::close(fd);
+    server.stop();
+    follower.stop();
+}
+#endif
@@ -0,0 +1,50 @@
+#include "router.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(RouterTest, CacheKeys) {
+    for (const char* method : {"GET", "HEAD", "PUT", "DELETE"}) {
+        RouteMatch match = match_route(method, "/cache/user:42/profile.json");
+        EXPECT_EQ(match.route, Route::CacheKey) << method;
+        EXPECT_EQ(match.key, "user:42/profile.json") << method;
+    }
+
+    // Any byte is part of the key
+    const std::string path = std::string("/cache/a\0b\n%?", 13);
+    EXPECT_EQ(match_route("GET", path).key, std::string_view("a\0b\n%?", 6));
+
+    EXPECT_EQ(match_route("GET", "/cache/").route, Route::NotFound);   // Empty key
+    EXPECT_EQ(match_route("GET", "/cache").route, Route::NotFound);
+    EXPECT_EQ(match_route("GET", "/cachex/a").route, Route::NotFound);
+    EXPECT_EQ(match_route("PATCH", "/cache/a").route, Route::NotFound);
+}
+
+TEST(RouterTest, FixedRoutes) {
+    EXPECT_EQ(match_route("POST", "/cache/_mget").route, Route::MultiGet);
+    EXPECT_EQ(match_route("POST", "/cache/_mset").route, Route::MultiSet);
+    EXPECT_EQ(match_route("POST", "/cache/_mdelete").route, Route::MultiDelete);
+    EXPECT_EQ(match_route("POST", "/cache/_import").route, Route::Import);
+    EXPECT_EQ(match_route("GET", "/cache/_export").route, Route::Export);
+    EXPECT_EQ(match_route("HEAD", "/cache/_export").route, Route::Export);
+    EXPECT_EQ(match_route("POST", "/cache/other").route, Route::NotFound);
+    EXPECT_EQ(match_route("GET", "/metrics").route, Route::Metrics);
+    EXPECT_EQ(match_route("HEAD", "/healthz").route, Route::Health);
+    EXPECT_EQ(match_route("GET", "/debug/hot_keys").route, Route::HotKeys);
+    EXPECT_EQ(match_route("POST", "/metrics").route, Route::NotFound);
+    EXPECT_EQ(match_route("GET", "/metrics/").route, Route::NotFound);
+
+    // The batch names are plain keys for other methods
+    RouteMatch match = match_route("GET", "/cache/_mget");
+    EXPECT_EQ(match.route, Route::CacheKey);
+    EXPECT_EQ(match.key, "_mget");
+    match = match_route("PUT", "/cache/_export");   // Only reads are shadowed
+    EXPECT_EQ(match.route, Route::CacheKey);
+    EXPECT_EQ(match.key, "_export");
+}
+
+TEST(RouterTest, EncodeKey) {
+    EXPECT_EQ(encode_key("Az09-._~"), "Az09-._~");
+    EXPECT_EQ(encode_key("user:42/a b"), "user%3A42%2Fa%20b");
+    EXPECT_EQ(encode_key(std::string("%\0\xff", 3)), "%25%00%FF");
+    EXPECT_EQ(encode_key(""), "");
+}
@@ -0,0 +1,235 @@
+#include "cache.h"
+#include "single_flight.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+CacheOptions load_options() {
+    CacheOptions options;
+    options.capacity = 100;
+    options.shard_count = 4;
+    options.eviction_interval_ms = 10;
+    return options;
+}
+
+// Waits until a call for some key is running
+template <typename T>
+void wait_for_flight(const SingleFlight<T>& flights) {
+    while (flights.in_flight() == 0) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+}
+
+//-------------------SingleFlight Tests-------------------
+
+TEST(SingleFlightTest, ConcurrentCallsShareOneRun) {
+    SingleFlight<int> flights;
+    std::atomic<int> runs{0};
+    std::atomic<bool> release{false};
+    auto slow = [&] {
+        runs.fetch_add(1);
+        while (!release.load()) std::this_thread::sleep_for(1ms);
+        return 42;
+    };
+
+    bool leader_joined = true;
+    std::thread leader([&] { EXPECT_EQ(flights.run("Key", slow, &leader_joined), 42); });
+    wait_for_flight(flights);
+
+    std::atomic<int> joined{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 6; ++i) {
+        waiters.emplace_back([&] {
+            bool j = false;
+            EXPECT_EQ(flights.run("Key", slow, &j), 42);
+            if (j) joined.fetch_add(1);
+        });
+    }
+    EXPECT_FALSE(flights.try_run("Key", slow).has_value());   // Busy: does not wait
+    EXPECT_EQ(flights.run("Other", [] { return 7; }), 7);     // Other keys are not held up
+
+    std::this_thread::sleep_for(20ms);
+    release.store(true);
+    leader.join();
+    for (auto& w : waiters) w.join();
+
+    EXPECT_EQ(runs.load(), 1);
+    EXPECT_FALSE(leader_joined);
+    EXPECT_EQ(joined.load(), 6);
+    EXPECT_EQ(flights.in_flight(), 0);
+}
+
+TEST(SingleFlightTest, ExceptionsReachEveryWaiter) {
+    SingleFlight<int> flights;
+    std::atomic<bool> release{false};
+    auto failing = [&]() -> int {
+        while (!release.load()) std::this_thread::sleep_for(1ms);
+        throw std::runtime_error("origin down");
+    };
+
+    std::thread leader([&] { EXPECT_THROW(flights.run("Key", failing), std::runtime_error); });
+    wait_for_flight(flights);
+    std::thread waiter([&] { EXPECT_THROW(flights.run("Key", failing), std::runtime_error); });
+    std::this_thread::sleep_for(20ms);
+    release.store(true);
+    leader.join();
+    waiter.join();
+
+    // A failure is not remembered: the next call runs again
+    EXPECT_EQ(flights.run("Key", [] { return 1; }), 1);
+    EXPECT_EQ(flights.in_flight(), 0);
+}
+
+//-------------------get_or_load Tests-------------------
+
+TEST(GetOrLoadTest, LoadsOnceThenHits) {
+    Cache cache(load_options());
+    int calls = 0;
+    auto loader = [&calls](std::string_view key) -> std::optional<std::string> {
+        ++calls;
+        return "Loaded:" + std::string(key);
+    };
+
+    EXPECT_EQ(cache.get_or_load("A", loader, 60000)->view(), "Loaded:A");
+    EXPECT_EQ(cache.get_or_load("A", loader, 60000)->view(), "Loaded:A");
+    EXPECT_EQ(cache.get("A").value(), "Loaded:A");
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(cache.loads(), 1);
+
+    // Values stored by put() are served as they are and never refreshed early
+    cache.put("B", "Put", 60000);
+    EXPECT_EQ(cache.get_or_load("B", loader, 60000)->view(), "Put");
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(cache.early_refreshes(), 0);
+}
+
+TEST(GetOrLoadTest, ConcurrentMissesShareOneLoad) {
+    Cache cache(load_options());
+    std::atomic<int> calls{0};
+    auto loader = [&calls](std::string_view) -> std::optional<std::string> {
+        calls.fetch_add(1);
+        std::this_thread::sleep_for(100ms);   // A slow database
+        return std::string("Value");
+    };
+
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 8; ++i) {
+        clients.emplace_back([&] {
+            auto value = cache.get_or_load("Popular", loader, 60000);
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(value->view(), "Value");
+        });
+    }
+    for (auto& c : clients) c.join();
+
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(cache.loads(), 1);
+    EXPECT_GE(cache.coalesced_loads(), 1);
+}
+
+TEST(GetOrLoadTest, AbsentKeysAreNotCached) {
+    Cache cache(load_options());
+    int calls = 0;
+    auto loader = [&calls](std::string_view) -> std::optional<std::string> {
+        ++calls;
+        return std::nullopt;
+    };
+    EXPECT_FALSE(cache.get_or_load("Missing", loader).has_value());
+    EXPECT_FALSE(cache.get_or_load("Missing", loader).has_value());
+    EXPECT_EQ(calls, 2);
+    EXPECT_FALSE(cache.contains("Missing"));
+}
+
+TEST(GetOrLoadTest, LoaderErrorsReachTheCaller) {
+    Cache cache(load_options());
+    auto failing = [](std::string_view) -> std::optional<std::string> { throw std::runtime_error("origin down"); };
+    EXPECT_THROW(cache.get_or_load("Key", failing), std::runtime_error);
+    EXPECT_FALSE(cache.contains("Key"));
+
+    auto working = [](std::string_view) -> std::optional<std::string> { return std::string("Back"); };
+    EXPECT_EQ(cache.get_or_load("Key", working)->view(), "Back");
+}
+
+TEST(GetOrLoadTest, WritesDuringALoadWin) {
+    Cache cache(load_options());
+    // A loader that reports it started, then waits to be released
+    struct Gate {
+        std::promise<void> started;
+        std::promise<void> release;
+    };
+    auto gated = [](Gate& gate, std::optional<std::string> result) {
+        return [&gate, result](std::string_view) {
+            gate.started.set_value();
+            gate.release.get_future().wait();
+            return result;
+        };
+    };
+
+    // A put made while the loader runs is not overwritten by the older loaded value
+    Gate put_gate;
+    auto loading = std::async(std::launch::async, [&] {
+        return cache.get_or_load("Key", gated(put_gate, std::string("Stale")), 60000);
+    });
+    put_gate.started.get_future().wait();
+    cache.put("Key", "Fresh");
+    put_gate.release.set_value();
+    EXPECT_EQ(loading.get()->view(), "Stale");   // The caller still gets what the loader saw
+    EXPECT_EQ(cache.get("Key").value(), "Fresh");
+
+    // Nor erased by a loader that found nothing
+    cache.erase("Key");
+    Gate absent_gate;
+    loading = std::async(std::launch::async, [&] {
+        return cache.get_or_load("Key", gated(absent_gate, std::nullopt), 60000);
+    });
+    absent_gate.started.get_future().wait();
+    cache.put("Key", "Fresh");
+    absent_gate.release.set_value();
+    EXPECT_FALSE(loading.get().has_value());
+    EXPECT_EQ(cache.get("Key").value(), "Fresh");
+
+    // An erase made while the loader runs is not undone either
+    cache.erase("Key");
+    Gate erase_gate;
+    loading = std::async(std::launch::async, [&] {
+        return cache.get_or_load("Key", gated(erase_gate, std::string("Stale")), 60000);
+    });
+    erase_gate.started.get_future().wait();
+    cache.erase("Key");
+    erase_gate.release.set_value();
+    EXPECT_EQ(loading.get()->view(), "Stale");
+    EXPECT_FALSE(cache.contains("Key"));
+
+    // Without a concurrent write the loaded value is stored as before
+    auto plain = [](std::string_view) -> std::optional<std::string> { return std::string("Loaded"); };
+    EXPECT_EQ(cache.get_or_load("Key", plain, 60000)->view(), "Loaded");
+    EXPECT_EQ(cache.get("Key").value(), "Loaded");
+}
+
+TEST(GetOrLoadTest, RefreshesBeforeExpiry) {
+    Cache cache(load_options());
+    std::atomic<int> calls{0};
+    auto loader = [&calls](std::string_view) -> std::optional<std::string> {
+        std::this_thread::sleep_for(20ms);
+        return "Version" + std::to_string(calls.fetch_add(1));
+    };
+
+    // Read across several TTLs: each expiry is preceded by a refresh, so only the first read misses
+    const auto end = std::chrono::steady_clock::now() + 600ms;
+    while (std::chrono::steady_clock::now() < end) {
+        ASSERT_TRUE(cache.get_or_load("Key", loader, 100).has_value());
+        std::this_thread::sleep_for(2ms);
+    }
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_GE(cache.early_refreshes(), 3);
+    EXPECT_EQ(cache.loads(), cache.early_refreshes() + 1);
+}
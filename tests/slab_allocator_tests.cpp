@@ -0,0 +1,170 @@
+#include "slab_allocator.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+TEST(SlabAllocatorTest, RoundsUpToSizeClass) {
+    SlabAllocator slab;
+    EXPECT_EQ(slab.chunk_size(0), 0);
+    EXPECT_EQ(slab.chunk_size(1), SlabAllocator::kMinChunkSize);
+    EXPECT_EQ(slab.chunk_size(SlabAllocator::kMinChunkSize), SlabAllocator::kMinChunkSize);
+    EXPECT_GT(slab.chunk_size(SlabAllocator::kMinChunkSize + 1), SlabAllocator::kMinChunkSize);
+
+    // Chunk never smaller than requested, waste bounded by the growth factor
+    for (size_t size : {100u, 1000u, 10000u, 100000u}) {
+        size_t chunk = slab.chunk_size(size);
+        EXPECT_GE(chunk, size);
+        EXPECT_LE(static_cast<double>(chunk), size * SlabAllocator::kGrowthFactor + 8);
+    }
+}
+
+TEST(SlabAllocatorTest, ReusesFreedChunks) {
+    SlabAllocator slab;
+    char* a = slab.allocate(100);
+    std::memset(a, 'x', 100);
+    slab.deallocate(a, 100);
+
+    char* b = slab.allocate(90); // Same class as 100
+    EXPECT_EQ(a, b);
+    slab.deallocate(b, 90);
+}
+
+TEST(SlabAllocatorTest, TracksUsagePerClass) {
+    SlabAllocator slab;
+    std::vector<char*> chunks;
+    for (int i = 0; i < 10; i++) {
+        chunks.push_back(slab.allocate(64));
+    }
+
+    auto stats = slab.stats();
+    ASSERT_FALSE(stats.empty());
+    EXPECT_EQ(stats[0].chunk_size, 64);
+    EXPECT_EQ(stats[0].chunks_used, 10);
+    EXPECT_EQ(stats[0].bytes_used, 640);
+    EXPECT_EQ(stats[0].pages, 1);
+
+    for (char* c : chunks) {
+        slab.deallocate(c, 64);
+    }
+    EXPECT_EQ(slab.stats()[0].chunks_used, 0);
+    EXPECT_EQ(slab.stats()[0].pages, 1); // One empty page is kept as a spare
+}
+
+TEST(SlabAllocatorTest, LargeAllocationsBypassSlabs) {
+    SlabAllocator slab(4096);
+    char* big = slab.allocate(10000);
+    ASSERT_NE(big, nullptr);
+    std::memset(big, 'y', 10000);
+    EXPECT_EQ(slab.chunk_size(10000), 10000);
+
+    auto stats = slab.stats();
+    EXPECT_EQ(stats.back().chunk_size, 0); // Large class
+    EXPECT_EQ(stats.back().chunks_used, 1);
+    EXPECT_EQ(stats.back().bytes_used, 10000);
+
+    slab.deallocate(big, 10000);
+    EXPECT_EQ(slab.stats().back().chunks_used, 0);
+}
+
+TEST(SlabAllocatorTest, FillsMultiplePages) {
+    SlabAllocator slab(4096);
+    std::vector<char*> chunks;
+    for (int i = 0; i < 200; i++) {
+        char* c = slab.allocate(64);
+        std::memset(c, i & 0xFF, 64);
+        chunks.push_back(c);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 200 * 64 / 4096 + 1);
+    EXPECT_EQ(slab.reserved_bytes(), slab.stats()[0].pages * 4096);
+    for (char* c : chunks) {
+        slab.deallocate(c, 64);
+    }
+}
+
+TEST(SlabAllocatorTest, ReleasesEmptyPagesButOneSpare) {
+    SlabAllocator slab(4096);
+    std::vector<char*> chunks;
+    for (int i = 0; i < 640; i++) {
+        chunks.push_back(slab.allocate(64));
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 10);
+
+    // A workload that moves to another size class hands the old pages back
+    for (char* c : chunks) {
+        slab.deallocate(c, 64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 1);
+    EXPECT_EQ(slab.reserved_bytes(), 4096);
+
+    // Churn at a page boundary reuses the spare instead of reaching malloc
+    std::vector<char*> full;
+    for (int i = 0; i < 64; i++) {
+        full.push_back(slab.allocate(64));
+    }
+    for (int i = 0; i < 100; i++) {
+        char* c = slab.allocate(64);
+        slab.deallocate(c, 64);
+        EXPECT_EQ(slab.stats()[0].pages, 2);
+    }
+    for (char* c : full) {
+        slab.deallocate(c, 64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 1);
+}
+
+TEST(SlabAllocatorTest, ReleasesPageOnceItsLastChunkReturns) {
+    SlabAllocator slab(4096);
+    std::vector<char*> chunks;
+    for (int i = 0; i < 3 * 64; i++) {
+        chunks.push_back(slab.allocate(64));
+    }
+    ASSERT_EQ(slab.stats()[0].pages, 3);
+
+    // Empty the first page and half the second: only the first can go, and
+    // being the only empty page it stays as the spare
+    for (int i = 0; i < 96; i++) {
+        slab.deallocate(chunks[i], 64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 3);
+    // Emptying the second page releases it; the first remains the spare
+    for (int i = 96; i < 128; i++) {
+        slab.deallocate(chunks[i], 64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 2);
+    EXPECT_EQ(slab.stats()[0].chunks_used, 64);
+
+    // Refilling takes the spare instead of a new page
+    for (int i = 0; i < 64; i++) {
+        chunks[i] = slab.allocate(64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 2);
+    for (int i = 0; i < 64; i++) {
+        slab.deallocate(chunks[i], 64);
+    }
+    for (int i = 128; i < 192; i++) {
+        slab.deallocate(chunks[i], 64);
+    }
+    EXPECT_EQ(slab.stats()[0].pages, 1);
+    EXPECT_EQ(slab.stats()[0].chunks_used, 0);
+}
+
+TEST(SlabAllocatorTest, PageSizeFollowsTheBudget) {
+    EXPECT_EQ(SlabAllocator::page_size_for(0), SlabAllocator::kMinPageSize);
+    EXPECT_EQ(SlabAllocator::page_size_for(size_t{1} << 40), SlabAllocator::kDefaultPageSize);
+
+    size_t previous = 0;
+    for (size_t budget = 1 << 20; budget <= (size_t{1} << 32); budget *= 4) {
+        size_t page_size = SlabAllocator::page_size_for(budget);
+        EXPECT_GE(page_size, previous);
+        previous = page_size;
+
+        // One partly used page and one spare per class fit an eighth of the budget
+        SlabAllocator slab(page_size);
+        size_t classes = slab.stats().size() - 1;
+        if (page_size > SlabAllocator::kMinPageSize) {
+            EXPECT_LE(2 * classes * page_size, budget / 8);
+        }
+        // The largest class still packs several chunks into a page
+        EXPECT_EQ(slab.stats()[classes - 1].chunk_size, page_size / SlabAllocator::kChunksPerPage);
+    }
+}
@@ -0,0 +1,97 @@
+#include "snapshot.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Snapshot file in the test's working directory, removed at the end
+class SnapshotTest : public ::testing::Test {
+protected:
+    void TearDown() override { std::remove(path.c_str()); }
+
+    std::string path = ::testing::UnitTest::GetInstance()->current_test_info()->name() + std::string(".snap");
+};
+
+TEST_F(SnapshotTest, RoundTripsKeysValuesAndTtl) {
+    Cache source(100, 100, 4);
+    source.put("A", "Apple");
+    source.put("B", std::string("bin\0ary", 7));
+    source.put("Empty", "");
+    source.put("Ttl", "Timed", 60000);
+    EXPECT_EQ(save_snapshot(source, path), 4);
+
+    Cache target(100);
+    SnapshotLoadResult result = load_snapshot(target, path);
+    EXPECT_EQ(result.loaded, 4);
+    EXPECT_EQ(result.expired, 0);
+    EXPECT_EQ(target.get("A").value(), "Apple");
+    EXPECT_EQ(target.get("B").value(), std::string("bin\0ary", 7));
+    EXPECT_EQ(target.get("Empty").value(), "");
+    EXPECT_EQ(target.get("Ttl").value(), "Timed");
+}
+
+TEST_F(SnapshotTest, RestoresRecencyOrder) {
+    Cache source(3);
+    source.put("A", "1");
+    source.put("B", "2");
+    source.put("C", "3");
+    source.get("A"); // A is now the most recently used, B the least
+    save_snapshot(source, path);
+
+    Cache target(3);
+    load_snapshot(target, path);
+    EXPECT_EQ(target.keys(), (std::vector<std::string>{"A", "C", "B"}));
+    target.put("D", "4");
+    EXPECT_FALSE(target.contains("B"));
+}
+
+TEST_F(SnapshotTest, SkipsEntriesThatExpired) {
+    Cache source(10);
+    source.put("Short", "gone", 30);
+    source.put("Long", "kept", 60000);
+    source.put("Forever", "kept");
+    save_snapshot(source, path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60)); // Short runs out while "down"
+
+    Cache target(10);
+    SnapshotLoadResult result = load_snapshot(target, path);
+    EXPECT_EQ(result.loaded, 2);
+    EXPECT_EQ(result.expired, 1);
+    EXPECT_FALSE(target.contains("Short"));
+    EXPECT_TRUE(target.contains("Long"));
+}
+
+TEST_F(SnapshotTest, RejectsDamagedFiles) {
+    Cache cache(10);
+    EXPECT_THROW(load_snapshot(cache, "missing.snap"), std::runtime_error);
+
+    std::ofstream(path, std::ios::binary) << "not a snapshot at all, just text";
+    EXPECT_THROW(load_snapshot(cache, path), std::runtime_error);
+
+    Cache source(10);
+    source.put("A", "Apple");
+    save_snapshot(source, path);
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() - 2);
+    EXPECT_THROW(load_snapshot(cache, path), std::runtime_error);
+}
+
+TEST_F(SnapshotTest, SchedulerSavesPeriodically) {
+    auto cache = std::make_shared<Cache>(10);
+    cache->put("A", "Apple");
+    {
+        SnapshotScheduler scheduler(cache, path, 20);
+        scheduler.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    } // Destructor stops the thread
+
+    Cache target(10);
+    EXPECT_EQ(load_snapshot(target, path).loaded, 1);
+    EXPECT_EQ(target.get("A").value(), "Apple");
+}
@@ -0,0 +1,153 @@
+#include "swiss_index.h"
+#include <gtest/gtest.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Node {
+    std::string key;
+    size_t hash;
+
+    explicit Node(std::string k) : key(std::move(k)), hash(std::hash<std::string>{}(key)) {}
+    Node(std::string k, size_t h) : key(std::move(k)), hash(h) {}
+};
+
+using Index = SwissIndex<Node, &Node::hash>;
+
+Node* find(const Index& index, const std::string& key, size_t hash) {
+    return index.find(hash, [&key](const Node* n) { return n->key == key; });
+}
+
+Node* find(const Index& index, const std::string& key) {
+    return find(index, key, std::hash<std::string>{}(key));
+}
+
+} // namespace
+
+TEST(SwissIndexTest, InsertFindErase) {
+    Index index;
+    Node a("alpha"), b("beta");
+    index.insert(&a);
+    index.insert(&b);
+
+    EXPECT_EQ(index.size(), 2);
+    EXPECT_EQ(find(index, "alpha"), &a);
+    EXPECT_EQ(find(index, "beta"), &b);
+    EXPECT_EQ(find(index, "gamma"), nullptr);
+
+    EXPECT_TRUE(index.erase(&a));
+    EXPECT_FALSE(index.erase(&a));
+    EXPECT_EQ(find(index, "alpha"), nullptr);
+    EXPECT_EQ(find(index, "beta"), &b);
+    EXPECT_EQ(index.size(), 1);
+}
+
+TEST(SwissIndexTest, GrowsAndKeepsEveryNode) {
+    Index index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 10000; i++) {
+        nodes.push_back(std::make_unique<Node>("Key" + std::to_string(i)));
+        index.insert(nodes.back().get());
+    }
+    EXPECT_EQ(index.size(), 10000);
+    EXPECT_GE(index.capacity(), 10000);
+    EXPECT_EQ(index.capacity() & (index.capacity() - 1), 0); // Power of two
+    for (const auto& node : nodes) {
+        EXPECT_EQ(find(index, node->key), node.get());
+    }
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_EQ(index.capacity(), Index::kGroupSize);
+    EXPECT_EQ(find(index, "Key1"), nullptr);
+}
+
+TEST(SwissIndexTest, FullHashCollisionsProbePastFullGroups) {
+    // Same hash for all: every node lands on the same probe sequence
+    Index index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 100; i++) {
+        nodes.push_back(std::make_unique<Node>("Key" + std::to_string(i), 42));
+        index.insert(nodes.back().get());
+    }
+    for (int i = 0; i < 100; i += 2) {
+        EXPECT_TRUE(index.erase(nodes[i].get()));
+    }
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(find(index, nodes[i]->key, 42), i % 2 ? nodes[i].get() : nullptr);
+    }
+}
+
+TEST(SwissIndexTest, ChurnReusesTombstones) {
+    Index index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 1000; i++) {
+        nodes.push_back(std::make_unique<Node>("Key" + std::to_string(i)));
+    }
+    // Steady size of 100 with constant replacement must not keep growing the table
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 100; i++) index.insert(nodes[(round * 100 + i) % 1000].get());
+        for (int i = 0; i < 100; i++) index.erase(nodes[(round * 100 + i) % 1000].get());
+    }
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_LE(index.capacity(), 256);
+}
+
+TEST(SwissIndexTest, MatchesUnorderedMapUnderRandomOperations) {
+    Index index;
+    std::unordered_map<std::string, std::unique_ptr<Node>> reference;
+    std::mt19937 rng(7);
+    for (int op = 0; op < 50000; op++) {
+        std::string key = "Key" + std::to_string(rng() % 2000);
+        auto it = reference.find(key);
+        if (rng() % 3 == 0) {
+            if (it != reference.end()) {
+                EXPECT_TRUE(index.erase(it->second.get()));
+                reference.erase(it);
+            }
+        } else if (it == reference.end()) {
+            auto node = std::make_unique<Node>(key);
+            index.insert(node.get());
+            reference.emplace(key, std::move(node));
+        }
+        Node* found = find(index, key);
+        auto ref = reference.find(key);
+        EXPECT_EQ(found, ref == reference.end() ? nullptr : ref->second.get());
+    }
+    EXPECT_EQ(index.size(), reference.size());
+}
+
+TEST(SwissIndexTest, ScanSeesEachNodeOnceWhileTheIndexChanges) {
+    Index index;
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 200; i++) {
+        nodes.push_back(std::make_unique<Node>("Key" + std::to_string(i)));
+        index.insert(nodes.back().get());
+    }
+    std::map<const Node*, int> seen;
+    size_t cursor = 0;
+    int added = 0;
+    do {
+        cursor = index.scan(cursor, 1, [&seen](const Node* n) { ++seen[n]; });
+        // Grow the table, and erase what was added so tombstones trigger cleanups too
+        for (int j = 0; j < 8; j++, added++) {
+            nodes.push_back(std::make_unique<Node>("New" + std::to_string(added)));
+            index.insert(nodes.back().get());
+            if (added % 3 == 0) index.erase(nodes.back().get());
+        }
+    } while (cursor != 0);
+
+    EXPECT_GE(index.capacity(), 512u);   // Grew from 256 mid-scan
+    for (int i = 0; i < 200; i++) {
+        EXPECT_EQ(seen[nodes[i].get()], 1) << "Key" << i;
+    }
+    for (const auto& [node, count] : seen) {
+        EXPECT_EQ(count, 1) << node->key;
+    }
+}
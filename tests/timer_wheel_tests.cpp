@@ -0,0 +1,97 @@
+#include "timer_wheel.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+struct Node {
+    Node(int node_id) : id(node_id) {}
+
+    int id;
+    TimerHook<Node> timer;
+};
+
+using Wheel = TimerWheel<Node, &Node::timer>;
+
+std::vector<int> drain(Wheel& wheel) {
+    std::vector<int> ids;
+    while (Node* n = wheel.pop_due()) {
+        ids.push_back(n->id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+} // namespace
+
+TEST(TimerWheelTest, NodeBecomesDueAtItsTick) {
+    Wheel wheel;
+    Node a{1};
+    wheel.schedule(&a, 10);
+    EXPECT_TRUE(Wheel::scheduled(&a));
+
+    wheel.advance(9);
+    EXPECT_FALSE(wheel.has_due());
+
+    wheel.advance(10);
+    EXPECT_EQ(drain(wheel), std::vector<int>{1});
+    EXPECT_FALSE(Wheel::scheduled(&a));
+    EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, PastTickIsImmediatelyDue) {
+    Wheel wheel;
+    wheel.advance(100);
+    Node a{1};
+    wheel.schedule(&a, 50);
+    EXPECT_TRUE(wheel.has_due());
+    EXPECT_EQ(drain(wheel), std::vector<int>{1});
+}
+
+TEST(TimerWheelTest, CascadesFromHigherLevels) {
+    Wheel wheel;
+    // One node per level: 64, 64^2 and 64^3 ticks away, plus one beyond the wheel span
+    std::vector<Node> nodes{{1}, {2}, {3}, {4}};
+    std::vector<uint64_t> ticks{70, 5000, 300000, Wheel::kMaxDelta + 1000};
+    for (size_t i = 0; i < nodes.size(); i++) {
+        wheel.schedule(&nodes[i], ticks[i]);
+    }
+    EXPECT_EQ(wheel.size(), 4);
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        wheel.advance(ticks[i] - 1);
+        EXPECT_FALSE(wheel.has_due()) << "node " << nodes[i].id << " fired early";
+        wheel.advance(ticks[i]);
+        EXPECT_EQ(drain(wheel), std::vector<int>{nodes[i].id});
+    }
+    EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, CancelUnlinksFromAnySlot) {
+    Wheel wheel;
+    Node a{1}, b{2}, c{3};
+    wheel.schedule(&a, 5);
+    wheel.schedule(&b, 5);
+    wheel.schedule(&c, 5000);
+
+    wheel.cancel(&a);
+    wheel.cancel(&c);
+    wheel.cancel(&c); // Cancelling twice is harmless
+    EXPECT_EQ(wheel.size(), 1);
+
+    wheel.advance(6000);
+    EXPECT_EQ(drain(wheel), std::vector<int>{2});
+}
+
+TEST(TimerWheelTest, CancelFromDueList) {
+    Wheel wheel;
+    Node a{1}, b{2};
+    wheel.schedule(&a, 3);
+    wheel.schedule(&b, 3);
+    wheel.advance(3);
+    ASSERT_TRUE(wheel.has_due());
+
+    wheel.cancel(&a);
+    EXPECT_EQ(drain(wheel), std::vector<int>{2});
+}
@@ -0,0 +1,79 @@
+#include "value_ref.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ValueArenaTest, StoresAnImmutableCopy) {
+    ValueArena* arena = ValueArena::create();
+    std::string source = "hello";
+    ValueRef ref = arena->store(source);
+    source[0] = 'j';
+
+    EXPECT_EQ(ref.view(), "hello");
+    EXPECT_EQ(ref.size(), 5);
+    EXPECT_EQ(ref.use_count(), 1);
+
+    ValueRef copy = ref;
+    EXPECT_EQ(copy.data(), ref.data());
+    EXPECT_EQ(ref.use_count(), 2);
+
+    ValueRef moved = std::move(copy);
+    EXPECT_EQ(ref.use_count(), 2);
+    EXPECT_EQ(copy.use_count(), 0);
+    arena->release_owner();
+}
+
+TEST(ValueArenaTest, EmptyValueHasNoBlock) {
+    ValueArena* arena = ValueArena::create();
+    ValueRef ref = arena->store("");
+    EXPECT_TRUE(ref.empty());
+    EXPECT_EQ(ref.view(), "");
+    EXPECT_EQ(ref.use_count(), 0);
+    EXPECT_EQ(arena->chunk_size(0), 0);
+    arena->release_owner();
+}
+
+TEST(ValueArenaTest, ChunksReturnWhenLastHandleDrops) {
+    ValueArena* arena = ValueArena::create();
+    {
+        ValueRef a = arena->store(std::string(100, 'a'));
+        ValueRef b = a;
+        EXPECT_EQ(arena->stats().back().chunks_used, 0); // Not a large value
+        size_t used = 0;
+        for (const auto& cls : arena->stats()) used += cls.chunks_used;
+        EXPECT_EQ(used, 1);
+    }
+    size_t used = 0;
+    for (const auto& cls : arena->stats()) used += cls.chunks_used;
+    EXPECT_EQ(used, 0);
+    arena->release_owner();
+}
+
+TEST(ValueArenaTest, BlocksOutliveTheOwner) {
+    ValueArena* arena = ValueArena::create();
+    ValueRef ref = arena->store("still here");
+    arena->release_owner(); // Arena is freed together with the last block
+    EXPECT_EQ(ref.view(), "still here");
+}
+
+TEST(ValueArenaTest, HandlesReleasedFromManyThreads) {
+    ValueArena* arena = ValueArena::create();
+    std::vector<ValueRef> values;
+    for (int i = 0; i < 100; i++) {
+        values.push_back(arena->store(std::string(200, static_cast<char>('a' + i % 26))));
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([values]() mutable {
+            for (int round = 0; round < 100; round++) {
+                std::vector<ValueRef> copies = values;
+            }
+            values.clear();
+        });
+    }
+    values.clear();
+    arena->release_owner();
+    for (auto& th : threads) th.join();
+}
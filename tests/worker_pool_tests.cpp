@@ -0,0 +1,64 @@
+#include "worker_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(WorkerPoolTest, RunsEveryTaskBeforeShutdownReturns) {
+    std::atomic<int> ran{0};
+    WorkerPool pool(4, 0);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(pool.submit([&ran] { ran.fetch_add(1); }));
+    }
+    pool.shutdown();
+    EXPECT_EQ(ran.load(), 1000);
+    EXPECT_FALSE(pool.submit([] {}));   // Shut down for good
+    pool.shutdown();                     // Idempotent
+}
+
+TEST(WorkerPoolTest, RefusesTasksOnceTheQueueIsFull) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> started;
+
+    WorkerPool pool(1, 2);
+    ASSERT_TRUE(pool.submit([&started, released] {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();   // The only worker is busy
+
+    EXPECT_TRUE(pool.submit([] {}));
+    EXPECT_TRUE(pool.submit([] {}));
+    EXPECT_EQ(pool.queued(), 2u);
+    EXPECT_FALSE(pool.submit([] {}));
+
+    release.set_value();
+    pool.shutdown();
+    EXPECT_EQ(pool.queued(), 0u);
+}
+
+TEST(WorkerPoolTest, ReportsQueueWaitOncePerTask) {
+    Histogram wait(Histogram::latency_bounds());
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<WorkerPool::Clock::duration> first, second;
+
+    WorkerPool pool(1, 0, &wait);
+    ASSERT_TRUE(pool.submit([released] { released.wait(); }));
+    ASSERT_TRUE(pool.submit([&first, &second] {
+        first.set_value(WorkerPool::take_queue_wait());
+        second.set_value(WorkerPool::take_queue_wait());
+    }));
+    std::this_thread::sleep_for(50ms);
+    release.set_value();
+
+    EXPECT_GE(first.get_future().get(), 50ms);
+    EXPECT_EQ(second.get_future().get(), WorkerPool::Clock::duration{0});
+    pool.shutdown();
+    EXPECT_EQ(wait.snapshot().count, 2u);
+    EXPECT_EQ(WorkerPool::take_queue_wait(), WorkerPool::Clock::duration{0});   // Not a pool thread
+}